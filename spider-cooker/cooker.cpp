@@ -0,0 +1,3107 @@
+#include <map>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <deque>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <random>
+#include <cmath>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <iostream>
+#include <optional>
+#include <string_view>
+#include <filesystem>
+#include <algorithm>
+
+#include "asset_cooker.hpp"
+#include "camera.hpp"
+#include "frustum_culling.hpp"
+#include "scene_hierarchy.hpp"
+#include "occlusion_culling.hpp"
+#include "mesh_simplifier.hpp"
+#include "mesh_optimizer.hpp"
+#include "vertex_compression.hpp"
+#include "meshlet_builder.hpp"
+#include "mesh_importer.hpp"
+#include "spmesh_format.hpp"
+#include "texture_residency.hpp"
+#include "dynamic_aabb_tree.hpp"
+#include "mip_generator.hpp"
+#include "texture_atlas.hpp"
+#include "asset_cache.hpp"
+#include "render_graph.hpp"
+#include "resource_state_tracker.hpp"
+#include "frame_profiler.hpp"
+#include "engine_stats.hpp"
+#include "tlsf_allocator.hpp"
+#include "offset_allocator.hpp"
+#include "logger.hpp"
+#include "input.hpp"
+
+using namespace spider_engine;
+
+// Headless asset cooker: spider-cooker <source folder> <output folder> [options]
+static void printUsage() {
+	std::cout <<
+		"Usage: spider-cooker <source folder> <output folder> [options]\n"
+		"       spider-cooker --bench-hierarchy [nodes]\n"
+		"       spider-cooker --bench-cull [bounds]\n"
+		"       spider-cooker --bench-tree [proxies]\n"
+		"       spider-cooker --bench-occlusion [props]\n"
+		"       spider-cooker --bench-lod [triangles]\n"
+		"       spider-cooker --bench-meshopt [model]\n"
+		"       spider-cooker --bench-meshlets [model]\n"
+		"       spider-cooker --bench-packing [vertices]\n"
+		"       spider-cooker --bench-spmesh [model]\n"
+		"       spider-cooker --bench-residency [textures]\n"
+		"       spider-cooker --bench-mips [size]\n"
+		"       spider-cooker --bench-atlas [textures]\n"
+		"       spider-cooker --bench-cache [assets]\n"
+		"       spider-cooker --bench-alloc [operations]\n"
+		"       spider-cooker --bench-graph [passes]\n"
+		"       spider-cooker --bench-barriers [resources]\n"
+		"       spider-cooker --bench-profiler [threads]\n"
+		"       spider-cooker --bench-stats [samples]\n"
+		"       spider-cooker --bench-log [threads]\n"
+		"       spider-cooker --bench-input [events]\n"
+		"  --packed            Bake meshes with the packed vertex format\n"
+		"  --lods <n>          Levels of detail per mesh (default 4)\n"
+		"  --threads <n>       Worker threads (default: every hardware thread)\n"
+		"  --bc <format>       Texture compression: auto, none, bc1, bc3, bc4, bc5, bc7 (default auto)\n"
+		"  --hq                Slower, higher quality texture compression (auto picks BC7 for color)\n"
+		"  --force             Ignore the cache and cook everything\n"
+		"  --top <n>           Slowest assets listed in the report (default 10)\n"
+		"  --bench-hierarchy   Check that only dirty subtrees are recomputed and time hierarchy updates (default 100000 nodes)\n"
+		"  --bench-cull        Check the SIMD frustum culler and time it against the scalar test (default 1000000 bounds)\n"
+		"  --bench-tree        Check the dynamic AABB tree queries and time them with per-frame updates (default 100000 proxies)\n"
+		"  --bench-occlusion   Check the occlusion culler on a synthetic scene and time whole frames (default 10000 props)\n"
+		"  --bench-lod         Check the LOD chain of a torus and the hysteresis of level selection, and time both (default 200000 triangles)\n"
+		"  --bench-meshopt     Check mesh optimization and report cache and overdraw figures (default generated nested spheres)\n"
+		"  --bench-meshlets    Check meshlet building and time it and the frustum-only meshlet culler (default generated nested spheres)\n"
+		"  --bench-packing     Check the packed vertex round trip against its error bounds and time it (default 1000000 vertices)\n"
+		"  --bench-spmesh      Check baked .spmesh files and time loading them against the Assimp import (default generated nested spheres)\n"
+		"  --bench-residency   Check texture residency under a scripted camera: budget, refine order, thrashing (default 2000 textures)\n"
+		"  --bench-mips        Time mip chain generation of a size x size RGBA8 image (default 4096)\n"
+		"  --bench-atlas       Check texture array and atlas packing, report its efficiency and time planning (default 2000 textures)\n"
+		"  --bench-cache       Check asset cache sharing, handle protection and LRU eviction against a model, time lookups (default 10000 assets)\n"
+		"  --bench-alloc       Check the TLSF allocator and time it against OffsetAllocator (default 1000000 operations)\n"
+		"  --bench-graph       Check the render graph plan and time its compilation (default 64 passes)\n"
+		"  --bench-barriers    Check barrier batching and elision of the state tracker against a model and time it (default 2000 resources)\n"
+		"  --bench-profiler    Check frame captures and the Chrome trace, time scopes idle and recording (default 4 threads)\n"
+		"  --bench-stats       Check frame time percentiles, recorder deltas and the stats JSON, and time them (default 100000 samples)\n"
+		"  --bench-log         Time log calls from several threads against formatting on the caller (default 4 threads)\n"
+		"  --bench-input       Check input edges (same frame taps, key repeat, focus loss) and time event throughput (default 1000000 events)\n";
+}
+
+static std::optional<rendering::TextureCompression> parseCompression(const std::string& name) {
+	if (name == "auto") return rendering::TextureCompression::AUTO;
+	if (name == "none") return rendering::TextureCompression::NONE;
+	if (name == "bc1")  return rendering::TextureCompression::BC1;
+	if (name == "bc3")  return rendering::TextureCompression::BC3;
+	if (name == "bc4")  return rendering::TextureCompression::BC4;
+	if (name == "bc5")  return rendering::TextureCompression::BC5;
+	if (name == "bc7")  return rendering::TextureCompression::BC7;
+	return std::nullopt;
+}
+
+// Fastest of a few runs in milliseconds, the first one also warms the caches
+template <typename Run>
+static double timeBest(const int repeats, Run run) {
+	double best = 0.0;
+	for (int r = 0; r < repeats; ++r) {
+		const auto start = std::chrono::steady_clock::now();
+		run();
+		const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (r == 0 || milliseconds < best) best = milliseconds;
+	}
+	return best;
+}
+
+// Camera at the origin looking down +z, as the renderer builds its frustum
+static rendering::Frustum makeBenchmarkFrustum(const float farZ) {
+	rendering::Camera camera(1920, 1080);
+	camera.setClippingPlanes(0.1f, farZ);
+	camera.updateViewMatrix();
+	return rendering::Frustum::fromViewProjection(camera.getViewProjectionMatrix());
+}
+
+// Boxes scattered around the camera, the size of props and buildings
+static std::vector<rendering::BoundingVolume> makeBenchmarkBounds(const size_t count, const float spread, const uint32_t seed) {
+	std::mt19937                          random(seed);
+	std::uniform_real_distribution<float> position(-spread, spread);
+	std::uniform_real_distribution<float> extent(0.1f, 4.0f);
+
+	std::vector<rendering::BoundingVolume> bounds(count);
+	for (rendering::BoundingVolume& box : bounds) {
+		box.center  = { position(random), position(random) * 0.1f, position(random) };
+		box.extents = { extent(random), extent(random), extent(random) };
+		box.radius  = std::sqrt(box.extents.x * box.extents.x + box.extents.y * box.extents.y + box.extents.z * box.extents.z);
+	}
+	return bounds;
+}
+
+// Distance of the box to the closest plane it could touch, results this close may differ by rounding
+static float getFrustumMargin(const rendering::Frustum& frustum, const rendering::BoundingVolume& box) {
+	float margin = std::numeric_limits<float>::max();
+	for (const DirectX::XMFLOAT4& plane : frustum.planes) {
+		const float distance = plane.x * box.center.x + plane.y * box.center.y + plane.z * box.center.z + plane.w;
+		const float radius   = std::fabs(plane.x) * box.extents.x + std::fabs(plane.y) * box.extents.y + std::fabs(plane.z) * box.extents.z;
+		margin = std::min({ margin, std::fabs(distance + radius), std::fabs(distance - radius) });
+	}
+	return margin;
+}
+
+// Random parents make a forest a few levels deep. After the first update only the subtrees under changed
+// nodes may be recomputed, and every world matrix has to match its local matrix times its parent's.
+static int benchmarkHierarchy(const size_t count) {
+	flecs::world              world;
+	rendering::SceneHierarchy hierarchy(&world);
+
+	std::mt19937                          random(0x41E2);
+	std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> angle(-3.14f, 3.14f);
+
+	auto makeLocal = [&]() {
+		return rendering::LocalTransform{ rendering::Transform(
+			DirectX::XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f),
+			DirectX::XMVectorSet(position(random), position(random), position(random), 1.0f),
+			DirectX::XMQuaternionRotationRollPitchYaw(angle(random), angle(random), angle(random))
+		) };
+	};
+
+	// Parents always come first, so walking forward visits parents before their children
+	const size_t               rootCount = std::max<size_t>(1, count / 64);
+	std::vector<flecs::entity> entities(count);
+	std::vector<uint32_t>      parents(count, UINT32_MAX);
+	for (size_t n = 0; n < count; ++n) {
+		entities[n] = world.entity();
+		if (n >= rootCount) {
+			parents[n] = std::uniform_int_distribution<uint32_t>(0, static_cast<uint32_t>(n - 1))(random);
+			entities[n].child_of(entities[parents[n]]);
+		}
+		entities[n].set<rendering::LocalTransform>(makeLocal());
+	}
+
+	auto checkMatrices = [&]() {
+		std::vector<DirectX::XMMATRIX> expected(count);
+		for (size_t n = 0; n < count; ++n) {
+			expected[n] = entities[n].get<rendering::LocalTransform>()->transform.toMatrix();
+			if (parents[n] != UINT32_MAX) expected[n] = expected[n] * expected[parents[n]];
+
+			const rendering::WorldTransform* transform = entities[n].get<rendering::WorldTransform>();
+			if (!transform) return false;
+			for (int r = 0; r < 4; ++r) {
+				const DirectX::XMVECTOR difference = DirectX::XMVectorAbs(DirectX::XMVectorSubtract(transform->matrix.r[r], expected[n].r[r]));
+				if (!DirectX::XMVector4LessOrEqual(difference, DirectX::XMVectorReplicate(1e-2f))) return false;
+			}
+		}
+		return true;
+	};
+
+	hierarchy.update();
+	if (hierarchy.getStats().nodeCount != count || hierarchy.getStats().matricesRecomputed != count || !checkMatrices()) {
+		std::cerr << "error: the first update did not compute every world matrix\n";
+		return 1;
+	}
+	hierarchy.update();
+	if (hierarchy.getStats().matricesRecomputed != 0) {
+		std::cerr << "error: an update without changes recomputed " << hierarchy.getStats().matricesRecomputed << " matrices\n";
+		return 1;
+	}
+
+	// A few moved nodes, expected to recompute the union of their subtrees
+	std::vector<bool> isMoved(count, false);
+	for (int m = 0; m < 8; ++m) {
+		const size_t n = std::uniform_int_distribution<size_t>(0, count - 1)(random);
+		entities[n].set<rendering::LocalTransform>(makeLocal());
+		isMoved[n] = true;
+	}
+	size_t expectedRecomputed = 0;
+	for (size_t n = 0; n < count; ++n) {
+		if (parents[n] != UINT32_MAX && isMoved[parents[n]]) isMoved[n] = true;
+		expectedRecomputed += isMoved[n];
+	}
+	hierarchy.update();
+	if (hierarchy.getStats().matricesRecomputed != expectedRecomputed || !checkMatrices()) {
+		std::cerr << "error: moving 8 nodes recomputed " << hierarchy.getStats().matricesRecomputed << " matrices, their subtrees hold " << expectedRecomputed << '\n';
+		return 1;
+	}
+	if (hierarchy.getStats().rebuildCount != 1) {
+		std::cerr << "error: transform changes rebuilt the hierarchy\n";
+		return 1;
+	}
+	std::cout << "Hierarchy checked " << count << " nodes over " << hierarchy.getStats().levelCount << " levels, 8 moved nodes recompute "
+			  << expectedRecomputed << " matrices\n";
+
+	constexpr int repeats = 10;
+
+	// Moving a root or a leaf each run, the idle update only walks the flags
+	const double all = timeBest(repeats, [&]() {
+		for (size_t n = 0; n < rootCount; ++n) entities[n].set<rendering::LocalTransform>(makeLocal());
+		hierarchy.update();
+	});
+	const double leaf = timeBest(repeats, [&]() {
+		entities[count - 1].set<rendering::LocalTransform>(makeLocal());
+		hierarchy.update();
+	});
+	const double idle = timeBest(repeats, [&]() {
+		hierarchy.update();
+	});
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << std::setw(12) << "moved" << std::setw(10) << "ms\n";
+	std::cout << std::setw(12) << "every root" << std::setw(10) << all << '\n';
+	std::cout << std::setw(12) << "one leaf" << std::setw(10) << leaf << '\n';
+	std::cout << std::setw(12) << "nothing" << std::setw(10) << idle << '\n';
+	return 0;
+}
+
+// The 8-wide kernel has to agree with Frustum::intersects on every box, except boxes touching a plane
+// within rounding, then both are timed on the same bounds
+static int benchmarkCulling(const size_t count) {
+	const rendering::Frustum          frustum = makeBenchmarkFrustum(1000.0f);
+	const std::vector<rendering::BoundingVolume> bounds  = makeBenchmarkBounds(count, 1000.0f, 0xC011);
+
+	rendering::FrustumCuller culler;
+	culler.reserve(bounds.size());
+	for (const rendering::BoundingVolume& box : bounds) culler.add(box);
+
+	const std::vector<uint32_t> visible = culler.cull(frustum);
+
+	size_t next = 0;
+	for (uint32_t b = 0; b < bounds.size(); ++b) {
+		const bool isVisible = frustum.intersects(bounds[b]);
+		const bool isListed  = next < visible.size() && visible[next] == b;
+		if (isListed) ++next;
+
+		if (isVisible != isListed && getFrustumMargin(frustum, bounds[b]) > 1e-3f) {
+			std::cerr << "error: box " << b << " is " << (isListed ? "listed" : "missing") << " in the visibility list\n";
+			return 1;
+		}
+	}
+	if (next != visible.size()) {
+		std::cerr << "error: the visibility list is not sorted\n";
+		return 1;
+	}
+	std::cout << "Culler checked over " << bounds.size() << " bounds, " << visible.size() << " visible\n";
+
+	constexpr int repeats = 10;
+
+	// The counts are printed, so neither loop is optimized away
+	size_t       scalarVisible = 0;
+	size_t       simdVisible   = 0;
+	const double scalar = timeBest(repeats, [&]() {
+		scalarVisible = 0;
+		for (const rendering::BoundingVolume& box : bounds) scalarVisible += frustum.intersects(box);
+	});
+	const double simd = timeBest(repeats, [&]() {
+		simdVisible = culler.cull(frustum).size();
+	});
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << std::setw(10) << "kernel" << std::setw(10) << "ms" << std::setw(12) << "ns/box" << std::setw(12) << "visible\n";
+	std::cout << std::setw(10) << "scalar" << std::setw(10) << scalar << std::setw(12) << scalar * 1e6 / bounds.size() << std::setw(11) << scalarVisible << '\n';
+	std::cout << std::setw(10) << "simd" << std::setw(10) << simd << std::setw(12) << simd * 1e6 / bounds.size() << std::setw(11) << simdVisible << '\n';
+	std::cout << "speedup " << scalar / simd << "x\n";
+	return 0;
+}
+
+static rendering::BoundingVolume toBoundingVolume(const rendering::Aabb& box) {
+	rendering::BoundingVolume bounds;
+	bounds.center  = { (box.lower.x + box.upper.x) * 0.5f, (box.lower.y + box.upper.y) * 0.5f, (box.lower.z + box.upper.z) * 0.5f };
+	bounds.extents = { (box.upper.x - box.lower.x) * 0.5f, (box.upper.y - box.lower.y) * 0.5f, (box.upper.z - box.lower.z) * 0.5f };
+	return bounds;
+}
+
+// Frustum, box and ray queries are checked against a linear scan of the tree's fat boxes. Then the scene
+// moves for a few frames, a tenth of it each frame and now and then a teleport, as the spatial index
+// sees it through transform changes.
+static int benchmarkAabbTree(const size_t count) {
+	const std::vector<rendering::BoundingVolume> bounds = makeBenchmarkBounds(count, 1000.0f, 0x7EE);
+
+	rendering::DynamicAabbTree tree(0.1f);
+	std::vector<int32_t>       proxies(bounds.size());
+	const double build = timeBest(1, [&]() {
+		for (size_t b = 0; b < bounds.size(); ++b) proxies[b] = tree.createProxy(rendering::Aabb::fromBoundingVolume(bounds[b]), b);
+	});
+
+	const rendering::Frustum frustum = makeBenchmarkFrustum(1000.0f);
+
+	std::mt19937                          random(0x7EE);
+	std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	constexpr size_t queryCount = 100;
+	std::vector<rendering::Aabb>         boxes(queryCount);
+	std::vector<rendering::RayCastInput> rays(queryCount);
+	for (size_t q = 0; q < queryCount; ++q) {
+		const DirectX::XMFLOAT3 center = { position(random), position(random) * 0.1f, position(random) };
+		boxes[q].lower = { center.x - 20.0f, center.y - 20.0f, center.z - 20.0f };
+		boxes[q].upper = { center.x + 20.0f, center.y + 20.0f, center.z + 20.0f };
+
+		DirectX::XMStoreFloat3(&rays[q].direction, DirectX::XMVector3Normalize(DirectX::XMVectorSet(unit(random), unit(random) * 0.1f, unit(random), 0.0f)));
+		rays[q].origin      = center;
+		rays[q].maxDistance = 500.0f;
+	}
+
+	// Tree results, then the same queries over every fat box
+	std::vector<uint64_t> treeFrustum;
+	tree.query(frustum, [&](const int32_t proxy) {
+		treeFrustum.push_back(tree.getUserData(proxy));
+		return true;
+	});
+	auto linearFrustum = [&](std::vector<uint64_t>& out) {
+		for (size_t b = 0; b < proxies.size(); ++b) {
+			if (frustum.intersects(toBoundingVolume(tree.getFatAabb(proxies[b])))) out.push_back(b);
+		}
+	};
+	std::vector<uint64_t> expectedFrustum;
+	linearFrustum(expectedFrustum);
+
+	std::sort(treeFrustum.begin(), treeFrustum.end());
+	std::vector<uint64_t> difference;
+	std::set_symmetric_difference(treeFrustum.begin(), treeFrustum.end(), expectedFrustum.begin(), expectedFrustum.end(), std::back_inserter(difference));
+	for (const uint64_t b : difference) {
+		if (getFrustumMargin(frustum, toBoundingVolume(tree.getFatAabb(proxies[b]))) > 1e-3f) {
+			std::cerr << "error: the frustum query disagrees with the linear scan on proxy " << b << '\n';
+			return 1;
+		}
+	}
+
+	auto treeBox = [&](const rendering::Aabb& box, std::vector<uint64_t>& out) {
+		tree.query(box, [&](const int32_t proxy) {
+			out.push_back(tree.getUserData(proxy));
+			return true;
+		});
+	};
+	auto linearBox = [&](const rendering::Aabb& box, std::vector<uint64_t>& out) {
+		for (size_t b = 0; b < proxies.size(); ++b) {
+			if (tree.getFatAabb(proxies[b]).overlaps(box)) out.push_back(b);
+		}
+	};
+	auto treeRay = [&](const rendering::RayCastInput& ray) {
+		const DirectX::XMFLOAT3 inverse = { 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+		float closest = -1.0f;
+		tree.rayCast(ray, [&](const int32_t proxy, const rendering::RayCastInput& current) {
+			const float distance = tree.getFatAabb(proxy).rayDistance(current.origin, inverse, current.maxDistance);
+			if (distance < 0.0f) return -1.0f;
+
+			closest = distance;
+			return std::max(distance, std::numeric_limits<float>::min());
+		});
+		return closest;
+	};
+	auto linearRay = [&](const rendering::RayCastInput& ray) {
+		const DirectX::XMFLOAT3 inverse = { 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+		float closest = -1.0f;
+		for (const int32_t proxy : proxies) {
+			const float distance = tree.getFatAabb(proxy).rayDistance(ray.origin, inverse, ray.maxDistance);
+			if (distance >= 0.0f && (closest < 0.0f || distance < closest)) closest = distance;
+		}
+		return closest;
+	};
+
+	for (size_t q = 0; q < queryCount; ++q) {
+		std::vector<uint64_t> found, expected;
+		treeBox(boxes[q], found);
+		linearBox(boxes[q], expected);
+		std::sort(found.begin(), found.end());
+		if (found != expected) {
+			std::cerr << "error: box query " << q << " found " << found.size() << " proxies, the linear scan " << expected.size() << '\n';
+			return 1;
+		}
+
+		const float hit = treeRay(rays[q]);
+		const float expectedHit = linearRay(rays[q]);
+		if ((hit < 0.0f) != (expectedHit < 0.0f) || std::fabs(hit - expectedHit) > 1e-3f) {
+			std::cerr << "error: ray " << q << " hit at " << hit << ", the linear scan at " << expectedHit << '\n';
+			return 1;
+		}
+	}
+	std::cout << "Tree checked over " << bounds.size() << " proxies, " << treeFrustum.size() << " in the frustum\n";
+
+	constexpr int repeats = 5;
+
+	size_t     found = 0;
+	const double frustumTree = timeBest(repeats, [&]() {
+		found = 0;
+		tree.query(frustum, [&found](int32_t) { ++found; return true; });
+	});
+	const double frustumLinear = timeBest(repeats, [&]() {
+		std::vector<uint64_t> out;
+		linearFrustum(out);
+		found += out.size();
+	});
+	const double boxTree = timeBest(repeats, [&]() {
+		for (const rendering::Aabb& box : boxes) {
+			std::vector<uint64_t> out;
+			treeBox(box, out);
+			found += out.size();
+		}
+	}) / queryCount;
+	const double boxLinear = timeBest(repeats, [&]() {
+		for (const rendering::Aabb& box : boxes) {
+			std::vector<uint64_t> out;
+			linearBox(box, out);
+			found += out.size();
+		}
+	}) / queryCount;
+	float distance = 0.0f;
+	const double rayTree = timeBest(repeats, [&]() {
+		for (const rendering::RayCastInput& ray : rays) distance += treeRay(ray);
+	}) / queryCount;
+	const double rayLinear = timeBest(repeats, [&]() {
+		for (const rendering::RayCastInput& ray : rays) distance += linearRay(ray);
+	}) / queryCount;
+
+	// A tenth of the scene drifts every frame, one in a thousand of those jumps somewhere else
+	constexpr int frames = 60;
+
+	std::vector<rendering::BoundingVolume> moving = bounds;
+	const rendering::DynamicAabbTreeStats  before = tree.getStats();
+	const double update = timeBest(1, [&]() {
+		for (int frame = 0; frame < frames; ++frame) {
+			for (size_t b = frame % 10; b < moving.size(); b += 10) {
+				rendering::BoundingVolume& box = moving[b];
+				if (random() % 1000 == 0) box.center = { position(random), position(random) * 0.1f, position(random) };
+				else                      box.center = { box.center.x + unit(random) * 0.05f, box.center.y, box.center.z + unit(random) * 0.05f };
+
+				tree.moveProxy(proxies[b], rendering::Aabb::fromBoundingVolume(box));
+			}
+		}
+	}) / frames;
+	const rendering::DynamicAabbTreeStats after = tree.getStats();
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "height " << after.height << ", area ratio " << tree.getAreaRatio() << ", built in " << build << " ms\n";
+	std::cout << std::setw(10) << "query" << std::setw(12) << "tree ms" << std::setw(12) << "linear ms" << std::setw(10) << "speedup\n";
+	auto report = [](const char* name, const double treeTime, const double linearTime) {
+		std::cout << std::setw(10) << name << std::setw(12) << treeTime << std::setw(12) << linearTime << std::setw(8) << std::setprecision(1) << linearTime / treeTime << "x\n" << std::setprecision(3);
+	};
+	report("frustum", frustumTree, frustumLinear);
+	report("box", boxTree, boxLinear);
+	report("ray", rayTree, rayLinear);
+	std::cout << "update " << update << " ms per frame moving " << moving.size() / 10 << " proxies: "
+			  << (after.moves - before.moves) / frames << " moves, " << (after.refits - before.refits) / frames << " refits, "
+			  << (after.reinserts - before.reinserts) / frames << " reinserts per frame\n";
+	return 0;
+}
+
+// Closed box as occluder geometry, 12 triangles
+static rendering::OccluderMesh makeBoxOccluder(const rendering::Aabb& box) {
+	rendering::OccluderMesh occluder;
+	for (int corner = 0; corner < 8; ++corner) {
+		occluder.positions.push_back({
+			(corner & 1) ? box.upper.x : box.lower.x,
+			(corner & 2) ? box.upper.y : box.lower.y,
+			(corner & 4) ? box.upper.z : box.lower.z
+		});
+	}
+	occluder.indices = {
+		0, 2, 1, 1, 2, 3, // -z
+		4, 5, 6, 5, 7, 6, // +z
+		0, 1, 4, 1, 5, 4, // -y
+		2, 6, 3, 3, 6, 7, // +y
+		0, 4, 2, 2, 4, 6, // -x
+		1, 3, 5, 3, 7, 5  // +x
+	};
+	return occluder;
+}
+
+// Whether the segment from the eye at the origin to the point enters the box before reaching it
+static bool isSegmentBlocked(const DirectX::XMFLOAT3& point, const rendering::Aabb& box) {
+	float enter = 0.0f, exit = 1.0f;
+	const float direction[3] = { point.x, point.y, point.z };
+	const float lower[3]     = { box.lower.x, box.lower.y, box.lower.z };
+	const float upper[3]     = { box.upper.x, box.upper.y, box.upper.z };
+	for (int axis = 0; axis < 3; ++axis) {
+		if (std::fabs(direction[axis]) < 1e-6f) {
+			if (lower[axis] > 0.0f || upper[axis] < 0.0f) return false;
+			continue;
+		}
+		float t0 = lower[axis] / direction[axis];
+		float t1 = upper[axis] / direction[axis];
+		if (t0 > t1) std::swap(t0, t1);
+		enter = std::max(enter, t0);
+		exit  = std::min(exit, t1);
+		if (enter > exit) return false;
+	}
+	return enter < 1.0f;
+}
+
+// A corridor of wall slabs in front of the camera hides part of a field of props. Every culled prop is
+// checked by casting segments from the eye to a grid of points on its faces, none may reach it past
+// the walls (grown by a few buffer pixels, the buffer is coarser than the walls' edges). Then whole
+// frames are timed: clear, rasterize the walls, test every prop.
+static int benchmarkOcclusion(const size_t count) {
+	rendering::Camera camera(1920, 1080);
+	camera.setClippingPlanes(0.1f, 1000.0f);
+	camera.updateViewMatrix();
+	const DirectX::XMMATRIX viewProjection = camera.getViewProjectionMatrix();
+
+	std::mt19937                          random(0x0CC1);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<rendering::Aabb>         walls;
+	std::vector<rendering::OccluderMesh> occluders;
+	for (int w = 0; w < 24; ++w) {
+		const float z      = 15.0f + 45.0f * unit(random);
+		const float x      = (unit(random) * 2.0f - 1.0f) * z * 0.6f;
+		const float width  = 4.0f + 16.0f * unit(random);
+		const float height = 4.0f + 10.0f * unit(random);
+
+		rendering::Aabb wall;
+		wall.lower = { x - width * 0.5f, -height * 0.5f, z };
+		wall.upper = { x + width * 0.5f, height * 0.5f, z + 0.5f };
+		walls.push_back(wall);
+		occluders.push_back(makeBoxOccluder(wall));
+	}
+
+	std::vector<rendering::BoundingVolume> props(count);
+	for (rendering::BoundingVolume& box : props) {
+		const float z = 5.0f + 395.0f * unit(random);
+		box.center  = { (unit(random) * 2.0f - 1.0f) * z * 0.7f, (unit(random) * 2.0f - 1.0f) * z * 0.3f, z };
+		box.extents = { 0.2f + 1.8f * unit(random), 0.2f + 1.8f * unit(random), 0.2f + 1.8f * unit(random) };
+		box.radius  = std::sqrt(box.extents.x * box.extents.x + box.extents.y * box.extents.y + box.extents.z * box.extents.z);
+	}
+
+	rendering::OcclusionCuller culler;
+	auto runFrame = [&](std::vector<uint32_t>& visible) {
+		culler.beginFrame(viewProjection);
+		for (size_t w = 0; w < walls.size(); ++w) culler.renderOccluder(occluders[w], DirectX::XMMatrixIdentity());
+
+		visible.resize(props.size());
+		for (uint32_t p = 0; p < props.size(); ++p) visible[p] = p;
+		culler.filterVisible(props, visible);
+	};
+
+	std::vector<uint32_t> visible;
+	runFrame(visible);
+	const rendering::OcclusionStats stats = culler.getStats();
+
+	// Size of a buffer pixel at the farthest wall
+	const float pixel = 2.0f * 60.5f * std::tan(camera.getFov() * 0.5f) / static_cast<float>(culler.getHeight());
+
+	std::vector<rendering::Aabb> grownWalls = walls;
+	for (rendering::Aabb& wall : grownWalls) {
+		wall.lower = { wall.lower.x - 2.0f * pixel, wall.lower.y - 2.0f * pixel, wall.lower.z };
+		wall.upper = { wall.upper.x + 2.0f * pixel, wall.upper.y + 2.0f * pixel, wall.upper.z };
+	}
+
+	constexpr int samples = 8;
+
+	size_t next = 0;
+	for (uint32_t p = 0; p < props.size(); ++p) {
+		if (next < visible.size() && visible[next] == p) {
+			++next;
+			continue;
+		}
+
+		const rendering::BoundingVolume& box = props[p];
+		for (int face = 0; face < 6; ++face) {
+			const int   axis = face / 2;
+			const float side = (face & 1) ? 1.0f : -1.0f;
+			for (int i = 0; i <= samples; ++i) {
+				for (int j = 0; j <= samples; ++j) {
+					const float u = (static_cast<float>(i) / samples) * 2.0f - 1.0f;
+					const float v = (static_cast<float>(j) / samples) * 2.0f - 1.0f;
+
+					const float offset[3] = {
+						axis == 0 ? side : u,
+						axis == 1 ? side : (axis == 0 ? u : v),
+						axis == 2 ? side : v
+					};
+					const DirectX::XMFLOAT3 point = {
+						box.center.x + offset[0] * box.extents.x,
+						box.center.y + offset[1] * box.extents.y,
+						box.center.z + offset[2] * box.extents.z
+					};
+
+					const bool isBlocked = std::any_of(grownWalls.begin(), grownWalls.end(), [&point](const rendering::Aabb& wall) {
+						return isSegmentBlocked(point, wall);
+					});
+					if (!isBlocked) {
+						std::cerr << "error: prop " << p << " is culled but visible at (" << point.x << ", " << point.y << ", " << point.z << ")\n";
+						return 1;
+					}
+				}
+			}
+		}
+	}
+	if (next != visible.size()) {
+		std::cerr << "error: the visibility list is not sorted\n";
+		return 1;
+	}
+	if (stats.culled == 0) {
+		std::cerr << "error: nothing was culled behind the walls\n";
+		return 1;
+	}
+
+	// A triangle reaching before the near plane is dropped whole, the GPU clips that part away and the
+	// rest would be rasterized with depths below zero
+	{
+		rendering::OccluderMesh nearOccluder;
+		nearOccluder.positions = { { 0.0f, 0.0f, 0.05f }, { -50.0f, -50.0f, 30.0f }, { 50.0f, -50.0f, 30.0f } };
+		nearOccluder.indices   = { 0, 1, 2 };
+
+		rendering::BoundingVolume behind;
+		behind.center  = { 0.0f, -10.0f, 40.0f };
+		behind.extents = { 1.0f, 1.0f, 1.0f };
+		behind.radius  = std::sqrt(3.0f);
+
+		culler.beginFrame(viewProjection);
+		culler.renderOccluder(nearOccluder, DirectX::XMMatrixIdentity());
+		if (culler.getStats().rasterizedTriangles != 0 || !culler.isVisible(behind)) {
+			std::cerr << "error: an occluder crossing the near plane was rasterized\n";
+			return 1;
+		}
+	}
+
+	std::cout << "Occlusion checked over " << props.size() << " props behind " << walls.size() << " walls, "
+			  << stats.culled << " culled, and across the near plane\n";
+
+	constexpr int frames = 20;
+
+	double raster = 0.0;
+	double test   = 0.0;
+	const double frame = timeBest(frames, [&]() {
+		runFrame(visible);
+		raster = culler.getStats().rasterMilliseconds;
+		test   = culler.getStats().testMilliseconds;
+	});
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "buffer " << culler.getWidth() << "x" << culler.getHeight() << ", " << stats.occluderTriangles << " occluder triangles, "
+			  << stats.rasterizedTriangles << " rasterized\n";
+	std::cout << "culled " << std::setprecision(1) << stats.getCulledPercentage() << "% of " << stats.tested << " tested\n" << std::setprecision(3);
+	std::cout << "frame " << frame << " ms: raster " << raster << " ms, test " << test << " ms (" << test * 1e6 / props.size() << " ns per prop)\n";
+	return 0;
+}
+
+// Torus around the y axis, closed and without poles, so every vertex can collapse
+static void makeBenchmarkTorus(const uint32_t rings, const uint32_t segments, std::vector<DirectX::XMFLOAT3>& positions, std::vector<uint32_t>& indices) {
+	constexpr float major = 1.0f;
+	constexpr float minor = 0.3f;
+
+	positions.clear();
+	indices.clear();
+	for (uint32_t ring = 0; ring < rings; ++ring) {
+		const float theta = DirectX::XM_2PI * static_cast<float>(ring) / static_cast<float>(rings);
+		for (uint32_t segment = 0; segment < segments; ++segment) {
+			const float phi    = DirectX::XM_2PI * static_cast<float>(segment) / static_cast<float>(segments);
+			const float radius = major + minor * std::cos(phi);
+			positions.push_back({ radius * std::cos(theta), minor * std::sin(phi), radius * std::sin(theta) });
+
+			const uint32_t a = ring * segments + segment;
+			const uint32_t b = ring * segments + (segment + 1) % segments;
+			const uint32_t c = (ring + 1) % rings * segments + segment;
+			const uint32_t d = (ring + 1) % rings * segments + (segment + 1) % segments;
+			indices.insert(indices.end(), { a, b, c, b, d, c });
+		}
+	}
+}
+
+// The LOD chain of a torus has to halve the triangles per level with growing errors, valid indices and
+// a surface that stays near the torus. Selection is swept out and back along a ray of distances: levels
+// may never exceed the pixel error by more than the hysteresis, and jitter around a switch distance must
+// only flip levels without hysteresis. Then both are timed.
+static int benchmarkLod(const size_t triangles) {
+	const uint32_t rings = std::max<uint32_t>(8, static_cast<uint32_t>(std::sqrt(static_cast<double>(triangles) / 8.0)));
+
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<uint32_t>          source;
+	makeBenchmarkTorus(rings, rings * 4, positions, source);
+
+	constexpr uint32_t              levelCount = 6;
+	std::vector<uint32_t>           indices;
+	std::vector<rendering::MeshLod> lods;
+	const double build = timeBest(1, [&]() {
+		indices = source;
+		lods    = rendering::generateLodChain(positions.data(), positions.size(), sizeof(DirectX::XMFLOAT3), indices, levelCount);
+	});
+
+	if (lods.size() < 3) {
+		std::cerr << "error: the torus only got " << lods.size() << " levels of detail\n";
+		return 1;
+	}
+	std::vector<double> deviations(lods.size(), 0.0);
+	for (size_t level = 0; level < lods.size(); ++level) {
+		const rendering::MeshLod& lod = lods[level];
+		if (level > 0 && (lod.indexCount > lods[level - 1].indexCount / 6 * 3 || lod.error < lods[level - 1].error)) {
+			std::cerr << "error: level " << level << " has " << lod.indexCount / 3 << " triangles and error " << lod.error
+					  << " after " << lods[level - 1].indexCount / 3 << " triangles and error " << lods[level - 1].error << '\n';
+			return 1;
+		}
+		for (uint32_t t = lod.indexOffset; t < lod.indexOffset + lod.indexCount; t += 3) {
+			const uint32_t a = indices[t], b = indices[t + 1], c = indices[t + 2];
+			if (a >= positions.size() || b >= positions.size() || c >= positions.size() || a == b || b == c || a == c) {
+				std::cerr << "error: level " << level << " has a degenerate or out of range triangle\n";
+				return 1;
+			}
+
+			// Distance of the triangle center to the torus
+			const float x = (positions[a].x + positions[b].x + positions[c].x) / 3.0f;
+			const float y = (positions[a].y + positions[b].y + positions[c].y) / 3.0f;
+			const float z = (positions[a].z + positions[b].z + positions[c].z) / 3.0f;
+			const float q = std::sqrt(x * x + z * z) - 1.0f;
+			deviations[level] = std::max(deviations[level], static_cast<double>(std::fabs(std::sqrt(q * q + y * y) - 0.3f)));
+		}
+		if (deviations[level] > 0.3 * 0.5) {
+			std::cerr << "error: level " << level << " strays " << deviations[level] << " from the torus\n";
+			return 1;
+		}
+	}
+
+	// Distances where one unit covers ppu pixels, as LodSelector::update computes them
+	constexpr float pixelError = 1.0f;
+	constexpr float hysteresis = 0.25f;
+	constexpr float focal      = 1000.0f;
+
+	std::vector<float> sweep;
+	for (float distance = 1.0f; distance < 1e5f; distance *= 1.02f) sweep.push_back(distance);
+	for (size_t d = sweep.size(); d-- > 0;) sweep.push_back(sweep[d]);
+
+	uint32_t level    = 0;
+	uint32_t deepest  = 0;
+	size_t   switches = 0;
+	for (size_t d = 0; d < sweep.size(); ++d) {
+		const float    ppu  = focal / sweep[d];
+		const uint32_t next = rendering::selectLodLevel(lods, ppu, level, pixelError, hysteresis);
+
+		const bool isMovingAway = d < sweep.size() / 2;
+		if ((isMovingAway && next < level) || (!isMovingAway && next > level)) {
+			std::cerr << "error: the level went from " << level << " to " << next << (isMovingAway ? " moving away\n" : " coming closer\n");
+			return 1;
+		}
+		if (lods[next].error * ppu > pixelError * (1.0f + hysteresis)) {
+			std::cerr << "error: level " << next << " is " << lods[next].error * ppu << " pixels off at distance " << sweep[d] << '\n';
+			return 1;
+		}
+		switches += next != level;
+		deepest   = std::max(deepest, next);
+		level     = next;
+	}
+	if (deepest != lods.size() - 1 || level != 0) {
+		std::cerr << "error: the sweep reached level " << deepest << " and came back to " << level << '\n';
+		return 1;
+	}
+
+	// Jitter of 10% around the distance where level 1 becomes acceptable
+	auto countJitterSwitches = [&](const float tolerance) {
+		const float center  = focal * lods[1].error / pixelError;
+		uint32_t    current = rendering::selectLodLevel(lods, focal / center, 0, pixelError, tolerance);
+		size_t      count   = 0;
+		for (int frame = 0; frame < 100; ++frame) {
+			const float    distance = center * (frame % 2 ? 1.05f : 0.95f);
+			const uint32_t next     = rendering::selectLodLevel(lods, focal / distance, current, pixelError, tolerance);
+			count  += next != current;
+			current = next;
+		}
+		return count;
+	};
+	const size_t jitterSwitches = countJitterSwitches(hysteresis);
+	const size_t plainSwitches  = countJitterSwitches(0.0f);
+	if (jitterSwitches != 0 || plainSwitches == 0) {
+		std::cerr << "error: jitter switched levels " << jitterSwitches << " times with hysteresis and " << plainSwitches << " times without\n";
+		return 1;
+	}
+	std::cout << "LOD checked " << lods.size() << " levels, " << switches << " switches over the sweep, "
+			  << plainSwitches << " jitter switches without hysteresis and none with it\n";
+
+	constexpr size_t selections = 1000000;
+	size_t           selected   = 0;
+	const double     select     = timeBest(5, [&]() {
+		selected = 0;
+		for (size_t s = 0; s < selections; ++s) selected += rendering::selectLodLevel(lods, focal / sweep[s % sweep.size()], 1, pixelError, hysteresis);
+	});
+
+	std::cout << std::fixed << std::setprecision(4);
+	std::cout << std::setw(8) << "level" << std::setw(12) << "triangles" << std::setw(10) << "error" << std::setw(12) << "deviation\n";
+	for (size_t l = 0; l < lods.size(); ++l) {
+		std::cout << std::setw(8) << l << std::setw(12) << lods[l].indexCount / 3 << std::setw(10) << lods[l].error << std::setw(11) << deviations[l] << '\n';
+	}
+	std::cout << std::setprecision(2);
+	std::cout << "chain built in " << build << " ms, selection " << select * 1e6 / selections << " ns (" << selected << ")\n";
+	return 0;
+}
+
+// Three nested bumpy spheres written as OBJ, like the inner parts of a model, triangles shuffled the way
+// badly ordered exports come out. Benches that take a model use it when none is given, so they still
+// go through the Assimp import.
+static std::filesystem::path makeBenchmarkModel(const uint32_t rings, const uint32_t segments) {
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "spider-bench-spheres.obj";
+
+	std::mt19937                          random(0x5FE);
+	std::uniform_real_distribution<float> bump(0.998f, 1.002f);
+
+	constexpr float shells[] = { 1.0f, 0.75f, 0.5f };
+
+	std::ofstream                        file(path);
+	std::vector<std::array<uint32_t, 3>> triangles;
+	uint32_t                             first = 1; // OBJ indices start at one
+	for (const float shell : shells) {
+		for (uint32_t ring = 0; ring <= rings; ++ring) {
+			const float theta = DirectX::XM_PI * static_cast<float>(ring) / static_cast<float>(rings);
+			for (uint32_t segment = 0; segment < segments; ++segment) {
+				const float phi    = DirectX::XM_2PI * static_cast<float>(segment) / static_cast<float>(segments);
+				const float radius = shell * bump(random);
+				file << "v " << radius * std::sin(theta) * std::cos(phi) << ' ' << radius * std::cos(theta) << ' ' << radius * std::sin(theta) * std::sin(phi) << '\n';
+			}
+		}
+
+		// Counter-clockwise seen from outside, as OBJ files are wound
+		for (uint32_t ring = 0; ring < rings; ++ring) {
+			for (uint32_t segment = 0; segment < segments; ++segment) {
+				const uint32_t a = first + ring * segments + segment;
+				const uint32_t b = first + ring * segments + (segment + 1) % segments;
+				triangles.push_back({ a, b, a + segments });
+				triangles.push_back({ b, b + segments, a + segments });
+			}
+		}
+		first += (rings + 1) * segments;
+	}
+
+	std::shuffle(triangles.begin(), triangles.end(), random);
+	for (const std::array<uint32_t, 3>& triangle : triangles) file << "f " << triangle[0] << ' ' << triangle[1] << ' ' << triangle[2] << '\n';
+
+	return path;
+}
+
+// Corners of every triangle, rotated to start at the smallest one and sorted, equal for the same
+// triangles whatever order they and their vertices are stored in
+static std::vector<std::array<float, 9>> getTriangleSet(const std::vector<rendering::Vertex>& vertices, const uint32_t* indices, const size_t indexCount) {
+	std::vector<std::array<float, 9>> triangles(indexCount / 3);
+	for (size_t t = 0; t < triangles.size(); ++t) {
+		std::array<std::array<float, 3>, 3> corners;
+		for (int k = 0; k < 3; ++k) {
+			const DirectX::XMFLOAT3& position = vertices[indices[t * 3 + k]].position;
+			corners[k] = { position.x, position.y, position.z };
+		}
+		const int first = static_cast<int>(std::min_element(corners.begin(), corners.end()) - corners.begin());
+		for (int k = 0; k < 3; ++k) std::copy(corners[(first + k) % 3].begin(), corners[(first + k) % 3].end(), triangles[t].begin() + k * 3);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// Imports the model without optimizing it, checks that optimizeMesh keeps the same triangles and
+// reports the cache and overdraw figures before and after along with the time it took
+static int benchmarkMeshOptimizer(const std::filesystem::path& model) {
+	Assimp::Importer              importer;
+	const rendering::ImportedMesh mesh = rendering::importMesh(importer, model, { 1, false, false });
+
+	std::vector<rendering::Vertex>   vertices = mesh.vertices;
+	std::vector<uint32_t>            indices  = mesh.indices;
+	rendering::MeshOptimizationStats stats;
+
+	const double optimize = timeBest(5, [&]() {
+		vertices = mesh.vertices;
+		indices  = mesh.indices;
+		stats    = rendering::optimizeMesh(vertices, indices, mesh.lods);
+	});
+
+	if (indices.size() != mesh.indices.size() ||
+		getTriangleSet(vertices, indices.data(), indices.size()) != getTriangleSet(mesh.vertices, mesh.indices.data(), mesh.indices.size()))
+	{
+		std::cerr << "error: the optimized mesh does not have the same triangles\n";
+		return 1;
+	}
+
+	const rendering::OverdrawStats overdrawBefore = rendering::analyzeOverdraw(mesh.indices.data(), mesh.indices.size(), &mesh.vertices[0].position, mesh.vertices.size(), sizeof(rendering::Vertex));
+	const rendering::OverdrawStats overdrawAfter  = rendering::analyzeOverdraw(indices.data(), indices.size(), &vertices[0].position, vertices.size(), sizeof(rendering::Vertex));
+
+	std::cout << model.filename().string() << ": " << mesh.indices.size() / 3 << " triangles, " << mesh.vertices.size() << " vertices, "
+			  << stats.clusterCount << " overdraw clusters\n";
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << std::setw(10) << "" << std::setw(10) << "acmr" << std::setw(10) << "atvr" << std::setw(12) << "overdraw\n";
+	std::cout << std::setw(10) << "before" << std::setw(10) << stats.before.acmr << std::setw(10) << stats.before.atvr << std::setw(11) << overdrawBefore.overdraw << '\n';
+	std::cout << std::setw(10) << "after" << std::setw(10) << stats.after.acmr << std::setw(10) << stats.after.atvr << std::setw(11) << overdrawAfter.overdraw << '\n';
+	std::cout << "optimized in " << optimize << " ms\n";
+	return 0;
+}
+
+// Builds meshlets over the optimized level 0 of the model and checks them: limits, the same triangles in
+// the same order, vertices inside the spheres, and from a ring of cameras around the model, no culled
+// meshlet with a vertex in the frustum. Then the culler is timed on the same cameras.
+static int benchmarkMeshlets(const std::filesystem::path& model) {
+	Assimp::Importer              importer;
+	const rendering::ImportedMesh mesh = rendering::importMesh(importer, model, { 1, true, false });
+
+	const uint32_t indexCount = mesh.lods.empty() ? static_cast<uint32_t>(mesh.indices.size()) : mesh.lods.front().indexCount;
+	const void*    positions  = &mesh.vertices[0].position;
+
+	rendering::MeshletData data;
+	const double build = timeBest(5, [&]() {
+		data = rendering::buildMeshlets(mesh.indices.data(), indexCount, positions, mesh.vertices.size(), sizeof(rendering::Vertex));
+	});
+
+	std::vector<uint32_t> expanded;
+	expanded.reserve(indexCount);
+	for (size_t m = 0; m < data.meshlets.size(); ++m) {
+		const rendering::Meshlet&       meshlet = data.meshlets[m];
+		const rendering::MeshletBounds& bounds  = data.bounds[m];
+
+		if (meshlet.vertexCount > rendering::MeshletData::maxVertices || meshlet.triangleCount > rendering::MeshletData::maxTriangles) {
+			std::cerr << "error: meshlet " << m << " has " << meshlet.vertexCount << " vertices and " << meshlet.triangleCount << " triangles\n";
+			return 1;
+		}
+		for (uint32_t i = 0; i < meshlet.triangleCount * 3; ++i) {
+			expanded.push_back(data.vertices[meshlet.vertexOffset + data.triangles[meshlet.triangleOffset + i]]);
+		}
+		for (uint32_t v = 0; v < meshlet.vertexCount; ++v) {
+			const DirectX::XMFLOAT3& position = mesh.vertices[data.vertices[meshlet.vertexOffset + v]].position;
+			const float dx = position.x - bounds.center.x, dy = position.y - bounds.center.y, dz = position.z - bounds.center.z;
+			if (std::sqrt(dx * dx + dy * dy + dz * dz) > bounds.radius * 1.0001f + 1e-6f) {
+				std::cerr << "error: a vertex of meshlet " << m << " is outside its sphere\n";
+				return 1;
+			}
+		}
+	}
+	if (!std::equal(expanded.begin(), expanded.end(), mesh.indices.begin(), mesh.indices.begin() + indexCount)) {
+		std::cerr << "error: the meshlets do not hold the same triangles\n";
+		return 1;
+	}
+
+	// Rotated, moved and scaled, so the planes really go through the object transform
+	const DirectX::XMMATRIX world = DirectX::XMMatrixScaling(2.0f, 2.0f, 2.0f) *
+									DirectX::XMMatrixRotationRollPitchYaw(0.3f, 1.1f, 0.0f) *
+									DirectX::XMMatrixTranslation(5.0f, -1.0f, 3.0f);
+
+	rendering::Camera camera(1920, 1080);
+	camera.setClippingPlanes(0.1f, 1000.0f);
+
+	// Close enough that the model does not fit the view
+	const float distance = mesh.bounds.radius * 2.0f * 1.6f;
+
+	constexpr int cameraCount = 64;
+	std::vector<rendering::Frustum> frusta(cameraCount);
+	for (int c = 0; c < cameraCount; ++c) {
+		const float angle = DirectX::XM_2PI * static_cast<float>(c) / cameraCount;
+		const DirectX::XMVECTOR target = DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&mesh.bounds.center), world);
+		const DirectX::XMVECTOR eye    = DirectX::XMVectorAdd(target, DirectX::XMVectorSet(std::cos(angle) * distance, std::sin(angle * 3.0f) * distance * 0.5f, std::sin(angle) * distance, 0.0f));
+
+		const DirectX::XMMATRIX view = DirectX::XMMatrixLookAtLH(eye, target, DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		frusta[c] = rendering::Frustum::fromViewProjection(view * camera.getProjectionMatrix());
+	}
+
+	auto worldPosition = [&](const uint32_t vertex) {
+		return DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&mesh.vertices[vertex].position), world);
+	};
+
+	rendering::MeshletCuller       culler;
+	rendering::MeshletCullingStats total;
+	for (int c = 0; c < cameraCount; ++c) {
+		const std::vector<uint32_t>& visible = culler.cull(data, frusta[c], world);
+
+		size_t next = 0;
+		for (uint32_t m = 0; m < data.meshlets.size(); ++m) {
+			if (next < visible.size() && visible[next] == m) {
+				++next;
+				continue;
+			}
+
+			const rendering::Meshlet& meshlet = data.meshlets[m];
+
+			// Culled by the frustum: every vertex behind one plane
+			bool isOutside = false;
+			for (const DirectX::XMFLOAT4& plane : frusta[c].planes) {
+				bool isBehind = true;
+				for (uint32_t v = 0; v < meshlet.vertexCount && isBehind; ++v) {
+					isBehind = DirectX::XMVectorGetX(DirectX::XMPlaneDotCoord(DirectX::XMLoadFloat4(&plane), worldPosition(data.vertices[meshlet.vertexOffset + v]))) < 1e-4f;
+				}
+				isOutside = isOutside || isBehind;
+			}
+			if (!isOutside) {
+				std::cerr << "error: meshlet " << m << " is culled from camera " << c << " with vertices inside the frustum\n";
+				return 1;
+			}
+		}
+		if (next != visible.size()) {
+			std::cerr << "error: the visible meshlets are not sorted\n";
+			return 1;
+		}
+
+		const rendering::MeshletCullingStats& stats = culler.getStats();
+		total.tested           += stats.tested;
+		total.frustumCulled    += stats.frustumCulled;
+		total.visibleTriangles += stats.visibleTriangles;
+	}
+	std::cout << "Meshlets checked from " << cameraCount << " cameras\n";
+
+	const double cull = timeBest(5, [&]() {
+		for (int c = 0; c < cameraCount; ++c) culler.cull(data, frusta[c], world);
+	}) / cameraCount;
+
+	size_t triangleCount = 0;
+	for (const rendering::Meshlet& meshlet : data.meshlets) triangleCount += meshlet.triangleCount;
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << model.filename().string() << ": " << indexCount / 3 << " triangles in " << data.meshlets.size() << " meshlets, "
+			  << static_cast<double>(triangleCount) / data.meshlets.size() << " triangles and "
+			  << static_cast<double>(data.vertices.size()) / data.meshlets.size() << " vertices per meshlet\n";
+	std::cout << "built in " << build << " ms\n";
+	std::cout << "per camera: " << 100.0 * total.frustumCulled / total.tested << "% frustum culled, "
+			  << 100.0 * total.visibleTriangles / (static_cast<double>(triangleCount) * cameraCount) << "% of the triangles drawn\n";
+	std::cout << "cull " << std::setprecision(4) << cull << " ms per camera (" << cull * 1e6 / data.meshlets.size() << " ns per meshlet)\n";
+	return 0;
+}
+
+// Angle between a vector and its decoded octahedral encoding in degrees, from the cross product since
+// the cosine of such small angles rounds to one in float
+static float getAngleError(const DirectX::XMFLOAT3& source, const DirectX::XMFLOAT3& decoded) {
+	const double cx  = double(source.y) * decoded.z - double(source.z) * decoded.y;
+	const double cy  = double(source.z) * decoded.x - double(source.x) * decoded.z;
+	const double cz  = double(source.x) * decoded.y - double(source.y) * decoded.x;
+	const double dot = double(source.x) * decoded.x + double(source.y) * decoded.y + double(source.z) * decoded.z;
+	if (dot == 0.0 && cx == 0.0 && cy == 0.0 && cz == 0.0) return 0.0f;
+
+	return static_cast<float>(std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot) * 180.0 / DirectX::XM_PI);
+}
+
+// Round trip of every packed attribute against its error bound: positions within a quantization step
+// (decoded both as unpackVertex does and from the shader constant), normals and tangents within a small
+// angle, UVs within half precision. Axis aligned and zero vectors are included, they sit on the edges of
+// the octahedron. Then 16-bit indices and the packing throughput.
+static int benchmarkPacking(const size_t count) {
+	std::mt19937                          random(0x9AC);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> uv(-4.0f, 4.0f);
+
+	auto randomDirection = [&]() {
+		DirectX::XMFLOAT3 direction;
+		DirectX::XMStoreFloat3(&direction, DirectX::XMVector3Normalize(DirectX::XMVectorSet(unit(random), unit(random), unit(random), 0.0f)));
+		return direction;
+	};
+
+	const DirectX::XMFLOAT3 edges[] = {
+		{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+		{ 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }, { 0.0f, 0.0f, 0.0f }
+	};
+
+	std::vector<rendering::Vertex> vertices(std::max<size_t>(count, std::size(edges)));
+	for (size_t v = 0; v < vertices.size(); ++v) {
+		rendering::Vertex& vertex = vertices[v];
+		vertex.position = { position(random), position(random) * 0.5f, position(random) * 2.0f };
+		vertex.normal   = v < std::size(edges) ? edges[v] : randomDirection();
+		vertex.tangent  = v < std::size(edges) ? edges[std::size(edges) - 1 - v] : randomDirection();
+		vertex.uv       = { uv(random), uv(random) };
+	}
+
+	rendering::VertexQuantization              quantization;
+	const std::vector<rendering::PackedVertex> packed = rendering::packVertices(vertices, quantization);
+
+	const DirectX::XMFLOAT3           bound  = quantization.getErrorBound();
+	const rendering::QuantizationData shader = quantization.toShaderData();
+
+	float positionError = 0.0f;
+	float normalError   = 0.0f;
+	float tangentError  = 0.0f;
+	float uvError       = 0.0f;
+
+	for (size_t v = 0; v < vertices.size(); ++v) {
+		const rendering::Vertex& source  = vertices[v];
+		const rendering::Vertex  decoded = rendering::unpackVertex<rendering::Vertex>(packed[v], quantization);
+
+		const float error[3] = {
+			std::fabs(decoded.position.x - source.position.x),
+			std::fabs(decoded.position.y - source.position.y),
+			std::fabs(decoded.position.z - source.position.z)
+		};
+		if (error[0] > bound.x || error[1] > bound.y || error[2] > bound.z) {
+			std::cerr << "error: position of vertex " << v << " is off by (" << error[0] << ", " << error[1] << ", " << error[2] << ")\n";
+			return 1;
+		}
+		positionError = std::max({ positionError, error[0] / quantization.scale.x, error[1] / quantization.scale.y, error[2] / quantization.scale.z });
+
+		// What decodePosition computes in the vertex shader
+		const DirectX::XMFLOAT3 fromShader = {
+			shader.offset.x + rendering::decodeUnorm16(packed[v].position[0]) * shader.scale.x,
+			shader.offset.y + rendering::decodeUnorm16(packed[v].position[1]) * shader.scale.y,
+			shader.offset.z + rendering::decodeUnorm16(packed[v].position[2]) * shader.scale.z
+		};
+		if (fromShader.x != decoded.position.x || fromShader.y != decoded.position.y || fromShader.z != decoded.position.z) {
+			std::cerr << "error: the shader constant decodes vertex " << v << " differently\n";
+			return 1;
+		}
+
+		const float normal  = getAngleError(source.normal, decoded.normal);
+		const float tangent = getAngleError(source.tangent, decoded.tangent);
+		if (normal > 0.01f || tangent > 0.01f) {
+			std::cerr << "error: normal or tangent of vertex " << v << " is off by " << std::max(normal, tangent) << " degrees\n";
+			return 1;
+		}
+		normalError  = std::max(normalError, normal);
+		tangentError = std::max(tangentError, tangent);
+
+		// Half precision keeps 11 significant bits
+		const float uvBound = std::max(std::fabs(source.uv.x), std::fabs(source.uv.y)) / 2048.0f;
+		const float uvDelta = std::max(std::fabs(decoded.uv.x - source.uv.x), std::fabs(decoded.uv.y - source.uv.y));
+		if (uvDelta > uvBound) {
+			std::cerr << "error: uv of vertex " << v << " is off by " << uvDelta << '\n';
+			return 1;
+		}
+		uvError = std::max(uvError, uvDelta);
+	}
+
+	// Zero vectors decode to +Z rather than to nothing
+	const rendering::Vertex zero = rendering::unpackVertex<rendering::Vertex>(packed[std::size(edges) - 1], quantization);
+	if (zero.normal.z != 1.0f) {
+		std::cerr << "error: a zero normal does not decode to +Z\n";
+		return 1;
+	}
+
+	// 16-bit indices up to the last addressable vertex
+	if (!rendering::canUse16BitIndices(0xffff) || rendering::canUse16BitIndices(0x10000)) {
+		std::cerr << "error: canUse16BitIndices has the wrong limit\n";
+		return 1;
+	}
+	std::vector<uint32_t> indices(std::min<size_t>(vertices.size(), 0xffff) * 3);
+	for (size_t i = 0; i < indices.size(); ++i) indices[i] = static_cast<uint32_t>((i * 7919) % (indices.size() / 3));
+	indices.back() = static_cast<uint32_t>(indices.size() / 3 - 1);
+
+	const std::vector<uint16_t> shortIndices = rendering::packIndices(indices);
+	if (!std::equal(indices.begin(), indices.end(), shortIndices.begin(), shortIndices.end())) {
+		std::cerr << "error: 16-bit indices do not match\n";
+		return 1;
+	}
+
+	std::cout << "Packing checked over " << vertices.size() << " vertices and " << indices.size() << " indices\n";
+
+	constexpr int repeats = 5;
+
+	rendering::VertexQuantization  timedQuantization;
+	std::vector<rendering::Vertex> unpacked(vertices.size());
+	const double pack = timeBest(repeats, [&]() {
+		rendering::packVertices(vertices, timedQuantization);
+	});
+	const double unpack = timeBest(repeats, [&]() {
+		for (size_t v = 0; v < packed.size(); ++v) unpacked[v] = rendering::unpackVertex<rendering::Vertex>(packed[v], quantization);
+	});
+
+	std::cout << std::fixed << std::setprecision(6);
+	std::cout << "worst position error " << positionError << " of the box (bound " << 1.0f / 65535.0f << "), normal "
+			  << normalError << " deg, tangent " << tangentError << " deg, uv " << uvError << '\n';
+	std::cout << std::setprecision(2);
+	std::cout << "vertex " << sizeof(rendering::Vertex) << " -> " << sizeof(rendering::PackedVertex) << " bytes, "
+			  << 100.0 * (1.0 - static_cast<double>(sizeof(rendering::PackedVertex)) / sizeof(rendering::Vertex)) << "% smaller\n";
+	std::cout << "pack " << pack << " ms (" << pack * 1e6 / vertices.size() << " ns per vertex), unpack " << unpack << " ms ("
+			  << unpack * 1e6 / vertices.size() << " ns per vertex)\n";
+	return 0;
+}
+
+// Header of a baked file edited in place, for the cases SpmeshFile has to reject
+template <typename Edit>
+static std::vector<uint8_t> editSpmesh(std::vector<uint8_t> bytes, Edit edit) {
+	rendering::SpmeshHeader header;
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	edit(header, bytes);
+	std::memcpy(bytes.data(), &header, sizeof(header));
+	return bytes;
+}
+
+// Bakes the model in both vertex formats and checks that the baked files load back what was imported,
+// and that SpmeshFile rejects files broken the ways validate guards against. Then the two load paths
+// are timed on the CPU up to the upload copy: import, optimize, pack and copy against map and copy.
+static int benchmarkSpmesh(const std::filesystem::path& model) {
+	const std::filesystem::path folder = std::filesystem::temp_directory_path();
+
+	Assimp::Importer              importer;
+	const rendering::ImportedMesh imported = rendering::importMesh(importer, model);
+
+	// Stands in for the upload heap
+	std::vector<uint8_t> upload;
+	auto copyToUpload = [&upload](const void* data, const size_t bytes) {
+		upload.resize(bytes);
+		std::memcpy(upload.data(), data, bytes);
+	};
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << model.filename().string() << ": " << imported.indices.size() / 3 << " triangles in " << imported.lods.size() << " levels, "
+			  << imported.meshlets.meshlets.size() << " meshlets\n";
+	std::cout << std::setw(8) << "format" << std::setw(12) << "file KiB" << std::setw(12) << "import ms" << std::setw(12) << "baked ms" << std::setw(10) << "speedup\n";
+
+	for (const rendering::VertexFormat format : { rendering::VertexFormat::FULL, rendering::VertexFormat::PACKED }) {
+		const bool                  isPacked = format == rendering::VertexFormat::PACKED;
+		const std::filesystem::path path     = folder / (isPacked ? "spider-bench-packed.spmesh" : "spider-bench-full.spmesh");
+		rendering::writeSpmesh(path, imported, format);
+
+		{
+			const rendering::SpmeshFile     file(path);
+			const rendering::SpmeshHeader& header = file.getHeader();
+
+			bool isSame = header.vertexCount == imported.vertices.size() && header.indexCount == imported.indices.size() &&
+						  std::equal(file.getLods().begin(), file.getLods().end(), imported.lods.begin(), imported.lods.end(), [](const rendering::MeshLod& a, const rendering::MeshLod& b) {
+							  return a.indexOffset == b.indexOffset && a.indexCount == b.indexCount;
+						  }) &&
+						  file.getMeshlets().size() == imported.meshlets.meshlets.size() &&
+						  file.getSubmeshes().size() == imported.submeshes.size();
+
+			for (size_t i = 0; isSame && i < header.indexCount; ++i) {
+				const uint32_t index = header.indexSize == sizeof(uint16_t) ? static_cast<const uint16_t*>(file.getIndexData())[i]
+																			: static_cast<const uint32_t*>(file.getIndexData())[i];
+				isSame = index == imported.indices[i];
+			}
+			if (isSame && !isPacked) isSame = std::memcmp(file.getVertexData(), imported.vertices.data(), header.vertices.size) == 0;
+
+			if (!isSame) {
+				std::cerr << "error: " << path.filename().string() << " does not hold the imported mesh\n";
+				return 1;
+			}
+		}
+
+		std::vector<uint8_t> bytes(std::filesystem::file_size(path));
+		std::ifstream(path, std::ios::binary).read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+		const std::pair<const char*, std::vector<uint8_t>> broken[] = {
+			{ "index size", editSpmesh(bytes, [](rendering::SpmeshHeader& header, std::vector<uint8_t>&) { header.indexSize = 3; }) },
+			{ "zero stride", editSpmesh(bytes, [](rendering::SpmeshHeader& header, std::vector<uint8_t>&) { header.vertexStride = 0; }) },
+			{ "vertex format", editSpmesh(bytes, [](rendering::SpmeshHeader& header, std::vector<uint8_t>&) { header.vertexFormat = 7; }) },
+			{ "meshlet count", editSpmesh(bytes, [](rendering::SpmeshHeader& header, std::vector<uint8_t>&) { ++header.meshletCount; }) },
+			{ "misaligned", editSpmesh(bytes, [](rendering::SpmeshHeader& header, std::vector<uint8_t>&) { header.meshletBounds.offset += 4; }) },
+			{ "lod range", editSpmesh(bytes, [](rendering::SpmeshHeader& header, std::vector<uint8_t>& data) {
+				rendering::MeshLod lod = { header.indexCount - 3, 6, 0.0f };
+				std::memcpy(data.data() + header.lods.offset, &lod, sizeof(lod));
+			}) },
+			{ "submesh lod range", editSpmesh(bytes, [](rendering::SpmeshHeader& header, std::vector<uint8_t>& data) {
+				rendering::MeshLod lod = { header.indexCount + 1, 0, 0.0f };
+				std::memcpy(data.data() + header.submeshLods.offset + header.submeshLods.size - sizeof(lod), &lod, sizeof(lod));
+			}) }
+		};
+
+		const std::filesystem::path brokenPath = folder / "spider-bench-broken.spmesh";
+		for (const auto& [name, brokenBytes] : broken) {
+			std::ofstream(brokenPath, std::ios::binary | std::ios::trunc).write(reinterpret_cast<const char*>(brokenBytes.data()), static_cast<std::streamsize>(brokenBytes.size()));
+
+			bool isRejected = false;
+			try {
+				rendering::SpmeshFile file(brokenPath);
+			}
+			catch (const std::runtime_error&) {
+				isRejected = true;
+			}
+			if (!isRejected) {
+				std::cerr << "error: a spmesh with a bad " << name << " was accepted\n";
+				return 1;
+			}
+		}
+		std::filesystem::remove(brokenPath);
+
+		constexpr int repeats = 3;
+
+		const double importTime = timeBest(repeats, [&]() {
+			Assimp::Importer              runImporter;
+			const rendering::ImportedMesh mesh = rendering::importMesh(runImporter, model);
+			if (isPacked) {
+				rendering::VertexQuantization              quantization;
+				const std::vector<rendering::PackedVertex> vertices = rendering::packVertices(mesh.vertices, quantization);
+				copyToUpload(vertices.data(), vertices.size() * sizeof(rendering::PackedVertex));
+			}
+			else {
+				copyToUpload(mesh.vertices.data(), mesh.vertices.size() * sizeof(rendering::Vertex));
+			}
+			copyToUpload(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+		});
+		const double bakedTime = timeBest(repeats, [&]() {
+			const rendering::SpmeshFile file(path);
+			copyToUpload(file.getVertexData(), file.getHeader().vertices.size);
+			copyToUpload(file.getIndexData(), file.getHeader().indices.size);
+
+			std::vector<rendering::Meshlet> meshlets(file.getMeshlets().begin(), file.getMeshlets().end());
+			std::vector<rendering::Submesh> submeshes(file.getSubmeshes().begin(), file.getSubmeshes().end());
+		});
+
+		std::cout << std::setw(8) << (isPacked ? "packed" : "full") << std::setw(12) << bytes.size() / 1024.0 << std::setw(12) << importTime
+				  << std::setw(12) << bakedTime << std::setw(8) << std::setprecision(1) << importTime / bakedTime << "x\n" << std::setprecision(2);
+
+		std::filesystem::remove(path);
+	}
+	std::cout << "Baked files checked, every broken one rejected\n";
+	return 0;
+}
+
+// Camera script of the residency check: a walk down the corridor, a stop, a turn back, a jitter in place
+struct ResidencyPhase {
+	const char* name;
+	int         frames;
+	float       speed;  // Units per frame along the view direction
+	float       jitter; // Back and forth amplitude, in units
+	bool        isBackward;
+};
+
+// Textured props along a corridor, requested the way TextureStreamer requests them while a scripted
+// camera walks through. Loads land a few frames after they are issued. Every frame checks that:
+// - resident and pending bytes stay within the budget;
+// - loads go one level at a time, the largest on screen first, never finer than requested.
+// A level evicted and loaded again within a second is counted as thrashing. None is allowed once the
+// camera stands still or jitters in place, and a still camera must stop loading within half its phase.
+static int benchmarkResidency(const size_t count) {
+	constexpr size_t   budget        = 256ull << 20;
+	constexpr uint32_t loadsPerFrame = 8;
+	constexpr int      latency       = 3;  // Frames from issuing a load to completing it
+	constexpr int      thrashWindow  = 60; // Frames
+
+	std::mt19937                          random(0x7E5);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	struct Prop {
+		rendering::BoundingVolume bounds;
+		uint32_t                  size;
+		uint32_t                  mipLevels;
+	};
+
+	rendering::TextureResidency      residency(budget, loadsPerFrame);
+	std::vector<Prop>                props(count);
+	std::vector<rendering::StreamingTextureId> ids(count);
+	size_t                           tailBytes = 0;
+	for (size_t p = 0; p < count; ++p) {
+		Prop& prop = props[p];
+		prop.bounds.center  = { (unit(random) * 2.0f - 1.0f) * 20.0f, unit(random) * 4.0f, unit(random) * 1000.0f };
+		prop.bounds.radius  = 0.5f + 2.5f * unit(random);
+		prop.bounds.extents = { prop.bounds.radius, prop.bounds.radius, prop.bounds.radius };
+		prop.size           = 1024u << (random() % 3);
+
+		// BC7, a byte per texel
+		rendering::StreamingTextureDesc desc;
+		desc.width  = prop.size;
+		desc.height = prop.size;
+		for (uint32_t size = prop.size; size > 0; size >>= 1) desc.mipBytes.push_back(std::max<size_t>(size_t(size) * size, 16));
+		prop.mipLevels = static_cast<uint32_t>(desc.mipBytes.size());
+
+		ids[p] = residency.add(desc);
+		for (uint32_t level = residency.getTailMip(ids[p]); level < prop.mipLevels; ++level) tailBytes += desc.mipBytes[level];
+	}
+	if (tailBytes > budget) {
+		std::cerr << "error: the tails alone do not fit the budget\n";
+		return 1;
+	}
+
+	const ResidencyPhase phases[] = {
+		{ "walk",   600, 1.5f, 0.0f, false },
+		{ "stop",   240, 0.0f, 0.0f, false },
+		{ "turn",   240, 0.0f, 0.0f, true  },
+		{ "jitter", 240, 0.0f, 0.5f, true  }
+	};
+
+	rendering::Camera camera(1920, 1080);
+	camera.setClippingPlanes(0.1f, 1000.0f);
+	const float pixelsPerUnitAtOne = static_cast<float>(camera.getHeight()) / (2.0f * std::tan(camera.getFov() * 0.5f));
+
+	// Frame each level of each texture was last evicted at, and loads waiting to land
+	std::vector<std::vector<int>>                           evictedAt(count);
+	std::deque<std::pair<int, rendering::TextureResidencyChange>> inFlight;
+	for (size_t p = 0; p < count; ++p) evictedAt[p].assign(props[p].mipLevels, -thrashWindow - 1);
+
+	std::vector<float> pixels(count);
+
+	float z     = -50.0f;
+	int   frame = 0;
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << count << " textures, " << (tailBytes >> 20) << " MiB of tails, " << (budget >> 20) << " MiB budget\n";
+	std::cout << std::setw(8) << "phase" << std::setw(8) << "loads" << std::setw(11) << "evictions" << std::setw(9) << "thrash"
+			  << std::setw(12) << "peak usage" << std::setw(10) << "limited" << std::setw(12) << "update ms\n";
+
+	for (const ResidencyPhase& phase : phases) {
+		size_t loads   = 0;
+		size_t evicted = 0;
+		size_t thrash  = 0;
+		size_t limited = 0;
+		double peak    = 0.0;
+		double update  = 0.0;
+		int    settled = 0; // First frame after the last load or eviction of the phase
+
+		for (int f = 0; f < phase.frames; ++f, ++frame) {
+			z += phase.speed;
+			const float jitter = phase.jitter * std::sin(static_cast<float>(f) * 0.7f);
+
+			camera.transform.position = DirectX::XMVectorSet(jitter, 2.0f, z, 1.0f);
+			camera.transform.rotation = DirectX::XMQuaternionRotationRollPitchYaw(0.0f, phase.isBackward ? DirectX::XM_PI : 0.0f, 0.0f);
+			camera.updateViewMatrix();
+
+			const rendering::Frustum frustum = rendering::Frustum::fromViewProjection(camera.getViewProjectionMatrix());
+			const DirectX::XMFLOAT3  eye     = { jitter, 2.0f, z };
+
+			std::fill(pixels.begin(), pixels.end(), 0.0f);
+			for (size_t p = 0; p < count; ++p) {
+				const Prop& prop = props[p];
+				if (!frustum.intersects(prop.bounds)) continue;
+
+				const float dx       = prop.bounds.center.x - eye.x;
+				const float dy       = prop.bounds.center.y - eye.y;
+				const float dz       = prop.bounds.center.z - eye.z;
+				const float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz) - prop.bounds.radius, camera.getNearZ());
+
+				pixels[p] = rendering::TextureResidency::computeScreenPixels(prop.bounds.radius, distance, pixelsPerUnitAtOne);
+				residency.request(ids[p], rendering::TextureResidency::computeDesiredMip(prop.size, prop.size, prop.mipLevels, pixels[p]), pixels[p]);
+			}
+
+			residency.update();
+			const rendering::TextureStreamingStats& stats = residency.getStats();
+
+			if (stats.residentBytes + stats.pendingBytes > budget) {
+				std::cerr << "error: frame " << frame << " holds " << stats.residentBytes + stats.pendingBytes << " bytes over a budget of " << budget << '\n';
+				return 1;
+			}
+
+			for (const rendering::TextureResidencyChange& eviction : residency.getEvictions()) {
+				for (uint32_t level = eviction.fromMip; level < eviction.toMip; ++level) evictedAt[eviction.id][level] = frame;
+			}
+
+			const std::vector<rendering::TextureResidencyChange>& issued = residency.getLoads();
+			for (size_t l = 0; l < issued.size(); ++l) {
+				const rendering::TextureResidencyChange& load = issued[l];
+				const uint32_t requested = rendering::TextureResidency::computeDesiredMip(props[load.id].size, props[load.id].size, props[load.id].mipLevels, pixels[load.id]);
+
+				if (load.toMip + 1 != load.fromMip || load.toMip < requested || (l > 0 && pixels[load.id] > pixels[issued[l - 1].id])) {
+					std::cerr << "error: frame " << frame << " loads texture " << load.id << " from mip " << load.fromMip << " to " << load.toMip
+							  << " out of order (requested " << requested << ")\n";
+					return 1;
+				}
+				if (frame - evictedAt[load.id][load.toMip] <= thrashWindow) ++thrash;
+
+				inFlight.push_back({ frame + latency, load });
+			}
+			while (!inFlight.empty() && inFlight.front().first <= frame) {
+				residency.completeLoad(inFlight.front().second.id, inFlight.front().second.toMip);
+				inFlight.pop_front();
+			}
+
+			if (!issued.empty() || !residency.getEvictions().empty()) settled = f + 1;
+
+			loads   += issued.size();
+			evicted += residency.getEvictions().size();
+			limited  = std::max(limited, stats.budgetLimited);
+			peak     = std::max(peak, stats.getBudgetUsage());
+			update  += stats.milliseconds;
+		}
+
+		std::cout << std::setw(8) << phase.name << std::setw(8) << loads << std::setw(11) << evicted << std::setw(9) << thrash
+				  << std::setw(11) << peak * 100.0 << '%' << std::setw(10) << limited << std::setw(11) << update / phase.frames << '\n';
+
+		if (thrash && phase.speed == 0.0f) {
+			std::cerr << "error: levels thrash while the camera stays in place (" << phase.name << ")\n";
+			return 1;
+		}
+		if (phase.speed == 0.0f && phase.jitter == 0.0f && settled > phase.frames / 2) {
+			std::cerr << "error: residency still changes " << settled << " frames into a still camera (" << phase.name << ")\n";
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Every filter, single threaded and parallel, on a noisy image so nothing is uniform
+static int benchmarkMips(const uint32_t size) {
+	std::vector<uint8_t> pixels(size_t(size) * size * 4);
+	uint32_t             state = 0x9E3779B9u;
+	for (uint8_t& pixel : pixels) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		pixel  = static_cast<uint8_t>(state);
+	}
+
+	constexpr int repeats = 5;
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << std::setw(8) << "filter" << std::setw(10) << "threads" << std::setw(10) << "ms" << std::setw(12) << "MP/s\n";
+	for (const rendering::MipFilter filter : { rendering::MipFilter::BOX, rendering::MipFilter::KAISER }) {
+		for (const bool isParallel : { false, true }) {
+			rendering::MipSettings mips;
+			mips.filter     = filter;
+			mips.isParallel = isParallel;
+
+			// Best of a few runs, the first one also pays for the lookup tables
+			rendering::MipGenerationStats best;
+			for (int r = 0; r < repeats; ++r) {
+				rendering::MipGenerationStats stats;
+				rendering::MipGenerator::generate(pixels.data(), size, size, size_t(size) * 4, mips, &stats);
+				if (r == 0 || stats.milliseconds < best.milliseconds) best = stats;
+			}
+
+			std::cout << std::setw(8) << (filter == rendering::MipFilter::BOX ? "box" : "kaiser")
+					  << std::setw(10) << (isParallel ? "all" : "1")
+					  << std::setw(10) << best.milliseconds
+					  << std::setw(11) << best.getMegapixelsPerSecond() << '\n';
+		}
+	}
+	return 0;
+}
+
+// A material library: mostly small textures in RGBA8 and BC7 with sizes in steps of 32 texels, some of
+// them repeated often enough to make arrays, and a few large or tiling ones that stay on their own
+static std::vector<rendering::TexturePackInput> makeBenchmarkTextures(const size_t count) {
+	std::mt19937                            random(0xA71A5);
+	std::uniform_int_distribution<uint32_t> steps(1, 8);
+	std::uniform_int_distribution<uint32_t> kind(0, 99);
+
+	std::vector<rendering::TexturePackInput> inputs(count);
+	for (rendering::TexturePackInput& input : inputs) {
+		const uint32_t k = kind(random);
+		input.width     = k < 5 ? 1024 : 32 * steps(random);
+		input.height    = k < 5 || k % 2 ? input.width : 32 * steps(random);
+		input.mipLevels = 1 + static_cast<uint32_t>(std::log2(std::max(input.width, input.height)));
+		input.isTiling  = k >= 90;
+		if (k % 3 == 0) {
+			input.format    = DXGI_FORMAT_BC7_UNORM;
+			input.blockSize = 4;
+		}
+		else {
+			input.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		}
+	}
+	return inputs;
+}
+
+// Every texture has to be placed once. Array slices share format, size and mips. Atlas rects, gutters
+// included, stay inside their page without overlapping, start every kept mip on a whole block, and
+// their uv transform maps [0, 1] onto them. Tiling and large textures never go to an atlas. The plan is
+// checked with arrays and with atlases alone, where the pages have to be mostly texture, then the
+// binding changes are reported and planning is timed.
+static int benchmarkAtlas(const size_t count) {
+	const std::vector<rendering::TexturePackInput> inputs = makeBenchmarkTextures(count);
+
+	auto check = [&](const rendering::TexturePackPlan& plan, const rendering::TexturePackSettings& settings, const rendering::TexturePackingStats& stats) {
+		std::vector<uint32_t> seen(inputs.size(), 0);
+		for (uint32_t p = 0; p < plan.pages.size(); ++p) {
+			const rendering::TexturePage& page = plan.pages[p];
+			for (const uint32_t id : page.textures) ++seen[id];
+
+			for (size_t t = 0; t < page.textures.size(); ++t) {
+				const uint32_t                     id        = page.textures[t];
+				const rendering::TexturePackInput& input     = inputs[id];
+				const rendering::TexturePlacement& placement = plan.placements[id];
+
+				if (placement.page != p || input.format != page.format || input.blockSize != page.blockSize) {
+					std::cerr << "error: texture " << id << " is listed in page " << p << " but placed in page " << placement.page << '\n';
+					return false;
+				}
+				if (page.type == rendering::TexturePageType::ARRAY &&
+					(input.width != page.width || input.height != page.height || input.mipLevels != page.mipLevels || placement.slice != t || page.arraySize < settings.minArraySlices))
+				{
+					std::cerr << "error: texture " << id << " does not match slice " << t << " of array page " << p << '\n';
+					return false;
+				}
+				if (page.type != rendering::TexturePageType::ATLAS) continue;
+
+				const uint32_t              alignment = page.blockSize << (page.mipLevels - 1);
+				const rendering::AtlasRect& rect      = placement.rect;
+				const bool isInside   = rect.x >= page.gutter && rect.y >= page.gutter && rect.x + rect.width + page.gutter <= page.width && rect.y + rect.height + page.gutter <= page.height;
+				const bool isAligned  = rect.x % alignment == 0 && rect.y % alignment == 0;
+				const bool isEligible = !input.isTiling && std::max(input.width, input.height) <= settings.maxPackedSize;
+				if (!isInside || !isAligned || !isEligible || rect.width != input.width || rect.height != input.height) {
+					std::cerr << "error: texture " << id << " at " << rect.x << ',' << rect.y << " does not belong in atlas page " << p << '\n';
+					return false;
+				}
+
+				const float uvRight  = placement.uvOffset.x + placement.uvScale.x;
+				const float uvBottom = placement.uvOffset.y + placement.uvScale.y;
+				if (std::fabs(placement.uvOffset.x * page.width - rect.x) > 1e-2f || std::fabs(uvRight * page.width - (rect.x + rect.width)) > 1e-2f ||
+					std::fabs(placement.uvOffset.y * page.height - rect.y) > 1e-2f || std::fabs(uvBottom * page.height - (rect.y + rect.height)) > 1e-2f)
+				{
+					std::cerr << "error: the uv transform of texture " << id << " misses its rect\n";
+					return false;
+				}
+
+				for (size_t o = 0; o < t; ++o) {
+					const rendering::AtlasRect& other = plan.placements[page.textures[o]].rect;
+					const bool isApartX = rect.x + rect.width + page.gutter <= other.x - page.gutter || other.x + other.width + page.gutter <= rect.x - page.gutter;
+					const bool isApartY = rect.y + rect.height + page.gutter <= other.y - page.gutter || other.y + other.height + page.gutter <= rect.y - page.gutter;
+					if (!isApartX && !isApartY) {
+						std::cerr << "error: textures " << id << " and " << page.textures[o] << " overlap in atlas page " << p << '\n';
+						return false;
+					}
+				}
+			}
+		}
+		for (size_t id = 0; id < inputs.size(); ++id) {
+			if (seen[id] != 1) {
+				std::cerr << "error: texture " << id << " is in " << seen[id] << " pages\n";
+				return false;
+			}
+		}
+		if (stats.getResourceCount() != plan.pages.size() || stats.textureCount != inputs.size()) {
+			std::cerr << "error: the stats count " << stats.getResourceCount() << " resources for " << plan.pages.size() << " pages\n";
+			return false;
+		}
+		return true;
+	};
+
+	rendering::TexturePackSettings atlasSettings;
+	atlasSettings.useArrays = false;
+
+	rendering::TexturePackingStats stats;
+	rendering::TexturePackingStats atlasStats;
+	rendering::TexturePackPlan     plan      = rendering::TexturePacker::plan(inputs, {}, &stats);
+	rendering::TexturePackPlan     atlasPlan = rendering::TexturePacker::plan(inputs, atlasSettings, &atlasStats);
+	if (!check(plan, {}, stats) || !check(atlasPlan, atlasSettings, atlasStats)) return 1;
+
+	// Gutters take a share of the smaller textures whatever the packer does, so it is judged on the
+	// padded rects it was given
+	size_t paddedTexels = 0;
+	for (const rendering::TexturePage& page : atlasPlan.pages) {
+		if (page.type != rendering::TexturePageType::ATLAS) continue;
+
+		const uint32_t alignment = page.blockSize << (page.mipLevels - 1);
+		for (const uint32_t id : page.textures) {
+			const rendering::AtlasRect& rect = atlasPlan.placements[id].rect;
+			paddedTexels += size_t((rect.width + 2 * page.gutter + alignment - 1) / alignment * alignment) *
+							((rect.height + 2 * page.gutter + alignment - 1) / alignment * alignment);
+		}
+	}
+	const double packerEfficiency = atlasStats.atlasTexels ? static_cast<double>(paddedTexels) / atlasStats.atlasTexels : 0.0;
+	if (atlasStats.atlasCount == 0 || packerEfficiency < 0.85) {
+		std::cerr << "error: padded rects only cover " << 100.0 * packerEfficiency << "% of the atlas pages\n";
+		return 1;
+	}
+	std::cout << "Packing checked " << inputs.size() << " textures into " << plan.pages.size() << " resources, "
+			  << atlasPlan.pages.size() << " without arrays\n";
+
+	// Draws grouped by material, as a scene would be sorted
+	std::mt19937          random(0xD4A3);
+	std::vector<uint32_t> drawOrder(inputs.size() * 4);
+	for (uint32_t& id : drawOrder) id = std::uniform_int_distribution<uint32_t>(0, static_cast<uint32_t>(inputs.size() - 1))(random);
+	std::sort(drawOrder.begin(), drawOrder.end());
+	plan.measureBindings(drawOrder, stats);
+	atlasPlan.measureBindings(drawOrder, atlasStats);
+
+	const double planning = timeBest(5, [&]() {
+		plan = rendering::TexturePacker::plan(inputs);
+	});
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << std::setw(10) << "settings" << std::setw(12) << "standalone" << std::setw(8) << "arrays" << std::setw(9) << "atlases"
+			  << std::setw(12) << "efficiency" << std::setw(10) << "bindings\n";
+	for (const auto& [name, packing] : { std::pair{ "default", &stats }, std::pair{ "no arrays", &atlasStats } }) {
+		std::cout << std::setw(10) << name << std::setw(12) << packing->standaloneCount << std::setw(8) << packing->arrayCount << std::setw(9) << packing->atlasCount
+				  << std::setw(11) << 100.0 * packing->getAtlasEfficiency() << '%' << std::setw(9) << packing->bindingsAfter << '\n';
+	}
+	std::cout << "unpacked: " << inputs.size() << " resources, " << stats.bindingsBefore << " bindings over " << drawOrder.size() << " draws\n";
+	std::cout << "padded rects cover " << 100.0 * packerEfficiency << "% of the atlas pages\n";
+	std::cout << std::setprecision(3) << "planned in " << planning << " ms\n";
+	return 0;
+}
+
+// Stands in for a mesh or texture, only its size matters to the cache
+struct CachedBlob {
+	uint64_t content;
+	size_t   bytes;
+};
+
+// A scripted case first: path and content hits, handles that keep entries past the budget, least
+// recently used eviction and purge. Then frames of skewed lookups, every content under two paths, are
+// replayed against a plain LRU model of the same policy: loads, evictions and bytes have to match,
+// and the cache may only be over budget while every entry is held.
+static int benchmarkAssetCache(const size_t count) {
+	auto sizeOf = [](const CachedBlob& blob) { return blob.bytes; };
+	auto load   = [](const uint64_t content, const size_t bytes) { return [=]() { return CachedBlob{ content, bytes }; }; };
+	auto hash   = [](const uint64_t content) { return [=]() { return content; }; };
+
+	{
+		AssetCache<CachedBlob> cache(sizeOf, 300);
+
+		std::shared_ptr<CachedBlob> a = cache.acquire("a", hash(1), load(1, 100));
+		std::shared_ptr<CachedBlob> b = cache.acquire("b", hash(2), load(2, 100));
+		std::shared_ptr<CachedBlob> c = cache.acquire("c", hash(3), load(3, 100));
+		const bool isShared = cache.acquire("a", hash(1), load(1, 100)) == a && cache.acquire("copy of b", hash(2), load(2, 100)) == b;
+
+		// Held entries stay whatever the budget
+		std::shared_ptr<CachedBlob> d = cache.acquire("d", hash(4), load(4, 100));
+		const AssetCacheStats held = cache.getStats();
+
+		// a and b were looked up again after c, so c goes first once nothing holds them
+		a.reset();
+		b.reset();
+		c.reset();
+		cache.trim();
+		const bool isLruEvicted = !cache.find("c") && cache.find("a") && cache.find("b") && cache.find("copy of b") && cache.find("d");
+
+		cache.purge();
+		const AssetCacheStats purged = cache.getStats();
+
+		if (!isShared || held.misses != 4 || held.pathHits != 1 || held.contentHits != 1 || held.bytes != 400 || held.evictions != 0 ||
+			!isLruEvicted || purged.entries != 1 || purged.referenced != 1 || purged.bytes != 100)
+		{
+			std::cerr << "error: the scripted cache case failed (shared " << isShared << ", " << held.misses << " loads, " << held.bytes
+					  << " bytes held, lru " << isLruEvicted << ", " << purged.entries << " entries after purge)\n";
+			return 1;
+		}
+	}
+
+	std::mt19937                          random(0xCAC4E);
+	std::uniform_int_distribution<size_t> size(1 << 10, 1 << 20);
+	std::exponential_distribution<double> rank(8.0 / static_cast<double>(count));
+
+	std::vector<size_t> bytes(count);
+	size_t              totalBytes = 0;
+	for (size_t& b : bytes) totalBytes += b = size(random);
+	const size_t budget = totalBytes / 4;
+
+	constexpr int    frames          = 200;
+	constexpr size_t lookupsPerFrame = 200;
+	std::vector<size_t> lookups(frames * lookupsPerFrame);
+	for (size_t& lookup : lookups) lookup = std::min<size_t>(static_cast<size_t>(rank(random)), count - 1) + (random() % 2) * count;
+
+	// The model keys entries by content, a second path to a resident content is found without loading
+	struct ModelEntry {
+		uint64_t lastUsed;
+		int      held;
+	};
+	ska::flat_hash_map<size_t, ModelEntry> model;
+	size_t   modelBytes     = 0;
+	size_t   modelLoads     = 0;
+	size_t   modelEvictions = 0;
+	uint64_t tick           = 0;
+
+	auto modelTrim = [&]() {
+		if (modelBytes <= budget) return;
+
+		std::vector<std::pair<uint64_t, size_t>> unreferenced;
+		for (const auto& [content, entry] : model) {
+			if (entry.held == 0) unreferenced.push_back({ entry.lastUsed, content });
+		}
+		std::sort(unreferenced.begin(), unreferenced.end());
+		for (const auto& [lastUsed, content] : unreferenced) {
+			if (modelBytes <= budget) break;
+			modelBytes -= bytes[content];
+			model.erase(content);
+			++modelEvictions;
+		}
+	};
+
+	AssetCache<CachedBlob>                   cache(sizeOf, budget);
+	std::vector<std::shared_ptr<CachedBlob>> handles;
+	std::vector<size_t>                      heldContents;
+	for (int frame = 0; frame < frames; ++frame) {
+		for (size_t l = 0; l < lookupsPerFrame; ++l) {
+			const size_t path    = lookups[frame * lookupsPerFrame + l];
+			const size_t content = path % count;
+
+			handles.push_back(cache.acquire(std::to_string(path), hash(content), load(content, bytes[content])));
+			if (handles.back()->content != content) {
+				std::cerr << "error: path " << path << " returned content " << handles.back()->content << '\n';
+				return 1;
+			}
+
+			auto it = model.find(content);
+			if (it == model.end()) {
+				model[content] = { ++tick, 1 };
+				modelBytes    += bytes[content];
+				++modelLoads;
+				modelTrim();
+			}
+			else {
+				it->second.lastUsed = ++tick;
+				++it->second.held;
+			}
+			heldContents.push_back(content);
+		}
+
+		// The frame lets go of its handles, then trims as the renderer does
+		handles.clear();
+		for (const size_t content : heldContents) --model[content].held;
+		heldContents.clear();
+		cache.trim();
+		modelTrim();
+
+		const AssetCacheStats stats = cache.getStats();
+		if (stats.misses != modelLoads || stats.evictions != modelEvictions || stats.bytes != modelBytes || stats.bytes > budget) {
+			std::cerr << "error: frame " << frame << " has " << stats.misses << " loads, " << stats.evictions << " evictions and " << stats.bytes
+					  << " bytes, the LRU model " << modelLoads << ", " << modelEvictions << " and " << modelBytes << '\n';
+			return 1;
+		}
+	}
+	const AssetCacheStats stats = cache.getStats();
+	std::cout << "Cache checked over " << lookups.size() << " lookups of " << count << " assets under two paths each, budget "
+			  << budget / (1 << 20) << " MB of " << totalBytes / (1 << 20) << " MB\n";
+
+	// Hits by path on held assets, then misses that load and evict
+	for (size_t l = 0; l < 64; ++l) handles.push_back(cache.acquire(std::to_string(lookups[l]), hash(lookups[l] % count), load(lookups[l] % count, bytes[lookups[l] % count])));
+	const size_t timed = 100000;
+	size_t       found = 0;
+	const double hits  = timeBest(5, [&]() {
+		for (size_t l = 0; l < timed; ++l) found += cache.find(std::to_string(lookups[l % 64])) != nullptr;
+	});
+	if (found != 5 * timed) {
+		std::cerr << "error: " << 5 * timed - found << " lookups of held assets missed\n";
+		return 1;
+	}
+	AssetCache<CachedBlob> churn(sizeOf, budget);
+	const double misses = timeBest(1, [&]() {
+		for (size_t l = 0; l < lookups.size(); ++l) churn.acquire(std::to_string(l), hash(l), load(l, bytes[l % count]));
+	});
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "hit rate " << 100.0 * stats.getHitRate() << "% (" << stats.pathHits << " by path, " << stats.contentHits << " by content), "
+			  << stats.misses << " loads, " << stats.evictions << " evictions\n";
+	std::cout << std::setprecision(3);
+	std::cout << "path hit " << hits * 1e6 / timed << " ns, load with eviction " << misses * 1e6 / lookups.size() << " ns\n";
+	return 0;
+}
+
+// One step of the allocation workload, replayed the same way on every allocator
+struct AllocationStep {
+	bool     isFree;
+	uint64_t size;      // Allocations only
+	uint64_t alignment;
+	size_t   slot;      // Live allocation freed, frees only
+};
+
+// Resource sized requests over a 4 GB space: mostly small buffers and textures, some large ones,
+// with placed resource alignments (4 KB small textures, 64 KB buffers and textures, 4 MB MSAA)
+static std::vector<AllocationStep> makeAllocationWorkload(const size_t operations) {
+	std::mt19937_64             random(0x5EED);
+	std::vector<AllocationStep> steps;
+	steps.reserve(operations);
+
+	size_t live = 0;
+	for (size_t o = 0; o < operations; ++o) {
+		// Grows towards two thousand live allocations (about two thirds full), then churns around it
+		if (live > 0 && random() % 100 < (live > 2048 ? 60u : 40u)) {
+			steps.push_back({ true, 0, 0, random() % live });
+			--live;
+			continue;
+		}
+
+		const uint32_t kind      = random() % 100;
+		const uint64_t size      = kind < 70 ? 256 + random() % (256 << 10) : kind < 97 ? (256 << 10) + random() % (4 << 20) : (4 << 20) + random() % (32 << 20);
+		const uint64_t alignment = kind < 40 ? 4096 : kind < 99 ? 65536 : 4 << 20;
+		steps.push_back({ false, size, alignment, 0 });
+		++live;
+	}
+	return steps;
+}
+
+// Replays the workload, the allocator's free() takes whatever its allocate() returned.
+// The stats are taken at the end of the workload, before everything is freed.
+template <typename Allocator, typename Allocate>
+static double runAllocationWorkload(Allocator& allocator, const std::vector<AllocationStep>& steps, Allocate allocate, size_t& failures, OffsetAllocatorStats& stats) {
+	using Allocation = decltype(allocate(allocator, steps.front()));
+
+	std::vector<Allocation> live;
+	live.reserve(steps.size());
+	failures = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for (const AllocationStep& step : steps) {
+		if (step.isFree) {
+			if (live.empty()) continue;
+
+			const size_t slot = step.slot % live.size();
+			allocator.free(live[slot]);
+			live[slot] = live.back();
+			live.pop_back();
+		}
+		else {
+			Allocation allocation = allocate(allocator, step);
+			if (allocation.isValid()) live.push_back(allocation);
+			else                      ++failures;
+		}
+	}
+	auto finish = std::chrono::steady_clock::now();
+
+	stats = allocator.getStats();
+	for (const Allocation& allocation : live) allocator.free(allocation);
+	return std::chrono::duration<double, std::nano>(finish - start).count();
+}
+
+// Every TLSF allocation is checked against the live ones for overlaps, bounds and alignment,
+// then the allocators are timed on the same steps
+static int benchmarkAllocators(const size_t operations) {
+	const std::vector<AllocationStep> steps = makeAllocationWorkload(operations);
+	constexpr uint64_t                capacity = 4ull << 30;
+
+	{
+		TlsfAllocator                           allocator(capacity, 256);
+		std::vector<TlsfAllocation>             live;
+		std::map<uint64_t, uint64_t>            ranges;
+		uint64_t                                used = 0;
+		for (const AllocationStep& step : steps) {
+			if (step.isFree) {
+				if (live.empty()) continue;
+
+				const size_t         slot       = step.slot % live.size();
+				const TlsfAllocation allocation = live[slot];
+				allocator.free(allocation);
+				ranges.erase(allocation.offset);
+				used      -= allocation.size;
+				live[slot] = live.back();
+				live.pop_back();
+			}
+			else {
+				const TlsfAllocation allocation = allocator.allocate(step.size, step.alignment);
+				if (!allocation.isValid()) continue;
+
+				bool isValid = allocation.size >= step.size && allocation.offset % step.alignment == 0 && allocation.offset + allocation.size <= capacity;
+				auto next    = ranges.upper_bound(allocation.offset);
+				if (next != ranges.end())   isValid &= allocation.offset + allocation.size <= next->first;
+				if (next != ranges.begin()) isValid &= std::prev(next)->first + std::prev(next)->second <= allocation.offset;
+				if (!isValid) {
+					std::cerr << "error: TLSF returned a bad block at offset " << allocation.offset << '\n';
+					return 1;
+				}
+
+				ranges.emplace(allocation.offset, allocation.size);
+				used += allocation.size;
+				live.push_back(allocation);
+			}
+
+			if (allocator.getUsed() != used) {
+				std::cerr << "error: TLSF lost track of its used size\n";
+				return 1;
+			}
+		}
+
+		for (const TlsfAllocation& allocation : live) allocator.free(allocation);
+		const OffsetAllocatorStats stats = allocator.getStats();
+		if (stats.used != 0 || stats.freeBlockCount != 1 || stats.largestFreeBlock != capacity) {
+			std::cerr << "error: TLSF did not merge every block back\n";
+			return 1;
+		}
+		std::cout << "TLSF checked over " << steps.size() << " operations\n";
+	}
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << std::setw(18) << "allocator" << std::setw(12) << "ns/op" << std::setw(12) << "failures" << std::setw(12) << "occupancy" << std::setw(16) << "fragmentation" << std::setw(14) << "free blocks\n";
+
+	auto report = [&steps](const char* name, const double nanoseconds, const size_t failures, const OffsetAllocatorStats& stats) {
+		std::cout << std::setw(18) << name << std::setw(12) << nanoseconds / steps.size() << std::setw(12) << failures
+				  << std::setw(11) << stats.getOccupancy() * 100.0 << " %" << std::setw(14) << stats.getFragmentation() * 100.0 << " %"
+				  << std::setw(13) << stats.freeBlockCount << '\n';
+	};
+
+	size_t               failures;
+	OffsetAllocatorStats stats;
+
+	// OffsetAllocator has no alignment, it gets the sizes only
+	OffsetAllocator offsetAllocator(capacity);
+	const double offsetTime = runAllocationWorkload(offsetAllocator, steps, [](OffsetAllocator& allocator, const AllocationStep& step) {
+		return allocator.allocate(step.size);
+	}, failures, stats);
+	report("offset (no align)", offsetTime, failures, stats);
+
+	TlsfAllocator tlsfAllocator(capacity, 256);
+	const double tlsfTime = runAllocationWorkload(tlsfAllocator, steps, [](TlsfAllocator& allocator, const AllocationStep& step) {
+		return allocator.allocate(step.size);
+	}, failures, stats);
+	report("tlsf (no align)", tlsfTime, failures, stats);
+
+	const double alignedTime = runAllocationWorkload(tlsfAllocator, steps, [](TlsfAllocator& allocator, const AllocationStep& step) {
+		return allocator.allocate(step.size, step.alignment);
+	}, failures, stats);
+	report("tlsf (aligned)", alignedTime, failures, stats);
+
+	return 0;
+}
+
+// Deferred frame shaped graph: chains of render target and compute passes, each reading a couple of
+// recent outputs, debug passes nobody reads (culled), read-modify-write compute passes, and a final
+// pass composing into the imported back buffer
+static rendering::RenderGraph makeBenchmarkGraph(const uint32_t passes) {
+	using rendering::ResourceAccess;
+
+	std::mt19937           random(0x6A4F);
+	rendering::RenderGraph graph;
+
+	const rendering::RenderResourceId backBuffer = graph.importResource("BackBuffer", ResourceAccess::PRESENT, ResourceAccess::PRESENT);
+	const rendering::RenderResourceId history    = graph.importResource("History", ResourceAccess::PIXEL_SHADER_RESOURCE, ResourceAccess::PIXEL_SHADER_RESOURCE);
+
+	std::vector<rendering::RenderResourceId> outputs;
+	for (uint32_t p = 0; p + 1 < passes; ++p) {
+		const std::string             name    = "Pass" + std::to_string(p);
+		const rendering::RenderPassId pass    = graph.addPass(name);
+		const bool                    isDebug = p % 5 == 4;
+
+		// A few recent outputs, or the history for the first passes
+		const size_t reads = outputs.empty() ? 0 : 1 + random() % 2;
+		for (size_t r = 0; r < reads; ++r) {
+			const size_t recent = std::min<size_t>(outputs.size(), 4);
+			graph.read(pass, outputs[outputs.size() - 1 - random() % recent], random() % 2 ? ResourceAccess::PIXEL_SHADER_RESOURCE : ResourceAccess::NON_PIXEL_SHADER_RESOURCE);
+		}
+		if (outputs.empty()) graph.read(pass, history, ResourceAccess::PIXEL_SHADER_RESOURCE);
+
+		// Render targets and UAV textures come from different heaps
+		const bool     isCompute = random() % 3 == 0;
+		const uint64_t size      = (1ull << (random() % 5)) << 20;
+		const rendering::RenderResourceId output = graph.createTransient(name, size, 65536, isCompute ? 1 : 0);
+		graph.write(pass, output, isCompute ? ResourceAccess::UNORDERED_ACCESS : ResourceAccess::RENDER_TARGET);
+
+		// Compute passes refining their output in place need a UAV barrier in between
+		if (isCompute && random() % 2) {
+			const rendering::RenderPassId refine = graph.addPass(name + "Refine");
+			graph.read(refine, output, ResourceAccess::UNORDERED_ACCESS);
+			graph.write(refine, output, ResourceAccess::UNORDERED_ACCESS);
+		}
+
+		if (!isDebug) outputs.push_back(output);
+	}
+
+	const rendering::RenderPassId compose = graph.addPass("Compose");
+	for (size_t r = 0; r < std::min<size_t>(outputs.size(), 2); ++r) {
+		graph.read(compose, outputs[outputs.size() - 1 - r], ResourceAccess::PIXEL_SHADER_RESOURCE);
+	}
+	graph.write(compose, backBuffer, ResourceAccess::RENDER_TARGET);
+	return graph;
+}
+
+// Replays the barriers of the plan: every pass has to find its resources in the state it asked for,
+// imported resources end in their final state and transients where the next frame creates them.
+// Transients sharing memory must never be alive at the same time.
+static bool validateRenderGraphPlan(const rendering::RenderGraph& graph, const rendering::RenderGraphPlan& plan) {
+	using rendering::ResourceAccess;
+
+	const std::vector<rendering::RenderResourceDesc>& resources = graph.getResources();
+
+	std::vector<ResourceAccess> current(resources.size());
+	for (size_t r = 0; r < resources.size(); ++r) {
+		current[r] = resources[r].isImported ? resources[r].initialAccess : plan.resources[r].createAccess;
+	}
+
+	auto apply = [&](const rendering::RenderBarrier& barrier) {
+		if (barrier.type != rendering::RenderBarrierType::TRANSITION) return true;
+		if (current[barrier.resource] != barrier.from) {
+			std::cerr << "error: barrier on " << resources[barrier.resource].name << " starts from the wrong state\n";
+			return false;
+		}
+		current[barrier.resource] = barrier.to;
+		return true;
+	};
+
+	for (size_t i = 0; i < plan.passes.size(); ++i) {
+		for (const rendering::RenderBarrier& barrier : plan.barriers[i]) {
+			if (!apply(barrier)) return false;
+		}
+
+		const rendering::RenderPassDesc& pass = graph.getPasses()[plan.passes[i]];
+		for (const rendering::RenderPassUse& use : pass.uses) {
+			const bool isReady = use.isWrite || !rendering::isReadOnlyAccess(use.access) ? current[use.resource] == use.access : (current[use.resource] & use.access) == use.access;
+			if (!isReady) {
+				std::cerr << "error: " << pass.name << " finds " << resources[use.resource].name << " in the wrong state\n";
+				return false;
+			}
+		}
+	}
+	for (const rendering::RenderBarrier& barrier : plan.finalBarriers) {
+		if (!apply(barrier)) return false;
+	}
+
+	for (size_t r = 0; r < resources.size(); ++r) {
+		const rendering::RenderResourceLifetime& lifetime = plan.resources[r];
+		const ResourceAccess                     expected = resources[r].isImported ? resources[r].finalAccess : lifetime.createAccess;
+		if (lifetime.isUsed() && current[r] != expected) {
+			std::cerr << "error: " << resources[r].name << " ends the frame in the wrong state\n";
+			return false;
+		}
+		if (resources[r].isImported || !lifetime.isUsed()) continue;
+
+		if (lifetime.heapOffset % resources[r].alignment != 0 || lifetime.heapOffset + resources[r].sizeInBytes > plan.heapBytes[resources[r].heapGroup]) {
+			std::cerr << "error: " << resources[r].name << " is placed outside its heap\n";
+			return false;
+		}
+		for (size_t other = r + 1; other < resources.size(); ++other) {
+			const rendering::RenderResourceLifetime& otherLifetime = plan.resources[other];
+			if (resources[other].isImported || !otherLifetime.isUsed() || resources[other].heapGroup != resources[r].heapGroup) continue;
+
+			const bool isMemoryShared = lifetime.heapOffset < otherLifetime.heapOffset + resources[other].sizeInBytes && otherLifetime.heapOffset < lifetime.heapOffset + resources[r].sizeInBytes;
+			const bool isTimeShared   = lifetime.firstPass <= otherLifetime.lastPass && otherLifetime.firstPass <= lifetime.lastPass;
+			if (isMemoryShared && isTimeShared) {
+				std::cerr << "error: " << resources[r].name << " and " << resources[other].name << " are alive in the same memory\n";
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// The plan is checked once, then compiled repeatedly as the renderer does every frame
+static int benchmarkRenderGraph(const uint32_t passes) {
+	const rendering::RenderGraph graph = makeBenchmarkGraph(std::max<uint32_t>(passes, 2));
+
+	rendering::RenderGraphPlan plan = graph.compile();
+	if (!validateRenderGraphPlan(graph, plan)) return 1;
+
+	constexpr int repeats = 1000;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < repeats; ++r) plan = graph.compile();
+	auto finish = std::chrono::steady_clock::now();
+
+	const rendering::RenderGraphStats& stats = plan.stats;
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << std::setw(10) << "passes" << std::setw(10) << "culled" << std::setw(12) << "barriers" << std::setw(10) << "batches" << std::setw(10) << "aliasing"
+			  << std::setw(14) << "transient MB" << std::setw(10) << "heap MB" << std::setw(10) << "saved" << std::setw(12) << "us/compile\n";
+	std::cout << std::setw(10) << graph.getPasses().size() << std::setw(10) << stats.culledPassCount << std::setw(12) << stats.barrierCount
+			  << std::setw(10) << stats.barrierBatchCount << std::setw(10) << stats.aliasingBarrierCount
+			  << std::setw(14) << stats.transientBytes / double(1 << 20) << std::setw(10) << stats.heapBytes / double(1 << 20)
+			  << std::setw(8) << stats.getAliasingSavings() * 100.0 << " %"
+			  << std::setw(11) << std::chrono::duration<double, std::micro>(finish - start).count() / repeats << '\n';
+	return 0;
+}
+
+// The tracker only reads the description, everything else is never called
+class BenchmarkResource final : public ID3D12Resource {
+private:
+	D3D12_RESOURCE_DESC desc_;
+
+public:
+	BenchmarkResource(const D3D12_RESOURCE_DESC& desc) :
+		desc_(desc)
+	{}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID, void** object) override {
+		*object = nullptr;
+		return E_NOINTERFACE;
+	}
+	ULONG STDMETHODCALLTYPE AddRef() override {
+		return 1;
+	}
+	ULONG STDMETHODCALLTYPE Release() override {
+		return 1;
+	}
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID, UINT*, void*) override {
+		return E_NOTIMPL;
+	}
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID, UINT, const void*) override {
+		return E_NOTIMPL;
+	}
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID, const IUnknown*) override {
+		return E_NOTIMPL;
+	}
+	HRESULT STDMETHODCALLTYPE SetName(LPCWSTR) override {
+		return E_NOTIMPL;
+	}
+	HRESULT STDMETHODCALLTYPE GetDevice(REFIID, void** device) override {
+		*device = nullptr;
+		return E_NOTIMPL;
+	}
+	HRESULT STDMETHODCALLTYPE Map(UINT, const D3D12_RANGE*, void** data) override {
+		if (data) *data = nullptr;
+		return E_NOTIMPL;
+	}
+	void STDMETHODCALLTYPE Unmap(UINT, const D3D12_RANGE*) override {}
+	D3D12_RESOURCE_DESC STDMETHODCALLTYPE GetDesc() override {
+		return desc_;
+	}
+	D3D12_GPU_VIRTUAL_ADDRESS STDMETHODCALLTYPE GetGPUVirtualAddress() override {
+		return 0;
+	}
+	HRESULT STDMETHODCALLTYPE WriteToSubresource(UINT, const D3D12_BOX*, const void*, UINT, UINT) override {
+		return E_NOTIMPL;
+	}
+	HRESULT STDMETHODCALLTYPE ReadFromSubresource(void*, UINT, UINT, UINT, const D3D12_BOX*) override {
+		return E_NOTIMPL;
+	}
+	HRESULT STDMETHODCALLTYPE GetHeapProperties(D3D12_HEAP_PROPERTIES*, D3D12_HEAP_FLAGS*) override {
+		return E_NOTIMPL;
+	}
+};
+
+// One call a command list makes on its tracker
+struct BarrierStep {
+	enum class Kind : uint8_t { TRANSITION, ASSUME, UAV };
+
+	Kind                  kind;
+	uint32_t              resource;
+	D3D12_RESOURCE_STATES state;
+	UINT                  subresource;
+};
+
+static void runBarrierStep(d3dx12::ResourceStateTracker& tracker, const std::vector<std::unique_ptr<BenchmarkResource>>& resources, const BarrierStep& step) {
+	ID3D12Resource* resource = resources[step.resource].get();
+	switch (step.kind) {
+		case BarrierStep::Kind::TRANSITION: tracker.transition(resource, step.state, step.subresource); break;
+		case BarrierStep::Kind::ASSUME:     tracker.assume(resource, step.state);                       break;
+		case BarrierStep::Kind::UAV:        tracker.uav(resource);                                      break;
+	}
+}
+
+// Command lists of random passes over buffers, mip chains and texture arrays: whole resources or
+// single mips, states repeated as passes read the same inputs again. After every call the batch the
+// tracker keeps for the next flush must hold exactly the barriers a per-subresource model expects:
+// none for the first use of a subresource, none for a state already satisfied, read states combined.
+static int benchmarkBarriers(const size_t resourceCount) {
+	constexpr UINT writes = D3D12_RESOURCE_STATE_RENDER_TARGET | D3D12_RESOURCE_STATE_UNORDERED_ACCESS |
+							D3D12_RESOURCE_STATE_DEPTH_WRITE   | D3D12_RESOURCE_STATE_COPY_DEST        |
+							D3D12_RESOURCE_STATE_STREAM_OUT    | D3D12_RESOURCE_STATE_RESOLVE_DEST;
+	constexpr D3D12_RESOURCE_STATES unknown = d3dx12::SubresourceStates::unknown;
+	constexpr std::array            states  = {
+		D3D12_RESOURCE_STATE_COMMON,                    D3D12_RESOURCE_STATE_RENDER_TARGET,     D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+		D3D12_RESOURCE_STATE_DEPTH_WRITE,               D3D12_RESOURCE_STATE_DEPTH_READ,        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+		D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_ALL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST,
+		D3D12_RESOURCE_STATE_COPY_SOURCE,               D3D12_RESOURCE_STATE_GENERIC_READ
+	};
+
+	std::mt19937 random(0xBA221E5);
+
+	std::vector<std::unique_ptr<BenchmarkResource>> resources;
+	std::vector<UINT>                               subresourceCounts;
+	for (size_t r = 0; r < std::max<size_t>(resourceCount, 1); ++r) {
+		D3D12_RESOURCE_DESC desc;
+		switch (random() % 4) {
+			case 0:  desc = CD3DX12_RESOURCE_DESC::Buffer(1 << 16); break;
+			case 1:  desc = CD3DX12_RESOURCE_DESC::Tex3D(DXGI_FORMAT_R16G16B16A16_FLOAT, 64, 64, 64, static_cast<UINT16>(1 + random() % 7)); break;
+			default: desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, 1024, 1024, static_cast<UINT16>(1 + random() % 6), static_cast<UINT16>(1 + random() % 11)); break;
+		}
+		resources.push_back(std::make_unique<BenchmarkResource>(desc));
+		subresourceCounts.push_back(d3dx12::getSubresourceCount(desc));
+	}
+
+	constexpr size_t listCount    = 64;
+	constexpr size_t stepsPerList = 4096;
+	std::vector<std::vector<BarrierStep>> lists(listCount);
+	std::vector<D3D12_RESOURCE_STATES>    lastStates(resources.size(), D3D12_RESOURCE_STATE_COMMON);
+	for (std::vector<BarrierStep>& steps : lists) {
+		for (size_t s = 0; s < stepsPerList; ++s) {
+			BarrierStep step = { BarrierStep::Kind::TRANSITION, static_cast<uint32_t>(random() % resources.size()), states[random() % states.size()],
+								 D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES };
+
+			// Passes read the same inputs again, mip chains go one level at a time
+			const uint32_t roll = random() % 100;
+			if (roll < 40)     step.state       = lastStates[step.resource];
+			if (roll % 4 == 0) step.subresource = random() % subresourceCounts[step.resource];
+			if (roll >= 97)    step.kind        = BarrierStep::Kind::ASSUME;
+			else if (roll >= 94) step.kind      = BarrierStep::Kind::UAV;
+
+			lastStates[step.resource] = step.state;
+			steps.push_back(step);
+		}
+	}
+
+	auto isSatisfied = [&](const D3D12_RESOURCE_STATES current, const D3D12_RESOURCE_STATES state) {
+		if (current == state) return true;
+		return state != D3D12_RESOURCE_STATE_COMMON && (current & writes) == 0 && (current & state) == state;
+	};
+	auto isEqual = [](const D3D12_RESOURCE_BARRIER& a, const D3D12_RESOURCE_BARRIER& b) {
+		if (a.Type != b.Type || a.Flags != b.Flags) return false;
+		if (a.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV) return a.UAV.pResource == b.UAV.pResource;
+		return a.Transition.pResource   == b.Transition.pResource   && a.Transition.Subresource == b.Transition.Subresource &&
+			   a.Transition.StateBefore == b.Transition.StateBefore && a.Transition.StateAfter  == b.Transition.StateAfter;
+	};
+
+	d3dx12::ResourceStateTracker tracker;
+	size_t transitions = 0;
+	size_t barriers    = 0;
+	size_t elided      = 0;
+	size_t deferred    = 0;
+	for (size_t l = 0; l < lists.size(); ++l) {
+		// The list's view of each subresource, unknown until it first uses it
+		ska::flat_hash_map<uint32_t, std::vector<D3D12_RESOURCE_STATES>> model;
+		std::vector<D3D12_RESOURCE_BARRIER>                              expected;
+		size_t                                                           listTransitions = 0;
+		size_t                                                           listElided      = 0;
+
+		for (const BarrierStep& step : lists[l]) {
+			ID3D12Resource*                     resource = resources[step.resource].get();
+			std::vector<D3D12_RESOURCE_STATES>& current  = model[step.resource];
+			if (current.empty()) current.assign(subresourceCounts[step.resource], unknown);
+
+			const size_t before = expected.size();
+			if (step.kind == BarrierStep::Kind::UAV) {
+				expected.push_back(CD3DX12_RESOURCE_BARRIER::UAV(resource));
+			}
+			else if (step.kind == BarrierStep::Kind::ASSUME) {
+				std::fill(current.begin(), current.end(), step.state);
+			}
+			else {
+				++listTransitions;
+
+				const bool isUniform = std::all_of(current.begin(), current.end(), [&](const D3D12_RESOURCE_STATES state) { return state == current[0]; });
+				bool       isChanged = false;
+				if (step.subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES && isUniform) {
+					if (current[0] == unknown) {
+						isChanged = true;
+						++deferred;
+					}
+					else if (!isSatisfied(current[0], step.state)) {
+						isChanged = true;
+						expected.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, current[0], step.state));
+					}
+					if (isChanged) std::fill(current.begin(), current.end(), step.state);
+				}
+				else {
+					const UINT first = step.subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES ? 0                                 : step.subresource;
+					const UINT last  = step.subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES ? subresourceCounts[step.resource] : step.subresource + 1;
+					for (UINT s = first; s < last; ++s) {
+						if (current[s] == unknown) ++deferred;
+						else if (isSatisfied(current[s], step.state)) continue;
+						else expected.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, current[s], step.state, s));
+
+						current[s] = step.state;
+						isChanged  = true;
+					}
+				}
+				if (!isChanged) ++listElided;
+			}
+
+			runBarrierStep(tracker, resources, step);
+
+			const std::vector<D3D12_RESOURCE_BARRIER>& pending = tracker.getPending();
+			if (pending.size() != expected.size() || !std::equal(pending.begin() + before, pending.end(), expected.begin() + before, isEqual)) {
+				std::cerr << "error: list " << l << " batched " << pending.size() << " barriers where " << expected.size() << " were expected\n";
+				return 1;
+			}
+		}
+
+		for (const auto& [r, current] : model) {
+			for (UINT s = 0; s < current.size(); ++s) {
+				if (tracker.getState(resources[r].get(), s) != current[s]) {
+					std::cerr << "error: list " << l << " leaves subresource " << s << " of resource " << r << " in the wrong state\n";
+					return 1;
+				}
+			}
+		}
+		const d3dx12::ResourceStateStats& stats = tracker.getStats();
+		if (stats.transitions != listTransitions || stats.elided != listElided) {
+			std::cerr << "error: list " << l << " counted " << stats.transitions << " transitions and " << stats.elided << " elided, the model "
+					  << listTransitions << " and " << listElided << '\n';
+			return 1;
+		}
+
+		transitions += listTransitions;
+		barriers    += expected.size();
+		elided   += listElided;
+		tracker.reset();
+	}
+	std::cout << "Barriers checked over " << lists.size() << " command lists of " << stepsPerList << " calls on " << resources.size() << " resources\n";
+
+	const double replay = timeBest(5, [&]() {
+		for (const std::vector<BarrierStep>& steps : lists) {
+			for (const BarrierStep& step : steps) runBarrierStep(tracker, resources, step);
+			tracker.reset();
+		}
+	});
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << transitions << " transitions: " << barriers << " barriers batched, " << elided << " elided, " << deferred
+			  << " first uses left to submission (" << 100.0 * barriers / transitions << "% recorded)\n";
+	std::cout << std::setprecision(3) << "tracked in " << replay * 1e6 / (lists.size() * stepsPerList) << " ns per call\n";
+	return 0;
+}
+
+// Strict enough for trace viewers: one value, quoted keys, valid escapes, no raw control characters
+class JsonChecker {
+private:
+	std::string_view text_;
+	size_t           at_ = 0;
+
+	void skipSpace() {
+		while (at_ < text_.size() && (text_[at_] == ' ' || text_[at_] == '\n' || text_[at_] == '\r' || text_[at_] == '\t')) ++at_;
+	}
+	bool consume(const char c) {
+		skipSpace();
+		if (at_ >= text_.size() || text_[at_] != c) return false;
+		++at_;
+		return true;
+	}
+
+	bool string() {
+		if (!consume('"')) return false;
+		while (at_ < text_.size() && text_[at_] != '"') {
+			const unsigned char c = static_cast<unsigned char>(text_[at_++]);
+			if (c < 0x20) return false;
+			if (c != '\\') continue;
+
+			if (at_ >= text_.size()) return false;
+			const char escaped = text_[at_++];
+			if (escaped == 'u') {
+				for (int i = 0; i < 4; ++i, ++at_) {
+					if (at_ >= text_.size() || !std::isxdigit(static_cast<unsigned char>(text_[at_]))) return false;
+				}
+			}
+			else if (std::string_view("\"\\/bfnrt").find(escaped) == std::string_view::npos) return false;
+		}
+		return consume('"');
+	}
+	bool number() {
+		const size_t start = at_;
+		if (at_ < text_.size() && text_[at_] == '-') ++at_;
+		const size_t digits = at_;
+		while (at_ < text_.size() && std::isdigit(static_cast<unsigned char>(text_[at_]))) ++at_;
+		if (at_ == digits) return false;
+		if (at_ < text_.size() && text_[at_] == '.') {
+			const size_t fraction = ++at_;
+			while (at_ < text_.size() && std::isdigit(static_cast<unsigned char>(text_[at_]))) ++at_;
+			if (at_ == fraction) return false;
+		}
+		if (at_ < text_.size() && (text_[at_] == 'e' || text_[at_] == 'E')) {
+			++at_;
+			if (at_ < text_.size() && (text_[at_] == '+' || text_[at_] == '-')) ++at_;
+			const size_t exponent = at_;
+			while (at_ < text_.size() && std::isdigit(static_cast<unsigned char>(text_[at_]))) ++at_;
+			if (at_ == exponent) return false;
+		}
+		return at_ > start;
+	}
+	bool value() {
+		skipSpace();
+		if (at_ >= text_.size()) return false;
+
+		const char c = text_[at_];
+		if (c == '"') return string();
+		if (c == '{' || c == '[') {
+			const char close    = c == '{' ? '}' : ']';
+			const bool isObject = c == '{';
+			++at_;
+			if (consume(close)) return true;
+			do {
+				if (isObject && (!string() || !consume(':'))) return false;
+				if (!value()) return false;
+			} while (consume(','));
+			return consume(close);
+		}
+		for (const std::string_view literal : { "true", "false", "null" }) {
+			if (text_.substr(at_, literal.size()) == literal) {
+				at_ += literal.size();
+				return true;
+			}
+		}
+		return number();
+	}
+
+public:
+	static bool isValid(const std::string_view text) {
+		JsonChecker checker;
+		checker.text_ = text;
+		if (!checker.value()) return false;
+
+		checker.skipSpace();
+		return checker.at_ == text.size();
+	}
+};
+
+static size_t countOccurrences(const std::string_view text, const std::string_view pattern) {
+	size_t count = 0;
+	for (size_t at = text.find(pattern); at != std::string_view::npos; at = text.find(pattern, at + pattern.size())) ++count;
+	return count;
+}
+
+// Workers started every frame, each one nesting scopes with literal and interned names; the main
+// thread adds GPU timings for frames on both sides of the capture. Nothing may be recorded outside
+// the captured frames, every scope inside them must reach the trace, and the trace must parse.
+// Then the cost of a scope is timed while idle and while recording on every thread at once.
+static int benchmarkProfiler(const uint32_t threadCount) {
+	FrameProfiler& profiler = FrameProfiler::get();
+
+	const uint32_t workers        = std::max<uint32_t>(threadCount, 1);
+	constexpr int  scopesPerFrame = 1000;
+	constexpr int  idleFrames     = 2;
+	constexpr int  capturedFrames = 3;
+	const std::string dynamicName = "Job \"batch\"\\\n";
+
+	auto runFrame = [&]() {
+		profiler.beginFrame();
+		ProfileScope frameScope("Frame");
+
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < workers; ++t) {
+			threads.emplace_back([&, t]() {
+				profiler.setThreadName("Worker " + std::to_string(t));
+				for (int s = 0; s < scopesPerFrame; ++s) {
+					ProfileScope outer("Update");
+					ProfileScope inner(ProfileScope::Dynamic{}, dynamicName);
+				}
+			});
+		}
+		for (std::thread& thread : threads) thread.join();
+	};
+
+	for (int f = 0; f < idleFrames; ++f) runFrame();
+	const FrameProfilerStats idle = profiler.getStats();
+
+	profiler.capture(capturedFrames);
+	for (int f = 0; f < capturedFrames + 2; ++f) runFrame();
+	for (uint64_t frame = 1; frame <= profiler.getFrame(); ++frame) {
+		profiler.addGpuEvent("Direct queue", "Draw", 1000 * frame, 1000 * frame + 500, frame, 0);
+	}
+	const FrameProfilerStats captured = profiler.getStats();
+
+	const uint64_t firstFrame     = idleFrames + 1;
+	const size_t   expectedEvents = capturedFrames * (workers * scopesPerFrame * 2 + 1);
+	if (idle.cpuEventCount != 0 || captured.firstFrame != firstFrame || captured.lastFrame != firstFrame + capturedFrames || captured.isCapturing ||
+		captured.cpuEventCount != expectedEvents || captured.gpuEventCount != capturedFrames)
+	{
+		std::cerr << "error: captured frames [" << captured.firstFrame << ", " << captured.lastFrame << ") with " << captured.cpuEventCount << " CPU and "
+				  << captured.gpuEventCount << " GPU events, expected [" << firstFrame << ", " << firstFrame + capturedFrames << ") with " << expectedEvents
+				  << " and " << capturedFrames << " (" << idle.cpuEventCount << " recorded while idle)\n";
+		return 1;
+	}
+
+	// Whatever the caller left the stream in
+	std::ostringstream trace;
+	trace << std::hex << std::setprecision(2);
+	profiler.writeChromeTrace(trace);
+	const bool        isRestored = (trace.flags() & std::ios::basefield) == std::ios::hex && trace.precision() == 2;
+	const std::string text       = trace.str();
+
+	bool isInRange = true;
+	for (size_t at = text.find("\"frame\":"); at != std::string::npos; at = text.find("\"frame\":", at + 1)) {
+		const uint64_t frame = std::stoull(text.substr(at + 8, 20));
+		isInRange &= frame >= firstFrame && frame < firstFrame + capturedFrames;
+	}
+	const size_t names = countOccurrences(text, "\"thread_name\"");
+	if (!JsonChecker::isValid(text) || !isRestored || !isInRange || countOccurrences(text, "\"ph\":\"X\"") != expectedEvents + capturedFrames ||
+		countOccurrences(text, "\"ph\":\"i\"") != capturedFrames + 1 || names != captured.threadCount + 1 ||
+		countOccurrences(text, "\"Job \\\"batch\\\"\\\\\\n\"") != capturedFrames * workers * scopesPerFrame)
+	{
+		std::cerr << "error: the Chrome trace is " << (JsonChecker::isValid(text) ? "valid" : "invalid") << " JSON with "
+				  << countOccurrences(text, "\"ph\":\"X\"") << " complete events, " << names << " thread names, frames in range " << isInRange
+				  << (isRestored ? "" : ", the stream's formatting changed") << '\n';
+		return 1;
+	}
+
+	// A new capture drops the previous one
+	profiler.capture(1);
+	runFrame();
+	runFrame();
+	const FrameProfilerStats recaptured = profiler.getStats();
+	if (recaptured.cpuEventCount != workers * scopesPerFrame * 2 + 1 || recaptured.gpuEventCount != 0) {
+		std::cerr << "error: a new capture of one frame holds " << recaptured.cpuEventCount << " CPU and " << recaptured.gpuEventCount << " GPU events\n";
+		return 1;
+	}
+	std::cout << "Profiler checked over " << idleFrames + capturedFrames + 4 << " frames of " << workers << " workers, "
+			  << captured.cpuEventCount << " events in a " << text.size() / 1024 << " KB trace\n";
+
+	constexpr int timed = 200000;
+	const double idleScope = timeBest(5, [&]() {
+		for (int s = 0; s < timed; ++s) ProfileScope scope("Idle");
+	});
+
+	profiler.capture(1);
+	profiler.beginFrame();
+	const double recordedScope = timeBest(1, [&]() {
+		std::vector<std::thread> threads;
+		for (uint32_t t = 0; t < workers; ++t) {
+			threads.emplace_back([&]() {
+				for (int s = 0; s < timed; ++s) ProfileScope scope("Recorded");
+			});
+		}
+		for (std::thread& thread : threads) thread.join();
+	});
+	profiler.beginFrame();
+	profiler.capture(0);
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "scope while idle " << idleScope * 1e6 / timed << " ns, while recording " << recordedScope * 1e6 / (timed * workers)
+			  << " ns with " << workers << " threads recording at once\n";
+	return 0;
+}
+
+// Nearest rank, written out separately from the histogram
+static double referencePercentile(const std::vector<float>& sorted, const double percentile) {
+	const double rank = std::ceil(percentile * static_cast<double>(sorted.size()) / 100.0);
+	return sorted[static_cast<size_t>(std::max(rank, 1.0)) - 1];
+}
+
+// Frame time percentiles against a sorted copy of the last window of samples, recorder deltas and
+// baselines, then the JSON snapshot: it must parse with hostile heap names, keep the stream's
+// formatting and match what saveJson writes. Adding a sample and computing the stats are timed.
+static int benchmarkStats(const size_t sampleCount) {
+	const size_t samples = std::max<size_t>(sampleCount, 1);
+
+	{
+		FrameTimeHistogram histogram(100);
+		for (int i = 100; i >= 1; --i) histogram.add(i);
+		const FrameTimeStats stats = histogram.getStats();
+		if (FrameTimeHistogram().getStats().sampleCount != 0 || stats.p50 != 50.0 || stats.p95 != 95.0 || stats.p99 != 99.0 ||
+			stats.minimum != 1.0 || stats.maximum != 100.0 || stats.average != 50.5 || stats.last != 1.0)
+		{
+			std::cerr << "error: 1 to 100 ms gave p50 " << stats.p50 << ", p95 " << stats.p95 << ", p99 " << stats.p99 << '\n';
+			return 1;
+		}
+	}
+
+	// Mostly steady frames with hitches, the window wraps many times
+	std::mt19937                           random(0x57A75);
+	std::lognormal_distribution<double>    frameTimes(std::log(16.6), 0.15);
+	std::bernoulli_distribution            hitch(0.01);
+	std::vector<double>                    times(samples);
+	for (double& time : times) time = frameTimes(random) * (hitch(random) ? 4.0 : 1.0);
+
+	constexpr size_t   window = 1024;
+	FrameTimeHistogram histogram(window);
+	for (size_t i = 0; i < times.size(); ++i) {
+		histogram.add(times[i]);
+		if (i % 997 != 0 && i + 1 != times.size()) continue;
+
+		std::vector<float> sorted;
+		for (size_t j = i + 1 - std::min(i + 1, window); j <= i; ++j) sorted.push_back(static_cast<float>(times[j]));
+		std::sort(sorted.begin(), sorted.end());
+		double sum = 0.0;
+		for (const float time : sorted) sum += time;
+
+		const FrameTimeStats stats = histogram.getStats();
+		if (stats.sampleCount != sorted.size() || stats.last != times[i] || stats.minimum != sorted.front() || stats.maximum != sorted.back() ||
+			std::abs(stats.average - sum / sorted.size()) > 1e-9 || stats.p50 != referencePercentile(sorted, 50.0) ||
+			stats.p95 != referencePercentile(sorted, 95.0) || stats.p99 != referencePercentile(sorted, 99.0))
+		{
+			std::cerr << "error: after " << i + 1 << " samples p50/p95/p99 are " << stats.p50 << '/' << stats.p95 << '/' << stats.p99 << ", expected "
+					  << referencePercentile(sorted, 50.0) << '/' << referencePercentile(sorted, 95.0) << '/' << referencePercentile(sorted, 99.0) << '\n';
+			return 1;
+		}
+	}
+
+	// Totals since startup go in, per frame deltas come out, the first frame is only the baseline
+	EngineStatsRecorder recorder(window);
+	EngineStats         recorded;
+	uint64_t            waited   = 5'000'000;
+	uint64_t            uploaded = 1 << 20;
+	recorder.endFrame(waited, uploaded);
+	for (int f = 1; f <= 10; ++f) recorder.endFrame(waited += 2'000'000 * f, uploaded += 4096 * f);
+	recorder.fill(recorded);
+	if (recorded.frame != 11 || recorded.frameTime.sampleCount != 10 || recorded.cpuWait.sampleCount != 10 || recorded.cpuWait.minimum != 2.0 ||
+		recorded.cpuWait.maximum != 20.0 || recorded.cpuWait.last != 20.0 || recorded.uploadedBytes != 40960 || recorded.totalUploadedBytes != uploaded)
+	{
+		std::cerr << "error: the recorder reports " << recorded.frameTime.sampleCount << " frame times, waits " << recorded.cpuWait.minimum << " to "
+				  << recorded.cpuWait.maximum << " ms and " << recorded.uploadedBytes << " bytes uploaded last frame\n";
+		return 1;
+	}
+	recorder.reset();
+	recorder.endFrame(waited, uploaded);
+	recorder.fill(recorded);
+	if (recorded.frame != 1 || recorded.frameTime.sampleCount != 0 || recorded.uploadedBytes != 0) {
+		std::cerr << "error: a reset recorder reports " << recorded.frameTime.sampleCount << " frame times\n";
+		return 1;
+	}
+
+	EngineStats stats;
+	stats.frame           = 1234;
+	stats.frameTime       = histogram.getStats();
+	stats.gpuMilliseconds = 12.5;
+	stats.render          = { 3000, 40, 5, 2 };
+	stats.descriptorHeaps = { { "CBV_SRV_UAV", 1500, 100000 }, { "Quote \" back\\slash\nnewline\ttab", 3, 8 } };
+	stats.heaps           = 4;
+	stats.entities        = 10000;
+
+	for (const bool hasHeaps : { true, false }) {
+		if (!hasHeaps) stats.descriptorHeaps.clear();
+
+		std::ostringstream out;
+		out << std::hex << std::setprecision(2);
+		stats.writeJson(out);
+		const bool isRestored = (out.flags() & std::ios::basefield) == std::ios::hex && out.precision() == 2;
+
+		const std::string text = out.str();
+		if (!JsonChecker::isValid(text) || !isRestored || text.find("\"drawCalls\": 3000") == std::string::npos ||
+			text.find("\"p99\": ") == std::string::npos || text.find("\"entities\": 10000") == std::string::npos)
+		{
+			std::cerr << "error: the stats JSON " << (hasHeaps ? "with" : "without") << " descriptor heaps is " << (JsonChecker::isValid(text) ? "valid" : "invalid")
+					  << (isRestored ? "" : " and changed the stream's formatting") << ":\n" << text;
+			return 1;
+		}
+	}
+
+	const std::filesystem::path path = std::filesystem::temp_directory_path() / "spider_stats_benchmark.json";
+	std::ostringstream written;
+	stats.writeJson(written);
+	const bool isSaved = stats.saveJson(path);
+	std::ifstream file(path, std::ios::binary);
+	const std::string saved((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+	std::filesystem::remove(path);
+	if (!isSaved || saved != written.str()) {
+		std::cerr << "error: saveJson wrote " << saved.size() << " bytes, writeJson " << written.str().size() << '\n';
+		return 1;
+	}
+	std::cout << "Stats checked over " << samples << " frame times in a window of " << window << ", recorder deltas and the JSON snapshot\n";
+
+	size_t       index = 0;
+	const double adds  = timeBest(5, [&]() {
+		for (size_t i = 0; i < samples; ++i) histogram.add(times[index++ % times.size()]);
+	});
+	double       checksum = 0.0;
+	constexpr int snapshots = 1000;
+	const double percentiles = timeBest(5, [&]() {
+		for (int s = 0; s < snapshots; ++s) checksum += histogram.getStats().p99;
+	});
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "p50 " << stats.frameTime.p50 << " ms, p95 " << stats.frameTime.p95 << " ms, p99 " << stats.frameTime.p99 << " ms\n";
+	std::cout << "add " << adds * 1e6 / samples << " ns, stats of a full window " << percentiles * 1e3 / snapshots << " us"
+			  << (checksum > 0.0 ? "\n" : " (empty)\n");
+	return 0;
+}
+
+// Counts what reaches it, so only the logger itself is measured
+class CountingLogSink : public LogSink {
+public:
+	size_t count = 0;
+
+	void write(const LogMessage&) override {
+		++count;
+	}
+};
+
+// Nanoseconds of every call, each thread measures its own
+template <typename Call>
+static std::vector<double> timeLogCalls(const uint32_t threads, const size_t calls, Call call) {
+	std::vector<std::vector<double>> latencies(threads);
+	std::vector<std::thread>         workers;
+	for (uint32_t t = 0; t < threads; ++t) {
+		workers.emplace_back([&, t]() {
+			latencies[t].reserve(calls);
+			for (size_t i = 0; i < calls; ++i) {
+				const auto start = std::chrono::steady_clock::now();
+				call(t, i);
+				latencies[t].push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+			}
+		});
+	}
+	for (std::thread& worker : workers) worker.join();
+
+	std::vector<double> all;
+	for (const std::vector<double>& thread : latencies) all.insert(all.end(), thread.begin(), thread.end());
+	std::sort(all.begin(), all.end());
+	return all;
+}
+
+static int benchmarkLogging(const uint32_t threads) {
+	// The ring holds every call, so none is dropped and the numbers are the caller's cost alone
+	constexpr size_t capacity = 1 << 16;
+	const size_t     calls    = capacity / threads;
+
+	size_t written = 0;
+	std::vector<double> asynchronous;
+	{
+		Logger logger(capacity, false);
+		auto   sink  = std::make_unique<CountingLogSink>();
+		auto*  count = sink.get();
+		logger.addSink(std::move(sink));
+
+		static constexpr LogSite site = { LogLevel::Info, "thread {} frame {} took {:.3f} ms in {}", __FILE__, __LINE__ };
+		const std::string        pass = "ShadowPass";
+		asynchronous = timeLogCalls(threads, calls, [&](const uint32_t t, const size_t i) {
+			logger.log(site, "thread {} frame {} took {:.3f} ms in {}", t, i, i * 0.016, pass);
+		});
+
+		logger.flush();
+		written = count->count;
+		if (written != threads * calls || logger.getStats().dropped != 0) {
+			std::cerr << "error: " << written << " of " << threads * calls << " messages written, " << logger.getStats().dropped << " dropped\n";
+			return 1;
+		}
+	}
+
+	// What DebugConsole used to do, minus the console: format on the caller and write under a lock
+	std::mutex          mutex;
+	std::string         output;
+	const std::string   pass = "ShadowPass";
+	std::vector<double> synchronous = timeLogCalls(threads, calls, [&](const uint32_t t, const size_t i) {
+		const std::string line = std::format("thread {} frame {} took {:.3f} ms in {}\n", t, i, i * 0.016, pass);
+		std::lock_guard   lock(mutex);
+		output = line;
+	});
+
+	auto percentile = [](const std::vector<double>& sorted, const double p) {
+		return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p / 100.0 * sorted.size()))];
+	};
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << threads << " threads, " << written << " messages\n";
+	std::cout << std::setw(14) << "ns/call" << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(12) << "p99.9" << std::setw(12) << "max\n";
+	std::cout << std::setw(14) << "async" << std::setw(10) << percentile(asynchronous, 50.0) << std::setw(10) << percentile(asynchronous, 99.0)
+			  << std::setw(12) << percentile(asynchronous, 99.9) << std::setw(11) << asynchronous.back() << '\n';
+	std::cout << std::setw(14) << "caller format" << std::setw(10) << percentile(synchronous, 50.0) << std::setw(10) << percentile(synchronous, 99.0)
+			  << std::setw(12) << percentile(synchronous, 99.9) << std::setw(11) << synchronous.back() << '\n';
+	return 0;
+}
+
+// An edge case of the input system: the events of each frame and what the state must show after its
+// update(). Frames are separated by '|'. Events are 'd' down, 'u' up, 'f' focus lost. Each expected
+// frame is three flags: held (D), pressed (P), released (R), or '-' when unset.
+struct InputCase {
+	const char* name;
+	const char* events;
+	const char* expected;
+};
+
+static std::vector<std::string_view> splitFrames(const std::string_view text) {
+	std::vector<std::string_view> frames;
+	for (size_t start = 0;;) {
+		const size_t end = text.find('|', start);
+		frames.push_back(text.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start));
+		if (end == std::string_view::npos) return frames;
+		start = end + 1;
+	}
+}
+
+// Every edge case on a key and on a mouse button, then the deltas and a full ring. Times single threaded
+// push and update, and four producers against one consumer.
+static int benchmarkInput(const size_t events) {
+	const InputCase cases[] = {
+		{ "same frame tap",               "du|",      "-PR|---"             },
+		{ "release and press while held", "d|ud|",    "DP-|DPR|D--"         },
+		{ "key repeat",                   "d|d|dd|u", "DP-|D--|D--|--R"     },
+		{ "focus lost while held",        "d|f|u|d",  "DP-|--R|---|DP-"     },
+		{ "press and focus lost",         "df|",      "-PR|---"             },
+		{ "focus lost then press",        "d|fd|",    "DP-|DPR|D--"         }
+	};
+
+	constexpr uint8_t key = 'A';
+	for (const InputCase& test : cases) {
+		for (const bool isButton : { false, true }) {
+			InputScript script;
+			for (const std::string_view frame : splitFrames(test.events)) {
+				for (const char event : frame) {
+					if      (event == 'f') script.loseFocus();
+					else if (isButton)     event == 'd' ? script.press(MouseButton::LEFT) : script.release(MouseButton::LEFT);
+					else                   event == 'd' ? script.press(key) : script.release(key);
+				}
+				script.frame();
+			}
+
+			InputSystem input;
+			uint32_t    frame = 0;
+			for (const std::string_view expected : splitFrames(test.expected)) {
+				script.pump(input);
+				input.update();
+
+				const InputState& state  = input.getState();
+				const bool        flags[] = {
+					isButton ? state.isButtonDown(MouseButton::LEFT)      : state.isKeyDown(key),
+					isButton ? state.wasButtonPressed(MouseButton::LEFT)  : state.wasKeyPressed(key),
+					isButton ? state.wasButtonReleased(MouseButton::LEFT) : state.wasKeyReleased(key)
+				};
+				for (size_t f = 0; f < 3; ++f) {
+					if (flags[f] != (expected[f] != '-')) {
+						std::cerr << "error: " << test.name << (isButton ? " (button)" : " (key)") << ", frame " << frame << " expects " << expected
+								  << ", got " << (flags[0] ? 'D' : '-') << (flags[1] ? 'P' : '-') << (flags[2] ? 'R' : '-') << '\n';
+						return 1;
+					}
+				}
+				++frame;
+			}
+		}
+	}
+
+	// Deltas add up within a frame and restart with the next, positions stay
+	{
+		InputScript script;
+		script.moveTo(10, 20).move(3, 4).move(-1, 1).scroll(120).scroll(120).frame();
+
+		InputSystem input;
+		script.pump(input);
+		input.update();
+		const InputState first = input.getState();
+		script.pump(input);
+		input.update();
+		const InputState& second = input.getState();
+
+		if (first.mouseDeltaX != 2 || first.mouseDeltaY != 5 || first.wheel != 240 || second.mouseDeltaX != 0 || second.mouseDeltaY != 0 || second.wheel != 0 ||
+			second.mouseX != 10 || second.mouseY != 20)
+		{
+			std::cerr << "error: mouse deltas do not add up within a frame or do not restart\n";
+			return 1;
+		}
+	}
+
+	// A full ring drops what does not fit and keeps the rest in order
+	{
+		InputSystem input(16);
+		for (uint32_t i = 0; i < 20; ++i) input.push({ InputEventType::MOUSE_MOVE, 0, 1, 0 });
+		input.update();
+
+		if (input.getStats().dropped != 4 || input.getState().mouseDeltaX != 16) {
+			std::cerr << "error: a full ring of 16 kept " << input.getState().mouseDeltaX << " of 20 events and dropped " << input.getStats().dropped << '\n';
+			return 1;
+		}
+	}
+
+	std::cout << std::size(cases) << " edge cases checked on a key and a mouse button, deltas and a full ring too\n";
+
+	// A frame's worth of typing and mouse motion at a time
+	constexpr size_t perFrame = 64;
+
+	InputSystem single(perFrame);
+	const double singleMs = timeBest(5, [&]() {
+		for (size_t e = 0; e < events; ++e) {
+			single.push({ e % 2 ? InputEventType::KEY_UP : InputEventType::KEY_DOWN, static_cast<uint8_t>(e >> 1) });
+			if (e % perFrame == perFrame - 1) single.update();
+		}
+		single.update();
+	});
+
+	// Producers spin on a full ring, nothing is dropped and every event is applied once
+	constexpr uint32_t producers = 4;
+
+	InputSystem           shared;
+	std::atomic<uint32_t> running = producers;
+	std::vector<std::thread> threads;
+
+	const auto start = std::chrono::steady_clock::now();
+	for (uint32_t p = 0; p < producers; ++p) {
+		threads.emplace_back([&]() {
+			for (size_t e = 0; e < events / producers; ++e) {
+				while (!shared.push({ InputEventType::MOUSE_MOVE, 0, 1, 0 })) std::this_thread::yield();
+			}
+			--running;
+		});
+	}
+	int64_t applied = 0;
+	while (running > 0) {
+		shared.update();
+		applied += shared.getState().mouseDeltaX;
+		std::this_thread::yield();
+	}
+	for (std::thread& thread : threads) thread.join();
+	shared.update();
+	applied += shared.getState().mouseDeltaX;
+	const double sharedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	if (applied != static_cast<int64_t>(events / producers * producers)) {
+		std::cerr << "error: " << applied << " of " << events / producers * producers << " events from " << producers << " producers applied\n";
+		return 1;
+	}
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << events << " events\n";
+	std::cout << std::setw(14) << "" << std::setw(11) << "ns/event\n";
+	std::cout << std::setw(14) << "1 thread"                                << std::setw(10) << singleMs * 1e6 / events << '\n';
+	std::cout << std::setw(14) << (std::to_string(producers) + " producers") << std::setw(10) << sharedMs * 1e6 / events << '\n';
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	if (argc >= 2 && std::string(argv[1]) == "--bench-hierarchy") {
+		return benchmarkHierarchy(argc >= 3 ? std::stoul(argv[2]) : 100000);
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-cull") {
+		return benchmarkCulling(argc >= 3 ? std::stoul(argv[2]) : 1000000);
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-tree") {
+		return benchmarkAabbTree(argc >= 3 ? std::stoul(argv[2]) : 100000);
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-occlusion") {
+		return benchmarkOcclusion(argc >= 3 ? std::stoul(argv[2]) : 10000);
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-lod") {
+		return benchmarkLod(argc >= 3 ? std::stoul(argv[2]) : 200000);
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-meshopt") {
+		return benchmarkMeshOptimizer(argc >= 3 ? std::filesystem::path(argv[2]) : makeBenchmarkModel(128, 256));
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-meshlets") {
+		return benchmarkMeshlets(argc >= 3 ? std::filesystem::path(argv[2]) : makeBenchmarkModel(128, 256));
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-packing") {
+		return benchmarkPacking(argc >= 3 ? std::stoul(argv[2]) : 1000000);
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-spmesh") {
+		return benchmarkSpmesh(argc >= 3 ? std::filesystem::path(argv[2]) : makeBenchmarkModel(128, 256));
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-residency") {
+		return benchmarkResidency(argc >= 3 ? std::stoul(argv[2]) : 2000);
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-mips") {
+		return benchmarkMips(argc >= 3 ? static_cast<uint32_t>(std::stoul(argv[2])) : 4096);
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-atlas") {
+		return benchmarkAtlas(argc >= 3 ? std::stoul(argv[2]) : 2000);
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-cache") {
+		return benchmarkAssetCache(argc >= 3 ? std::stoul(argv[2]) : 10000);
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-alloc") {
+		return benchmarkAllocators(argc >= 3 ? std::stoul(argv[2]) : 1000000);
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-graph") {
+		return benchmarkRenderGraph(argc >= 3 ? static_cast<uint32_t>(std::stoul(argv[2])) : 64);
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-barriers") {
+		return benchmarkBarriers(argc >= 3 ? std::stoul(argv[2]) : 2000);
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-profiler") {
+		return benchmarkProfiler(argc >= 3 ? static_cast<uint32_t>(std::stoul(argv[2])) : 4);
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-stats") {
+		return benchmarkStats(argc >= 3 ? std::stoul(argv[2]) : 100000);
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-log") {
+		return benchmarkLogging(std::max<uint32_t>(argc >= 3 ? static_cast<uint32_t>(std::stoul(argv[2])) : 4, 1));
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench-input") {
+		return benchmarkInput(argc >= 3 ? std::stoul(argv[2]) : 1000000);
+	}
+	if (argc < 3) {
+		printUsage();
+		return 1;
+	}
+
+	CookSettings settings;
+	size_t       top = 10;
+
+	for (int i = 3; i < argc; ++i) {
+		const std::string option = argv[i];
+		const bool        hasValue = i + 1 < argc;
+
+		if      (option == "--packed")              settings.vertexFormat        = rendering::VertexFormat::PACKED;
+		else if (option == "--hq")                  settings.texture.highQuality = true;
+		else if (option == "--force")               settings.force               = true;
+		else if (option == "--lods" && hasValue)    settings.mesh.lodCount       = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (option == "--threads" && hasValue) settings.threadCount         = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (option == "--top" && hasValue)     top                          = std::stoul(argv[++i]);
+		else if (option == "--bc" && hasValue && parseCompression(argv[i + 1])) {
+			settings.texture.compression = *parseCompression(argv[++i]);
+		}
+		else {
+			printUsage();
+			return 1;
+		}
+	}
+
+	try {
+		AssetCooker      cooker(argv[1], argv[2], settings);
+		const CookStats& stats = cooker.cook();
+
+		// Slowest first, cache hits only cost their hash
+		std::vector<const AssetCookRecord*> records;
+		for (const AssetCookRecord& record : stats.records) records.push_back(&record);
+		std::sort(records.begin(), records.end(), [](const AssetCookRecord* a, const AssetCookRecord* b) {
+			return a->hashMilliseconds + a->cookMilliseconds > b->hashMilliseconds + b->cookMilliseconds;
+		});
+
+		std::cout << std::fixed << std::setprecision(2);
+		std::cout << std::setw(10) << "hash ms" << std::setw(10) << "cook ms" << "  status  asset\n";
+		for (size_t r = 0; r < std::min(top, records.size()); ++r) {
+			const AssetCookRecord& record = *records[r];
+			std::cout << std::setw(10) << record.hashMilliseconds
+					  << std::setw(10) << record.cookMilliseconds << "  "
+					  << (record.failed ? "failed" : record.cacheHit ? "cached" : "cooked") << "  "
+					  << record.sourcePath.generic_string() << '\n';
+		}
+
+		for (const AssetCookRecord& record : stats.records) {
+			if (record.failed) std::cerr << "error: " << record.sourcePath.generic_string() << ": " << record.error << '\n';
+		}
+
+		if (stats.textures.textureCount) {
+			const rendering::TextureCompressionStats& textures = stats.textures;
+			std::cout << textures.textureCount << " textures, "
+					  << textures.uncompressedBytes / 1048576.0 << " MB as RGBA8 -> "
+					  << textures.compressedBytes / 1048576.0 << " MB ("
+					  << textures.getSavedBytes() / 1048576.0 << " MB of VRAM saved), "
+					  << textures.getMegapixelsPerSecond() << " MP/s encoded per thread\n";
+		}
+
+		std::cout << stats.assetCount << " assets, "
+				  << stats.cookedCount << " cooked, "
+				  << stats.cacheHits << " cached (" << stats.getHitRate() * 100.0 << "% hit rate), "
+				  << stats.failedCount << " failed, "
+				  << stats.removedCount << " removed in "
+				  << stats.totalMilliseconds << " ms\n";
+
+		return stats.failedCount ? 2 : 0;
+	}
+	catch (const std::exception& exception) {
+		std::cerr << "error: " << exception.what() << '\n';
+		return 1;
+	}
+}
\ No newline at end of file
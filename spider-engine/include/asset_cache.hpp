@@ -0,0 +1,203 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+
+#include "flat_hash_map.hpp"
+
+namespace spider_engine {
+	struct AssetCacheStats {
+		size_t entries           = 0;
+		size_t referenced        = 0; // Held by at least one handle besides the cache
+		size_t bytes             = 0;
+		size_t unreferencedBytes = 0; // What the budget can reclaim
+		size_t budgetBytes       = 0;
+
+		size_t pathHits     = 0;
+		size_t contentHits  = 0; // Same content found under another path, nothing was loaded
+		size_t misses       = 0;
+		size_t evictions    = 0;
+		size_t evictedBytes = 0;
+
+		double getHitRate() const {
+			const size_t lookups = pathHits + contentHits + misses;
+			return lookups ? static_cast<double>(pathHits + contentHits) / lookups : 0.0;
+		}
+	};
+
+	// Shares loaded assets between their users. Entries are found by a path key first (the path plus
+	// whatever load settings change the result), then by a hash of the content, so copies of a file
+	// under other names are loaded once too. Handles are shared pointers: an entry only the cache holds
+	// is unreferenced, and unreferenced entries are dropped least recently used first whenever the cache
+	// is over its byte budget. Referenced entries are never dropped, so the budget can be exceeded.
+	// Not thread safe, it lives on the thread that owns the renderer.
+	template <typename Ty>
+	class AssetCache {
+	private:
+		struct Entry {
+			std::shared_ptr<Ty>      asset;
+			std::vector<std::string> paths; // Every path key pointing here
+			uint64_t                 contentHash;
+			size_t                   bytes;
+			uint64_t                 lastUsed;
+		};
+
+		std::vector<Entry>    entries_;
+		std::vector<uint32_t> freeIds_;
+
+		ska::flat_hash_map<std::string, uint32_t> byPath_;
+		ska::flat_hash_map<uint64_t, uint32_t>    byContent_;
+
+		std::function<size_t(const Ty&)> sizeOf_;
+
+		size_t   budgetBytes_;
+		size_t   bytes_ = 0;
+		uint64_t tick_  = 0;
+
+		AssetCacheStats stats_;
+
+		std::shared_ptr<Ty> use(const uint32_t id) {
+			entries_[id].lastUsed = ++tick_;
+			return entries_[id].asset;
+		}
+
+		// The path now also leads to the entry with the same content, if there is one
+		std::shared_ptr<Ty> findContent(const std::string& path, const uint64_t contentHash) {
+			auto it = byContent_.find(contentHash);
+			if (it == byContent_.end()) return nullptr;
+
+			++stats_.contentHits;
+			entries_[it->second].paths.push_back(path);
+			byPath_[path] = it->second;
+			return use(it->second);
+		}
+
+		void evict(const uint32_t id) {
+			// Keys inserted again since then lead to the newer entry
+			Entry& entry = entries_[id];
+			for (const std::string& path : entry.paths) {
+				if (auto it = byPath_.find(path); it != byPath_.end() && it->second == id) byPath_.erase(it);
+			}
+			if (auto it = byContent_.find(entry.contentHash); it != byContent_.end() && it->second == id) byContent_.erase(it);
+
+			bytes_ -= entry.bytes;
+			++stats_.evictions;
+			stats_.evictedBytes += entry.bytes;
+
+			entry = {};
+			freeIds_.push_back(id);
+		}
+
+	public:
+		AssetCache(std::function<size_t(const Ty&)> sizeOf, const size_t budgetBytes = 512ull << 20) :
+			sizeOf_(std::move(sizeOf)),
+			budgetBytes_(budgetBytes)
+		{}
+		AssetCache(const AssetCache&)     = delete;
+		AssetCache(AssetCache&&) noexcept = default;
+
+		// Null on a miss, a miss by path still finds the asset when hashContent matches a cached one
+		std::shared_ptr<Ty> find(const std::string& path, const std::function<uint64_t()>& hashContent = {}) {
+			if (auto it = byPath_.find(path); it != byPath_.end()) {
+				++stats_.pathHits;
+				return use(it->second);
+			}
+			return hashContent ? findContent(path, hashContent()) : nullptr;
+		}
+
+		std::shared_ptr<Ty> insert(const std::string& path, const uint64_t contentHash, Ty&& asset) {
+			++stats_.misses;
+
+			uint32_t id;
+			if (!freeIds_.empty()) {
+				id = freeIds_.back();
+				freeIds_.pop_back();
+			}
+			else {
+				id = static_cast<uint32_t>(entries_.size());
+				entries_.emplace_back();
+			}
+
+			Entry& entry      = entries_[id];
+			entry.asset       = std::make_shared<Ty>(std::move(asset));
+			entry.paths       = { path };
+			entry.contentHash = contentHash;
+			entry.bytes       = sizeOf_(*entry.asset);
+
+			byPath_[path]           = id;
+			byContent_[contentHash] = id;
+			bytes_                 += entry.bytes;
+
+			std::shared_ptr<Ty> handle = use(id);
+			trim();
+			return handle;
+		}
+
+		// Finds the asset or loads it. The content is only hashed on a path miss, and only loaded when that misses too.
+		std::shared_ptr<Ty> acquire(const std::string& path, const std::function<uint64_t()>& hashContent, const std::function<Ty()>& load) {
+			if (auto it = byPath_.find(path); it != byPath_.end()) {
+				++stats_.pathHits;
+				return use(it->second);
+			}
+
+			const uint64_t contentHash = hashContent();
+			if (std::shared_ptr<Ty> asset = findContent(path, contentHash)) return asset;
+
+			return insert(path, contentHash, load());
+		}
+
+		// Drops unreferenced entries, least recently used first, until the cache fits its budget.
+		// Runs on every insert, call it once per frame as well so released handles give their memory back.
+		void trim() {
+			if (bytes_ <= budgetBytes_) return;
+
+			std::vector<uint32_t> unreferenced;
+			for (uint32_t id = 0; id < entries_.size(); ++id) {
+				if (entries_[id].asset && entries_[id].asset.use_count() == 1) unreferenced.push_back(id);
+			}
+			std::sort(unreferenced.begin(), unreferenced.end(), [this](const uint32_t a, const uint32_t b) {
+				return entries_[a].lastUsed < entries_[b].lastUsed;
+			});
+
+			for (const uint32_t id : unreferenced) {
+				if (bytes_ <= budgetBytes_) break;
+				evict(id);
+			}
+		}
+
+		// Drops every unreferenced entry, whatever the budget
+		void purge() {
+			for (uint32_t id = 0; id < entries_.size(); ++id) {
+				if (entries_[id].asset && entries_[id].asset.use_count() == 1) evict(id);
+			}
+		}
+
+		void setBudget(const size_t budgetBytes) {
+			budgetBytes_ = budgetBytes;
+			trim();
+		}
+		size_t getBudget() const {
+			return budgetBytes_;
+		}
+
+		AssetCacheStats getStats() const {
+			AssetCacheStats stats = stats_;
+			stats.bytes       = bytes_;
+			stats.budgetBytes = budgetBytes_;
+			for (const Entry& entry : entries_) {
+				if (!entry.asset) continue;
+
+				++stats.entries;
+				if (entry.asset.use_count() > 1) ++stats.referenced;
+				else                             stats.unreferencedBytes += entry.bytes;
+			}
+			return stats;
+		}
+
+		AssetCache& operator=(const AssetCache&)     = delete;
+		AssetCache& operator=(AssetCache&&) noexcept = default;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,388 @@
+#pragma once
+#include <cctype>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <algorithm>
+#include <filesystem>
+
+#include "asset_manifest.hpp"
+#include "content_hash.hpp"
+#include "mesh_importer.hpp"
+#include "spmesh_format.hpp"
+#include "texture_compression.hpp"
+#include "vertex_compression.hpp"
+
+namespace spider_engine {
+	struct CookSettings {
+		rendering::MeshImportSettings mesh;
+		rendering::VertexFormat       vertexFormat = rendering::VertexFormat::FULL;
+		rendering::TextureCookSettings texture;
+
+		uint32_t threadCount = 0;     // 0 uses every hardware thread
+		bool     force       = false; // Ignore the cache and cook everything
+	};
+
+	struct AssetCookRecord {
+		std::filesystem::path sourcePath; // Relative to the source root
+		AssetType             type;
+
+		bool        cacheHit = false;
+		bool        failed   = false;
+		std::string error;
+
+		double hashMilliseconds = 0.0;
+		double cookMilliseconds = 0.0;
+
+		rendering::TextureCompressionStats compression; // Textures only
+	};
+
+	struct CookStats {
+		size_t assetCount   = 0;
+		size_t cookedCount  = 0;
+		size_t cacheHits    = 0;
+		size_t failedCount  = 0;
+		size_t removedCount = 0; // Cooked files whose source was deleted
+
+		double totalMilliseconds = 0.0;
+
+		rendering::TextureCompressionStats textures; // Cooked this run, cache hits are not encoded again
+
+		std::vector<AssetCookRecord> records;
+
+		double getHitRate() const {
+			return assetCount ? static_cast<double>(cacheHits) / assetCount : 0.0;
+		}
+	};
+
+	// Walks a source tree and cooks every changed asset into engine formats under the output root.
+	// Nothing here touches the GPU or the window, so it runs headless on any platform.
+	class AssetCooker {
+	private:
+		// Bump whenever a cook function changes its output, every asset is then rebuilt once
+		static constexpr uint32_t cookerVersion = 2;
+
+		struct CookJob {
+			std::filesystem::path source;   // Absolute
+			std::filesystem::path relative; // Relative to the source root
+			AssetType             type;
+			uint64_t              inputHash = 0;
+		};
+
+		std::filesystem::path sourceRoot_;
+		std::filesystem::path outputRoot_;
+		CookSettings          settings_;
+		CookStats             stats_;
+
+		static std::optional<AssetType> classify(const std::filesystem::path& path) {
+			std::string extension = path.extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+			if (extension == ".obj" || extension == ".fbx" || extension == ".gltf" || extension == ".glb" || extension == ".dae") return AssetType::MESH;
+			if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".dds") return AssetType::TEXTURE;
+			if (extension == ".hlsl" || extension == ".hlsli") return AssetType::SHADER;
+
+			return std::nullopt;
+		}
+
+		// Textures this platform can decode are cooked into DDS, the rest are copied
+		static std::filesystem::path getCookedPath(const std::filesystem::path& relative, const AssetType type) {
+			std::filesystem::path cooked = relative;
+			if      (type == AssetType::MESH)                                                   cooked.replace_extension(".spmesh");
+			else if (type == AssetType::TEXTURE && rendering::canLoadTextureSource(relative)) cooked.replace_extension(".dds");
+			return cooked;
+		}
+
+		// Local #include "..." files, followed recursively so editing a header re-cooks its users
+		static void hashShaderIncludes(const std::filesystem::path& shader, ContentHasher& hasher, std::vector<std::filesystem::path>& visited) {
+			std::ifstream stream(shader);
+			std::string   line;
+			while (std::getline(stream, line)) {
+				const size_t directive = line.find("#include");
+				if (directive == std::string::npos) continue;
+
+				const size_t open  = line.find('"', directive);
+				const size_t close = open != std::string::npos ? line.find('"', open + 1) : std::string::npos;
+				if (close == std::string::npos) continue;
+
+				const std::filesystem::path include = (shader.parent_path() / line.substr(open + 1, close - open - 1)).lexically_normal();
+				if (std::find(visited.begin(), visited.end(), include) != visited.end()) continue;
+				visited.push_back(include);
+
+				if (!std::filesystem::exists(include)) continue;
+
+				hasher.update(std::string_view(include.generic_string()));
+				hasher.update(hashFile(include));
+				hashShaderIncludes(include, hasher, visited);
+			}
+		}
+
+		// Files a model pulls in next to itself: OBJ material libraries and glTF buffers and images.
+		// Their content goes in the hash, so editing a .mtl or a .bin re-cooks the model.
+		static void hashMeshSideFiles(const std::filesystem::path& model, ContentHasher& hasher) {
+			std::string extension = model.extension().string();
+			std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+			std::vector<std::filesystem::path> sideFiles;
+
+			std::ifstream stream(model);
+			std::string   line;
+			if (extension == ".obj") {
+				while (std::getline(stream, line)) {
+					const size_t start = line.find_first_not_of(" \t");
+					if (start == std::string::npos || line.compare(start, 7, "mtllib ") != 0) continue;
+
+					// Several libraries may follow on one line
+					size_t name = line.find_first_not_of(" \t", start + 7);
+					while (name != std::string::npos) {
+						const size_t end = line.find_first_of(" \t\r", name);
+						sideFiles.push_back(model.parent_path() / line.substr(name, end - name));
+						name = end != std::string::npos ? line.find_first_not_of(" \t\r", end) : end;
+					}
+				}
+			}
+			else if (extension == ".gltf") {
+				const std::string json((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+				for (size_t key = json.find("\"uri\""); key != std::string::npos; key = json.find("\"uri\"", key + 5)) {
+					const size_t open  = json.find('"', json.find(':', key));
+					const size_t close = open != std::string::npos ? json.find('"', open + 1) : std::string::npos;
+					if (close == std::string::npos) break;
+
+					// Embedded data is already part of the file
+					const std::string uri = json.substr(open + 1, close - open - 1);
+					if (uri.rfind("data:", 0) != 0) sideFiles.push_back(model.parent_path() / uri);
+				}
+			}
+
+			for (std::filesystem::path& sideFile : sideFiles) sideFile = sideFile.lexically_normal();
+			std::sort(sideFiles.begin(), sideFiles.end());
+			sideFiles.erase(std::unique(sideFiles.begin(), sideFiles.end()), sideFiles.end());
+
+			for (const std::filesystem::path& sideFile : sideFiles) {
+				hasher.update(std::string_view(sideFile.generic_string()));
+				if (std::filesystem::exists(sideFile)) hasher.update(hashFile(sideFile));
+			}
+		}
+
+		uint64_t hashInputs(const CookJob& job) const {
+			ContentHasher hasher;
+			hasher.update(cookerVersion);
+			hasher.update(job.type);
+			hasher.update(hashFile(job.source));
+
+			switch (job.type) {
+				case AssetType::MESH:
+					hasher.update(settings_.mesh.lodCount);
+					hasher.update(settings_.mesh.optimize);
+					hasher.update(settings_.mesh.buildMeshlets);
+					hasher.update(settings_.vertexFormat);
+					hasher.update(rendering::spmeshVersion);
+					hashMeshSideFiles(job.source, hasher);
+					break;
+
+				case AssetType::TEXTURE:
+					hasher.update(settings_.texture.compression);
+					hasher.update(settings_.texture.mipFilter);
+					hasher.update(settings_.texture.highQuality);
+					break;
+
+				case AssetType::SHADER: {
+					std::vector<std::filesystem::path> visited;
+					hashShaderIncludes(job.source, hasher, visited);
+					break;
+				}
+
+				default:
+					break;
+			}
+
+			return hasher.finish();
+		}
+
+		void cookMesh(const CookJob& job, const std::filesystem::path& output, Assimp::Importer& importer) const {
+			rendering::ImportedMesh imported = rendering::importMesh(importer, job.source, settings_.mesh);
+
+			// Textures are cooked into the same relative place, so point every material at the cooked copy
+			for (std::filesystem::path& materialTexture : imported.materialTextures) {
+				if (materialTexture.empty()) continue;
+
+				const std::filesystem::path texture = materialTexture.lexically_normal().lexically_relative(sourceRoot_);
+				if (!texture.empty() && *texture.begin() != "..") {
+					materialTexture = outputRoot_ / getCookedPath(texture, AssetType::TEXTURE);
+				}
+			}
+
+			rendering::writeSpmesh(output, imported, settings_.vertexFormat);
+		}
+
+		// Shaders and textures this platform cannot decode are copied as is, the runtime handles them
+		void cookCopy(const CookJob& job, const std::filesystem::path& output) const {
+			std::filesystem::copy_file(job.source, output, std::filesystem::copy_options::overwrite_existing);
+		}
+
+		void runJob(CookJob& job, AssetCookRecord& record, const AssetManifest& previous, Assimp::Importer& importer) const {
+			record.sourcePath = job.relative;
+			record.type       = job.type;
+
+			const std::filesystem::path output = outputRoot_ / getCookedPath(job.relative, job.type);
+
+			try {
+				auto hashStart = std::chrono::steady_clock::now();
+
+				job.inputHash = hashInputs(job);
+
+				auto hashFinish = std::chrono::steady_clock::now();
+				record.hashMilliseconds = std::chrono::duration<double, std::milli>(hashFinish - hashStart).count();
+
+				const AssetManifestEntry* entry = previous.find(job.relative);
+				if (!settings_.force && entry && entry->inputHash == job.inputHash && std::filesystem::exists(output)) {
+					record.cacheHit = true;
+					return;
+				}
+
+				std::filesystem::create_directories(output.parent_path());
+
+				if      (job.type == AssetType::MESH)                                                   cookMesh(job, output, importer);
+				else if (job.type == AssetType::TEXTURE && rendering::canLoadTextureSource(job.source)) rendering::cookTexture(job.source, output, settings_.texture, &record.compression);
+				else                                                                                    cookCopy(job, output);
+
+				auto cookFinish = std::chrono::steady_clock::now();
+				record.cookMilliseconds = std::chrono::duration<double, std::milli>(cookFinish - hashFinish).count();
+			}
+			catch (const std::exception& exception) {
+				record.failed = true;
+				record.error  = exception.what();
+			}
+		}
+
+	public:
+		AssetCooker(const std::filesystem::path& sourceRoot,
+					const std::filesystem::path& outputRoot,
+					const CookSettings&          settings = {}) :
+			sourceRoot_(std::filesystem::absolute(sourceRoot).lexically_normal()),
+			outputRoot_(std::filesystem::absolute(outputRoot).lexically_normal()),
+			settings_(settings)
+		{}
+
+		const CookStats& cook() {
+			auto start = std::chrono::steady_clock::now();
+
+			stats_ = {};
+
+			if (!std::filesystem::is_directory(sourceRoot_)) {
+				throw std::runtime_error("Source folder not found: " + sourceRoot_.string());
+			}
+			std::filesystem::create_directories(outputRoot_);
+
+			const AssetManifest previous = AssetManifest::load(outputRoot_);
+
+			// Sorted so the manifest and the report do not depend on directory iteration order
+			std::vector<CookJob> jobs;
+			for (auto it = std::filesystem::recursive_directory_iterator(sourceRoot_); it != std::filesystem::recursive_directory_iterator(); ++it) {
+				const std::filesystem::directory_entry& file = *it;
+
+				// An output folder inside the source tree is never cooked again
+				if (file.is_directory() && file.path().lexically_normal() == outputRoot_) {
+					it.disable_recursion_pending();
+					continue;
+				}
+				if (!file.is_regular_file()) continue;
+
+				const std::optional<AssetType> type = classify(file.path());
+				if (!type) continue;
+
+				CookJob job;
+				job.source   = file.path();
+				job.relative = file.path().lexically_relative(sourceRoot_);
+				job.type     = *type;
+				jobs.push_back(std::move(job));
+			}
+			std::sort(jobs.begin(), jobs.end(), [](const CookJob& a, const CookJob& b) { return a.relative < b.relative; });
+
+			stats_.assetCount = jobs.size();
+			stats_.records.resize(jobs.size());
+
+			// Workers pull jobs from a shared counter, big meshes do not stall a fixed partition
+			const uint32_t threadCount = std::max<uint32_t>(1, std::min<uint32_t>(
+				settings_.threadCount ? settings_.threadCount : std::thread::hardware_concurrency(),
+				static_cast<uint32_t>(jobs.size())
+			));
+
+			std::atomic<size_t> next = 0;
+			auto worker = [&]() {
+#ifdef _WIN32
+				// WIC decoding needs COM on this thread
+				const HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+#endif
+				Assimp::Importer importer; // Not thread safe, one per worker
+
+				for (size_t j = next++; j < jobs.size(); j = next++) {
+					runJob(jobs[j], stats_.records[j], previous, importer);
+				}
+#ifdef _WIN32
+				if (SUCCEEDED(comResult)) CoUninitialize();
+#endif
+			};
+
+			std::vector<std::thread> threads;
+			for (uint32_t t = 1; t < threadCount; ++t) threads.emplace_back(worker);
+			worker();
+			for (std::thread& thread : threads) thread.join();
+
+			// Failed assets keep their old entry so the last good cook stays usable
+			AssetManifest manifest;
+			for (size_t j = 0; j < jobs.size(); ++j) {
+				const AssetCookRecord& record = stats_.records[j];
+
+				if (record.failed) {
+					++stats_.failedCount;
+					if (const AssetManifestEntry* entry = previous.find(jobs[j].relative)) manifest.add(*entry);
+					continue;
+				}
+
+				if (record.cacheHit) ++stats_.cacheHits;
+				else                 ++stats_.cookedCount;
+
+				stats_.textures += record.compression;
+
+				AssetManifestEntry entry;
+				entry.id         = makeAssetId(jobs[j].relative);
+				entry.type       = jobs[j].type;
+				entry.sourcePath = jobs[j].relative;
+				entry.cookedPath = getCookedPath(jobs[j].relative, jobs[j].type);
+				entry.inputHash  = jobs[j].inputHash;
+				manifest.add(std::move(entry));
+			}
+
+			// Outputs whose source is gone
+			for (const AssetManifestEntry& entry : previous.getEntries()) {
+				if (manifest.find(entry.id)) continue;
+
+				std::error_code error;
+				if (std::filesystem::remove(outputRoot_ / entry.cookedPath, error)) ++stats_.removedCount;
+			}
+
+			manifest.save(outputRoot_);
+
+			auto finish = std::chrono::steady_clock::now();
+			stats_.totalMilliseconds = std::chrono::duration<double, std::milli>(finish - start).count();
+
+			return stats_;
+		}
+
+		const CookStats& getStats() const {
+			return stats_;
+		}
+		const std::filesystem::path& getSourceRoot() const {
+			return sourceRoot_;
+		}
+		const std::filesystem::path& getOutputRoot() const {
+			return outputRoot_;
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,604 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <filesystem>
+#include <condition_variable>
+#include <objbase.h>
+
+#include "dx12_renderer.hpp"
+#include "frame_profiler.hpp"
+#include "flecs.h"
+
+namespace spider_engine::d3dx12 {
+	enum class AssetState : uint8_t {
+		QUEUED,    // Waiting for a worker
+		LOADING,   // File I/O and decoding on a worker
+		UPLOADING, // Copy recorded, waiting for the GPU
+		READY,
+		FAILED,
+		CANCELLED
+	};
+
+	enum class AssetPriority : uint8_t {
+		LOW,
+		NORMAL,
+		HIGH,
+		CRITICAL
+	};
+
+	// Kept on the target entity of a request, so systems can query what is still loading
+	struct AssetLoadState {
+		uint64_t   requestId;
+		AssetState state;
+	};
+
+	struct AssetStageLatency {
+		size_t samples             = 0;
+		double lastMilliseconds    = 0.0;
+		double averageMilliseconds = 0.0;
+		double maxMilliseconds     = 0.0;
+
+		void add(const double milliseconds) {
+			++samples;
+			lastMilliseconds     = milliseconds;
+			averageMilliseconds += (milliseconds - averageMilliseconds) / samples;
+			maxMilliseconds      = std::max(maxMilliseconds, milliseconds);
+		}
+	};
+
+	struct AssetLoaderStats {
+		// Current depth of every stage
+		size_t queued        = 0;
+		size_t loading       = 0;
+		size_t waitingUpload = 0;
+		size_t uploading     = 0;
+
+		size_t completed     = 0;
+		size_t failed        = 0;
+		size_t cancelled     = 0;
+		size_t uploadedBytes = 0;
+
+		AssetStageLatency queue;  // Request to worker pickup
+		AssetStageLatency load;   // I/O, decoding and buffer creation
+		AssetStageLatency upload; // Waiting for the upload budget plus the GPU copy
+		AssetStageLatency total;
+	};
+
+	class AssetSlotBase {
+	public:
+		std::atomic<AssetState> state           = AssetState::QUEUED;
+		std::atomic<bool>       cancelRequested = false;
+
+		uint64_t              id = 0;
+		std::filesystem::path path;
+		std::string           error;
+
+		virtual ~AssetSlotBase() = default;
+	};
+
+	template <typename Ty>
+	class AssetSlot : public AssetSlotBase {
+	public:
+		Ty   asset;
+		bool isMovedToEntity = false;
+	};
+
+	// Returned right away by the loader, the asset becomes available once the state is READY
+	template <typename Ty>
+	class AssetHandle {
+	private:
+		std::shared_ptr<AssetSlot<Ty>> slot_;
+
+		friend class AssetLoader;
+
+		AssetHandle(std::shared_ptr<AssetSlot<Ty>> slot) :
+			slot_(std::move(slot))
+		{}
+
+	public:
+		AssetHandle() = default;
+
+		bool isValid() const {
+			return slot_ != nullptr;
+		}
+		uint64_t getId() const {
+			return slot_ ? slot_->id : 0;
+		}
+		AssetState getState() const {
+			return slot_ ? slot_->state.load(std::memory_order_acquire) : AssetState::FAILED;
+		}
+		bool isReady() const {
+			return getState() == AssetState::READY;
+		}
+		bool isDone() const {
+			const AssetState state = getState();
+			return state == AssetState::READY || state == AssetState::FAILED || state == AssetState::CANCELLED;
+		}
+
+		// Null until ready, and after the asset was moved into the target entity of the request
+		Ty* get() const {
+			return isReady() && !slot_->isMovedToEntity ? &slot_->asset : nullptr;
+		}
+		const std::string& getError() const {
+			return slot_->error;
+		}
+
+		// Requests that have not reached the GPU are dropped, the others are released once the copy is done
+		void cancel() const {
+			if (slot_) slot_->cancelRequested = true;
+		}
+	};
+
+	// Loads renderizables and textures in the background. Workers do the file I/O, parsing and
+	// decoding, the thread that owns the renderer records the texture copies in update() under a
+	// per call byte budget, and requests complete once their copy fence is reached.
+	class AssetLoader {
+	private:
+		template <typename Ty>
+		using ComPtr = Microsoft::WRL::ComPtr<Ty>;
+
+		using Clock = std::chrono::steady_clock;
+
+		SPIDER_DX12_ERROR_CHECK_PREPARE;
+
+		struct Request {
+			std::shared_ptr<AssetSlotBase> slot;
+			AssetPriority                  priority = AssetPriority::NORMAL;
+			uint64_t                       sequence = 0;
+			flecs::entity                  target;
+
+			std::function<void(Request&, Assimp::Importer&)>            load;     // Worker
+			std::function<size_t(Request&, ID3D12GraphicsCommandList*)> record;   // Owner thread, returns uploaded bytes
+			std::function<void(Request&, AssetState)>                   complete; // Owner thread, final state
+
+			DirectX::ScratchImage image; // Decoded, waiting for its copy
+			uint64_t              fenceValue = 0;
+			bool                  isFailed   = false;
+
+			Clock::time_point requested;
+			Clock::time_point started;
+			Clock::time_point decoded;
+		};
+		using RequestPtr = std::unique_ptr<Request>;
+
+		struct UploadBatch {
+			ComPtr<ID3D12CommandAllocator>    allocator;
+			ComPtr<ID3D12GraphicsCommandList> commandList;
+			uint64_t                          fenceValue = 0;
+		};
+
+		// Highest priority first, then oldest first
+		static bool isLowerPriority(const RequestPtr& a, const RequestPtr& b) {
+			if (a->priority != b->priority) return a->priority < b->priority;
+			return a->sequence > b->sequence;
+		}
+
+		flecs::world* world_;
+		DX12Renderer* renderer_;
+
+		std::vector<std::thread> workers_;
+		std::mutex               mutex_;
+		std::condition_variable  condition_;
+		std::vector<RequestPtr>  pending_; // Heap
+		std::vector<RequestPtr>  decoded_; // Heap
+		std::atomic<size_t>      loadingCount_ = 0;
+		bool                     isStopping_   = false;
+
+		std::vector<RequestPtr>  inFlight_;
+		std::vector<UploadBatch> batches_;
+		ComPtr<ID3D12Fence>      fence_;
+		uint64_t                 fenceValue_ = 0;
+
+		uint64_t nextId_ = 1;
+		size_t   uploadBudgetBytes_;
+
+		AssetLoaderStats stats_;
+
+		void workerLoop() {
+			// WIC decoding needs COM on this thread
+			const HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+			SPIDER_PROFILE_THREAD("AssetLoader worker");
+
+			Assimp::Importer importer; // Not thread safe, one per worker
+
+			while (true) {
+				RequestPtr request;
+				{
+					std::unique_lock lock(mutex_);
+					condition_.wait(lock, [this]() { return isStopping_ || !pending_.empty(); });
+					if (isStopping_) break;
+
+					std::pop_heap(pending_.begin(), pending_.end(), isLowerPriority);
+					request = std::move(pending_.back());
+					pending_.pop_back();
+				}
+
+				request->started = Clock::now();
+
+				AssetSlotBase& slot = *request->slot;
+				if (!slot.cancelRequested) {
+					++loadingCount_;
+					slot.state = AssetState::LOADING;
+
+					try {
+						SPIDER_PROFILE_SCOPE_DYNAMIC(slot.path.filename().string());
+						request->load(*request, importer);
+					}
+					catch (const std::exception& exception) {
+						slot.error        = exception.what();
+						request->isFailed = true;
+					}
+
+					--loadingCount_;
+				}
+
+				request->decoded = Clock::now();
+
+				// Every request goes back to the owner thread, which makes all the final transitions
+				std::lock_guard lock(mutex_);
+				decoded_.push_back(std::move(request));
+				std::push_heap(decoded_.begin(), decoded_.end(), isLowerPriority);
+			}
+
+			if (SUCCEEDED(comResult)) CoUninitialize();
+		}
+
+		void finish(Request& request, const AssetState state) {
+			AssetSlotBase& slot = *request.slot;
+
+			request.complete(request, state);
+
+			if      (state == AssetState::READY)  ++stats_.completed;
+			else if (state == AssetState::FAILED) ++stats_.failed;
+			else                                  ++stats_.cancelled;
+
+			if (request.target.id() != 0 && request.target.is_alive()) {
+				request.target.set<AssetLoadState>({ slot.id, state });
+			}
+
+			const Clock::time_point now = Clock::now();
+			stats_.total.add(std::chrono::duration<double, std::milli>(now - request.requested).count());
+		}
+
+		UploadBatch& acquireBatch() {
+			const uint64_t completed = fence_->GetCompletedValue();
+			for (UploadBatch& batch : batches_) {
+				if (batch.fenceValue <= completed) return batch;
+			}
+
+			UploadBatch& batch = batches_.emplace_back();
+			SPIDER_DX12_ERROR_CHECK(
+				renderer_->device_->CreateCommandAllocator(
+					D3D12_COMMAND_LIST_TYPE_DIRECT,
+					IID_PPV_ARGS(&batch.allocator)
+				)
+			);
+			SPIDER_DX12_ERROR_CHECK(
+				renderer_->device_->CreateCommandList(
+					0,
+					D3D12_COMMAND_LIST_TYPE_DIRECT,
+					batch.allocator.Get(),
+					nullptr,
+					IID_PPV_ARGS(&batch.commandList)
+				)
+			);
+			batch.commandList->Close();
+
+			return batch;
+		}
+
+		void completeUploads() {
+			const uint64_t completed = fence_->GetCompletedValue();
+
+			auto isDone = [completed](const RequestPtr& request) { return request->fenceValue <= completed; };
+			auto split  = std::stable_partition(inFlight_.begin(), inFlight_.end(), [&](const RequestPtr& request) { return !isDone(request); });
+
+			for (auto it = split; it != inFlight_.end(); ++it) {
+				Request& request = **it;
+				stats_.upload.add(std::chrono::duration<double, std::milli>(Clock::now() - request.decoded).count());
+
+				finish(request, request.slot->cancelRequested ? AssetState::CANCELLED : AssetState::READY);
+			}
+			inFlight_.erase(split, inFlight_.end());
+		}
+
+		void submitUploads() {
+			SPIDER_PROFILE_SCOPE("AssetLoader::submitUploads");
+
+			std::vector<RequestPtr> batch;
+			size_t                  batchBytes = 0;
+			{
+				std::lock_guard lock(mutex_);
+				while (!decoded_.empty()) {
+					const size_t bytes = decoded_.front()->image.GetPixelsSize();
+
+					// Always take one, an asset larger than the budget would otherwise never upload
+					if (!batch.empty() && batchBytes + bytes > uploadBudgetBytes_) break;
+
+					std::pop_heap(decoded_.begin(), decoded_.end(), isLowerPriority);
+					batch.push_back(std::move(decoded_.back()));
+					decoded_.pop_back();
+					batchBytes += bytes;
+				}
+			}
+			if (batch.empty()) return;
+
+			UploadBatch& upload = acquireBatch();
+			SPIDER_DX12_ERROR_CHECK(upload.allocator->Reset());
+			SPIDER_DX12_ERROR_CHECK(upload.commandList->Reset(upload.allocator.Get(), nullptr));
+
+			std::vector<RequestPtr> recorded;
+			for (RequestPtr& request : batch) {
+				AssetSlotBase& slot = *request->slot;
+
+				stats_.load.add(std::chrono::duration<double, std::milli>(request->decoded - request->started).count());
+				stats_.queue.add(std::chrono::duration<double, std::milli>(request->started - request->requested).count());
+
+				if (slot.cancelRequested) {
+					finish(*request, AssetState::CANCELLED);
+					continue;
+				}
+				if (request->isFailed) {
+					finish(*request, AssetState::FAILED);
+					continue;
+				}
+
+				try {
+					stats_.uploadedBytes += request->record(*request, upload.commandList.Get());
+					slot.state = AssetState::UPLOADING;
+					recorded.push_back(std::move(request));
+				}
+				catch (const std::exception& exception) {
+					slot.error = exception.what();
+					finish(*request, AssetState::FAILED);
+				}
+			}
+
+			if (recorded.empty()) {
+				renderer_->resourceStates_->discard(upload.commandList.Get());
+				SPIDER_DX12_ERROR_CHECK(upload.commandList->Close());
+				return;
+			}
+
+			// The textures of the batch transition together when the list is flushed
+			renderer_->resourceStates_->submit(renderer_->commandQueue_.Get(), upload.commandList.Get());
+			renderer_->commandQueue_->Signal(fence_.Get(), ++fenceValue_);
+			upload.fenceValue = fenceValue_;
+
+			for (RequestPtr& request : recorded) {
+				request->fenceValue = fenceValue_;
+				inFlight_.push_back(std::move(request));
+			}
+		}
+
+		static void releaseUploadResources(Texture2D& texture) {
+			texture.uploadResource.Reset();
+		}
+		static void releaseUploadResources(Renderizable& renderizable) {
+			// A cached texture was copied by this batch or an earlier one, the fence of the request covers both
+			if (renderizable.texture) releaseUploadResources(*std::const_pointer_cast<Texture2D>(renderizable.texture));
+		}
+
+		template <typename Ty>
+		AssetHandle<Ty> enqueue(const std::filesystem::path&                                                path,
+								const AssetPriority                                                         priority,
+								flecs::entity                                                               target,
+								std::function<void(const AssetHandle<Ty>&)>                                 callback,
+								std::function<void(Request&, AssetSlot<Ty>&, Assimp::Importer&)>            load,
+								std::function<size_t(Request&, AssetSlot<Ty>&, ID3D12GraphicsCommandList*)> record)
+		{
+			auto slot  = std::make_shared<AssetSlot<Ty>>();
+			slot->id   = nextId_++;
+			slot->path = path;
+
+			auto request       = std::make_unique<Request>();
+			request->slot      = slot;
+			request->priority  = priority;
+			request->sequence  = slot->id;
+			request->target    = target;
+			request->requested = Clock::now();
+
+			AssetSlot<Ty>* typed = slot.get();
+			request->load = [typed, load = std::move(load)](Request& request, Assimp::Importer& importer) {
+				load(request, *typed, importer);
+			};
+			request->record = [typed, record = std::move(record)](Request& request, ID3D12GraphicsCommandList* commandList) {
+				return record(request, *typed, commandList);
+			};
+			request->complete = [typed, callback = std::move(callback)](Request& request, const AssetState state) {
+				// The copy is done (or never happened), the intermediate buffers can go
+				request.image.Release();
+				releaseUploadResources(typed->asset);
+
+				if (state == AssetState::READY && request.target.id() != 0 && request.target.is_alive()) {
+					request.target.set<Ty>(std::move(typed->asset));
+					typed->isMovedToEntity = true;
+				}
+				typed->state.store(state, std::memory_order_release);
+
+				// Cancelled requests were dropped on purpose, nobody is waiting for them
+				if (callback && state != AssetState::CANCELLED) {
+					callback(AssetHandle<Ty>(std::static_pointer_cast<AssetSlot<Ty>>(request.slot)));
+				}
+			};
+
+			if (target.id() != 0 && target.is_alive()) {
+				target.set<AssetLoadState>({ slot->id, AssetState::QUEUED });
+			}
+
+			{
+				std::lock_guard lock(mutex_);
+				pending_.push_back(std::move(request));
+				std::push_heap(pending_.begin(), pending_.end(), isLowerPriority);
+			}
+			condition_.notify_one();
+
+			return AssetHandle<Ty>(std::move(slot));
+		}
+
+	public:
+		AssetLoader(flecs::world*  world,
+					DX12Renderer&  renderer,
+					const uint32_t threadCount       = 2,
+					const size_t   uploadBudgetBytes = 64ull << 20) :
+			world_(world),
+			renderer_(&renderer),
+			uploadBudgetBytes_(uploadBudgetBytes)
+		{
+			SPIDER_DX12_ERROR_CHECK(renderer_->device_->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence_)));
+
+			const uint32_t workerCount = std::max<uint32_t>(1, threadCount);
+			for (uint32_t t = 0; t < workerCount; ++t) {
+				workers_.emplace_back(&AssetLoader::workerLoop, this);
+			}
+		}
+		AssetLoader(const AssetLoader&) = delete;
+		AssetLoader(AssetLoader&&)      = delete;
+
+		~AssetLoader() {
+			{
+				std::lock_guard lock(mutex_);
+				isStopping_ = true;
+			}
+			condition_.notify_all();
+			for (std::thread& worker : workers_) worker.join();
+
+			// Resources of in-flight requests are still being written by the GPU
+			if (fence_ && fence_->GetCompletedValue() < fenceValue_) {
+				fence_->SetEventOnCompletion(fenceValue_, nullptr);
+			}
+		}
+
+		// Mesh buffers are created on the worker, the diffuse texture is decoded there and copied in update().
+		// Both go through the renderer caches under the keys acquireMesh and acquireTexture2D use: a path hit skips
+		// the work, and what the worker loads is matched by content before it is added.
+		AssetHandle<Renderizable> loadRenderizable(const std::filesystem::path&                          path,
+												   const AssetPriority                                   priority = AssetPriority::NORMAL,
+												   flecs::entity                                         target   = {},
+												   std::function<void(const AssetHandle<Renderizable>&)> callback = {},
+												   const uint32_t                                        lodCount = 4,
+												   const rendering::VertexFormat                         format   = rendering::VertexFormat::FULL)
+		{
+			// Written by the worker, read by the owner thread once the request is back
+			struct Loaded {
+				std::string           meshKey;
+				MeshHandle            cachedMesh;
+				TextureHandle         cachedTexture;
+				Mesh                  mesh;
+				uint64_t              meshHash = 0;
+				std::filesystem::path diffuseTexture;
+				uint64_t              textureHash = 0;
+			};
+			auto loaded = std::make_shared<Loaded>();
+
+			// The caches are only touched on this thread, and the path lookups need no I/O
+			loaded->meshKey    = DX12Renderer::getMeshCacheKey(path, lodCount, format);
+			loaded->cachedMesh = renderer_->meshCache_.find(loaded->meshKey);
+			if (loaded->cachedMesh && !loaded->cachedMesh->diffuseTexture.empty()) {
+				loaded->cachedTexture = renderer_->textureCache_.find(DX12Renderer::getTextureCacheKey(loaded->cachedMesh->diffuseTexture));
+			}
+
+			return enqueue<Renderizable>(
+				path,
+				priority,
+				target,
+				std::move(callback),
+				[this, loaded, lodCount, format](Request& request, AssetSlot<Renderizable>& slot, Assimp::Importer& importer) {
+					if (loaded->cachedMesh) {
+						loaded->diffuseTexture = loaded->cachedMesh->diffuseTexture;
+					}
+					else {
+						loaded->meshHash = hashFile(slot.path, DX12Renderer::getMeshSettings(lodCount, format));
+						loaded->mesh     = renderer_->loadMesh(slot.path, importer, loaded->diffuseTexture, lodCount, format);
+					}
+
+					if (!loaded->diffuseTexture.empty() && !loaded->cachedTexture) {
+						loaded->textureHash = hashFile(loaded->diffuseTexture);
+						request.image       = DX12Renderer::loadImage(loaded->diffuseTexture.wstring());
+					}
+				},
+				[this, loaded](Request& request, AssetSlot<Renderizable>& slot, ID3D12GraphicsCommandList* commandList) -> size_t {
+					slot.asset.mesh = loaded->cachedMesh;
+					if (!slot.asset.mesh) {
+						slot.asset.mesh = renderer_->meshCache_.find(loaded->meshKey, [&]() { return loaded->meshHash; });
+						if (!slot.asset.mesh) slot.asset.mesh = renderer_->meshCache_.insert(loaded->meshKey, loaded->meshHash, std::move(loaded->mesh));
+					}
+
+					const std::filesystem::path& diffuseTexture = slot.asset.mesh->diffuseTexture;
+					if (diffuseTexture.empty()) return 0;
+
+					slot.asset.texture = loaded->cachedTexture;
+					if (slot.asset.texture) return 0;
+
+					// A mesh found by content keeps the texture of its first path, which the worker did not decode
+					if (diffuseTexture != loaded->diffuseTexture || !request.image.GetPixels()) {
+						slot.asset.texture = renderer_->acquireTexture2D(diffuseTexture);
+						return 0;
+					}
+
+					const std::string textureKey = DX12Renderer::getTextureCacheKey(diffuseTexture);
+					slot.asset.texture = renderer_->textureCache_.find(textureKey, [&]() { return loaded->textureHash; });
+					if (slot.asset.texture) return 0;
+
+					slot.asset.texture = renderer_->textureCache_.insert(textureKey, loaded->textureHash, renderer_->createTexture2D(request.image, commandList));
+					return request.image.GetPixelsSize();
+				}
+			);
+		}
+
+		AssetHandle<Texture2D> loadTexture2D(const std::filesystem::path&                       path,
+											 const AssetPriority                                priority = AssetPriority::NORMAL,
+											 flecs::entity                                      target   = {},
+											 std::function<void(const AssetHandle<Texture2D>&)> callback = {})
+		{
+			return enqueue<Texture2D>(
+				path,
+				priority,
+				target,
+				std::move(callback),
+				[](Request& request, AssetSlot<Texture2D>& slot, Assimp::Importer&) {
+					request.image = DX12Renderer::loadImage(slot.path.wstring());
+				},
+				[this](Request& request, AssetSlot<Texture2D>& slot, ID3D12GraphicsCommandList* commandList) -> size_t {
+					slot.asset = renderer_->createTexture2D(request.image, commandList);
+					return request.image.GetPixelsSize();
+				}
+			);
+		}
+
+		// Call once per frame from the thread that owns the renderer, completions and callbacks happen here
+		void update() {
+			SPIDER_PROFILE_SCOPE("AssetLoader::update");
+
+			completeUploads();
+			submitUploads();
+		}
+
+		void setUploadBudget(const size_t bytes) {
+			uploadBudgetBytes_ = bytes;
+		}
+
+		AssetLoaderStats getStats() {
+			AssetLoaderStats stats = stats_;
+			{
+				std::lock_guard lock(mutex_);
+				stats.queued        = pending_.size();
+				stats.waitingUpload = decoded_.size();
+			}
+			stats.loading   = loadingCount_;
+			stats.uploading = inFlight_.size();
+			return stats;
+		}
+
+		AssetLoader& operator=(const AssetLoader&) = delete;
+		AssetLoader& operator=(AssetLoader&&)      = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <filesystem>
+#include <string_view>
+
+#include "flat_hash_map.hpp"
+#include "content_hash.hpp"
+
+namespace spider_engine {
+	using AssetId = uint64_t;
+
+	enum class AssetType : uint8_t {
+		MESH,
+		TEXTURE,
+		SHADER
+	};
+
+	inline constexpr std::string_view assetTypeNames[] = { "mesh", "texture", "shader" };
+
+	// Ids come from the source path relative to the source root, so they survive re-cooks and moves of the root
+	inline AssetId makeAssetId(const std::filesystem::path& relativePath) {
+		const std::u8string utf8 = relativePath.generic_u8string();
+		return hashBytes(utf8.data(), utf8.size());
+	}
+
+	struct AssetManifestEntry {
+		AssetId   id;
+		AssetType type;
+
+		std::filesystem::path sourcePath; // Relative to the source root
+		std::filesystem::path cookedPath; // Relative to the manifest folder
+
+		uint64_t inputHash; // Source content, dependencies and cook settings
+	};
+
+	// Text manifest, one asset per line: id type input-hash source cooked
+	class AssetManifest {
+	private:
+		std::vector<AssetManifestEntry>     entries_;
+		ska::flat_hash_map<AssetId, size_t> index_;
+
+		std::filesystem::path root_;
+
+		static std::string toLine(const std::filesystem::path& path) {
+			const std::u8string utf8 = path.generic_u8string();
+			return std::string(utf8.begin(), utf8.end());
+		}
+
+	public:
+		static constexpr std::string_view fileName = "manifest.txt";
+
+		AssetManifest() = default;
+
+		// Missing manifests load as empty, everything is then considered dirty
+		static AssetManifest load(const std::filesystem::path& root) {
+			AssetManifest manifest;
+			manifest.root_ = root;
+
+			std::ifstream stream(root / fileName);
+			if (!stream) return manifest;
+
+			std::string line;
+			while (std::getline(stream, line)) {
+				if (line.empty() || line[0] == '#') continue;
+
+				// Paths may contain spaces, so the three fixed fields are split off and the rest is tab separated
+				std::istringstream fields(line);
+				std::string        id, type, inputHash, paths;
+				fields >> id >> type >> inputHash;
+				std::getline(fields >> std::ws, paths);
+
+				const size_t tab = paths.find('\t');
+				if (tab == std::string::npos) {
+					throw std::runtime_error("Malformed manifest line: " + line);
+				}
+
+				AssetManifestEntry entry;
+				entry.id         = std::stoull(id, nullptr, 16);
+				entry.type       = AssetType::MESH;
+				entry.inputHash  = std::stoull(inputHash, nullptr, 16);
+				entry.sourcePath = std::filesystem::u8path(paths.substr(0, tab));
+				entry.cookedPath = std::filesystem::u8path(paths.substr(tab + 1));
+				for (size_t t = 0; t < std::size(assetTypeNames); ++t) {
+					if (assetTypeNames[t] == type) entry.type = static_cast<AssetType>(t);
+				}
+
+				manifest.add(std::move(entry));
+			}
+
+			return manifest;
+		}
+
+		void save(const std::filesystem::path& root) const {
+			std::ofstream stream(root / fileName, std::ios::trunc);
+			if (!stream) {
+				throw std::runtime_error("Failed to write " + (root / fileName).string());
+			}
+
+			stream << "# id type input-hash source\tcooked\n";
+			for (const AssetManifestEntry& entry : entries_) {
+				stream << toHexString(entry.id) << ' '
+					   << assetTypeNames[static_cast<size_t>(entry.type)] << ' '
+					   << toHexString(entry.inputHash) << ' '
+					   << toLine(entry.sourcePath) << '\t'
+					   << toLine(entry.cookedPath) << '\n';
+			}
+		}
+
+		// Replaces any entry with the same id
+		void add(AssetManifestEntry entry) {
+			auto it = index_.find(entry.id);
+			if (it != index_.end()) {
+				entries_[it->second] = std::move(entry);
+				return;
+			}
+
+			index_.emplace(entry.id, entries_.size());
+			entries_.push_back(std::move(entry));
+		}
+
+		const AssetManifestEntry* find(const AssetId id) const {
+			auto it = index_.find(id);
+			return it != index_.end() ? &entries_[it->second] : nullptr;
+		}
+		const AssetManifestEntry* find(const std::filesystem::path& sourcePath) const {
+			return find(makeAssetId(sourcePath));
+		}
+
+		// Absolute path of a cooked asset, empty when the id is unknown
+		std::filesystem::path resolve(const AssetId id) const {
+			const AssetManifestEntry* entry = find(id);
+			return entry ? root_ / entry->cookedPath : std::filesystem::path();
+		}
+
+		const std::vector<AssetManifestEntry>& getEntries() const {
+			return entries_;
+		}
+		const std::filesystem::path& getRoot() const {
+			return root_;
+		}
+		size_t size() const {
+			return entries_.size();
+		}
+	};
+}
\ No newline at end of file
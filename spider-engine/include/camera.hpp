@@ -64,7 +64,23 @@ namespace spider_engine::rendering {
         }
 
         DirectX::XMMATRIX getViewProjectionMatrix() const {
-            return projectionMatrix_ * viewMatrix_;
+            return viewMatrix_ * projectionMatrix_;
+        }
+
+        uint32_t getWidth() const {
+            return width_;
+        }
+        uint32_t getHeight() const {
+            return height_;
+        }
+        float getFov() const {
+            return fovY_;
+        }
+        float getNearZ() const {
+            return nearZ_;
+        }
+        float getFarZ() const {
+            return farZ_;
         }
     };
 }
\ No newline at end of file
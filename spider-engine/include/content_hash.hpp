@@ -0,0 +1,163 @@
+#pragma once
+#include <bit>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#include <string_view>
+#include <filesystem>
+
+#include "mapped_file.hpp"
+
+namespace spider_engine {
+	// 64-bit content hash (XXH64), stable across platforms and runs so it can be stored on disk
+	class ContentHasher {
+	private:
+		static constexpr uint64_t prime1 = 0x9e3779b185ebca87ull;
+		static constexpr uint64_t prime2 = 0xc2b2ae3d27d4eb4full;
+		static constexpr uint64_t prime3 = 0x165667b19e3779f9ull;
+		static constexpr uint64_t prime4 = 0x85ebca77c2b2ae63ull;
+		static constexpr uint64_t prime5 = 0x27d4eb2f165667c5ull;
+
+		uint64_t lanes_[4];
+		uint8_t  buffer_[32];
+		size_t   buffered_    = 0;
+		uint64_t totalLength_ = 0;
+		uint64_t seed_;
+
+		static uint64_t read64(const uint8_t* bytes) {
+			uint64_t value;
+			std::memcpy(&value, bytes, sizeof(value));
+			return value;
+		}
+		static uint32_t read32(const uint8_t* bytes) {
+			uint32_t value;
+			std::memcpy(&value, bytes, sizeof(value));
+			return value;
+		}
+
+		static uint64_t round(uint64_t lane, const uint64_t input) {
+			lane += input * prime2;
+			lane  = std::rotl(lane, 31);
+			return lane * prime1;
+		}
+		static uint64_t merge(uint64_t hash, const uint64_t lane) {
+			hash ^= round(0, lane);
+			return hash * prime1 + prime4;
+		}
+
+		void consumeStripe(const uint8_t* stripe) {
+			lanes_[0] = round(lanes_[0], read64(stripe));
+			lanes_[1] = round(lanes_[1], read64(stripe + 8));
+			lanes_[2] = round(lanes_[2], read64(stripe + 16));
+			lanes_[3] = round(lanes_[3], read64(stripe + 24));
+		}
+
+	public:
+		ContentHasher(const uint64_t seed = 0) :
+			seed_(seed)
+		{
+			lanes_[0] = seed + prime1 + prime2;
+			lanes_[1] = seed + prime2;
+			lanes_[2] = seed;
+			lanes_[3] = seed - prime1;
+		}
+
+		ContentHasher& update(const void* data, size_t size) {
+			if (size == 0) return *this;
+
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			totalLength_        += size;
+
+			if (buffered_) {
+				const size_t fill = std::min(size, sizeof(buffer_) - buffered_);
+				std::memcpy(buffer_ + buffered_, bytes, fill);
+				buffered_ += fill;
+				bytes     += fill;
+				size      -= fill;
+
+				if (buffered_ < sizeof(buffer_)) return *this;
+
+				consumeStripe(buffer_);
+				buffered_ = 0;
+			}
+
+			for (; size >= sizeof(buffer_); bytes += sizeof(buffer_), size -= sizeof(buffer_)) {
+				consumeStripe(bytes);
+			}
+
+			std::memcpy(buffer_, bytes, size);
+			buffered_ = size;
+
+			return *this;
+		}
+		ContentHasher& update(const std::string_view text) {
+			// Length prefixed, so ("ab", "c") and ("a", "bc") differ
+			const uint64_t length = text.size();
+			update(&length, sizeof(length));
+			return update(text.data(), text.size());
+		}
+		template <typename Ty>
+			requires std::is_trivially_copyable_v<Ty>
+		ContentHasher& update(const Ty& value) {
+			return update(&value, sizeof(Ty));
+		}
+
+		uint64_t finish() const {
+			uint64_t hash;
+			if (totalLength_ >= sizeof(buffer_)) {
+				hash = std::rotl(lanes_[0], 1) + std::rotl(lanes_[1], 7) + std::rotl(lanes_[2], 12) + std::rotl(lanes_[3], 18);
+				for (uint64_t lane : lanes_) hash = merge(hash, lane);
+			}
+			else {
+				hash = seed_ + prime5;
+			}
+			hash += totalLength_;
+
+			const uint8_t* bytes = buffer_;
+			size_t         size  = buffered_;
+			for (; size >= 8; bytes += 8, size -= 8) {
+				hash ^= round(0, read64(bytes));
+				hash  = std::rotl(hash, 27) * prime1 + prime4;
+			}
+			if (size >= 4) {
+				hash ^= uint64_t(read32(bytes)) * prime1;
+				hash  = std::rotl(hash, 23) * prime2 + prime3;
+				bytes += 4;
+				size  -= 4;
+			}
+			for (; size > 0; ++bytes, --size) {
+				hash ^= *bytes * prime5;
+				hash  = std::rotl(hash, 11) * prime1;
+			}
+
+			hash ^= hash >> 33;
+			hash *= prime2;
+			hash ^= hash >> 29;
+			hash *= prime3;
+			hash ^= hash >> 32;
+			return hash;
+		}
+	};
+
+	inline uint64_t hashBytes(const void* data, const size_t size, const uint64_t seed = 0) {
+		return ContentHasher(seed).update(data, size).finish();
+	}
+
+	// Maps the file instead of reading it, large sources are hashed straight from the page cache
+	inline uint64_t hashFile(const std::filesystem::path& path, const uint64_t seed = 0) {
+		MappedFile file(path);
+		return hashBytes(file.data(), file.size(), seed);
+	}
+
+	inline std::string toHexString(const uint64_t hash) {
+		static constexpr char digits[] = "0123456789abcdef";
+
+		std::string text(16, '0');
+		for (int i = 0; i < 16; ++i) {
+			text[15 - i] = digits[(hash >> (i * 4)) & 0xf];
+		}
+		return text;
+	}
+}
\ No newline at end of file
@@ -3,7 +3,15 @@
 
 #include "window.hpp"
 #include "dx12_renderer.hpp"
+#include "asset_loader.hpp"
+#include "texture_streamer.hpp"
 #include "camera.hpp"
+#include "scene_hierarchy.hpp"
+#include "scene_spatial_index.hpp"
+#include "occlusion_culling.hpp"
+#include "lod_selector.hpp"
+#include "frame_profiler.hpp"
+#include "engine_stats.hpp"
 
 #include "flecs.h"
 
@@ -45,21 +53,28 @@ namespace spider_engine::core_engine {
 	private:
 		flecs::world world_;
 
-		std::unique_ptr<Window> window_;
+		std::unique_ptr<InputSystem> input_;  // Outlives the window, whose procedure pushes into it
+		std::unique_ptr<Window>      window_;
 
 		std::unique_ptr<d3dx12::DX12Renderer> renderer_;
 		std::unique_ptr<d3dx12::DX12Compiler> compiler_;
+		std::unique_ptr<d3dx12::AssetLoader>     assetLoader_;     // Destroyed before the renderer
+		std::unique_ptr<d3dx12::TextureStreamer> textureStreamer_; // Destroyed before the renderer
 
 		std::unique_ptr<spider_engine::rendering::Camera> camera_;
 
+		std::unique_ptr<spider_engine::rendering::SceneHierarchy>    sceneHierarchy_;
+		std::unique_ptr<spider_engine::rendering::SceneSpatialIndex> sceneSpatialIndex_;
+		std::unique_ptr<spider_engine::rendering::LodSelector>       lodSelector_;
+
+		EngineStatsRecorder stats_;
+
 	public:
 		template <typename... Types>
 		CoreEngine() {
 			// Register internal components (dx12 types)
 			world_.component<d3dx12::ShaderStage>();
 			world_.component<d3dx12::Vertex>();
-			world_.component<d3dx12::VertexArrayBuffer>();
-			world_.component<d3dx12::IndexArrayBuffer>();
 			world_.component<d3dx12::ConstantBufferVariable>();
 			world_.component<d3dx12::ConstantBufferData>();
 			world_.component<d3dx12::ShaderResourceView>();
@@ -75,10 +90,25 @@ namespace spider_engine::core_engine {
 			world_.component<d3dx12::Renderizable>();
 			world_.component<d3dx12::Shader>();
 			world_.component<d3dx12::RenderPipeline>();
+			world_.component<d3dx12::AssetLoadState>();
+			world_.component<d3dx12::StreamedTexture>();
 
 			// Initialize internal components (rendering)
 			world_.component<rendering::Transform>();
 			world_.component<rendering::FrameData>();
+			world_.component<rendering::LocalTransform>();
+			world_.component<rendering::WorldTransform>();
+			world_.component<rendering::OccluderMesh>();
+			world_.component<rendering::LodState>();
+
+			// Initialize scene hierarchy (tracks ChildOf relationships)
+			sceneHierarchy_ = std::make_unique<spider_engine::rendering::SceneHierarchy>(&world_);
+
+			// Initialize scene spatial index (tracks Renderizable bounds)
+			sceneSpatialIndex_ = std::make_unique<spider_engine::rendering::SceneSpatialIndex>(&world_);
+
+			// Initialize level of detail selection (writes LodState)
+			lodSelector_ = std::make_unique<spider_engine::rendering::LodSelector>(&world_);
 
 			// Register user components
 			(world_.component<Types>(), ...);
@@ -94,6 +124,9 @@ namespace spider_engine::core_engine {
 				description.y,
 				description.windowClassName
 			);
+			input_ = std::make_unique<InputSystem>();
+			window_->setInput(input_.get());
+
 			renderer_ = std::make_unique<d3dx12::DX12Renderer>(
 				&world_,
 				window_->hwnd_,
@@ -105,6 +138,9 @@ namespace spider_engine::core_engine {
 			);
 			compiler_ = std::make_unique<d3dx12::DX12Compiler>(&world_, *renderer_);
 
+			assetLoader_     = std::make_unique<d3dx12::AssetLoader>(&world_, *renderer_, description.threadCount);
+			textureStreamer_ = std::make_unique<d3dx12::TextureStreamer>(&world_, *renderer_);
+
 			camera_ = std::make_unique<spider_engine::rendering::Camera>(window_->width_, window_->height_);
 		}
 
@@ -208,13 +244,28 @@ namespace spider_engine::core_engine {
 		}
 
 		void start(std::function<void()> fn) {
+			SPIDER_PROFILE_THREAD("Main");
+
 			MSG msg = {};
 			while (msg.message != WM_QUIT && window_->isRunning_) {
+				SPIDER_PROFILE_FRAME();
+				SPIDER_PROFILE_SCOPE("Frame");
+
 				while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
 					TranslateMessage(&msg);
 					DispatchMessage(&msg);
 				}
+				if (input_) input_->update();
+
+				// Scene systems see what the previous frame changed, their results are ready before this one is recorded
+				sceneHierarchy_->update();
+				if (camera_)          lodSelector_->update(*camera_);
+				if (assetLoader_)     assetLoader_->update();
+				if (textureStreamer_) textureStreamer_->update(*camera_);
+
 				fn();
+
+				if (renderer_) stats_.endFrame(renderer_->getCpuWaitNanoseconds(), renderer_->getUploadedBytes());
 			}
 		}
 
@@ -240,15 +291,65 @@ namespace spider_engine::core_engine {
 			return world_;
 		}
 
+		InputSystem& getInput() {
+			return *input_;
+		}
+
 		d3dx12::DX12Renderer& getRenderer() {
 			return *renderer_;
 		}
 		d3dx12::DX12Compiler& getCompiler() {
 			return *compiler_;
 		}
+		d3dx12::AssetLoader& getAssetLoader() {
+			return *assetLoader_;
+		}
+		d3dx12::TextureStreamer& getTextureStreamer() {
+			return *textureStreamer_;
+		}
 
 		spider_engine::rendering::Camera& getCamera() {
 			return *camera_;
 		}
+
+		spider_engine::rendering::SceneHierarchy& getSceneHierarchy() {
+			return *sceneHierarchy_;
+		}
+		spider_engine::rendering::SceneSpatialIndex& getSceneSpatialIndex() {
+			return *sceneSpatialIndex_;
+		}
+		spider_engine::rendering::LodSelector& getLodSelector() {
+			return *lodSelector_;
+		}
+
+		// Gathered on the call, the frame loop only records frame times and counter totals
+		EngineStats getStats() {
+			EngineStats stats;
+			stats_.fill(stats);
+
+			if (renderer_) {
+				stats.gpuMilliseconds = renderer_->getGpuProfiler().getLastFrameMilliseconds();
+				stats.render          = renderer_->getRenderCounters();
+				stats.descriptorHeaps = renderer_->getDescriptorHeapUsage();
+				stats.geometryPages   = renderer_->getGeometryStats().pageCount;
+
+				const d3dx12::GpuMemoryStats memory = renderer_->getGpuMemoryStats();
+				for (const d3dx12::GpuMemoryCategoryStats& category : memory.categories) {
+					stats.heaps              += category.heapCount;
+					stats.placedResources    += category.placedCount;
+					stats.committedResources += category.committedCount;
+				}
+			}
+
+			stats.entities = static_cast<size_t>(ecs_get_entities(world_.c_ptr()).alive_count);
+			stats.tables   = static_cast<size_t>(ecs_get_world_info(world_.c_ptr())->table_count);
+			return stats;
+		}
+		bool saveStats(const std::filesystem::path& path) {
+			return getStats().saveJson(path);
+		}
+		void resetStats() {
+			stats_.reset();
+		}
 	};
 }
\ No newline at end of file
@@ -1,9 +1,12 @@
 #pragma once
 #include <iostream>
 #include <print>
-#include <exception>
+#include <format>
+#include <stdexcept>
 #include <Windows.h>
 
+#include "logger.hpp"
+
 namespace spider_engine {
 	enum class DebugLevel {
 		Info,
@@ -14,8 +17,8 @@ namespace spider_engine {
 
 	class DebugConsole {
 	private:
-		static HANDLE handle_;
-		static size_t instanceCount_;
+		inline static HANDLE handle_        = nullptr;
+		inline static size_t instanceCount_ = 0;
 
 		DebugConsole() {
 			++instanceCount_;
@@ -38,8 +41,25 @@ namespace spider_engine {
 			FreeConsole();
 		}
 
-		static void setColor(uint16_t color) {
-			SetConsoleTextAttribute(handle_, color);
+		static LogLevel toLogLevel(const DebugLevel dbgLevel) {
+			switch (dbgLevel) {
+				case DebugLevel::Warning: return LogLevel::Warning;
+				case DebugLevel::Error:   return LogLevel::Error;
+				case DebugLevel::Fatal:   return LogLevel::Fatal;
+				default:                  return LogLevel::Info;
+			}
+		}
+
+		// The message is a runtime format string, so arguments are formatted here. Fatal messages are
+		// written before this returns, like SPIDER_LOG_FATAL, and what happens next is up to the caller.
+		template <typename... Args>
+		static void write(const std::string& message, const DebugLevel dbgLevel, Args&... args) {
+			if constexpr (sizeof...(Args) > 0) {
+				Logger::get().write(toLogLevel(dbgLevel), std::vformat(message, std::make_format_args(args...)));
+			}
+			else {
+				Logger::get().write(toLogLevel(dbgLevel), message);
+			}
 		}
 
 	public:
@@ -47,53 +67,17 @@ namespace spider_engine {
 			return handle_;
 		}
 
+		// Kept for old code only. The SPIDER_LOG macros check the format at compile time and leave the
+		// formatting to the logger thread, these format on the caller.
 		template <typename... Args>
+		[[deprecated("Use the SPIDER_LOG macros")]]
 		static void print(const std::string& message, DebugLevel dbgLevel = DebugLevel::Info, Args... args) {
-			switch (dbgLevel)
-			{
-			case spider_engine::DebugLevel::Info:
-				DebugConsole::setColor(FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE);
-				break;
-			case spider_engine::DebugLevel::Warning:
-				DebugConsole::setColor(FOREGROUND_RED | FOREGROUND_GREEN);
-				break;
-			case spider_engine::DebugLevel::Error:
-				DebugConsole::setColor(FOREGROUND_RED);
-				break;
-			case spider_engine::DebugLevel::Fatal:
-				DebugConsole::setColor(FOREGROUND_RED | FOREGROUND_INTENSITY);
-				std::cout << std::format("{}", std::format("{}", message).c_str(), args...);
-				throw std::runtime_error("Fatal error: " + message);
-				break;
-			default:
-				break;
-			}
-			std::cout << std::format("{}", std::format("{}", message).c_str(), args...);
+			write(message, dbgLevel, args...);
 		}
 		template <typename... Args>
+		[[deprecated("Use the SPIDER_LOG macros")]]
 		static void println(const std::string& message, DebugLevel dbgLevel = DebugLevel::Info, Args... args) {
-			switch (dbgLevel)
-			{
-			case spider_engine::DebugLevel::Info:
-				DebugConsole::setColor(FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE);
-				break;
-			case spider_engine::DebugLevel::Warning:
-				DebugConsole::setColor(FOREGROUND_RED | FOREGROUND_GREEN);
-				break;
-			case spider_engine::DebugLevel::Error:
-				DebugConsole::setColor(FOREGROUND_RED);
-				break;
-			case spider_engine::DebugLevel::Fatal:
-				DebugConsole::setColor(FOREGROUND_RED | FOREGROUND_INTENSITY);
-				std::cout << std::format("{}\n", std::format("{}", message).c_str(), args...);
-				throw std::runtime_error("Fatal error: " + message);
-				break;
-			default:
-				break;
-			}
-			std::cout << std::format("{}\n", std::format("{}", message).c_str(), args...);
+			write(message, dbgLevel, args...);
 		}
 	};
-	HANDLE DebugConsole::handle_        = nullptr;
-	size_t DebugConsole::instanceCount_ = 0;
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <format>
+#include <string>
 
 #include "debug.hpp"
 
@@ -18,29 +19,38 @@
     HRESULT hr = (expr);                                                     \
     if (hr == DXGI_ERROR_DEVICE_REMOVED) {                                   \
         _com_error err(device_->GetDeviceRemovedReason());                   \
-        std::wcout << L"[DX12 ERROR] Device Removed: "                       \
-                   << err.ErrorMessage() << std::endl;                       \
+        SPIDER_LOG_ERROR("[DX12 ERROR] Device Removed: {}",                  \
+                         ::spider_engine::toLogText(err.ErrorMessage()));    \
+        ::spider_engine::Logger::get().flush();                              \
         throw std::runtime_error("DX12 Device was removed.");                \
     }                                                                        \
     else if (FAILED(hr)) {                                                   \
         _com_error err(hr);                                                  \
-        std::wcout << L"[DX12 ERROR] " << err.ErrorMessage() << std::endl;   \
+        SPIDER_LOG_ERROR("[DX12 ERROR] {} (0x{:08X})",                       \
+                         ::spider_engine::toLogText(err.ErrorMessage()),     \
+                         static_cast<uint32_t>(hr));                         \
+        ::spider_engine::Logger::get().flush();                              \
         throw std::runtime_error("DX12 Error.");                             \
     }                                                                        \
 }
 #define SPIDER_CODE_SWAP(dbg, rel) dbg
 #endif
 
-#define SPIDER_RAW_BITCAST(Target, origin) (*reinterpret_cast<Target*>(reinterpret_cast<void*>(&origin)))
-
-using uint_t = unsigned int;
+namespace spider_engine {
+	// Log arguments are narrow text, Windows messages are wide in unicode builds
+	inline std::string toLogText(const char* text) {
+		return text ? text : "";
+	}
+	inline std::string toLogText(const wchar_t* text) {
+		const int size = text ? WideCharToMultiByte(CP_UTF8, 0, text, -1, nullptr, 0, nullptr, nullptr) : 0;
+		if (size <= 1) return {};
 
-bool isButtonDown(int vkey) {
-    bool prev[256] = {};
+		std::string result(size - 1, '\0');
+		WideCharToMultiByte(CP_UTF8, 0, text, -1, result.data(), size, nullptr, nullptr);
+		return result;
+	}
+}
 
-    bool down = (GetAsyncKeyState(vkey) & 0x8000) != 0;
-    bool pressed = down && !prev[vkey];
+#define SPIDER_RAW_BITCAST(Target, origin) (*reinterpret_cast<Target*>(reinterpret_cast<void*>(&origin)))
 
-    prev[vkey] = down;
-    return pressed;
-}
\ No newline at end of file
+using uint_t = unsigned int;
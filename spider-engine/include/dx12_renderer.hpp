@@ -15,6 +15,9 @@
 #include <comdef.h>
 #include <unordered_map>
 #include <filesystem>
+#include <chrono>
+#include <atomic>
+#include <cstring>
 
 // DirectX Helper includes
 #include "d3dx12.h"
@@ -24,8 +27,6 @@
 
 // Asimp
 #include "assimp/Importer.hpp"
-#include "assimp/scene.h"
-#include "assimp/postprocess.h"
 
 // Framework includes
 #include "definitions.hpp"
@@ -38,6 +39,22 @@
 
 // Other includes
 #include "camera.hpp"
+#include "scene_hierarchy.hpp"
+#include "frustum_culling.hpp"
+#include "occlusion_culling.hpp"
+#include "lod_selector.hpp"
+#include "mesh_importer.hpp"
+#include "mip_generator.hpp"
+#include "texture_compression.hpp"
+#include "texture_atlas_builder.hpp"
+#include "asset_cache.hpp"
+#include "content_hash.hpp"
+#include "gpu_memory_allocator.hpp"
+#include "resource_state_registry.hpp"
+#include "render_graph_executor.hpp"
+#include "frame_profiler.hpp"
+#include "gpu_profiler.hpp"
+#include "engine_stats.hpp"
 
 // Link DirectX libraries
 #pragma comment(lib, "d3d12.lib")
@@ -75,6 +92,38 @@ namespace spider_engine::d3dx12 {
 
 		std::unique_ptr<HeapAllocator> heapAllocator_;
 
+		std::shared_ptr<GpuMemoryAllocator> memoryAllocator_; // Shared, placed resources return their blocks to it
+
+		// Declared again every frame, draws are recorded by the scene pass when the frame ends
+		struct SceneDraw {
+			flecs::entity      entity;
+			RenderPipeline*    pipeline;
+			rendering::Camera* camera;
+			DirectX::XMMATRIX  world; // Filled when the scene is culled
+			uint32_t           frustum;
+		};
+
+		std::shared_ptr<ResourceStateRegistry> resourceStates_;
+		std::unique_ptr<RenderGraphExecutor>   renderGraph_;
+		std::unique_ptr<GpuProfiler>           gpuProfiler_;
+		rendering::RenderResourceId            backBufferResource_;
+		rendering::RenderResourceId            depthBufferResource_;
+		std::vector<SceneDraw>                 sceneDraws_;
+		std::vector<uint32_t>                  visibleDraws_; // Indices into sceneDraws_, in submission order
+		std::vector<rendering::Frustum>        sceneFrusta_;  // One per camera of the frame
+
+		std::shared_ptr<GeometryBuffer> geometryBuffer_; // Shared, meshes return their ranges to it
+		const D3D12_VERTEX_BUFFER_VIEW* boundVertexView_ = nullptr;
+		const D3D12_INDEX_BUFFER_VIEW*  boundIndexView_  = nullptr;
+
+		// Pipeline state of the scene pass, draws sharing a pipeline skip rebinding it
+		ID3D12RootSignature* boundRootSignature_      = nullptr;
+		ID3D12PipelineState* boundPipelineState_      = nullptr;
+		bool                 areDescriptorHeapsBound_ = false;
+
+		RenderCounters        renderCounters_;
+		std::atomic<uint64_t> uploadedBytes_ = 0; // Texture uploads, meshes load from worker threads
+
 		DescriptorHeap* rtvDescriptorHeap_;
 		DescriptorHeap* dsvDescriptorHeap_;
 		DescriptorHeap* cbvSrvUavDescriptorHeap_;
@@ -89,6 +138,20 @@ namespace spider_engine::d3dx12 {
 
 		Assimp::Importer importer;
 
+		rendering::FrustumCuller              sceneCuller_;
+		rendering::CullingStats               sceneCullingStats_;
+		std::vector<uint32_t>                 culledDraws_;  // Draw of every box in the scene culler
+		std::vector<rendering::BoundingVolume> culledBounds_; // World bounds of every box in the scene culler
+		rendering::OcclusionCuller            sceneOcclusion_;
+		rendering::OcclusionStats             sceneOcclusionStats_;
+		rendering::SubmeshCuller submeshCuller_;
+
+		rendering::TextureMemoryStats textureMemory_;
+
+		// Keyed by path and load settings, then by file content
+		AssetCache<Mesh>      meshCache_   { [](const Mesh& mesh) { return mesh.memory.getTotalBytes(); } };
+		AssetCache<Texture2D> textureCache_{ [](const Texture2D& texture) { return texture.sizeInBytes; } };
+
 		void createCommandAllocatorQueueAndList() {
 			// Create command queue
 			D3D12_COMMAND_QUEUE_DESC queueDesc = {};
@@ -195,6 +258,7 @@ namespace spider_engine::d3dx12 {
 
 				SPIDER_DX12_ERROR_CHECK(swapChain_->GetBuffer(i, IID_PPV_ARGS(&backBuffers_[i])));
 				device_->CreateRenderTargetView(backBuffers_[i].Get(), nullptr, rtvDescriptorHeap_->cpuHandle);
+				resourceStates_->track(backBuffers_[i].Get(), D3D12_RESOURCE_STATE_PRESENT);
 
 				SPIDER_DBG_CODE(
 					backBuffers_[i]->SetName(
@@ -260,6 +324,7 @@ namespace spider_engine::d3dx12 {
 				dsvDesc.Flags						  = D3D12_DSV_FLAG_NONE;
 
 				device_->CreateDepthStencilView(depthBuffers_[i].Get(), &dsvDesc, dsvDescriptorHeap_->cpuHandle);
+				resourceStates_->track(depthBuffers_[i].Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE);
 
 				SPIDER_DBG_CODE(
 					depthBuffers_[i]->SetName(
@@ -272,170 +337,268 @@ namespace spider_engine::d3dx12 {
 			heapAllocator_->writeOnDescriptorHeap(dsvDescriptorHeap_, bufferCount_, dsvFn);
 		}
 
-		VertexArrayBuffer createVertexBuffer(const std::vector<Vertex>& vertices) {
-			// Create Vertex Array Buffer (struct)
-			VertexArrayBuffer vertexArrayBuffer = {};
+		// Packed texture arrays are seen whole, the slice comes from the material
+		static D3D12_SHADER_RESOURCE_VIEW_DESC getTexture2DViewDescription(const Texture2D& texture) {
+			D3D12_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDescription = {};
+			shaderResourceViewDescription.Format                          = texture.format;
+			shaderResourceViewDescription.Shader4ComponentMapping         = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+
+			if (texture.arraySize > 1) {
+				shaderResourceViewDescription.ViewDimension                  = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+				shaderResourceViewDescription.Texture2DArray.MostDetailedMip = 0;
+				shaderResourceViewDescription.Texture2DArray.MipLevels       = texture.mipLevels;
+				shaderResourceViewDescription.Texture2DArray.FirstArraySlice = 0;
+				shaderResourceViewDescription.Texture2DArray.ArraySize       = texture.arraySize;
+			}
+			else {
+				shaderResourceViewDescription.ViewDimension             = D3D12_SRV_DIMENSION_TEXTURE2D;
+				shaderResourceViewDescription.Texture2D.MostDetailedMip = 0;
+				shaderResourceViewDescription.Texture2D.MipLevels       = texture.mipLevels;
+			}
 
-			// Calculate buffer size
-			const size_t bufferSize = sizeof(Vertex) * vertices.size();
-			vertexArrayBuffer.size  = vertices.size();
+			return shaderResourceViewDescription;
+		}
 
-			// Create Vertex Array Buffer (resource)
-			CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_UPLOAD);
-			CD3DX12_RESOURCE_DESC   resDesc = CD3DX12_RESOURCE_DESC::Buffer(bufferSize);
-			SPIDER_DX12_ERROR_CHECK(
-				device_->CreateCommittedResource(
-					&heapProps,
-					D3D12_HEAP_FLAG_NONE,
-					&resDesc,
-					D3D12_RESOURCE_STATE_GENERIC_READ,
-					nullptr,
-					IID_PPV_ARGS(&vertexArrayBuffer.vertexArrayBuffer)
-				)
-			);
+		// One queued draw, the scene pass has the render target and viewport set already
+		void recordDraw(ID3D12GraphicsCommandList* cmd, const SceneDraw& draw) {
+			flecs::entity      entity   = draw.entity;
+			RenderPipeline&    pipeline = *draw.pipeline;
+			rendering::Camera& camera   = *draw.camera;
 
-			// Copy vertex data to the vertex array buffer
-			uint8_t*      vertexDataBegin;
-			CD3DX12_RANGE readRange(0, 0);
-			vertexArrayBuffer.vertexArrayBuffer->Map(0, &readRange, reinterpret_cast<void**>(&vertexDataBegin));
-			memcpy(vertexDataBegin, vertices.data(), bufferSize);
-			vertexArrayBuffer.vertexArrayBuffer->Unmap(0, nullptr);
+			// Get renderizable component
+			const Renderizable* renderizable = entity.get<Renderizable>();
+			if (!renderizable) return;
 
-			// Initialize the vertex buffer view
-			vertexArrayBuffer.vertexArrayBufferView.BufferLocation = vertexArrayBuffer.vertexArrayBuffer->GetGPUVirtualAddress();
-			vertexArrayBuffer.vertexArrayBufferView.StrideInBytes  = sizeof(Vertex);
-			vertexArrayBuffer.vertexArrayBufferView.SizeInBytes    = bufferSize;
+			// Nothing to draw for empty meshes
+			if (!renderizable->mesh) return;
 
-			SPIDER_DBG_CODE(vertexArrayBuffer.vertexArrayBuffer->SetName(L"VertexArrayBuffer"));
+			// Get mesh
+			const Mesh& mesh = *renderizable->mesh;
 
-			return vertexArrayBuffer;
-		}
-		VertexArrayBuffer createVertexBuffer(const Vertex* verticesBegin,
-			const Vertex* verticesEnd)
-		{
-			const size_t verticesSize = static_cast<size_t>(verticesEnd - verticesBegin);
+			if (!mesh.vertices.isValid() || !mesh.indices.isValid()) return;
+
+			// Create and bind frame data
+			rendering::FrameData frameData;
+			frameData.view       = camera.getViewMatrix();
+			frameData.projection = camera.getProjectionMatrix();
+			frameData.model      = draw.world;
 
-			// Create Vertex Array Buffer (struct)
-			VertexArrayBuffer vertexArrayBuffer = {};
+			// Bind frame data to pipeline
+			pipeline.bindBuffer<>("frameData", ShaderStage::STAGE_VERTEX, frameData);
 
-			// Calculate buffer size
-			const size_t bufferSize = sizeof(Vertex) * verticesSize;
-			vertexArrayBuffer.size  = verticesSize;
+			// Packed and full vertices have different layouts, a pipeline only draws its own
+			if (mesh.vertexFormat != pipeline.vertexFormat_) {
+				SPIDER_LOG_ERROR("Skipped a draw whose mesh vertex format does not match its pipeline.");
+				return;
+			}
 
-			// Create Vertex Array Buffer (resource)
-			CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_UPLOAD);
-			CD3DX12_RESOURCE_DESC resDesc = CD3DX12_RESOURCE_DESC::Buffer(bufferSize);
-			SPIDER_DX12_ERROR_CHECK(
-				device_->CreateCommittedResource(
-					&heapProps,
-					D3D12_HEAP_FLAG_NONE,
-					&resDesc,
-					D3D12_RESOURCE_STATE_GENERIC_READ,
-					nullptr,
-					IID_PPV_ARGS(&vertexArrayBuffer.vertexArrayBuffer)
-				)
-			);
+			// Packed positions are normalized to the mesh box, their shaders decode them with packedVertexDecodeHlsl
+			if (mesh.vertexFormat == rendering::VertexFormat::PACKED) {
+				pipeline.bindBuffer<>("quantization", ShaderStage::STAGE_VERTEX, mesh.quantization.toShaderData());
+			}
+
+			// Descriptor heaps, once per pass
+			if (!areDescriptorHeapsBound_) {
+				ID3D12DescriptorHeap* descriptorHeaps[] = {
+					cbvSrvUavDescriptorHeap_->heap.Get(),
+					samplerDescriptorHeap_->heap.Get()
+				};
+				cmd->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+				areDescriptorHeapsBound_ = true;
+				++renderCounters_.descriptorHeapBinds;
+			}
+
+			// Set pipeline state, a new root signature drops the root arguments so the tables go with it
+			if (pipeline.rootSignature_.Get() != boundRootSignature_) {
+				cmd->SetGraphicsRootSignature(pipeline.rootSignature_.Get());
+				cmd->SetGraphicsRootDescriptorTable(0, cbvSrvUavDescriptorHeap_->heap->GetGPUDescriptorHandleForHeapStart());
+				cmd->SetGraphicsRootDescriptorTable(1, samplerDescriptorHeap_->heap->GetGPUDescriptorHandleForHeapStart());
+				boundRootSignature_ = pipeline.rootSignature_.Get();
+				++renderCounters_.rootSignatureSwitches;
+			}
+			if (pipeline.pipelineState_.Get() != boundPipelineState_) {
+				cmd->SetPipelineState(pipeline.pipelineState_.Get());
+				boundPipelineState_ = pipeline.pipelineState_.Get();
+				++renderCounters_.pipelineSwitches;
+			}
+
+			// Buffers, meshes sharing a geometry page keep the previous binding
+			cmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-			// Copy vertex data to the vertex array buffer
-			UINT8*		  vertexDataBegin;
-			CD3DX12_RANGE readRange(0, 0);
-			vertexArrayBuffer.vertexArrayBuffer->Map(0, &readRange, reinterpret_cast<void**>(&vertexDataBegin));
-			memcpy(vertexDataBegin, verticesBegin, bufferSize);
-			vertexArrayBuffer.vertexArrayBuffer->Unmap(0, nullptr);
+			const D3D12_VERTEX_BUFFER_VIEW* vertexView = &geometryBuffer_->getVertexView(mesh.vertices);
+			const D3D12_INDEX_BUFFER_VIEW*  indexView  = &geometryBuffer_->getIndexView(mesh.indices);
+			if (vertexView != boundVertexView_) {
+				cmd->IASetVertexBuffers(0, 1, vertexView);
+				boundVertexView_ = vertexView;
+			}
+			if (indexView != boundIndexView_) {
+				cmd->IASetIndexBuffer(indexView);
+				boundIndexView_ = indexView;
+			}
 
-			// Initialize the vertex buffer view
-			vertexArrayBuffer.vertexArrayBufferView.BufferLocation = vertexArrayBuffer.vertexArrayBuffer->GetGPUVirtualAddress();
-			vertexArrayBuffer.vertexArrayBufferView.StrideInBytes = sizeof(Vertex);
-			vertexArrayBuffer.vertexArrayBufferView.SizeInBytes = bufferSize;
+			const UINT startIndex = mesh.indices.getOffset();
+			const INT  baseVertex = static_cast<INT>(mesh.vertices.getOffset());
 
-			SPIDER_DBG_CODE(vertexArrayBuffer.vertexArrayBuffer->SetName(L"VertexArrayBuffer"));
+			const rendering::LodState* lodState = entity.get<rendering::LodState>();
+			const uint32_t             level    = lodState ? lodState->level : 0;
+
+			// Submeshes are culled on their own and drawn grouped by material
+			if (!mesh.submeshes.empty()) {
+				for (const rendering::SubmeshDraw& submeshDraw : submeshCuller_.cull(mesh.submeshes, level, sceneFrusta_[draw.frustum], draw.world)) {
+					cmd->DrawIndexedInstanced(submeshDraw.indexCount, 1, startIndex + submeshDraw.indexOffset, baseVertex + submeshDraw.baseVertex, 0);
+					++renderCounters_.drawCalls;
+				}
+			}
+			// Otherwise the level picked by the LOD selector, or the whole buffer
+			else {
+				UINT indexCount  = mesh.indices.getCount();
+				UINT indexOffset = 0;
+				if (!mesh.lods.empty()) {
+					const rendering::MeshLod& lod = mesh.lods[std::min<size_t>(level, mesh.lods.size() - 1)];
 
-			return vertexArrayBuffer;
+					indexCount  = lod.indexCount;
+					indexOffset = lod.indexOffset;
+				}
+				cmd->DrawIndexedInstanced(indexCount, 1, startIndex + indexOffset, baseVertex, 0);
+				++renderCounters_.drawCalls;
+			}
 		}
 
-		IndexArrayBuffer createIndexArrayBuffer(const std::vector<uint32_t>& indices) {
-			// Create Index Array Buffer (struct)
-			IndexArrayBuffer indexArrayBuffer = {};
+		// World bounds of every queued draw go through the frustum culler, one pass per camera. Survivors with
+		// an OccluderMesh are then rasterized into the occlusion buffer and the rest are tested against it.
+		// What is left is the frame's visibility list, the scene pass records nothing else.
+		void cullScene() {
+			SPIDER_PROFILE_SCOPE("DX12Renderer::cullScene");
+
+			visibleDraws_.clear();
+			sceneFrusta_.clear();
+			sceneCullingStats_   = {};
+			sceneOcclusionStats_ = {};
+
+			std::vector<rendering::Camera*> cameras;
+			for (SceneDraw& draw : sceneDraws_) {
+				auto camera = std::find(cameras.begin(), cameras.end(), draw.camera);
+				if (camera == cameras.end()) {
+					cameras.push_back(draw.camera);
+					sceneFrusta_.push_back(rendering::Frustum::fromViewProjection(draw.camera->getViewProjectionMatrix()));
+					camera = cameras.end() - 1;
+				}
+				draw.frustum = static_cast<uint32_t>(camera - cameras.begin());
 
-			// Calculate buffer size
-			const size_t bufferSize = sizeof(uint32_t) * indices.size();
-			indexArrayBuffer.size   = indices.size();
+				// Model matrix (entities in the scene hierarchy already have it computed)
+				if (const rendering::WorldTransform* worldTransform = draw.entity.get<rendering::WorldTransform>()) {
+					draw.world = worldTransform->matrix;
+				}
+				else if (const Renderizable* renderizable = draw.entity.get<Renderizable>()) {
+					draw.world = renderizable->transform.toMatrix();
+				}
+			}
 
-			// Create Index Array Buffer (resource)
-			CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_UPLOAD);
-			CD3DX12_RESOURCE_DESC   resDesc = CD3DX12_RESOURCE_DESC::Buffer(bufferSize);
-			SPIDER_DX12_ERROR_CHECK(
-				device_->CreateCommittedResource(
-					&heapProps,
-					D3D12_HEAP_FLAG_NONE,
-					&resDesc,
-					D3D12_RESOURCE_STATE_GENERIC_READ,
-					nullptr,
-					IID_PPV_ARGS(&indexArrayBuffer.indexArrayBuffer)
-				)
-			);
+			for (uint32_t frustum = 0; frustum < sceneFrusta_.size(); ++frustum) {
+				sceneCuller_.clear();
+				culledDraws_.clear();
+				culledBounds_.clear();
 
-			// Copy index data to the index array buffer
-			UINT8*		  indexDataBegin;
-			CD3DX12_RANGE readRange(0, 0);
-			indexArrayBuffer.indexArrayBuffer->Map(0, &readRange, reinterpret_cast<void**>(&indexDataBegin));
-			memcpy(indexDataBegin, indices.data(), bufferSize);
-			indexArrayBuffer.indexArrayBuffer->Unmap(0, nullptr);
+				for (uint32_t d = 0; d < sceneDraws_.size(); ++d) {
+					const SceneDraw& draw = sceneDraws_[d];
+					if (draw.frustum != frustum) continue;
 
-			// Initialize the index buffer view
-			indexArrayBuffer.indexArrayBufferView.BufferLocation = indexArrayBuffer.indexArrayBuffer->GetGPUVirtualAddress();
-			indexArrayBuffer.indexArrayBufferView.Format		 = DXGI_FORMAT_R32_UINT;
-			indexArrayBuffer.indexArrayBufferView.SizeInBytes	 = bufferSize;
+					const Renderizable* renderizable = draw.entity.get<Renderizable>();
+					if (!renderizable || !renderizable->mesh) continue;
 
-			SPIDER_DBG_CODE(indexArrayBuffer.indexArrayBuffer->SetName(L"IndexArrayBuffer"));
+					culledBounds_.push_back(renderizable->mesh->bounds.transformed(draw.world));
+					sceneCuller_.add(culledBounds_.back());
+					culledDraws_.push_back(d);
+				}
 
-			return indexArrayBuffer;
-		}
-		IndexArrayBuffer createIndexArrayBuffer(const uint32_t* indicesBegin,
-												const uint32_t* indicesEnd)
-		{
-			const size_t indicesSize = static_cast<size_t>(indicesEnd - indicesBegin);
+				const std::vector<uint32_t>& inFrustum = sceneCuller_.cull(sceneFrusta_[frustum]);
 
-			// Create Index Array Buffer (struct)
-			IndexArrayBuffer indexArrayBuffer = {};
+				const rendering::CullingStats& stats = sceneCuller_.getStats();
+				sceneCullingStats_.tested           += stats.tested;
+				sceneCullingStats_.visible          += stats.visible;
+				sceneCullingStats_.cullMilliseconds += stats.cullMilliseconds;
 
-			// Calculate buffer size
-			const size_t bufferSize = sizeof(uint32_t) * indicesSize;
-			indexArrayBuffer.size   = indicesSize;
+				// Occluders are only rasterized when they survived the frustum, off screen they hide nothing
+				bool hasOccluders = false;
+				for (const uint32_t visible : inFrustum) {
+					const SceneDraw&               draw     = sceneDraws_[culledDraws_[visible]];
+					const rendering::OccluderMesh* occluder = draw.entity.get<rendering::OccluderMesh>();
+					if (!occluder) continue;
 
-			// Create Index Array Buffer (resource)
-			CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_UPLOAD);
-			CD3DX12_RESOURCE_DESC   resDesc = CD3DX12_RESOURCE_DESC::Buffer(bufferSize);
-			SPIDER_DX12_ERROR_CHECK(
-				device_->CreateCommittedResource(
-					&heapProps,
-					D3D12_HEAP_FLAG_NONE,
-					&resDesc,
-					D3D12_RESOURCE_STATE_GENERIC_READ,
-					nullptr,
-					IID_PPV_ARGS(&indexArrayBuffer.indexArrayBuffer)
-				)
+					if (!hasOccluders) {
+						sceneOcclusion_.beginFrame(cameras[frustum]->getViewProjectionMatrix());
+						hasOccluders = true;
+					}
+					sceneOcclusion_.renderOccluder(*occluder, draw.world);
+				}
+
+				for (const uint32_t visible : inFrustum) {
+					const SceneDraw& draw = sceneDraws_[culledDraws_[visible]];
+
+					// Occluders are always drawn, their own bounds would be tested against themselves
+					if (hasOccluders && !draw.entity.has<rendering::OccluderMesh>() && !sceneOcclusion_.isVisible(culledBounds_[visible])) continue;
+					visibleDraws_.push_back(culledDraws_[visible]);
+				}
+
+				if (hasOccluders) {
+					const rendering::OcclusionStats& occlusion = sceneOcclusion_.getStats();
+					sceneOcclusionStats_.occluderCount       += occlusion.occluderCount;
+					sceneOcclusionStats_.occluderTriangles   += occlusion.occluderTriangles;
+					sceneOcclusionStats_.rasterizedTriangles += occlusion.rasterizedTriangles;
+					sceneOcclusionStats_.tested              += occlusion.tested;
+					sceneOcclusionStats_.culled              += occlusion.culled;
+					sceneOcclusionStats_.rasterMilliseconds  += occlusion.rasterMilliseconds;
+					sceneOcclusionStats_.testMilliseconds    += occlusion.testMilliseconds;
+				}
+			}
+
+			// Cameras were culled one after the other, draws keep the order they were queued in
+			if (sceneFrusta_.size() > 1) std::sort(visibleDraws_.begin(), visibleDraws_.end());
+		}
+
+		// Clears the back buffer and depth buffer once, then records every draw left after culling
+		void recordScene(ID3D12GraphicsCommandList* cmd) {
+			// Get the cpu descriptor handle for the current back buffer
+			CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(
+				rtvDescriptorHeap_->heap->GetCPUDescriptorHandleForHeapStart(),
+				frameIndex_,
+				rtvDescriptorHeap_->descriptorHandleIncrementSize
+			);
+			CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(
+				dsvDescriptorHeap_->heap->GetCPUDescriptorHandleForHeapStart(),
+				frameIndex_,
+				dsvDescriptorHeap_->descriptorHandleIncrementSize
 			);
 
-			// Copy index data to the index array buffer
-			UINT8*		  indexDataBegin;
-			CD3DX12_RANGE readRange(0, 0);
-			indexArrayBuffer.indexArrayBuffer->Map(0, &readRange, reinterpret_cast<void**>(&indexDataBegin));
-			memcpy(indexDataBegin, indicesBegin, bufferSize);
-			indexArrayBuffer.indexArrayBuffer->Unmap(0, nullptr);
+			// Set render target and clear
+			cmd->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
+			float clearColor[] = { 0.0, 0.0, 1.0, 1.0 };
+			cmd->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
+			cmd->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
-			// Initialize the index buffer view
-			indexArrayBuffer.indexArrayBufferView.BufferLocation = indexArrayBuffer.indexArrayBuffer->GetGPUVirtualAddress();
-			indexArrayBuffer.indexArrayBufferView.Format		 = DXGI_FORMAT_R32_UINT;
-			indexArrayBuffer.indexArrayBufferView.SizeInBytes    = bufferSize;
+			// Viewport and Scissor
+			D3D12_RESOURCE_DESC backDesc = backBuffers_[frameIndex_]->GetDesc();
+			float width				     = static_cast<float>(backDesc.Width);
+			float height				 = static_cast<float>(backDesc.Height);
+			CD3DX12_VIEWPORT viewport(0.0f, 0.0f, width, height);
+			CD3DX12_RECT scissorRect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height));
+			cmd->RSSetViewports(1, &viewport);
+			cmd->RSSetScissorRects(1, &scissorRect);
 
-			SPIDER_DBG_CODE(indexArrayBuffer.indexArrayBuffer->SetName(L"IndexArrayBuffer"));
+			// Passes before this one may have bound anything
+			boundRootSignature_      = nullptr;
+			boundPipelineState_      = nullptr;
+			areDescriptorHeapsBound_ = false;
+			boundVertexView_         = nullptr;
+			boundIndexView_          = nullptr;
 
-			return indexArrayBuffer;
+			for (const uint32_t draw : visibleDraws_) recordDraw(cmd, sceneDraws_[draw]);
 		}
 
 	public:
 		friend class DX12Compiler;
+		friend class AssetLoader;
+		friend class TextureStreamer;
 
 		DX12Renderer(flecs::world*  world,
 					 HWND           hwnd,
@@ -484,7 +647,11 @@ namespace spider_engine::d3dx12 {
 				infoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_WARNING, FALSE);
 			}
 
-			heapAllocator_ = std::make_unique<HeapAllocator>(device_);
+			heapAllocator_   = std::make_unique<HeapAllocator>(device_);
+			memoryAllocator_ = std::make_shared<GpuMemoryAllocator>(device_.Get(), adapter.Get(), bufferCount_);
+			resourceStates_  = std::make_shared<ResourceStateRegistry>(device_.Get());
+			renderGraph_     = std::make_unique<RenderGraphExecutor>(device_.Get(), resourceStates_, bufferCount_);
+			geometryBuffer_  = std::make_shared<GeometryBuffer>(device_.Get(), bufferCount_);
 			cbvSrvUavDescriptorHeap_ = heapAllocator_->createDescriptorHeap(
 				"CbvUavDescriptorHeap", 
 				D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 
@@ -499,6 +666,10 @@ namespace spider_engine::d3dx12 {
 			// Create Command Allocator, Command Queue and Command List
 			this->createCommandAllocatorQueueAndList();
 
+			// Timestamps around the frame and every render graph pass
+			gpuProfiler_ = std::make_unique<GpuProfiler>(device_.Get(), commandQueue_.Get(), bufferCount_);
+			renderGraph_->setProfiler(gpuProfiler_.get());
+
 			// Create Swap Chain, Render Target Views and Depth Stencil Views
 			this->createSwapChain();
 			this->createRenderTargetViewsAndDepthStencilViews();
@@ -524,10 +695,23 @@ namespace spider_engine::d3dx12 {
 			depthBuffers_(other.depthBuffers_),
 			synchronizationObject_(std::move(other.synchronizationObject_)),
 			nonRenderingRelatedSynchronizationObject_(std::move(other.nonRenderingRelatedSynchronizationObject_)),
+			memoryAllocator_(std::move(other.memoryAllocator_)),
+			resourceStates_(std::move(other.resourceStates_)),
+			renderGraph_(std::move(other.renderGraph_)),
+			gpuProfiler_(std::move(other.gpuProfiler_)),
+			backBufferResource_(other.backBufferResource_),
+			depthBufferResource_(other.depthBufferResource_),
+			sceneDraws_(std::move(other.sceneDraws_)),
+			geometryBuffer_(std::move(other.geometryBuffer_)),
+			renderCounters_(other.renderCounters_),
+			uploadedBytes_(other.uploadedBytes_.load()),
 			frameIndex_(other.frameIndex_),
 			isFullScreen_(other.isFullScreen_),
 			isVSync_(other.isVSync_),
-			bufferCount_(other.bufferCount_)
+			bufferCount_(other.bufferCount_),
+			textureMemory_(other.textureMemory_),
+			meshCache_(std::move(other.meshCache_)),
+			textureCache_(std::move(other.textureCache_))
 		{}
 
 		~DX12Renderer() {
@@ -547,6 +731,8 @@ namespace spider_engine::d3dx12 {
 								  const uint32_t      width,
 								  const uint32_t      height) 
 		{
+			SPIDER_PROFILE_SCOPE("DX12Renderer::createTexture2D");
+
 			// Get command allocator and list
 			ID3D12CommandAllocator*    commandAllocator = nonRenderingRelatedCommandAllocators_[0].Get();
 			ID3D12GraphicsCommandList* commandList      = nonRenderingRelatedCommandLists_[0].Get();
@@ -567,8 +753,9 @@ namespace spider_engine::d3dx12 {
 
 			// Create Texture2D (struct)
 			Texture2D texture;
-			texture.width  = width;
-			texture.height = height;
+			texture.width       = width;
+			texture.height      = height;
+			texture.sizeInBytes = size_t(width) * height * 4;
 
 			// Create texture description
 			D3D12_RESOURCE_DESC textureDesc = {};
@@ -585,33 +772,12 @@ namespace spider_engine::d3dx12 {
 			textureDesc.Flags			    = D3D12_RESOURCE_FLAG_NONE;
 
 			// Create Texture2D (gpu resource)
-			D3D12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-			SPIDER_DX12_ERROR_CHECK(
-				device_->CreateCommittedResource(
-					&heapProps,
-					D3D12_HEAP_FLAG_NONE,
-					&textureDesc,
-					D3D12_RESOURCE_STATE_COPY_DEST,
-					nullptr,
-					IID_PPV_ARGS(&texture.resource)
-				)
-			);
+			texture.resource = memoryAllocator_->createResource(GpuMemoryCategory::TEXTURE, textureDesc, D3D12_RESOURCE_STATE_COPY_DEST);
+			resourceStates_->track(texture.resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
 
 			// Create Texture2D (upload resource)
 			const UINT64 uploadBufferSize = GetRequiredIntermediateSize(texture.resource.Get(), 0, 1);
-
-			heapProps                            = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-			D3D12_RESOURCE_DESC uploadBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
-			SPIDER_DX12_ERROR_CHECK(
-				device_->CreateCommittedResource(
-					&heapProps,
-					D3D12_HEAP_FLAG_NONE,
-					&uploadBufferDesc,
-					D3D12_RESOURCE_STATE_GENERIC_READ,
-					nullptr,
-					IID_PPV_ARGS(&texture.uploadResource)
-				)
-			);
+			texture.uploadResource        = memoryAllocator_->createBuffer(GpuMemoryCategory::UPLOAD, uploadBufferSize, D3D12_RESOURCE_STATE_GENERIC_READ);
 
 			// Prepare data
 			texture.textureData.pData      = data;
@@ -619,7 +785,7 @@ namespace spider_engine::d3dx12 {
 			texture.textureData.SlicePitch = texture.textureData.RowPitch * height;
 
 			// Copy data to GPU
-			UpdateSubresources(
+			uploadedBytes_ += UpdateSubresources(
 				commandList,
 				texture.resource.Get(),
 				texture.uploadResource.Get(),
@@ -630,19 +796,12 @@ namespace spider_engine::d3dx12 {
 			);
 
 			// After copy, transition to shader-read state
-			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-				texture.resource.Get(),
-				D3D12_RESOURCE_STATE_COPY_DEST,
-				D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE
-			);
-			nonRenderingRelatedCommandLists_[0]->ResourceBarrier(1, &barrier);
-
-			// Close Graphics Command List
-			SPIDER_DX12_ERROR_CHECK(nonRenderingRelatedCommandLists_[0]->Close());
+			ResourceStateTracker& states = resourceStates_->getTracker(commandList);
+			states.assume(texture.resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+			states.transition(texture.resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
-			// Execute Graphics Command List
-			ID3D12CommandList* ppCommandLists[] = { commandList };
-			commandQueue_->ExecuteCommandLists(1, ppCommandLists);
+			// Close and execute Graphics Command List
+			resourceStates_->submit(commandQueue_.Get(), commandList);
 
 			SPIDER_DBG_CODE(
 				texture.resource->SetName(L"Texture2D");
@@ -652,6 +811,8 @@ namespace spider_engine::d3dx12 {
 			return texture;
 		}
 		Texture2D createTexture2D(const std::wstring& path) {
+			SPIDER_PROFILE_SCOPE("DX12Renderer::createTexture2D");
+
 			// Get command allocator and list
 			ID3D12CommandAllocator*    commandAllocator = nonRenderingRelatedCommandAllocators_[0].Get();
 			ID3D12GraphicsCommandList* commandList      = nonRenderingRelatedCommandLists_[0].Get();
@@ -674,23 +835,71 @@ namespace spider_engine::d3dx12 {
 			));
 
 			// Load image from file
-			DirectX::ScratchImage image;
-			HRESULT hr = DirectX::LoadFromWICFile(path.c_str(), DirectX::WIC_FLAGS_NONE, nullptr, image);
-			if (FAILED(hr)) {
-				throw std::runtime_error("Failed to load image");
-			}
+			DirectX::ScratchImage image = loadImage(path);
+
+			// Record the upload
+			Texture2D texture = createTexture2D(image, commandList);
+
+			// Close and execute Graphics Command List
+			resourceStates_->submit(commandQueue_.Get(), commandList);
+
+			return texture;
+		}
+
+		// Decoding only touches the CPU, so it can run on any thread (WIC needs COM initialized there).
+		// The image comes back with its whole mip chain, as RGBA8 unless it was a compressed DDS.
+		static DirectX::ScratchImage loadImage(const std::wstring&            path,
+											   const rendering::MipSettings&  mips  = {},
+											   rendering::MipGenerationStats* stats = nullptr)
+		{
+			DirectX::ScratchImage image = rendering::loadTextureSource(path);
 
 			const DirectX::Image* img = image.GetImage(0, 0, 0);
 			if (!img || !img->pixels) {
 				throw std::runtime_error("Failed to get image data");
 			}
 
-			const uint8_t* data = img->pixels;
+			// Cooked DDS files carry their mips, usually block compressed, and go to the GPU as they are
+			const DirectX::TexMetadata& metadata = image.GetMetadata();
+			if (DirectX::IsCompressed(metadata.format) || metadata.mipLevels > 1) return image;
+
+			// WIC keeps the file's own layout (BGRA, 16-bit, grayscale...), the filters work on RGBA8
+			if (img->format != DXGI_FORMAT_R8G8B8A8_UNORM) {
+				DirectX::ScratchImage converted;
+				HRESULT hr = DirectX::Convert(*img, DXGI_FORMAT_R8G8B8A8_UNORM, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, converted);
+				if (FAILED(hr)) {
+					throw std::runtime_error("Failed to convert image to RGBA8");
+				}
+				image = std::move(converted);
+			}
+
+			return generateMips(image, mips, stats);
+		}
+
+		// Builds the mip chain of the first image on the CPU, see MipGenerator
+		static DirectX::ScratchImage generateMips(const DirectX::ScratchImage&  image,
+												  const rendering::MipSettings&  settings = {},
+												  rendering::MipGenerationStats* stats    = nullptr)
+		{
+			return rendering::generateMipImage(*image.GetImage(0, 0, 0), settings, stats);
+		}
+
+		// Records the copy of a decoded image into an open command list, the caller executes it.
+		// Every mip level goes through one upload resource, which has to live until the copy is done on the GPU.
+		Texture2D createTexture2D(const DirectX::ScratchImage& image, ID3D12GraphicsCommandList* commandList) {
+			SPIDER_PROFILE_SCOPE("DX12Renderer::recordTexture2D");
+
+			const DirectX::TexMetadata& metadata = image.GetMetadata();
+			const DirectX::Image*       img      = image.GetImage(0, 0, 0);
 
 			// Create Texture2D (struct)
 			Texture2D texture;
-			texture.width  = img->width;
-			texture.height = img->height;
+			texture.width       = img->width;
+			texture.height      = img->height;
+			texture.mipLevels   = static_cast<uint32_t>(metadata.mipLevels);
+			texture.arraySize   = static_cast<uint32_t>(metadata.arraySize);
+			texture.format      = metadata.format;
+			texture.sizeInBytes = image.GetPixelsSize();
 
 			// Create texture description
 			D3D12_RESOURCE_DESC textureDesc = {};
@@ -698,85 +907,61 @@ namespace spider_engine::d3dx12 {
 			textureDesc.Alignment		    = 0;
 			textureDesc.Width			    = img->width;
 			textureDesc.Height			    = img->height;
-			textureDesc.DepthOrArraySize	= 1;
-			textureDesc.MipLevels		    = 1;
-			textureDesc.Format			    = DXGI_FORMAT_R8G8B8A8_UNORM;
+			textureDesc.DepthOrArraySize	= static_cast<UINT16>(texture.arraySize);
+			textureDesc.MipLevels		    = static_cast<UINT16>(texture.mipLevels);
+			textureDesc.Format			    = texture.format;
 			textureDesc.SampleDesc.Count    = 1;
 			textureDesc.SampleDesc.Quality  = 0;
 			textureDesc.Layout			    = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 			textureDesc.Flags			    = D3D12_RESOURCE_FLAG_NONE;
 
-			// Create Texture2D (gpu resource)
-			D3D12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
-			SPIDER_DX12_ERROR_CHECK(
-				device_->CreateCommittedResource(
-					&heapProps,
-					D3D12_HEAP_FLAG_NONE,
-					&textureDesc,
-					D3D12_RESOURCE_STATE_COPY_DEST,
-					nullptr,
-					IID_PPV_ARGS(&texture.resource)
-				)
-			);
-
-			const UINT64 uploadBufferSize = GetRequiredIntermediateSize(texture.resource.Get(), 0, 1);
-
-			// Create Texture2D (upload resource)
-			heapProps                            = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-			D3D12_RESOURCE_DESC uploadBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uploadBufferSize);
-			SPIDER_DX12_ERROR_CHECK(
-				device_->CreateCommittedResource(
-					&heapProps,
-					D3D12_HEAP_FLAG_NONE,
-					&uploadBufferDesc,
-					D3D12_RESOURCE_STATE_GENERIC_READ,
-					nullptr,
-					IID_PPV_ARGS(&texture.uploadResource)
-				)
-			);
+			// Create Texture2D (gpu resource), placed in a shared heap
+			texture.resource = memoryAllocator_->createResource(GpuMemoryCategory::TEXTURE, textureDesc, D3D12_RESOURCE_STATE_COPY_DEST);
+			resourceStates_->track(texture.resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+
+			const uint32_t subresourceCount = texture.mipLevels * texture.arraySize;
+			const UINT64   uploadBufferSize = GetRequiredIntermediateSize(texture.resource.Get(), 0, subresourceCount);
+
+			// Create Texture2D (upload resource), its block is reused once the copy is done
+			texture.uploadResource = memoryAllocator_->createBuffer(GpuMemoryCategory::UPLOAD, uploadBufferSize, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+			// Prepare data, one subresource per mip level of every slice, slice major like D3D12 numbers them
+			std::vector<D3D12_SUBRESOURCE_DATA> subresources(subresourceCount);
+			for (uint32_t slice = 0; slice < texture.arraySize; ++slice) {
+				for (uint32_t level = 0; level < texture.mipLevels; ++level) {
+					const DirectX::Image*   mip         = image.GetImage(level, slice, 0);
+					D3D12_SUBRESOURCE_DATA& subresource = subresources[slice * texture.mipLevels + level];
+					subresource.pData      = mip->pixels;
+					subresource.RowPitch   = mip->rowPitch;
+					subresource.SlicePitch = mip->slicePitch;
+				}
+			}
+			texture.textureData = subresources[0];
 
-			// Prepare data
-			size_t rowPitch	  = 0;
-			size_t slicePitch = 0;
-			DirectX::ComputePitch(
-				DXGI_FORMAT_R8G8B8A8_UNORM,
-				img->width,
-				img->height,
-				rowPitch,
-				slicePitch
-			);
-			texture.textureData.pData      = data;
-			texture.textureData.RowPitch   = rowPitch;
-			texture.textureData.SlicePitch = slicePitch;
+			++textureMemory_.textureCount;
+			textureMemory_.bytes             += texture.sizeInBytes;
+			textureMemory_.uncompressedBytes += rendering::getUncompressedSize(metadata);
 
-			// Copy data to GPU
-			if (UpdateSubresources(
+			// Copy every level to GPU in one batch
+			const UINT64 uploaded = UpdateSubresources(
 				commandList,
 				texture.resource.Get(),
 				texture.uploadResource.Get(),
 				0,
 				0,
-				1,
-				&texture.textureData
-			) == 0) 
-			{
+				subresourceCount,
+				subresources.data()
+			);
+			if (uploaded == 0) {
 				throw std::runtime_error("UpdateSubresources returned 0!");
 			}
+			uploadedBytes_ += uploaded;
 
-			// After copy, transition to shader-read state
-			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-				texture.resource.Get(),
-				D3D12_RESOURCE_STATE_COPY_DEST,
-				D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE
-			);
-			nonRenderingRelatedCommandLists_[0]->ResourceBarrier(1, &barrier);
-
-			// Close Graphics Command List
-			SPIDER_DX12_ERROR_CHECK(nonRenderingRelatedCommandLists_[0]->Close());
-
-			// Execute Graphics Command List
-			ID3D12CommandList* ppCommandLists[] = { commandList };
-			commandQueue_->ExecuteCommandLists(1, ppCommandLists);
+			// After copy, transition to shader-read state. The barrier waits in the list's batch, so the
+			// textures of one upload batch all transition in one call when the list is submitted.
+			ResourceStateTracker& states = resourceStates_->getTracker(commandList);
+			states.assume(texture.resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+			states.transition(texture.resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
 			SPIDER_DBG_CODE(
 				texture.resource->SetName(L"Texture2D");
@@ -786,6 +971,27 @@ namespace spider_engine::d3dx12 {
 			return texture;
 		}
 
+		// Records the upload of every page of packed textures, one resource and view per page instead of per texture.
+		// Standalone pages upload their texture as it is. Materials find their page, slice and uv transform in
+		// packed.plan.placements.
+		std::vector<Texture2D> createPackedTextures(const rendering::PackedTextures&                 packed,
+													const std::vector<const DirectX::ScratchImage*>& textures,
+													ID3D12GraphicsCommandList*                       commandList)
+		{
+			std::vector<Texture2D> pages;
+			pages.reserve(packed.plan.pages.size());
+
+			for (size_t p = 0; p < packed.plan.pages.size(); ++p) {
+				const rendering::TexturePage& page = packed.plan.pages[p];
+				pages.push_back(createTexture2D(
+					page.type == rendering::TexturePageType::STANDALONE ? *textures[page.textures.front()] : packed.pages[p],
+					commandList
+				));
+			}
+
+			return pages;
+		}
+
 		ConstantBuffer createConstantBuffer(const std::string& name, 
 											const size_t	   size,
 											const ShaderStage  stage) 
@@ -794,17 +1000,7 @@ namespace spider_engine::d3dx12 {
 			size_t alignedSize = (size + 255) & ~255;
 
 			// Create constant buffer (resource)
-			D3D12_HEAP_PROPERTIES heapProps  = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-			D3D12_RESOURCE_DESC   bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(alignedSize);
-			Microsoft::WRL::ComPtr<ID3D12Resource> resource;
-			SPIDER_DX12_ERROR_CHECK(device_->CreateCommittedResource(
-				&heapProps,
-				D3D12_HEAP_FLAG_NONE,
-				&bufferDesc,
-				D3D12_RESOURCE_STATE_GENERIC_READ,
-				nullptr,
-				IID_PPV_ARGS(&resource)
-			));
+			Microsoft::WRL::ComPtr<ID3D12Resource> resource = memoryAllocator_->createBuffer(GpuMemoryCategory::UPLOAD, alignedSize, D3D12_RESOURCE_STATE_GENERIC_READ);
 
 			ConstantBuffer constantBuffer;
 			auto fn = [&name, &size, &alignedSize, &resource, &stage, &constantBuffer, this](DescriptorHeap* descriptorHeap) {
@@ -852,17 +1048,7 @@ namespace spider_engine::d3dx12 {
 			}
 
 			// Create constant buffer (resource)
-			D3D12_HEAP_PROPERTIES heapProps  = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-			D3D12_RESOURCE_DESC   bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(totalSizeInBytes);
-			Microsoft::WRL::ComPtr<ID3D12Resource> resource;
-			SPIDER_DX12_ERROR_CHECK(device_->CreateCommittedResource(
-				&heapProps,
-				D3D12_HEAP_FLAG_NONE,
-				&bufferDesc,
-				D3D12_RESOURCE_STATE_GENERIC_READ,
-				nullptr,
-				IID_PPV_ARGS(&resource)
-			));
+			Microsoft::WRL::ComPtr<ID3D12Resource> resource = memoryAllocator_->createBuffer(GpuMemoryCategory::UPLOAD, totalSizeInBytes, D3D12_RESOURCE_STATE_GENERIC_READ);
 
 			// Create constant buffers
 			std::vector<ConstantBuffer> constantBuffers;
@@ -925,15 +1111,7 @@ namespace spider_engine::d3dx12 {
 			resourceDesc.Flags			     = D3D12_RESOURCE_FLAG_NONE;
 
 			// Create resource
-			D3D12_HEAP_PROPERTIES heapProps = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-			device_->CreateCommittedResource(
-				&heapProps,
-				D3D12_HEAP_FLAG_NONE,
-				&resourceDesc,
-				D3D12_RESOURCE_STATE_GENERIC_READ,
-				nullptr,
-				IID_PPV_ARGS(&shaderResourceView.resource_)
-			);
+			shaderResourceView.resource_ = memoryAllocator_->createResource(GpuMemoryCategory::UPLOAD, resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ);
 			
 			auto fn = [&shaderResourceView, name, data, stage, this](DescriptorHeap* descriptorHeap) {
 				// Fill out Shader Resource View struct
@@ -974,7 +1152,7 @@ namespace spider_engine::d3dx12 {
 		{
 			ShaderResourceView shaderResourceView;
 
-			const size_t dataSize = (data.width * data.height) * 4;
+			const size_t dataSize = data.sizeInBytes;
 			
 			auto fn = [&shaderResourceView, &name, dataSize, stage, &data, this](DescriptorHeap* descriptorHeap) {
 				// Create Shader Resource View struct
@@ -991,12 +1169,7 @@ namespace spider_engine::d3dx12 {
 				UINT8*        dataBegin = nullptr;
 				CD3DX12_RANGE readRange(0, 0);
 
-				D3D12_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDescription = {};
-				shaderResourceViewDescription.Format						  = DXGI_FORMAT_R8G8B8A8_UNORM;
-				shaderResourceViewDescription.ViewDimension				      = D3D12_SRV_DIMENSION_TEXTURE2D;
-				shaderResourceViewDescription.Shader4ComponentMapping		  = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-				shaderResourceViewDescription.Texture2D.MostDetailedMip	      = 0;
-				shaderResourceViewDescription.Texture2D.MipLevels			  = 1;
+				D3D12_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDescription = getTexture2DViewDescription(data);
 
 				// Create Shader Resource View
 				device_->CreateShaderResourceView(data.resource.Get(), &shaderResourceViewDescription, shaderResourceView.cpuHandle_);
@@ -1038,18 +1211,9 @@ namespace spider_engine::d3dx12 {
 			resourceDesc.SampleDesc.Quality	 = 0;
 			resourceDesc.Layout				 = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
 			resourceDesc.Flags			     = D3D12_RESOURCE_FLAG_NONE;
-			D3D12_HEAP_PROPERTIES heapProps  = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
 
 			// Create resource
-			ComPtr<ID3D12Resource> resource;
-			device_->CreateCommittedResource(
-				&heapProps,
-				D3D12_HEAP_FLAG_NONE,
-				&resourceDesc,
-				D3D12_RESOURCE_STATE_GENERIC_READ,
-				nullptr,
-				IID_PPV_ARGS(&resource)
-			);
+			ComPtr<ID3D12Resource> resource = memoryAllocator_->createResource(GpuMemoryCategory::UPLOAD, resourceDesc, D3D12_RESOURCE_STATE_GENERIC_READ);
 
 			// Allocate Shader Resource Views
 			shaderResourceViews.reserve(count);
@@ -1114,8 +1278,8 @@ namespace spider_engine::d3dx12 {
 			size_t			  totalDataSize = 0;
 			std::vector<size_t> sizes(count);
 			for (UINT i = 0; i < count; ++i) {
-				totalDataSize += (data[i].width * data[i].height) * 4;
-				sizes.push_back(static_cast<size_t>(data[i].width * data[i].height) * 4);
+				totalDataSize += data[i].sizeInBytes;
+				sizes.push_back(data[i].sizeInBytes);
 			}
 
 			// Allocate Shader Resource Views
@@ -1136,12 +1300,7 @@ namespace spider_engine::d3dx12 {
 				shaderResourceView.index_			   = i;
 
 				// Create Shader Resource View Description
-				D3D12_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDescription = {};
-				shaderResourceViewDescription.Format						  = DXGI_FORMAT_R8G8B8A8_UNORM;
-				shaderResourceViewDescription.ViewDimension				      = D3D12_SRV_DIMENSION_TEXTURE2D;
-				shaderResourceViewDescription.Shader4ComponentMapping		  = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-				shaderResourceViewDescription.Texture2D.MostDetailedMip	      = 0;
-				shaderResourceViewDescription.Texture2D.MipLevels			  = 1;
+				D3D12_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDescription = getTexture2DViewDescription(data[i]);
 
 				// Create Shader Resource View
 				device_->CreateShaderResourceView(
@@ -1237,95 +1396,175 @@ namespace spider_engine::d3dx12 {
 
 		Mesh createMesh(const std::vector<Vertex>&   vertices,
 						const std::vector<uint32_t>& indices)
+		{
+			std::vector<rendering::MeshLod> lods = { { 0, static_cast<uint32_t>(indices.size()), 0.0f } };
+
+			return createMesh(vertices, indices, std::move(lods));
+		}
+
+		// Every level indexes the same vertex buffer through its own index range.
+		// With submeshes, indices are local to each submesh and drawn with its base vertex.
+		Mesh createMesh(const std::vector<Vertex>&      vertices,
+						const std::vector<uint32_t>&    indices,
+						std::vector<rendering::MeshLod> lods,
+						const rendering::VertexFormat   format    = rendering::VertexFormat::FULL,
+						rendering::SubmeshTable         submeshes = {})
 		{
 			// Create mesh (struct)
 			Mesh mesh;
+			mesh.vertexFormat = format;
 			
-			// Populate mesh buffers
-			mesh.vertexArrayBuffer = std::make_unique<VertexArrayBuffer>(createVertexBuffer(vertices));
-			mesh.indexArrayBuffer  = std::make_unique<IndexArrayBuffer>(createIndexArrayBuffer(indices));
+			// Sub-allocate the mesh out of the shared geometry buffers
+			if (format == rendering::VertexFormat::PACKED) {
+				std::vector<rendering::PackedVertex> packed = rendering::packVertices(vertices, mesh.quantization);
+				mesh.vertices           = geometryBuffer_->allocateVertices(packed.data(), packed.size(), sizeof(rendering::PackedVertex));
+				mesh.memory.vertexBytes = packed.size() * sizeof(rendering::PackedVertex);
+			}
+			else {
+				mesh.vertices           = geometryBuffer_->allocateVertices(vertices.data(), vertices.size(), sizeof(Vertex));
+				mesh.memory.vertexBytes = vertices.size() * sizeof(Vertex);
+			}
+
+			// Packed meshes also drop to 16-bit indices when every vertex (of the largest submesh) fits
+			const size_t indexRange = submeshes.empty() ? vertices.size() : submeshes.getMaxVertexCount();
+			if (format == rendering::VertexFormat::PACKED && rendering::canUse16BitIndices(indexRange)) {
+				std::vector<uint16_t> packed = rendering::packIndices(indices);
+				mesh.indices           = geometryBuffer_->allocateIndices(packed.data(), packed.size());
+				mesh.memory.indexBytes = packed.size() * sizeof(uint16_t);
+			}
+			else {
+				mesh.indices           = geometryBuffer_->allocateIndices(indices.data(), indices.size());
+				mesh.memory.indexBytes = indices.size() * sizeof(uint32_t);
+			}
+
+			// Compute object space bounds for culling
+			mesh.bounds    = computeBoundingVolume(vertices.data(), vertices.data() + vertices.size());
+			mesh.lods      = std::move(lods);
+			mesh.submeshes = std::move(submeshes);
 
 			return mesh;
 		}
 
-		Renderizable createRenderizable(const std::wstring& path) {
-			std::string utf8Path(path.begin(), path.end());
+		// Uploads a baked mesh straight from the mapping, only the small CPU side tables are copied
+		Mesh createMesh(const rendering::SpmeshFile& file) {
+			const rendering::SpmeshHeader& header = file.getHeader();
 
-			const aiScene* scene = importer.ReadFile(
-				utf8Path,
-				aiProcess_Triangulate |
-				aiProcess_JoinIdenticalVertices |
-				aiProcess_CalcTangentSpace |
-				aiProcess_GenSmoothNormals |
-				aiProcess_FlipUVs |
-				aiProcess_MakeLeftHanded |
-				aiProcess_FlipWindingOrder
-			);
+			Mesh mesh;
+			mesh.vertexFormat = file.getVertexFormat();
+			mesh.quantization = file.getQuantization();
+			mesh.bounds       = file.getBounds();
 
-			if (!scene || !scene->mRootNode || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE)) {
-				throw std::runtime_error(std::string("Assimp error: ") + importer.GetErrorString());
+			mesh.vertices = geometryBuffer_->allocateVertices(file.getVertexData(), header.vertexCount, header.vertexStride);
+			if (header.indexSize == sizeof(uint16_t)) {
+				mesh.indices = geometryBuffer_->allocateIndices(static_cast<const uint16_t*>(file.getIndexData()), header.indexCount);
+			}
+			else {
+				mesh.indices = geometryBuffer_->allocateIndices(static_cast<const uint32_t*>(file.getIndexData()), header.indexCount);
 			}
+			mesh.memory.vertexBytes = header.vertices.size;
+			mesh.memory.indexBytes  = header.indices.size;
 
-			std::vector<Vertex>  vertices;
-			std::vector<uint32_t> indices;
+			mesh.lods.assign(file.getLods().begin(), file.getLods().end());
+			mesh.meshlets.meshlets.assign(file.getMeshlets().begin(), file.getMeshlets().end());
+			mesh.meshlets.bounds.assign(file.getMeshletBounds().begin(), file.getMeshletBounds().end());
+			mesh.meshlets.vertices.assign(file.getMeshletVertices().begin(), file.getMeshletVertices().end());
+			mesh.meshlets.triangles.assign(file.getMeshletTriangles().begin(), file.getMeshletTriangles().end());
+			mesh.submeshes.submeshes.assign(file.getSubmeshes().begin(), file.getSubmeshes().end());
+			mesh.submeshes.lods.assign(file.getSubmeshLods().begin(), file.getSubmeshLods().end());
 
-			size_t vertexOffset = 0;
+			return mesh;
+		}
 
-			// Loop through every mesh
-			for (uint32_t m = 0; m < scene->mNumMeshes; ++m) {
-				aiMesh* mesh = scene->mMeshes[m];
+		// Baked .spmesh files skip the import entirely, the format is the one they were baked with.
+		// Only creates upload heap buffers through the device, so it is safe to call from worker
+		// threads as long as each one brings its own importer.
+		Mesh loadMesh(const std::filesystem::path&  path,
+					  Assimp::Importer&             importer,
+					  std::filesystem::path&        diffuseTexture,
+					  const uint32_t                lodCount = 4,
+					  const rendering::VertexFormat format   = rendering::VertexFormat::FULL)
+		{
+			SPIDER_PROFILE_SCOPE("DX12Renderer::loadMesh");
 
-				for (uint32_t i = 0; i < mesh->mNumVertices; ++i) {
-					Vertex v {};
-					v.position = { mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z };
+			auto start = std::chrono::steady_clock::now();
 
-					if (mesh->HasNormals())
-						v.normal = { mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z };
-					else
-						v.normal = { 0.f, 1.f, 0.f };
+			Mesh mesh;
 
-					if (mesh->mTextureCoords[0])
-						v.uv = { mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y };
-					else
-						v.uv = { 0.f, 0.f };
+			if (path.extension() == L".spmesh") {
+				rendering::SpmeshFile file(path);
 
-					if (mesh->HasTangentsAndBitangents())
-						v.tangent = { mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z };
-					else
-						v.tangent = { 0.f, 0.f, 0.f };
+				mesh           = createMesh(file);
+				diffuseTexture = file.getDiffuseTexture();
 
-					vertices.push_back(v);
-				}
+				mesh.load.source    = rendering::MeshSource::BAKED;
+				mesh.load.fileBytes = file.getSize();
+			}
+			else {
+				rendering::MeshImportSettings settings;
+				settings.lodCount = lodCount;
 
-				for (uint32_t i = 0; i < mesh->mNumFaces; ++i) {
-					const aiFace& face = mesh->mFaces[i];
-					for (uint32_t j = 0; j < face.mNumIndices; ++j)
-						indices.push_back(face.mIndices[j] + static_cast<uint32_t>(vertexOffset));
-				}
+				rendering::ImportedMesh imported = rendering::importMesh(importer, path, settings);
+
+				mesh           = createMesh(imported.vertices, imported.indices, std::move(imported.lods), format, std::move(imported.submeshes));
+				diffuseTexture = imported.diffuseTexture;
 
-				vertexOffset += mesh->mNumVertices;
+				mesh.optimizationStats = imported.optimizationStats;
+				mesh.meshlets          = std::move(imported.meshlets);
+				mesh.load.source       = rendering::MeshSource::IMPORTED;
+				mesh.load.fileBytes    = std::filesystem::file_size(path);
 			}
 
-			// Try to load first diffuse texture
-			Texture2D texture {};
-			for (uint32_t m = 0; m < scene->mNumMeshes; ++m) {
-				aiMesh* mesh = scene->mMeshes[m];
-				if (mesh->mMaterialIndex < 0)
-					continue;
+			mesh.diffuseTexture = diffuseTexture;
+
+			auto finish = std::chrono::steady_clock::now();
+			mesh.load.loadMilliseconds = std::chrono::duration<double, std::milli>(finish - start).count();
+
+			return mesh;
+		}
+
+		// Keys of the mesh and texture caches, the asset loader fills the same entries
+		static uint64_t getMeshSettings(const uint32_t lodCount, const rendering::VertexFormat format) {
+			return (uint64_t(lodCount) << 8) | static_cast<uint8_t>(format);
+		}
+		static std::string getMeshCacheKey(const std::filesystem::path& path, const uint32_t lodCount, const rendering::VertexFormat format) {
+			return std::filesystem::weakly_canonical(path).string() + '|' + std::to_string(getMeshSettings(lodCount, format));
+		}
+		static std::string getTextureCacheKey(const std::filesystem::path& path) {
+			return std::filesystem::weakly_canonical(path).string();
+		}
 
-				aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-				aiString texPath;
-				if (material->GetTexture(aiTextureType_DIFFUSE, 0, &texPath) == AI_SUCCESS) {
-					std::filesystem::path folder = std::filesystem::path(utf8Path).parent_path();
-					std::filesystem::path texFullPath = folder / texPath.C_Str();
-					texture = createTexture2D(texFullPath.wstring());
-					break;
+		// Cached, the same file with the same settings is imported once however many models use it.
+		// Files with the same bytes share one mesh, and with it the diffuse texture the first one referenced.
+		MeshHandle acquireMesh(const std::filesystem::path&  path,
+							   const uint32_t                lodCount = 4,
+							   const rendering::VertexFormat format   = rendering::VertexFormat::FULL)
+		{
+			return meshCache_.acquire(
+				getMeshCacheKey(path, lodCount, format),
+				[&]() { return hashFile(path, getMeshSettings(lodCount, format)); },
+				[&]() {
+					std::filesystem::path diffuseTexture;
+					return loadMesh(path, importer, diffuseTexture, lodCount, format);
 				}
-			}
+			);
+		}
 
+		// Cached, decoded and uploaded once per file content
+		TextureHandle acquireTexture2D(const std::filesystem::path& path) {
+			return textureCache_.acquire(
+				getTextureCacheKey(path),
+				[&path]() { return hashFile(path); },
+				[&]() { return createTexture2D(path.wstring()); }
+			);
+		}
+
+		Renderizable createRenderizable(const std::wstring&           path,
+										const uint32_t                lodCount = 4,
+										const rendering::VertexFormat format   = rendering::VertexFormat::FULL)
+		{
 			Renderizable renderizable;
-			renderizable.mesh    = std::move(createMesh(vertices, indices));
-			renderizable.texture = std::move(texture);
+			renderizable.mesh = acquireMesh(path, lodCount, format);
+			if (!renderizable.mesh->diffuseTexture.empty()) renderizable.texture = acquireTexture2D(renderizable.mesh->diffuseTexture);
 
 			return renderizable;
 		}
@@ -1334,7 +1573,7 @@ namespace spider_engine::d3dx12 {
 										const std::vector<uint32_t>& indices)
 		{
 			Renderizable renderizable;
-			renderizable.mesh = this->createMesh(vertices, indices);
+			renderizable.mesh = std::make_shared<Mesh>(this->createMesh(vertices, indices));
 
 			return renderizable;
 		}
@@ -1342,17 +1581,38 @@ namespace spider_engine::d3dx12 {
 		Renderizable createRenderizable(Mesh&& mesh)
 		{
 			Renderizable renderizable;
-			renderizable.mesh = std::move(mesh);
+			renderizable.mesh = std::make_shared<Mesh>(std::move(mesh));
 
 			return renderizable;
 		}
 
 		void beginFrame() {
+			SPIDER_PROFILE_SCOPE("DX12Renderer::beginFrame");
+
 			// Get current back buffer index
 			frameIndex_ = swapChain_->GetCurrentBackBufferIndex();
 
 			// Wait until the last frame is finished
-			synchronizationObject_->wait(frameIndex_);
+			{
+				SPIDER_PROFILE_SCOPE("DX12Renderer::waitForFrame");
+				synchronizationObject_->wait(frameIndex_);
+			}
+
+			// Timestamps of the frame that used this slot are complete now
+			gpuProfiler_->beginFrame(frameIndex_);
+
+			submeshCuller_.resetStats();
+			renderCounters_ = {};
+
+			// Assets released since the last frame give their memory back if the caches are over budget
+			meshCache_.trim();
+			textureCache_.trim();
+
+			// Ranges freed by frames that are now complete go back to the geometry buffers, blocks to their heaps
+			geometryBuffer_->beginFrame();
+			memoryAllocator_->beginFrame();
+			boundVertexView_ = nullptr;
+			boundIndexView_  = nullptr;
 
 			// Reset command allocator and list
 			SPIDER_DX12_ERROR_CHECK(commandAllocators_[frameIndex_]->Reset());
@@ -1360,116 +1620,54 @@ namespace spider_engine::d3dx12 {
 				commandAllocators_[frameIndex_].Get(),
 				nullptr
 			));
+			gpuProfiler_->begin(commandLists_[frameIndex_].Get(), "Frame");
+
+			// Barrier counters restart with the frame
+			resourceStates_->beginFrame();
+
+			// Declare the frame: the scene pass draws into the back buffer, passes added after it see what it wrote
+			renderGraph_->beginFrame();
+			sceneDraws_.clear();
+
+			backBufferResource_  = renderGraph_->importResource("BackBuffer", backBuffers_[frameIndex_].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+			depthBufferResource_ = renderGraph_->importResource("DepthBuffer", depthBuffers_[frameIndex_].Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+			const rendering::RenderPassId scenePass = renderGraph_->addPass("Scene", [this](ID3D12GraphicsCommandList* cmd, RenderGraphExecutor&) {
+				recordScene(cmd);
+			});
+			renderGraph_->write(scenePass, backBufferResource_, D3D12_RESOURCE_STATE_RENDER_TARGET);
+			renderGraph_->write(scenePass, depthBufferResource_, D3D12_RESOURCE_STATE_DEPTH_WRITE);
 		}
 
+		// Queued for the scene pass, pipeline and camera have to live until endFrame
 		void draw(flecs::entity&     entity,
 				  RenderPipeline&    pipeline,
 				  rendering::Camera& camera)
 		{
-			// Get renderizable component
-			const Renderizable* renderizable = entity.get<Renderizable>();
-
-			// Get mesh and transform
-			const Mesh&				    mesh      = renderizable->mesh;
-			const rendering::Transform& transfrom = renderizable->transform;
-
-			// Create and bind frame data
-			rendering::FrameData frameData;
-			frameData.view       = camera.getViewMatrix();
-			frameData.projection = camera.getProjectionMatrix();
-
-			// Model matrix
-			DirectX::XMMATRIX scale       = DirectX::XMMatrixScalingFromVector(transfrom.scale);
-			DirectX::XMMATRIX rotation    = DirectX::XMMatrixRotationQuaternion(transfrom.rotation);
-			DirectX::XMMATRIX translation = DirectX::XMMatrixTranslationFromVector(transfrom.position);
-
-			// Combine to form model matrix
-			frameData.model = scale * rotation * translation;
-			
-			// Bind frame data to pipeline
-			pipeline.bindBuffer<>("frameData", ShaderStage::STAGE_VERTEX, frameData);
-
-			// Get current command list
-			ID3D12GraphicsCommandList* cmd = commandLists_[frameIndex_].Get();
-
-			// Transition the back buffer to be used as render target
-			CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-				backBuffers_[frameIndex_].Get(),
-				D3D12_RESOURCE_STATE_PRESENT,
-				D3D12_RESOURCE_STATE_RENDER_TARGET
-			);
-			cmd->ResourceBarrier(1, &barrier);
-
-			// Get the cpu descriptor handle for the current back buffer
-			CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(
-				rtvDescriptorHeap_->heap->GetCPUDescriptorHandleForHeapStart(),
-				frameIndex_,
-				rtvDescriptorHeap_->descriptorHandleIncrementSize
-			);
-			CD3DX12_CPU_DESCRIPTOR_HANDLE dsvHandle(
-				dsvDescriptorHeap_->heap->GetCPUDescriptorHandleForHeapStart(),
-				frameIndex_,
-				dsvDescriptorHeap_->descriptorHandleIncrementSize
-			);
-
-			// Set render target and clear
-			cmd->OMSetRenderTargets(1, &rtvHandle, FALSE, &dsvHandle);
-			float clearColor[] = { 0.0, 0.0, 1.0, 1.0 };
-			cmd->ClearRenderTargetView(rtvHandle, clearColor, 0, nullptr);
-
-			// Set pipeline state
-			cmd->SetGraphicsRootSignature(pipeline.rootSignature_.Get());
-			cmd->SetPipelineState(pipeline.pipelineState_.Get());
-			
-			// Descriptor heaps
-			ID3D12DescriptorHeap* descriptorHeaps[] = {
-				cbvSrvUavDescriptorHeap_->heap.Get(),
-				samplerDescriptorHeap_->heap.Get()
-			};
-			cmd->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+			sceneDraws_.push_back({ entity, &pipeline, &camera, DirectX::XMMatrixIdentity(), 0 });
+		}
 
-			cmd->SetGraphicsRootDescriptorTable(0, cbvSrvUavDescriptorHeap_->heap->GetGPUDescriptorHandleForHeapStart());
-			cmd->SetGraphicsRootDescriptorTable(1, samplerDescriptorHeap_->heap->GetGPUDescriptorHandleForHeapStart());
+		void endFrame() {
+			SPIDER_PROFILE_SCOPE("DX12Renderer::endFrame");
 
-			// Viewport and Scissor
-			D3D12_RESOURCE_DESC backDesc = backBuffers_[frameIndex_]->GetDesc();
-			float width				     = static_cast<float>(backDesc.Width);
-			float height				 = static_cast<float>(backDesc.Height);
-			CD3DX12_VIEWPORT viewport(0.0f, 0.0f, width, height);
-			CD3DX12_RECT scissorRect(0, 0, static_cast<LONG>(width), static_cast<LONG>(height));
-			cmd->RSSetViewports(1, &viewport);
-			cmd->RSSetScissorRects(1, &scissorRect);
+			// Only what the cameras see reaches the scene pass
+			cullScene();
 
-			// Buffers
-			cmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			cmd->IASetVertexBuffers(0, 1, &mesh.vertexArrayBuffer->vertexArrayBufferView);
-			cmd->IASetIndexBuffer(&mesh.indexArrayBuffer->indexArrayBufferView);
+			// Record every pass with the barriers the graph needs between them
+			renderGraph_->execute(commandLists_[frameIndex_].Get());
 
-			// Draw
-			cmd->DrawIndexedInstanced(static_cast<UINT>(mesh.indexArrayBuffer->size), 1, 0, 0, 0);
+			gpuProfiler_->end(commandLists_[frameIndex_].Get());
+			gpuProfiler_->resolve(commandLists_[frameIndex_].Get());
 
-			// Transition the back buffer to be used to present
-			barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-				backBuffers_[frameIndex_].Get(),
-				D3D12_RESOURCE_STATE_RENDER_TARGET,
-				D3D12_RESOURCE_STATE_PRESENT
-			);
-			cmd->ResourceBarrier(1, &barrier);
-		}
-
-		void endFrame() {
-			// Close command list
-			commandLists_[frameIndex_]->Close();
-
-			// Execute command list
-			ID3D12CommandList* cmds[] = { commandLists_[frameIndex_].Get() };
-			commandQueue_->ExecuteCommandLists(1, cmds);
+			// Close and execute command list, behind the fixups for states other lists left behind
+			resourceStates_->submit(commandQueue_.Get(), commandLists_[frameIndex_].Get());
 
 			// Signal that the frame is finished
 			synchronizationObject_->signal(commandQueue_.Get(), frameIndex_);
 		}
 
 		void present() {
+			SPIDER_PROFILE_SCOPE("DX12Renderer::present");
 			HRESULT hr;
 
 			// Present the frame
@@ -1520,6 +1718,91 @@ namespace spider_engine::d3dx12 {
 			return isVSync_;
 		}
 
+		// Occupancy and fragmentation of the shared vertex and index buffers
+		GeometryBufferStats getGeometryStats() const {
+			return geometryBuffer_->getStats();
+		}
+
+		// Passes added between beginFrame and endFrame run after the scene pass, in the order they were added
+		RenderGraphExecutor& getRenderGraph() {
+			return *renderGraph_;
+		}
+		rendering::RenderResourceId getBackBufferResource() const {
+			return backBufferResource_;
+		}
+		rendering::RenderResourceId getDepthBufferResource() const {
+			return depthBufferResource_;
+		}
+
+		// Barriers issued, elided and resolved at submission over the last frame
+		ResourceStateStats getResourceStateStats() const {
+			return resourceStates_->getStats();
+		}
+		ResourceStateRegistry& getResourceStates() {
+			return *resourceStates_;
+		}
+
+		// Culled passes, barriers and transient memory of the last frame
+		const rendering::RenderGraphStats& getRenderGraphStats() const {
+			return renderGraph_->getStats();
+		}
+
+		// GPU time of the frame and its passes, read back frameLatency frames later
+		GpuProfiler& getGpuProfiler() {
+			return *gpuProfiler_;
+		}
+
+		// Draws and state changes of the last frame, complete once endFrame recorded it
+		const RenderCounters& getRenderCounters() const {
+			return renderCounters_;
+		}
+		// Time blocked on fences and bytes written for the GPU, both since creation
+		uint64_t getCpuWaitNanoseconds() const {
+			return synchronizationObject_->waitedNanoseconds_ + nonRenderingRelatedSynchronizationObject_->waitedNanoseconds_;
+		}
+		uint64_t getUploadedBytes() const {
+			return uploadedBytes_.load(std::memory_order_relaxed) + geometryBuffer_->getUploadedBytes();
+		}
+		std::vector<DescriptorHeapUsage> getDescriptorHeapUsage() const {
+			return heapAllocator_->getDescriptorHeapUsage();
+		}
+
+		// Heaps, placed and committed resources per category, and the OS memory budget
+		GpuMemoryStats getGpuMemoryStats() const {
+			return memoryAllocator_->getStats();
+		}
+
+		// Frustum culling of the draws queued for the last frame
+		const rendering::CullingStats& getSceneCullingStats() const {
+			return sceneCullingStats_;
+		}
+		// Occlusion culling of the draws that survived the frustum in the last frame
+		const rendering::OcclusionStats& getSceneOcclusionStats() const {
+			return sceneOcclusionStats_;
+		}
+		// Submesh culling of every draw since the last beginFrame
+		const rendering::SubmeshCullingStats& getSubmeshCullingStats() const {
+			return submeshCuller_.getStats();
+		}
+
+		// Bytes of every texture created so far, and what block compression saved over RGBA8
+		const rendering::TextureMemoryStats& getTextureMemoryStats() const {
+			return textureMemory_;
+		}
+
+		// Hits, misses and memory of the caches behind acquireMesh and acquireTexture2D
+		AssetCacheStats getMeshCacheStats() const {
+			return meshCache_.getStats();
+		}
+		AssetCacheStats getTextureCacheStats() const {
+			return textureCache_.getStats();
+		}
+
+		void setAssetCacheBudgets(const size_t meshBytes, const size_t textureBytes) {
+			meshCache_.setBudget(meshBytes);
+			textureCache_.setBudget(textureBytes);
+		}
+
 		DX12Renderer& operator=(const DX12Renderer&) = delete;
 		DX12Renderer& operator=(DX12Renderer&& other) {
 			if (this != &other) {
@@ -1538,6 +1821,20 @@ namespace spider_engine::d3dx12 {
 				frameIndex_							  = std::move(other.frameIndex_);
 				isFullScreen_						  = std::move(other.isFullScreen_);
 				isVSync_							  = std::move(other.isVSync_);
+				submeshCuller_						  = std::move(other.submeshCuller_);
+				memoryAllocator_					  = std::move(other.memoryAllocator_);
+				resourceStates_						  = std::move(other.resourceStates_);
+				renderGraph_						  = std::move(other.renderGraph_);
+				gpuProfiler_						  = std::move(other.gpuProfiler_);
+				backBufferResource_					  = other.backBufferResource_;
+				depthBufferResource_				  = other.depthBufferResource_;
+				sceneDraws_							  = std::move(other.sceneDraws_);
+				geometryBuffer_						  = std::move(other.geometryBuffer_);
+				renderCounters_						  = other.renderCounters_;
+				uploadedBytes_						  = other.uploadedBytes_.load();
+				textureMemory_						  = other.textureMemory_;
+				meshCache_							  = std::move(other.meshCache_);
+				textureCache_						  = std::move(other.textureCache_);
 			}
 			return *this;
 		}
@@ -1760,6 +2057,7 @@ namespace spider_engine::d3dx12 {
 		ComPtr<IDxcBlob> compileShader(const std::wstring& path, 
 									   const ShaderStage   shaderStage) 
 		{
+			SPIDER_PROFILE_SCOPE("DX12Compiler::compileShader");
 			HRESULT hr;
 
 			// Check compiler
@@ -1844,6 +2142,7 @@ namespace spider_engine::d3dx12 {
 		Microsoft::WRL::ComPtr<IDxcBlob> compileShader(const std::wstring& source, 
 													   const ShaderStage   shaderStage) 
 		{
+			SPIDER_PROFILE_SCOPE("DX12Compiler::compileShader");
 			HRESULT hr;
 
 			// Check compiler
@@ -1910,8 +2209,15 @@ namespace spider_engine::d3dx12 {
 				Microsoft::WRL::ComPtr<IDxcBlobEncoding> errors;
 				resultBuff->GetErrorBuffer(&errors);
 				if (errors) {
-					std::string errMsg((char*)errors->GetBufferPointer(), errors->GetBufferSize());
-					std::cerr << "DXC compile errors:\n" << errMsg << std::endl;
+					// A line per message, a whole error buffer would be truncated
+					const char*            text = static_cast<const char*>(errors->GetBufferPointer());
+					const std::string_view errMsg(text, strnlen(text, errors->GetBufferSize()));
+					SPIDER_LOG_ERROR("DXC compile errors:");
+					for (size_t start = 0; start < errMsg.size();) {
+						const size_t end = std::min(errMsg.find('\n', start), errMsg.size());
+						if (end > start) SPIDER_LOG_ERROR("{}", errMsg.substr(start, end - start));
+						start = end + 1;
+					}
 				}
 				throw std::runtime_error("Shader compilation failed.");
 			}
@@ -1987,17 +2293,23 @@ namespace spider_engine::d3dx12 {
 		}
 
 		template <typename Policy>
-		RenderPipeline createRenderPipeline(std::vector<ShaderDescription>& descriptions) {
+		RenderPipeline createRenderPipeline(std::vector<ShaderDescription>& descriptions,
+											const rendering::VertexFormat   vertexFormat = rendering::VertexFormat::FULL)
+		{
+			SPIDER_PROFILE_SCOPE("DX12Compiler::createRenderPipeline");
 			HRESULT hr = 0;
 
 			RenderPipeline renderPipeline									  = {};
 			renderPipeline.renderer_										  = renderer_;
 			renderPipeline.createShaderResourceViewForStructuredDataFunction_ = &DX12Renderer::createShaderResourceView;
 			renderPipeline.createShaderResourceViewForTexture2DFunction_      = &DX12Renderer::createShaderResourceViewForTexture2D;
+			renderPipeline.vertexFormat_                                      = vertexFormat;
 
 			// Create Pipeline State Object (PSO) description
 			D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-			psoDesc.InputLayout				           = { psInputLayout, _countof(psInputLayout) };
+			psoDesc.InputLayout				           = vertexFormat == rendering::VertexFormat::PACKED ?
+														 D3D12_INPUT_LAYOUT_DESC{ psPackedInputLayout, _countof(psPackedInputLayout) } :
+														 D3D12_INPUT_LAYOUT_DESC{ psInputLayout, _countof(psInputLayout) };
 			// Set rasterizer state: disable back-face culling for debugging
 			psoDesc.RasterizerState			           = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 			psoDesc.RasterizerState.CullMode           = D3D12_CULL_MODE_NONE;
@@ -2113,7 +2425,7 @@ namespace spider_engine::d3dx12 {
 			if (FAILED(serializeHr)) {
 				if (errorBlob) {
 					const char* msg = static_cast<const char*>(errorBlob->GetBufferPointer());
-					std::fprintf(stderr, "Root signature serialize error: %s\n", msg);
+					SPIDER_LOG_ERROR("Root signature serialize error: {}", msg);
 				}
 				SPIDER_DX12_ERROR_CHECK(serializeHr);
 			}
@@ -2197,6 +2509,13 @@ namespace spider_engine::d3dx12 {
 				}
 			}
 
+			// Packed pipelines decode positions with the mesh box, recordDraw relies on the buffer being there
+			if (vertexFormat == rendering::VertexFormat::PACKED &&
+				requiredConstantBuffers.find(std::make_pair(std::string("quantization"), ShaderStage::STAGE_VERTEX)) == requiredConstantBuffers.end())
+			{
+				throw std::runtime_error("Packed pipeline without a quantization buffer in its vertex shader.");
+			}
+
 			// Create references to Shader Resource Views
 			auto& requiredShaderResourceViews = renderPipeline.requiredShaderResourceViews_;
 
@@ -1,3 +1,7 @@
+#pragma once
+#include <chrono>
+#include <memory>
+#include <filesystem>
 #include <DirectXMath.h>
 #include <DirectXColors.h>
 #include <wrl/client.h>
@@ -9,9 +13,17 @@
 #include "DirectXTex/DirectXTex.h"
 
 #include "definitions.hpp"
+#include "types.hpp"
+#include "mesh_optimizer.hpp"
+#include "vertex_compression.hpp"
+#include "meshlet_builder.hpp"
+#include "submesh.hpp"
+#include "spmesh_format.hpp"
 #include "concepts.hpp"
 #include "policies.hpp"
 #include "dx12_policies.hpp"
+#include "geometry_buffer.hpp"
+#include "engine_stats.hpp"
 
 namespace spider_engine::d3dx12 {
 	enum class ShaderStage : uint8_t {
@@ -67,12 +79,9 @@ namespace spider_engine::d3dx12 {
 	class DX12Renderer;
 	class DX12Compiler;
 
-	struct Vertex {
-		DirectX::XMFLOAT3 position;
-		DirectX::XMFLOAT3 normal;
-		DirectX::XMFLOAT2 uv;
-		DirectX::XMFLOAT3 tangent;
-	};
+	// Shared with the portable import and cooking code
+	using rendering::Vertex;
+	using rendering::computeBoundingVolume;
 
 	inline constexpr D3D12_INPUT_ELEMENT_DESC psInputLayout[] = {
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,
@@ -92,27 +101,37 @@ namespace spider_engine::d3dx12 {
 		  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 	};
 
-	struct VertexArrayBuffer {
-		Microsoft::WRL::ComPtr<ID3D12Resource> vertexArrayBuffer;
-		D3D12_VERTEX_BUFFER_VIEW			   vertexArrayBufferView;
+	// Matches rendering::PackedVertex, normals and tangents need decodeOctahedral in the shader
+	inline constexpr D3D12_INPUT_ELEMENT_DESC psPackedInputLayout[] = {
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0,
+		  static_cast<UINT>(offsetof(rendering::PackedVertex, position)),
+		  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 
-		size_t size;
-	};
-	struct IndexArrayBuffer {
-		Microsoft::WRL::ComPtr<ID3D12Resource> indexArrayBuffer;
-		D3D12_INDEX_BUFFER_VIEW			       indexArrayBufferView;
+		{ "NORMAL",   0, DXGI_FORMAT_R16G16_SNORM,       0,
+		  static_cast<UINT>(offsetof(rendering::PackedVertex, normal)),
+		  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 
-		size_t size;
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,       0,
+		  static_cast<UINT>(offsetof(rendering::PackedVertex, uv)),
+		  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+
+		{ "TANGENT",  0, DXGI_FORMAT_R16G16_SNORM,       0,
+		  static_cast<UINT>(offsetof(rendering::PackedVertex, tangent)),
+		  D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 	};
 
 	struct Texture2D {
 		Microsoft::WRL::ComPtr<ID3D12Resource> resource;
 		Microsoft::WRL::ComPtr<ID3D12Resource> uploadResource;
 
-		D3D12_SUBRESOURCE_DATA textureData;
+		D3D12_SUBRESOURCE_DATA textureData; // Level 0
 
-		uint32_t width;
-		uint32_t height;
+		uint32_t    width;
+		uint32_t    height;
+		uint32_t    mipLevels   = 1;
+		uint32_t    arraySize   = 1; // Slices of a packed texture array, sampled with a Texture2DArray view
+		DXGI_FORMAT format      = DXGI_FORMAT_R8G8B8A8_UNORM;
+		size_t      sizeInBytes = 0; // Every mip level
 	};
 
 	struct ConstantBufferVariable {
@@ -369,13 +388,43 @@ namespace spider_engine::d3dx12 {
 	};
 
 	struct Mesh {
-		std::unique_ptr<VertexArrayBuffer> vertexArrayBuffer;
-		std::unique_ptr<IndexArrayBuffer>  indexArrayBuffer;
+		// Slices of the renderer's shared geometry buffers
+		GeometryRange vertices;
+		GeometryRange indices;
+
+		rendering::BoundingVolume bounds;
+
+		// Index ranges of every level of detail, level 0 is the full mesh
+		std::vector<rendering::MeshLod> lods;
+
+		// Vertex cache report of the import time optimization (level 0)
+		rendering::MeshOptimizationStats optimizationStats;
+
+		// Vertex layout and, for packed meshes, the position dequantization constant
+		rendering::VertexFormat       vertexFormat = rendering::VertexFormat::FULL;
+		rendering::VertexQuantization quantization;
+
+		rendering::MeshMemoryStats memory;
+
+		// Clusters of level 0 for mesh shaders or CPU cluster culling
+		rendering::MeshletData meshlets;
+
+		// Parts with their own material and bounds, empty for meshes built from a single index list
+		rendering::SubmeshTable submeshes;
+
+		rendering::MeshLoadStats load;
+
+		// Of the first material, empty when there is none
+		std::filesystem::path diffuseTexture;
 	};
 
+	// Shared between every renderizable using them, the renderer's caches hand them out
+	using MeshHandle    = std::shared_ptr<const Mesh>;
+	using TextureHandle = std::shared_ptr<const Texture2D>;
+
 	struct Renderizable {
-		Mesh				 mesh;
-		Texture2D			 texture;
+		MeshHandle			 mesh;
+		TextureHandle		 texture;
 		rendering::Transform transform;
 	};
 
@@ -398,6 +447,8 @@ namespace spider_engine::d3dx12 {
 
 		size_t bufferCount_;
 
+		uint64_t waitedNanoseconds_ = 0; // Time blocked in wait since creation
+
 		SynchronizationObject() = default;
 		SynchronizationObject(ID3D12Device* device,
 							  const size_t  bufferCount) :
@@ -427,7 +478,8 @@ namespace spider_engine::d3dx12 {
 			values_(other.values_),
 			currentValue_(other.currentValue_),
 			handles_(other.handles_),
-			bufferCount_(other.bufferCount_)
+			bufferCount_(other.bufferCount_),
+			waitedNanoseconds_(other.waitedNanoseconds_)
 		{}
 
 		~SynchronizationObject() {
@@ -442,9 +494,13 @@ namespace spider_engine::d3dx12 {
 
 			// Wait until the fence has been signaled
 			if (fence_->GetCompletedValue() < values_[index]) {
+				const auto start = std::chrono::steady_clock::now();
+
 				HANDLE& handle = this->handles_[index];
 				fence_->SetEventOnCompletion(values_[index], handle);
 				WaitForSingleObject(handle, INFINITE);
+
+				waitedNanoseconds_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
 			}
 		}
 
@@ -465,6 +521,7 @@ namespace spider_engine::d3dx12 {
 				currentValue_ = other.currentValue_;
 				handles_	  = other.handles_;
 				bufferCount_  = other.bufferCount_;
+				waitedNanoseconds_ = other.waitedNanoseconds_;
 			}
 			return *this;
 		}
@@ -674,6 +731,19 @@ namespace spider_engine::d3dx12 {
 			return {};
 		}
 
+		// Descriptors written into every heap, sorted by name
+		std::vector<DescriptorHeapUsage> getDescriptorHeapUsage() const {
+			std::vector<DescriptorHeapUsage> usage;
+			usage.reserve(descriptorHeaps_.size());
+			for (const auto& [name, descriptorHeap] : descriptorHeaps_) {
+				usage.push_back({ name, descriptorHeap->size, descriptorHeap->capacity });
+			}
+			std::sort(usage.begin(), usage.end(), [](const DescriptorHeapUsage& a, const DescriptorHeapUsage& b) {
+				return a.name < b.name;
+			});
+			return usage;
+		}
+
 		HeapAllocator& operator=(const HeapAllocator&)     = delete;
 		HeapAllocator& operator=(HeapAllocator&&) noexcept = default;
 	};
@@ -710,6 +780,7 @@ namespace spider_engine::d3dx12 {
 		Microsoft::WRL::ComPtr<ID3D12PipelineState> pipelineState_;
 		Microsoft::WRL::ComPtr<ID3D12RootSignature> rootSignature_;
 		D3D12_RESOURCE_BARRIER                      barrier_;
+		rendering::VertexFormat                     vertexFormat_ = rendering::VertexFormat::FULL;
 
 	public:
 		friend class DX12Renderer;
@@ -0,0 +1,545 @@
+#pragma once
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <DirectXMath.h>
+
+#include "types.hpp"
+#include "concepts.hpp"
+#include "frustum_culling.hpp"
+
+namespace spider_engine::rendering {
+	struct Aabb {
+		DirectX::XMFLOAT3 lower;
+		DirectX::XMFLOAT3 upper;
+
+		static Aabb fromBoundingVolume(const BoundingVolume& bounds) {
+			Aabb box;
+			box.lower = { bounds.center.x - bounds.extents.x, bounds.center.y - bounds.extents.y, bounds.center.z - bounds.extents.z };
+			box.upper = { bounds.center.x + bounds.extents.x, bounds.center.y + bounds.extents.y, bounds.center.z + bounds.extents.z };
+			return box;
+		}
+		static Aabb combine(const Aabb& a, const Aabb& b) {
+			Aabb box;
+			box.lower = { std::min(a.lower.x, b.lower.x), std::min(a.lower.y, b.lower.y), std::min(a.lower.z, b.lower.z) };
+			box.upper = { std::max(a.upper.x, b.upper.x), std::max(a.upper.y, b.upper.y), std::max(a.upper.z, b.upper.z) };
+			return box;
+		}
+
+		Aabb expanded(const float margin) const {
+			Aabb box;
+			box.lower = { lower.x - margin, lower.y - margin, lower.z - margin };
+			box.upper = { upper.x + margin, upper.y + margin, upper.z + margin };
+			return box;
+		}
+
+		bool contains(const Aabb& other) const {
+			return lower.x <= other.lower.x && lower.y <= other.lower.y && lower.z <= other.lower.z &&
+				   upper.x >= other.upper.x && upper.y >= other.upper.y && upper.z >= other.upper.z;
+		}
+		bool overlaps(const Aabb& other) const {
+			return lower.x <= other.upper.x && lower.y <= other.upper.y && lower.z <= other.upper.z &&
+				   upper.x >= other.lower.x && upper.y >= other.lower.y && upper.z >= other.lower.z;
+		}
+
+		float surfaceArea() const {
+			const float dx = upper.x - lower.x;
+			const float dy = upper.y - lower.y;
+			const float dz = upper.z - lower.z;
+			return 2.0f * (dx * dy + dy * dz + dz * dx);
+		}
+
+		// Slab test, returns the entry distance or a negative value on a miss
+		float rayDistance(const DirectX::XMFLOAT3& origin,
+						  const DirectX::XMFLOAT3& inverseDirection,
+						  const float              maxDistance) const
+		{
+			float tMin = 0.0f;
+			float tMax = maxDistance;
+
+			const float o[3]   = { origin.x, origin.y, origin.z };
+			const float inv[3] = { inverseDirection.x, inverseDirection.y, inverseDirection.z };
+			const float lo[3]  = { lower.x, lower.y, lower.z };
+			const float hi[3]  = { upper.x, upper.y, upper.z };
+			for (int axis = 0; axis < 3; ++axis) {
+				float t1 = (lo[axis] - o[axis]) * inv[axis];
+				float t2 = (hi[axis] - o[axis]) * inv[axis];
+				if (t1 > t2) std::swap(t1, t2);
+
+				tMin = std::max(tMin, t1);
+				tMax = std::min(tMax, t2);
+				if (tMin > tMax) return -1.0f;
+			}
+			return tMin;
+		}
+	};
+
+	struct RayCastInput {
+		DirectX::XMFLOAT3 origin;
+		DirectX::XMFLOAT3 direction;
+		float             maxDistance;
+	};
+
+	struct DynamicAabbTreeStats {
+		size_t proxyCount = 0;
+		size_t nodeCount  = 0;
+		size_t height     = 0;
+		size_t moves      = 0;
+		size_t refits     = 0;
+		size_t reinserts  = 0;
+		size_t rotations  = 0;
+	};
+
+	class DynamicAabbTree {
+	private:
+		static constexpr int32_t nullNode_ = -1;
+
+		struct Node {
+			Aabb     box;
+			uint64_t userData;
+
+			// Doubles as the free list link when the node is not in use
+			int32_t parent;
+			int32_t child1;
+			int32_t child2;
+			int32_t height;
+
+			bool isLeaf() const {
+				return child1 == nullNode_;
+			}
+		};
+
+		std::vector<Node> nodes_;
+
+		int32_t root_;
+		int32_t freeList_;
+
+		float margin_;
+
+		DynamicAabbTreeStats stats_;
+
+		int32_t allocateNode() {
+			if (freeList_ == nullNode_) {
+				nodes_.emplace_back();
+				nodes_.back().parent = nullNode_;
+				freeList_ = static_cast<int32_t>(nodes_.size() - 1);
+			}
+
+			const int32_t index = freeList_;
+			Node& node          = nodes_[index];
+			freeList_           = node.parent;
+			node.parent         = nullNode_;
+			node.child1         = nullNode_;
+			node.child2         = nullNode_;
+			node.height         = 0;
+			node.userData       = 0;
+
+			++stats_.nodeCount;
+			return index;
+		}
+		void freeNode(const int32_t index) {
+			nodes_[index].parent = freeList_;
+			nodes_[index].height = -1;
+			freeList_            = index;
+
+			--stats_.nodeCount;
+		}
+
+		void fixUpwards(int32_t index) {
+			// Rebalance and refit every ancestor up to the root
+			while (index != nullNode_) {
+				index = balance(index);
+
+				Node& node  = nodes_[index];
+				node.height = 1 + std::max(nodes_[node.child1].height, nodes_[node.child2].height);
+				node.box    = Aabb::combine(nodes_[node.child1].box, nodes_[node.child2].box);
+
+				index = node.parent;
+			}
+		}
+
+		void insertLeaf(const int32_t leaf) {
+			if (root_ == nullNode_) {
+				root_               = leaf;
+				nodes_[leaf].parent = nullNode_;
+				return;
+			}
+
+			// Descend choosing the child with the lowest surface area cost
+			const Aabb leafBox = nodes_[leaf].box;
+			int32_t    index   = root_;
+			while (!nodes_[index].isLeaf()) {
+				const Node& node = nodes_[index];
+
+				const float area         = node.box.surfaceArea();
+				const float combinedArea = Aabb::combine(node.box, leafBox).surfaceArea();
+
+				// Cost of making a new parent for this node and the leaf
+				const float cost = 2.0f * combinedArea;
+
+				// Minimum cost of pushing the leaf further down the tree
+				const float inheritanceCost = 2.0f * (combinedArea - area);
+
+				auto childCost = [&](const int32_t child) {
+					const Node& childNode = nodes_[child];
+					const float newArea   = Aabb::combine(childNode.box, leafBox).surfaceArea();
+					if (childNode.isLeaf()) return newArea + inheritanceCost;
+					return (newArea - childNode.box.surfaceArea()) + inheritanceCost;
+				};
+				const float cost1 = childCost(node.child1);
+				const float cost2 = childCost(node.child2);
+
+				if (cost < cost1 && cost < cost2) break;
+
+				index = cost1 < cost2 ? node.child1 : node.child2;
+			}
+
+			// Create a new parent for the sibling and the leaf
+			const int32_t sibling   = index;
+			const int32_t oldParent = nodes_[sibling].parent;
+			const int32_t newParent = allocateNode();
+
+			Node& parentNode    = nodes_[newParent];
+			parentNode.parent   = oldParent;
+			parentNode.box      = Aabb::combine(leafBox, nodes_[sibling].box);
+			parentNode.height   = nodes_[sibling].height + 1;
+			parentNode.child1   = sibling;
+			parentNode.child2   = leaf;
+
+			if (oldParent != nullNode_) {
+				if (nodes_[oldParent].child1 == sibling) nodes_[oldParent].child1 = newParent;
+				else                                     nodes_[oldParent].child2 = newParent;
+			}
+			else {
+				root_ = newParent;
+			}
+			nodes_[sibling].parent = newParent;
+			nodes_[leaf].parent    = newParent;
+
+			fixUpwards(nodes_[leaf].parent);
+		}
+
+		void removeLeaf(const int32_t leaf) {
+			if (leaf == root_) {
+				root_ = nullNode_;
+				return;
+			}
+
+			const int32_t parent      = nodes_[leaf].parent;
+			const int32_t grandParent = nodes_[parent].parent;
+			const int32_t sibling     = nodes_[parent].child1 == leaf ? nodes_[parent].child2 : nodes_[parent].child1;
+
+			// Replace the parent by the sibling
+			if (grandParent != nullNode_) {
+				if (nodes_[grandParent].child1 == parent) nodes_[grandParent].child1 = sibling;
+				else                                      nodes_[grandParent].child2 = sibling;
+				nodes_[sibling].parent = grandParent;
+				freeNode(parent);
+
+				fixUpwards(grandParent);
+			}
+			else {
+				root_                  = sibling;
+				nodes_[sibling].parent = nullNode_;
+				freeNode(parent);
+			}
+		}
+
+		// Rotates the taller grandchild up when the subtree is unbalanced, returns the new subtree root
+		int32_t balance(const int32_t iA) {
+			Node& A = nodes_[iA];
+			if (A.isLeaf() || A.height < 2) return iA;
+
+			const int32_t iB = A.child1;
+			const int32_t iC = A.child2;
+			Node& B = nodes_[iB];
+			Node& C = nodes_[iC];
+
+			const int32_t difference = C.height - B.height;
+
+			// Rotate C up
+			if (difference > 1) {
+				const int32_t iF = C.child1;
+				const int32_t iG = C.child2;
+				Node& F = nodes_[iF];
+				Node& G = nodes_[iG];
+
+				C.child1 = iA;
+				C.parent = A.parent;
+				A.parent = iC;
+
+				if (C.parent != nullNode_) {
+					if (nodes_[C.parent].child1 == iA) nodes_[C.parent].child1 = iC;
+					else                               nodes_[C.parent].child2 = iC;
+				}
+				else {
+					root_ = iC;
+				}
+
+				if (F.height > G.height) {
+					C.child2 = iF;
+					A.child2 = iG;
+					G.parent = iA;
+					A.box    = Aabb::combine(B.box, G.box);
+					C.box    = Aabb::combine(A.box, F.box);
+					A.height = 1 + std::max(B.height, G.height);
+					C.height = 1 + std::max(A.height, F.height);
+				}
+				else {
+					C.child2 = iG;
+					A.child2 = iF;
+					F.parent = iA;
+					A.box    = Aabb::combine(B.box, F.box);
+					C.box    = Aabb::combine(A.box, G.box);
+					A.height = 1 + std::max(B.height, F.height);
+					C.height = 1 + std::max(A.height, G.height);
+				}
+
+				++stats_.rotations;
+				return iC;
+			}
+
+			// Rotate B up
+			if (difference < -1) {
+				const int32_t iD = B.child1;
+				const int32_t iE = B.child2;
+				Node& D = nodes_[iD];
+				Node& E = nodes_[iE];
+
+				B.child1 = iA;
+				B.parent = A.parent;
+				A.parent = iB;
+
+				if (B.parent != nullNode_) {
+					if (nodes_[B.parent].child1 == iA) nodes_[B.parent].child1 = iB;
+					else                               nodes_[B.parent].child2 = iB;
+				}
+				else {
+					root_ = iB;
+				}
+
+				if (D.height > E.height) {
+					B.child2 = iD;
+					A.child1 = iE;
+					E.parent = iA;
+					A.box    = Aabb::combine(C.box, E.box);
+					B.box    = Aabb::combine(A.box, D.box);
+					A.height = 1 + std::max(C.height, E.height);
+					B.height = 1 + std::max(A.height, D.height);
+				}
+				else {
+					B.child2 = iE;
+					A.child1 = iD;
+					D.parent = iA;
+					A.box    = Aabb::combine(C.box, D.box);
+					B.box    = Aabb::combine(A.box, E.box);
+					A.height = 1 + std::max(C.height, D.height);
+					B.height = 1 + std::max(A.height, E.height);
+				}
+
+				++stats_.rotations;
+				return iB;
+			}
+
+			return iA;
+		}
+
+	public:
+		DynamicAabbTree(const float margin = 0.1f) :
+			root_(nullNode_),
+			freeList_(nullNode_),
+			margin_(margin)
+		{}
+		DynamicAabbTree(const DynamicAabbTree&)     = default;
+		DynamicAabbTree(DynamicAabbTree&&) noexcept = default;
+
+		int32_t createProxy(const Aabb& box, const uint64_t userData) {
+			const int32_t proxy = allocateNode();
+
+			nodes_[proxy].box      = box.expanded(margin_);
+			nodes_[proxy].userData = userData;
+			nodes_[proxy].height   = 0;
+
+			insertLeaf(proxy);
+
+			++stats_.proxyCount;
+			return proxy;
+		}
+		void destroyProxy(const int32_t proxy) {
+			removeLeaf(proxy);
+			freeNode(proxy);
+
+			--stats_.proxyCount;
+		}
+
+		// Returns false when the fat box still contains the new box and nothing had to change
+		bool moveProxy(const int32_t proxy, const Aabb& box) {
+			const Aabb oldFatBox = nodes_[proxy].box;
+			if (oldFatBox.contains(box)) return false;
+
+			const Aabb newFatBox = box.expanded(margin_);
+			++stats_.moves;
+
+			// Small moves refit the ancestors in place, large jumps find a new sibling
+			if (oldFatBox.overlaps(newFatBox)) {
+				nodes_[proxy].box = newFatBox;
+				fixUpwards(nodes_[proxy].parent);
+				++stats_.refits;
+			}
+			else {
+				removeLeaf(proxy);
+				nodes_[proxy].box = newFatBox;
+				insertLeaf(proxy);
+				++stats_.reinserts;
+			}
+			return true;
+		}
+
+		uint64_t getUserData(const int32_t proxy) const {
+			return nodes_[proxy].userData;
+		}
+		const Aabb& getFatAabb(const int32_t proxy) const {
+			return nodes_[proxy].box;
+		}
+
+		// fn(proxy) returns false to stop the query
+		template <typename Fn>
+		requires (CallableAs<Fn, bool, int32_t>)
+		void query(const Aabb& box, Fn&& fn) const {
+			if (root_ == nullNode_) return;
+
+			std::vector<int32_t> stack;
+			stack.reserve(64);
+			stack.push_back(root_);
+
+			while (!stack.empty()) {
+				const int32_t index = stack.back();
+				stack.pop_back();
+
+				const Node& node = nodes_[index];
+				if (!node.box.overlaps(box)) continue;
+
+				if (node.isLeaf()) {
+					if (!fn(index)) return;
+				}
+				else {
+					stack.push_back(node.child1);
+					stack.push_back(node.child2);
+				}
+			}
+		}
+
+		template <typename Fn>
+		requires (CallableAs<Fn, bool, int32_t>)
+		void query(const Frustum& frustum, Fn&& fn) const {
+			if (root_ == nullNode_) return;
+
+			// Second element tells whether the subtree is already known to be fully inside
+			std::vector<std::pair<int32_t, bool>> stack;
+			stack.reserve(64);
+			stack.emplace_back(root_, false);
+
+			while (!stack.empty()) {
+				auto [index, isInside] = stack.back();
+				stack.pop_back();
+
+				const Node& node = nodes_[index];
+
+				if (!isInside) {
+					const DirectX::XMFLOAT3 center  = {
+						(node.box.lower.x + node.box.upper.x) * 0.5f,
+						(node.box.lower.y + node.box.upper.y) * 0.5f,
+						(node.box.lower.z + node.box.upper.z) * 0.5f
+					};
+					const DirectX::XMFLOAT3 extents = {
+						(node.box.upper.x - node.box.lower.x) * 0.5f,
+						(node.box.upper.y - node.box.lower.y) * 0.5f,
+						(node.box.upper.z - node.box.lower.z) * 0.5f
+					};
+
+					bool isOutside = false;
+					isInside       = true;
+					for (const auto& plane : frustum.planes) {
+						const float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+						const float radius   = std::fabs(plane.x) * extents.x + std::fabs(plane.y) * extents.y + std::fabs(plane.z) * extents.z;
+						if (distance + radius < 0.0f) {
+							isOutside = true;
+							break;
+						}
+						if (distance - radius < 0.0f) isInside = false;
+					}
+					if (isOutside) continue;
+				}
+
+				if (node.isLeaf()) {
+					if (!fn(index)) return;
+				}
+				else {
+					stack.emplace_back(node.child1, isInside);
+					stack.emplace_back(node.child2, isInside);
+				}
+			}
+		}
+
+		// fn(proxy, input) returns the new max distance: 0 stops, negative ignores the proxy
+		template <typename Fn>
+		requires (CallableAs<Fn, float, int32_t, const RayCastInput&>)
+		void rayCast(const RayCastInput& input, Fn&& fn) const {
+			if (root_ == nullNode_) return;
+
+			const DirectX::XMFLOAT3 inverseDirection = {
+				1.0f / input.direction.x,
+				1.0f / input.direction.y,
+				1.0f / input.direction.z
+			};
+
+			RayCastInput current = input;
+
+			std::vector<int32_t> stack;
+			stack.reserve(64);
+			stack.push_back(root_);
+
+			while (!stack.empty()) {
+				const int32_t index = stack.back();
+				stack.pop_back();
+
+				const Node& node = nodes_[index];
+				if (node.box.rayDistance(current.origin, inverseDirection, current.maxDistance) < 0.0f) continue;
+
+				if (node.isLeaf()) {
+					const float value = fn(index, current);
+					if (value == 0.0f) return;
+					if (value > 0.0f) current.maxDistance = value;
+				}
+				else {
+					stack.push_back(node.child1);
+					stack.push_back(node.child2);
+				}
+			}
+		}
+
+		size_t getHeight() const {
+			return root_ == nullNode_ ? 0 : static_cast<size_t>(nodes_[root_].height);
+		}
+
+		// Sum of node areas over root area, lower is a better tree
+		float getAreaRatio() const {
+			if (root_ == nullNode_) return 0.0f;
+
+			float totalArea = 0.0f;
+			for (const auto& node : nodes_) {
+				if (node.height < 0) continue;
+				totalArea += node.box.surfaceArea();
+			}
+			return totalArea / nodes_[root_].box.surfaceArea();
+		}
+
+		const DynamicAabbTreeStats& getStats() {
+			stats_.height = getHeight();
+			return stats_;
+		}
+
+		DynamicAabbTree& operator=(const DynamicAabbTree&)     = default;
+		DynamicAabbTree& operator=(DynamicAabbTree&&) noexcept = default;
+	};
+}
\ No newline at end of file
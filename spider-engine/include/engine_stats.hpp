@@ -0,0 +1,228 @@
+#pragma once
+#include <cmath>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+
+namespace spider_engine {
+	// Milliseconds over the samples a FrameTimeHistogram holds
+	struct FrameTimeStats {
+		size_t sampleCount = 0;
+		double last        = 0.0;
+		double average     = 0.0;
+		double minimum     = 0.0;
+		double maximum     = 0.0;
+		double p50         = 0.0;
+		double p95         = 0.0;
+		double p99         = 0.0;
+	};
+
+	// The last frame times in a ring. Adding one is all a frame pays, percentiles sort a copy when asked.
+	class FrameTimeHistogram {
+	private:
+		std::vector<float> samples_;
+		size_t             next_  = 0;
+		size_t             count_ = 0;
+		double             last_  = 0.0;
+
+		// Nearest rank on sorted samples: the smallest one with at least percentile % of them at or below it
+		static double getPercentile(const std::vector<float>& sorted, const double percentile) {
+			const size_t rank = static_cast<size_t>(std::ceil(percentile * static_cast<double>(sorted.size()) / 100.0));
+			return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+		}
+
+	public:
+		explicit FrameTimeHistogram(const size_t capacity = 1024) :
+			samples_(std::max<size_t>(capacity, 1))
+		{}
+
+		void add(const double milliseconds) {
+			samples_[next_] = static_cast<float>(milliseconds);
+			next_           = (next_ + 1) % samples_.size();
+			count_          = std::min(count_ + 1, samples_.size());
+			last_           = milliseconds;
+		}
+		void clear() {
+			next_  = 0;
+			count_ = 0;
+			last_  = 0.0;
+		}
+
+		FrameTimeStats getStats() const {
+			FrameTimeStats stats;
+			stats.sampleCount = count_;
+			stats.last        = last_;
+			if (count_ == 0) return stats;
+
+			std::vector<float> sorted(samples_.begin(), samples_.begin() + count_);
+			std::sort(sorted.begin(), sorted.end());
+
+			double sum = 0.0;
+			for (const float sample : sorted) sum += sample;
+
+			stats.average = sum / static_cast<double>(count_);
+			stats.minimum = sorted.front();
+			stats.maximum = sorted.back();
+			stats.p50     = getPercentile(sorted, 50.0);
+			stats.p95     = getPercentile(sorted, 95.0);
+			stats.p99     = getPercentile(sorted, 99.0);
+			return stats;
+		}
+	};
+
+	// What the renderer recorded in its last frame
+	struct RenderCounters {
+		uint64_t drawCalls             = 0;
+		uint64_t pipelineSwitches      = 0;
+		uint64_t rootSignatureSwitches = 0;
+		uint64_t descriptorHeapBinds   = 0;
+	};
+
+	struct DescriptorHeapUsage {
+		std::string name;
+		size_t      used     = 0;
+		size_t      capacity = 0;
+	};
+
+	// One snapshot of the engine, gathered when asked for
+	struct EngineStats {
+		uint64_t       frame = 0;
+		FrameTimeStats frameTime;
+		FrameTimeStats cpuWait;              // Per frame, blocked in SynchronizationObject::wait
+		double         gpuMilliseconds = 0.0; // Of the last frame read back, frames in flight behind
+
+		RenderCounters                   render;
+		std::vector<DescriptorHeapUsage> descriptorHeaps;
+
+		uint64_t uploadedBytes      = 0; // Last frame
+		uint64_t totalUploadedBytes = 0;
+
+		// Live GPU objects
+		size_t heaps              = 0;
+		size_t placedResources    = 0;
+		size_t committedResources = 0;
+		size_t geometryPages      = 0;
+
+		// ECS
+		size_t entities = 0;
+		size_t tables   = 0;
+
+		void writeJson(std::ostream& out) const {
+			const std::ios_base::fmtflags flags     = out.flags();
+			const std::streamsize         precision = out.precision();
+			out << std::dec << std::fixed << std::setprecision(3);
+
+			auto writeTimes = [&out](const std::string_view name, const FrameTimeStats& times) {
+				out << "  \"" << name << "\": {\"samples\": " << times.sampleCount
+					<< ", \"last\": "    << times.last
+					<< ", \"average\": " << times.average
+					<< ", \"min\": "     << times.minimum
+					<< ", \"max\": "     << times.maximum
+					<< ", \"p50\": "     << times.p50
+					<< ", \"p95\": "     << times.p95
+					<< ", \"p99\": "     << times.p99 << "},\n";
+			};
+
+			out << "{\n";
+			out << "  \"frame\": " << frame << ",\n";
+			writeTimes("frameTimeMs", frameTime);
+			writeTimes("cpuWaitMs", cpuWait);
+			out << "  \"gpuMs\": " << gpuMilliseconds << ",\n";
+			out << "  \"render\": {\"drawCalls\": " << render.drawCalls
+				<< ", \"pipelineSwitches\": "       << render.pipelineSwitches
+				<< ", \"rootSignatureSwitches\": "  << render.rootSignatureSwitches
+				<< ", \"descriptorHeapBinds\": "    << render.descriptorHeapBinds << "},\n";
+
+			out << "  \"descriptorHeaps\": [";
+			for (size_t i = 0; i < descriptorHeaps.size(); ++i) {
+				out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"";
+				for (const char c : descriptorHeaps[i].name) {
+					if (c == '"' || c == '\\') out << '\\';
+					out << (static_cast<unsigned char>(c) < 0x20 ? ' ' : c);
+				}
+				out << "\", \"used\": " << descriptorHeaps[i].used << ", \"capacity\": " << descriptorHeaps[i].capacity << "}";
+			}
+			out << (descriptorHeaps.empty() ? "],\n" : "\n  ],\n");
+
+			out << "  \"uploadedBytes\": "      << uploadedBytes      << ",\n";
+			out << "  \"totalUploadedBytes\": " << totalUploadedBytes << ",\n";
+			out << "  \"resources\": {\"heaps\": " << heaps
+				<< ", \"placed\": "                << placedResources
+				<< ", \"committed\": "             << committedResources
+				<< ", \"geometryPages\": "         << geometryPages << "},\n";
+			out << "  \"ecs\": {\"entities\": " << entities << ", \"tables\": " << tables << "}\n";
+			out << "}\n";
+
+			out.flags(flags);
+			out.precision(precision);
+		}
+		bool saveJson(const std::filesystem::path& path) const {
+			std::ofstream file(path);
+			if (!file) return false;
+
+			writeJson(file);
+			return static_cast<bool>(file);
+		}
+	};
+
+	// Per frame part of the stats: frame time, and the frame's share of counters that only ever grow.
+	// Everything else is read when a snapshot is taken.
+	class EngineStatsRecorder {
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		FrameTimeHistogram frameTimes_;
+		FrameTimeHistogram cpuWaits_;
+		Clock::time_point  lastFrame_;
+		uint64_t           frame_ = 0;
+
+		uint64_t waitNanoseconds_ = 0; // Totals at the end of the last frame
+		uint64_t uploadedBytes_   = 0;
+		uint64_t frameUploaded_   = 0;
+
+	public:
+		explicit EngineStatsRecorder(const size_t windowSize = 1024) :
+			frameTimes_(windowSize),
+			cpuWaits_(windowSize)
+		{}
+
+		// Totals since startup, the first frame only sets the baseline
+		void endFrame(const uint64_t totalWaitNanoseconds, const uint64_t totalUploadedBytes) {
+			const Clock::time_point now = Clock::now();
+
+			if (frame_ > 0) {
+				frameTimes_.add(std::chrono::duration<double, std::milli>(now - lastFrame_).count());
+				cpuWaits_.add(static_cast<double>(totalWaitNanoseconds - waitNanoseconds_) / 1e6);
+				frameUploaded_ = totalUploadedBytes - uploadedBytes_;
+			}
+
+			lastFrame_       = now;
+			waitNanoseconds_ = totalWaitNanoseconds;
+			uploadedBytes_   = totalUploadedBytes;
+			++frame_;
+		}
+
+		// Fills what the recorder owns, the rest of the snapshot is left alone
+		void fill(EngineStats& stats) const {
+			stats.frame              = frame_;
+			stats.frameTime          = frameTimes_.getStats();
+			stats.cpuWait            = cpuWaits_.getStats();
+			stats.uploadedBytes      = frameUploaded_;
+			stats.totalUploadedBytes = uploadedBytes_;
+		}
+
+		void reset() {
+			frameTimes_.clear();
+			cpuWaits_.clear();
+			frame_         = 0;
+			frameUploaded_ = 0;
+		}
+	};
+}
\ No newline at end of file
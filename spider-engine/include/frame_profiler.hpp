@@ -0,0 +1,327 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <algorithm>
+#include <string_view>
+#include <unordered_set>
+
+// Profiling is compiled in unless SPIDER_PROFILING is defined to 0, scopes then expand to nothing.
+// Compiled in, a scope outside a capture costs one relaxed atomic load.
+#ifndef SPIDER_PROFILING
+#define SPIDER_PROFILING 1
+#endif
+
+#if SPIDER_PROFILING
+#define SPIDER_PROFILE_CONCAT_IMPL(a, b) a##b
+#define SPIDER_PROFILE_CONCAT(a, b) SPIDER_PROFILE_CONCAT_IMPL(a, b)
+#define SPIDER_PROFILE_SCOPE(name) ::spider_engine::ProfileScope SPIDER_PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define SPIDER_PROFILE_SCOPE_DYNAMIC(name) ::spider_engine::ProfileScope SPIDER_PROFILE_CONCAT(profileScope_, __LINE__)(::spider_engine::ProfileScope::Dynamic{}, name)
+#define SPIDER_PROFILE_FUNCTION() SPIDER_PROFILE_SCOPE(__func__)
+#define SPIDER_PROFILE_FRAME() ::spider_engine::FrameProfiler::get().beginFrame()
+#define SPIDER_PROFILE_THREAD(name) ::spider_engine::FrameProfiler::get().setThreadName(name)
+#else
+#define SPIDER_PROFILE_SCOPE(name)
+#define SPIDER_PROFILE_SCOPE_DYNAMIC(name)
+#define SPIDER_PROFILE_FUNCTION()
+#define SPIDER_PROFILE_FRAME()
+#define SPIDER_PROFILE_THREAD(name)
+#endif
+
+namespace spider_engine {
+	// Times are steady clock nanoseconds, names outlive the capture (literals or interned)
+	struct ProfileEvent {
+		const char* name;
+		uint64_t    begin;
+		uint64_t    end;
+		uint64_t    frame;
+		uint32_t    depth;
+	};
+
+	struct FrameProfilerStats {
+		uint64_t frame         = 0;
+		uint64_t firstFrame    = 0; // Captured range [firstFrame, lastFrame)
+		uint64_t lastFrame     = 0;
+		size_t   threadCount   = 0;
+		size_t   cpuEventCount = 0;
+		size_t   gpuEventCount = 0;
+		bool     isCapturing   = false;
+	};
+
+	// Collects CPU scopes from every thread and GPU timings from the backend over a range of frames, and
+	// writes them as a Chrome trace (chrome://tracing, Perfetto). Each thread appends to its own buffer,
+	// so scopes on different threads never contend; the buffers stay with the profiler when threads exit.
+	// Outside a capture nothing is recorded.
+	class FrameProfiler {
+	private:
+		struct ThreadBuffer {
+			std::mutex                mutex; // Only contended while the trace is written
+			std::vector<ProfileEvent> events;
+			std::string               name;
+			uint32_t                  id;
+			uint32_t                  depth = 0;
+		};
+
+		struct GpuTrack {
+			std::string               name;
+			std::vector<ProfileEvent> events;
+		};
+
+		std::atomic<bool>     isRecording_ = false;
+		std::atomic<uint64_t> frame_       = 0;
+
+		std::mutex                                 mutex_;
+		std::vector<std::unique_ptr<ThreadBuffer>> threads_;
+		std::vector<GpuTrack>                      gpuTracks_;
+		std::unordered_set<std::string>            names_; // Nodes never move, their c_str() stays valid
+
+		uint32_t                                   requestedFrames_ = 0;
+		uint64_t                                   firstFrame_      = 0;
+		uint64_t                                   lastFrame_       = 0;
+		uint64_t                                   captureStart_    = 0;
+		std::vector<std::pair<uint64_t, uint64_t>> frameStarts_; // Frame and time, the last one ends the capture
+
+		FrameProfiler() = default;
+
+		ThreadBuffer& getThreadBuffer() {
+			thread_local ThreadBuffer* buffer = nullptr;
+			if (buffer) return *buffer;
+
+			std::lock_guard lock(mutex_);
+			threads_.push_back(std::make_unique<ThreadBuffer>());
+			buffer     = threads_.back().get();
+			buffer->id = static_cast<uint32_t>(threads_.size());
+			return *buffer;
+		}
+
+		static void writeEscaped(std::ostream& out, const std::string_view text) {
+			for (const char c : text) {
+				switch (c) {
+					case '"':  out << "\\\""; break;
+					case '\\': out << "\\\\"; break;
+					case '\n': out << "\\n";  break;
+					case '\t': out << "\\t";  break;
+					default:
+						if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+						else                                      out << c;
+				}
+			}
+		}
+
+		// Complete event, times in microseconds from the start of the capture
+		void writeEvent(std::ostream& out, bool& isFirst, const ProfileEvent& event, const uint32_t pid, const uint32_t tid) const {
+			const double begin    = (static_cast<double>(event.begin) - static_cast<double>(captureStart_)) / 1000.0;
+			const double duration = static_cast<double>(event.end - event.begin) / 1000.0;
+
+			out << (isFirst ? "\n" : ",\n") << "{\"name\":\"";
+			writeEscaped(out, event.name);
+			out << "\",\"ph\":\"X\",\"ts\":" << begin << ",\"dur\":" << duration << ",\"pid\":" << pid << ",\"tid\":" << tid
+				<< ",\"args\":{\"frame\":" << event.frame << "}}";
+			isFirst = false;
+		}
+		void writeThreadName(std::ostream& out, bool& isFirst, const std::string_view name, const uint32_t pid, const uint32_t tid) const {
+			out << (isFirst ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid << ",\"args\":{\"name\":\"";
+			writeEscaped(out, name);
+			out << "\"}}";
+			isFirst = false;
+		}
+
+	public:
+		FrameProfiler(const FrameProfiler&) = delete;
+		FrameProfiler(FrameProfiler&&)      = delete;
+
+		static FrameProfiler& get() {
+			static FrameProfiler profiler;
+			return profiler;
+		}
+
+		static uint64_t now() {
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+		}
+
+		bool isRecording() const {
+			return isRecording_.load(std::memory_order_relaxed);
+		}
+		uint64_t getFrame() const {
+			return frame_.load(std::memory_order_relaxed);
+		}
+
+		// Records the next frameCount frames, dropping the previous capture
+		void capture(const uint32_t frameCount) {
+			std::lock_guard lock(mutex_);
+			for (std::unique_ptr<ThreadBuffer>& thread : threads_) {
+				std::lock_guard threadLock(thread->mutex);
+				thread->events.clear();
+			}
+			for (GpuTrack& track : gpuTracks_) track.events.clear();
+			frameStarts_.clear();
+
+			requestedFrames_ = frameCount;
+			firstFrame_      = 0;
+			lastFrame_       = 0;
+		}
+
+		// Call once per frame, before anything of the frame is recorded. Captures start and stop here.
+		void beginFrame() {
+			const uint64_t frame = frame_.fetch_add(1, std::memory_order_relaxed) + 1;
+			const uint64_t time  = now();
+
+			std::lock_guard lock(mutex_);
+			if (requestedFrames_ > 0 && !isRecording()) {
+				firstFrame_   = frame;
+				lastFrame_    = frame + requestedFrames_;
+				captureStart_ = time;
+				isRecording_.store(true, std::memory_order_relaxed);
+			}
+			if (!isRecording()) return;
+
+			if (frame == lastFrame_) {
+				requestedFrames_ = 0;
+				isRecording_.store(false, std::memory_order_relaxed);
+			}
+			frameStarts_.push_back({ frame, time });
+		}
+
+		// Copy of a name that is not a literal, kept until the profiler is destroyed
+		const char* intern(const std::string_view name) {
+			std::lock_guard lock(mutex_);
+			return names_.emplace(name).first->c_str();
+		}
+
+		void setThreadName(const std::string_view name) {
+			ThreadBuffer& buffer = getThreadBuffer();
+			std::lock_guard lock(buffer.mutex);
+			buffer.name = name;
+		}
+
+		// Scope bookkeeping, ProfileScope calls these
+		uint32_t pushScope() {
+			return getThreadBuffer().depth++;
+		}
+		void popScope(const char* name, const uint64_t begin, const uint32_t depth) {
+			ThreadBuffer& buffer = getThreadBuffer();
+			buffer.depth = depth;
+
+			std::lock_guard lock(buffer.mutex);
+			buffer.events.push_back({ name, begin, now(), getFrame(), depth });
+		}
+
+		// GPU timings arrive frames after they were recorded, they are kept when their frame was captured.
+		// Times are already on the steady clock.
+		void addGpuEvent(const std::string_view track, const char* name, const uint64_t begin, const uint64_t end, const uint64_t frame, const uint32_t depth) {
+			std::lock_guard lock(mutex_);
+			if (firstFrame_ == 0 || frame < firstFrame_ || frame >= lastFrame_) return;
+
+			auto it = std::find_if(gpuTracks_.begin(), gpuTracks_.end(), [track](const GpuTrack& gpuTrack) { return gpuTrack.name == track; });
+			if (it == gpuTracks_.end()) {
+				gpuTracks_.push_back({ std::string(track), {} });
+				it = gpuTracks_.end() - 1;
+			}
+			it->events.push_back({ name, begin, end, frame, depth });
+		}
+
+		// CPU threads are one process, GPU queues another, frame starts are global instant events
+		void writeChromeTrace(std::ostream& out) {
+			std::lock_guard lock(mutex_);
+
+			const std::ios::fmtflags flags     = out.flags();
+			const std::streamsize    precision = out.precision();
+			out << std::dec << std::fixed << std::setprecision(3);
+
+			out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+			bool isFirst = true;
+
+			for (const std::unique_ptr<ThreadBuffer>& thread : threads_) {
+				std::lock_guard threadLock(thread->mutex);
+				writeThreadName(out, isFirst, thread->name.empty() ? "Thread " + std::to_string(thread->id) : thread->name, 1, thread->id);
+				for (const ProfileEvent& event : thread->events) writeEvent(out, isFirst, event, 1, thread->id);
+			}
+			for (uint32_t t = 0; t < gpuTracks_.size(); ++t) {
+				writeThreadName(out, isFirst, gpuTracks_[t].name, 2, t + 1);
+				for (const ProfileEvent& event : gpuTracks_[t].events) writeEvent(out, isFirst, event, 2, t + 1);
+			}
+			for (const auto& [frame, time] : frameStarts_) {
+				out << (isFirst ? "\n" : ",\n") << "{\"name\":\"Frame " << frame << "\",\"ph\":\"i\",\"s\":\"g\",\"ts\":"
+					<< (static_cast<double>(time) - static_cast<double>(captureStart_)) / 1000.0 << ",\"pid\":1,\"tid\":0}";
+				isFirst = false;
+			}
+
+			out << (isFirst ? "" : "\n") << "]}\n";
+
+			out.flags(flags);
+			out.precision(precision);
+		}
+		bool saveChromeTrace(const std::string& path) {
+			std::ofstream file(path, std::ios::binary);
+			if (!file) return false;
+
+			writeChromeTrace(file);
+			return static_cast<bool>(file);
+		}
+
+		FrameProfilerStats getStats() {
+			std::lock_guard lock(mutex_);
+
+			FrameProfilerStats stats;
+			stats.frame       = getFrame();
+			stats.firstFrame  = firstFrame_;
+			stats.lastFrame   = lastFrame_;
+			stats.threadCount = threads_.size();
+			stats.isCapturing = isRecording();
+			for (const std::unique_ptr<ThreadBuffer>& thread : threads_) {
+				std::lock_guard threadLock(thread->mutex);
+				stats.cpuEventCount += thread->events.size();
+			}
+			for (const GpuTrack& track : gpuTracks_) stats.gpuEventCount += track.events.size();
+			return stats;
+		}
+
+		FrameProfiler& operator=(const FrameProfiler&) = delete;
+		FrameProfiler& operator=(FrameProfiler&&)      = delete;
+	};
+
+	// Times its lifetime on the calling thread while a capture is recording
+	class ProfileScope {
+	private:
+		const char* name_  = nullptr;
+		uint64_t    begin_ = 0;
+		uint32_t    depth_ = 0;
+
+	public:
+		struct Dynamic {};
+
+		ProfileScope(const char* name) {
+			FrameProfiler& profiler = FrameProfiler::get();
+			if (!profiler.isRecording()) return;
+
+			name_  = name;
+			depth_ = profiler.pushScope();
+			begin_ = FrameProfiler::now();
+		}
+		// Names built at runtime are only copied while recording
+		ProfileScope(Dynamic, const std::string_view name) {
+			FrameProfiler& profiler = FrameProfiler::get();
+			if (!profiler.isRecording()) return;
+
+			name_  = profiler.intern(name);
+			depth_ = profiler.pushScope();
+			begin_ = FrameProfiler::now();
+		}
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope(ProfileScope&&)      = delete;
+
+		~ProfileScope() {
+			if (name_) FrameProfiler::get().popScope(name_, begin_, depth_);
+		}
+
+		ProfileScope& operator=(const ProfileScope&) = delete;
+		ProfileScope& operator=(ProfileScope&&)      = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,247 @@
+#pragma once
+#include <vector>
+#include <bit>
+#include <chrono>
+#include <execution>
+#include <immintrin.h>
+#include <DirectXMath.h>
+
+#include "types.hpp"
+
+namespace spider_engine::rendering {
+	struct Frustum {
+		// left, right, bottom, top, near, far (normals point inwards)
+		DirectX::XMFLOAT4 planes[6];
+
+		static Frustum fromViewProjection(DirectX::FXMMATRIX viewProjection) {
+			// Columns of the row-vector matrix are the rows of its transpose
+			DirectX::XMMATRIX m = DirectX::XMMatrixTranspose(viewProjection);
+
+			DirectX::XMVECTOR planes[6] = {
+				DirectX::XMVectorAdd(m.r[3], m.r[0]),
+				DirectX::XMVectorSubtract(m.r[3], m.r[0]),
+				DirectX::XMVectorAdd(m.r[3], m.r[1]),
+				DirectX::XMVectorSubtract(m.r[3], m.r[1]),
+				m.r[2],
+				DirectX::XMVectorSubtract(m.r[3], m.r[2]),
+			};
+
+			Frustum frustum;
+			for (int i = 0; i < 6; ++i) {
+				DirectX::XMStoreFloat4(&frustum.planes[i], DirectX::XMPlaneNormalize(planes[i]));
+			}
+			return frustum;
+		}
+
+		bool intersects(const BoundingVolume& bounds) const {
+			for (const auto& plane : planes) {
+				const float distance = plane.x * bounds.center.x + plane.y * bounds.center.y + plane.z * bounds.center.z + plane.w;
+				const float radius   = std::fabs(plane.x) * bounds.extents.x + std::fabs(plane.y) * bounds.extents.y + std::fabs(plane.z) * bounds.extents.z;
+				if (distance + radius < 0.0f) return false;
+			}
+			return true;
+		}
+	};
+
+	struct CullingStats {
+		size_t tested  = 0;
+		size_t visible = 0;
+		double cullMilliseconds = 0.0;
+	};
+
+	class FrustumCuller {
+	private:
+		static constexpr size_t laneCount_ = 8;
+		static constexpr size_t chunkSize_ = 16384;
+
+		// Structure of arrays, padded to a multiple of the lane count
+		std::vector<float> centerX_;
+		std::vector<float> centerY_;
+		std::vector<float> centerZ_;
+		std::vector<float> extentX_;
+		std::vector<float> extentY_;
+		std::vector<float> extentZ_;
+
+		size_t count_;
+
+		std::vector<std::vector<uint32_t>> chunkVisible_;
+		std::vector<uint32_t>              visible_;
+
+		CullingStats stats_;
+
+		void cullChunk(const Frustum& frustum,
+					   const size_t   begin,
+					   const size_t   end,
+					   std::vector<uint32_t>& out) const
+		{
+			out.clear();
+
+#if defined(__AVX__)
+			__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+			__m256 absX[6], absY[6], absZ[6];
+			for (int p = 0; p < 6; ++p) {
+				const DirectX::XMFLOAT4& plane = frustum.planes[p];
+				planeX[p] = _mm256_set1_ps(plane.x);
+				planeY[p] = _mm256_set1_ps(plane.y);
+				planeZ[p] = _mm256_set1_ps(plane.z);
+				planeW[p] = _mm256_set1_ps(plane.w);
+				absX[p]   = _mm256_set1_ps(std::fabs(plane.x));
+				absY[p]   = _mm256_set1_ps(std::fabs(plane.y));
+				absZ[p]   = _mm256_set1_ps(std::fabs(plane.z));
+			}
+			const __m256 zero = _mm256_setzero_ps();
+
+			for (size_t i = begin; i < end; i += laneCount_) {
+				const __m256 cx = _mm256_loadu_ps(&centerX_[i]);
+				const __m256 cy = _mm256_loadu_ps(&centerY_[i]);
+				const __m256 cz = _mm256_loadu_ps(&centerZ_[i]);
+				const __m256 ex = _mm256_loadu_ps(&extentX_[i]);
+				const __m256 ey = _mm256_loadu_ps(&extentY_[i]);
+				const __m256 ez = _mm256_loadu_ps(&extentZ_[i]);
+
+				// A box is outside when it lies completely behind any plane
+				__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+				for (int p = 0; p < 6; ++p) {
+					__m256 distance = _mm256_add_ps(_mm256_mul_ps(planeX[p], cx), planeW[p]);
+					distance        = _mm256_add_ps(_mm256_mul_ps(planeY[p], cy), distance);
+					distance        = _mm256_add_ps(_mm256_mul_ps(planeZ[p], cz), distance);
+
+					__m256 radius = _mm256_mul_ps(absX[p], ex);
+					radius        = _mm256_add_ps(_mm256_mul_ps(absY[p], ey), radius);
+					radius        = _mm256_add_ps(_mm256_mul_ps(absZ[p], ez), radius);
+
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+				}
+
+				uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+				while (mask) {
+					const uint32_t lane  = static_cast<uint32_t>(std::countr_zero(mask));
+					const size_t   index = i + lane;
+					if (index < count_) out.push_back(static_cast<uint32_t>(index));
+					mask &= mask - 1;
+				}
+			}
+#else
+			for (size_t i = begin; i < end && i < count_; ++i) {
+				BoundingVolume bounds;
+				bounds.center  = { centerX_[i], centerY_[i], centerZ_[i] };
+				bounds.extents = { extentX_[i], extentY_[i], extentZ_[i] };
+				if (frustum.intersects(bounds)) out.push_back(static_cast<uint32_t>(i));
+			}
+#endif
+		}
+
+	public:
+		FrustumCuller() :
+			count_(0)
+		{}
+		FrustumCuller(const FrustumCuller&)     = default;
+		FrustumCuller(FrustumCuller&&) noexcept = default;
+
+		void reserve(const size_t count) {
+			const size_t padded = (count + laneCount_ - 1) / laneCount_ * laneCount_;
+			centerX_.reserve(padded);
+			centerY_.reserve(padded);
+			centerZ_.reserve(padded);
+			extentX_.reserve(padded);
+			extentY_.reserve(padded);
+			extentZ_.reserve(padded);
+		}
+
+		void clear() {
+			centerX_.clear();
+			centerY_.clear();
+			centerZ_.clear();
+			extentX_.clear();
+			extentY_.clear();
+			extentZ_.clear();
+			count_ = 0;
+		}
+
+		// Bounds must already be in world space, returns the index reported on the visibility list
+		uint32_t add(const BoundingVolume& bounds) {
+			// Overwrite padding slots before growing
+			if (count_ < centerX_.size()) {
+				centerX_[count_] = bounds.center.x;
+				centerY_[count_] = bounds.center.y;
+				centerZ_[count_] = bounds.center.z;
+				extentX_[count_] = bounds.extents.x;
+				extentY_[count_] = bounds.extents.y;
+				extentZ_[count_] = bounds.extents.z;
+			}
+			else {
+				centerX_.push_back(bounds.center.x);
+				centerY_.push_back(bounds.center.y);
+				centerZ_.push_back(bounds.center.z);
+				extentX_.push_back(bounds.extents.x);
+				extentY_.push_back(bounds.extents.y);
+				extentZ_.push_back(bounds.extents.z);
+			}
+			return static_cast<uint32_t>(count_++);
+		}
+		void set(const uint32_t index, const BoundingVolume& bounds) {
+			centerX_[index] = bounds.center.x;
+			centerY_[index] = bounds.center.y;
+			centerZ_[index] = bounds.center.z;
+			extentX_[index] = bounds.extents.x;
+			extentY_[index] = bounds.extents.y;
+			extentZ_[index] = bounds.extents.z;
+		}
+
+		const std::vector<uint32_t>& cull(const Frustum& frustum) {
+			auto start = std::chrono::steady_clock::now();
+
+			// Pad to a whole number of lanes so the kernel never reads past the end
+			const size_t padded = (count_ + laneCount_ - 1) / laneCount_ * laneCount_;
+			centerX_.resize(padded, 0.0f);
+			centerY_.resize(padded, 0.0f);
+			centerZ_.resize(padded, 0.0f);
+			extentX_.resize(padded, 0.0f);
+			extentY_.resize(padded, 0.0f);
+			extentZ_.resize(padded, 0.0f);
+
+			// Cull chunks in parallel, each chunk keeps its own output list
+			const size_t chunkCount = (padded + chunkSize_ - 1) / chunkSize_;
+			chunkVisible_.resize(chunkCount);
+
+			std::for_each(
+				std::execution::par,
+				chunkVisible_.begin(),
+				chunkVisible_.end(),
+				[this, &frustum, padded](std::vector<uint32_t>& out) {
+					const size_t chunk = static_cast<size_t>(&out - chunkVisible_.data());
+					const size_t begin = chunk * chunkSize_;
+					const size_t end   = std::min(begin + chunkSize_, padded);
+					cullChunk(frustum, begin, end, out);
+				}
+			);
+
+			// Concatenate in chunk order so the list stays sorted
+			visible_.clear();
+			for (const auto& out : chunkVisible_) {
+				visible_.insert(visible_.end(), out.begin(), out.end());
+			}
+
+			auto finish = std::chrono::steady_clock::now();
+
+			stats_.tested           = count_;
+			stats_.visible          = visible_.size();
+			stats_.cullMilliseconds = std::chrono::duration<double, std::milli>(finish - start).count();
+
+			return visible_;
+		}
+
+		const std::vector<uint32_t>& getVisible() const {
+			return visible_;
+		}
+		size_t getCount() const {
+			return count_;
+		}
+		const CullingStats& getStats() const {
+			return stats_;
+		}
+
+		FrustumCuller& operator=(const FrustumCuller&)     = default;
+		FrustumCuller& operator=(FrustumCuller&&) noexcept = default;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,319 @@
+#pragma once
+#include <mutex>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <d3d12.h>
+#include <wrl/client.h>
+
+#include "d3dx12.h"
+#include "definitions.hpp"
+#include "offset_allocator.hpp"
+
+namespace spider_engine::d3dx12 {
+	class GeometryBuffer;
+
+	enum class GeometryKind : uint8_t {
+		VERTEX,
+		INDEX
+	};
+
+	// A mesh's slice of one of the shared geometry buffers, in elements of its pool.
+	// Returned to the buffer when destroyed, once the frames that may still read it are done.
+	class GeometryRange {
+	private:
+		std::weak_ptr<GeometryBuffer> owner_;
+
+		uint32_t         pool_ = 0;
+		uint32_t         page_ = 0;
+		OffsetAllocation allocation_;
+
+		friend class GeometryBuffer;
+
+		void release();
+
+	public:
+		GeometryRange() = default;
+		GeometryRange(const GeometryRange&) = delete;
+		GeometryRange(GeometryRange&& other) noexcept :
+			owner_(std::move(other.owner_)),
+			pool_(other.pool_),
+			page_(other.page_),
+			allocation_(std::exchange(other.allocation_, {}))
+		{}
+		~GeometryRange() {
+			release();
+		}
+
+		bool isValid() const {
+			return allocation_.isValid();
+		}
+
+		// Base vertex or start index of the range inside its buffer
+		uint32_t getOffset() const {
+			return static_cast<uint32_t>(allocation_.offset);
+		}
+		uint32_t getCount() const {
+			return static_cast<uint32_t>(allocation_.size);
+		}
+
+		// Ranges with the same pool and page are drawn without rebinding
+		uint32_t getPool() const {
+			return pool_;
+		}
+		uint32_t getPage() const {
+			return page_;
+		}
+
+		GeometryRange& operator=(const GeometryRange&) = delete;
+		GeometryRange& operator=(GeometryRange&& other) noexcept {
+			if (this != &other) {
+				release();
+				owner_      = std::move(other.owner_);
+				pool_       = other.pool_;
+				page_       = other.page_;
+				allocation_ = std::exchange(other.allocation_, {});
+			}
+			return *this;
+		}
+	};
+
+	// Sizes are in bytes, summed over every page of every pool
+	struct GeometryBufferStats {
+		size_t               pageCount = 0;
+		OffsetAllocatorStats vertices;
+		OffsetAllocatorStats indices;
+		size_t               pendingReleases = 0; // Freed ranges waiting for the GPU
+		uint64_t             uploadedBytes   = 0; // Written since creation
+	};
+
+	// Static geometry of every mesh sub-allocated out of a few large buffers, one pool per vertex stride
+	// and index size. Pages stay mapped on the upload heap like the per mesh buffers they replace, and new
+	// pages are only added when no existing one has room.
+	class GeometryBuffer : public std::enable_shared_from_this<GeometryBuffer> {
+	private:
+		template <typename Ty>
+		using ComPtr = Microsoft::WRL::ComPtr<Ty>;
+
+		struct Page {
+			ComPtr<ID3D12Resource> resource;
+			uint8_t*               mapped;
+			OffsetAllocator        allocator;
+
+			D3D12_VERTEX_BUFFER_VIEW vertexView;
+			D3D12_INDEX_BUFFER_VIEW  indexView;
+		};
+
+		struct Pool {
+			GeometryKind kind;
+			uint32_t     stride;
+
+			std::vector<std::unique_ptr<Page>> pages; // Stable addresses, views are handed out
+		};
+
+		struct Retired {
+			uint32_t         pool;
+			uint32_t         page;
+			OffsetAllocation allocation;
+			uint64_t         frame;
+		};
+
+		ID3D12Device* device_;
+
+		uint64_t pageBytes_;
+		uint64_t frameLatency_;
+		uint64_t frame_         = 0;
+		uint64_t uploadedBytes_ = 0;
+
+		std::mutex           mutex_;
+		std::vector<Pool>    pools_;
+		std::vector<Retired> retired_;
+
+		friend class GeometryRange;
+
+		uint32_t findPool(const GeometryKind kind, const uint32_t stride) {
+			for (uint32_t p = 0; p < pools_.size(); ++p) {
+				if (pools_[p].kind == kind && pools_[p].stride == stride) return p;
+			}
+			pools_.push_back({ kind, stride, {} });
+			return static_cast<uint32_t>(pools_.size() - 1);
+		}
+
+		Page& addPage(Pool& pool, const uint64_t minimumCount) {
+			const uint64_t count = std::max(pageBytes_ / pool.stride, minimumCount);
+			const uint64_t bytes = count * pool.stride;
+			if (bytes > UINT32_MAX) {
+				throw std::runtime_error("Geometry larger than a buffer view can address");
+			}
+
+			auto page       = std::make_unique<Page>();
+			page->allocator = OffsetAllocator(count);
+
+			CD3DX12_HEAP_PROPERTIES heapProps(D3D12_HEAP_TYPE_UPLOAD);
+			CD3DX12_RESOURCE_DESC   resDesc = CD3DX12_RESOURCE_DESC::Buffer(bytes);
+			SPIDER_DX12_ERROR_CHECK(
+				device_->CreateCommittedResource(
+					&heapProps,
+					D3D12_HEAP_FLAG_NONE,
+					&resDesc,
+					D3D12_RESOURCE_STATE_GENERIC_READ,
+					nullptr,
+					IID_PPV_ARGS(&page->resource)
+				)
+			);
+
+			// Upload heap pages stay mapped for their whole life
+			CD3DX12_RANGE readRange(0, 0);
+			page->resource->Map(0, &readRange, reinterpret_cast<void**>(&page->mapped));
+
+			const D3D12_GPU_VIRTUAL_ADDRESS address = page->resource->GetGPUVirtualAddress();
+			page->vertexView.BufferLocation = address;
+			page->vertexView.StrideInBytes  = pool.stride;
+			page->vertexView.SizeInBytes    = static_cast<UINT>(bytes);
+			page->indexView.BufferLocation  = address;
+			page->indexView.Format          = pool.stride == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+			page->indexView.SizeInBytes     = static_cast<UINT>(bytes);
+
+			SPIDER_DBG_CODE(page->resource->SetName(pool.kind == GeometryKind::VERTEX ? L"GeometryVertexPage" : L"GeometryIndexPage"));
+
+			pool.pages.push_back(std::move(page));
+			return *pool.pages.back();
+		}
+
+		GeometryRange allocate(const GeometryKind kind, const void* data, const size_t count, const uint32_t stride) {
+			GeometryRange range;
+			if (count == 0) return range;
+
+			uint8_t* destination;
+			{
+				std::lock_guard lock(mutex_);
+
+				range.owner_ = weak_from_this();
+				range.pool_  = findPool(kind, stride);
+				Pool& pool   = pools_[range.pool_];
+
+				// First page with room, so geometry packs into as few bindings as possible
+				for (uint32_t p = 0; p < pool.pages.size() && !range.allocation_.isValid(); ++p) {
+					range.allocation_ = pool.pages[p]->allocator.allocate(count);
+					range.page_       = p;
+				}
+				if (!range.allocation_.isValid()) {
+					Page& page        = addPage(pool, count);
+					range.allocation_ = page.allocator.allocate(count);
+					range.page_       = static_cast<uint32_t>(pool.pages.size() - 1);
+				}
+
+				destination     = pool.pages[range.page_]->mapped + range.allocation_.offset * stride;
+				uploadedBytes_ += static_cast<uint64_t>(count) * stride;
+			}
+
+			// Ranges never overlap, so the copy does not need the lock
+			std::memcpy(destination, data, count * stride);
+
+			return range;
+		}
+
+		void retire(GeometryRange& range) {
+			std::lock_guard lock(mutex_);
+			retired_.push_back({ range.pool_, range.page_, range.allocation_, frame_ });
+		}
+
+	public:
+		// Frame latency is the number of frames in flight, ranges are reused only after it has passed
+		GeometryBuffer(ID3D12Device*  device,
+					   const uint64_t frameLatency,
+					   const uint64_t pageBytes = 64ull << 20) :
+			device_(device),
+			pageBytes_(pageBytes),
+			frameLatency_(frameLatency)
+		{}
+		GeometryBuffer(const GeometryBuffer&) = delete;
+		GeometryBuffer(GeometryBuffer&&)      = delete;
+
+		~GeometryBuffer() {
+			for (Pool& pool : pools_) {
+				for (auto& page : pool.pages) page->resource->Unmap(0, nullptr);
+			}
+		}
+
+		// Thread safe, asset loader workers create meshes concurrently
+		GeometryRange allocateVertices(const void* vertices, const size_t count, const uint32_t stride) {
+			return allocate(GeometryKind::VERTEX, vertices, count, stride);
+		}
+		GeometryRange allocateIndices(const uint16_t* indices, const size_t count) {
+			return allocate(GeometryKind::INDEX, indices, count, sizeof(uint16_t));
+		}
+		GeometryRange allocateIndices(const uint32_t* indices, const size_t count) {
+			return allocate(GeometryKind::INDEX, indices, count, sizeof(uint32_t));
+		}
+
+		// Call once per frame after waiting for its fence, returns the ranges no frame in flight can still read
+		void beginFrame() {
+			std::lock_guard lock(mutex_);
+			++frame_;
+
+			auto done = std::partition(retired_.begin(), retired_.end(), [this](const Retired& retired) {
+				return frame_ - retired.frame <= frameLatency_;
+			});
+			for (auto it = done; it != retired_.end(); ++it) {
+				pools_[it->pool].pages[it->page]->allocator.free(it->allocation);
+			}
+			retired_.erase(done, retired_.end());
+		}
+
+		// Views cover the whole page, draws add the range offset as base vertex / start index
+		const D3D12_VERTEX_BUFFER_VIEW& getVertexView(const GeometryRange& range) {
+			std::lock_guard lock(mutex_);
+			return pools_[range.pool_].pages[range.page_]->vertexView;
+		}
+		const D3D12_INDEX_BUFFER_VIEW& getIndexView(const GeometryRange& range) {
+			std::lock_guard lock(mutex_);
+			return pools_[range.pool_].pages[range.page_]->indexView;
+		}
+
+		GeometryBufferStats getStats() {
+			std::lock_guard lock(mutex_);
+
+			GeometryBufferStats stats;
+			stats.pendingReleases = retired_.size();
+			stats.uploadedBytes   = uploadedBytes_;
+
+			for (const Pool& pool : pools_) {
+				OffsetAllocatorStats& total = pool.kind == GeometryKind::VERTEX ? stats.vertices : stats.indices;
+
+				for (const auto& page : pool.pages) {
+					OffsetAllocatorStats bytes = page->allocator.getStats();
+					bytes.capacity         *= pool.stride;
+					bytes.used             *= pool.stride;
+					bytes.largestFreeBlock *= pool.stride;
+
+					total += bytes;
+					++stats.pageCount;
+				}
+			}
+			return stats;
+		}
+
+		uint64_t getUploadedBytes() {
+			std::lock_guard lock(mutex_);
+			return uploadedBytes_;
+		}
+
+		GeometryBuffer& operator=(const GeometryBuffer&) = delete;
+		GeometryBuffer& operator=(GeometryBuffer&&)      = delete;
+	};
+
+	inline void GeometryRange::release() {
+		if (!allocation_.isValid()) return;
+
+		// The buffer may already be gone when meshes outlive the renderer, its memory went with it
+		if (std::shared_ptr<GeometryBuffer> owner = owner_.lock()) owner->retire(*this);
+
+		allocation_ = {};
+		owner_.reset();
+	}
+}
\ No newline at end of file
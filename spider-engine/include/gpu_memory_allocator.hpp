@@ -0,0 +1,389 @@
+#pragma once
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+#include <d3d12.h>
+#include <dxgi1_6.h>
+#include <wrl/client.h>
+
+#include "d3dx12.h"
+#include "definitions.hpp"
+#include "tlsf_allocator.hpp"
+
+namespace spider_engine::d3dx12 {
+	// Resources of a category share heaps, heap flags keep them apart so resource heap tier 1 works too
+	enum class GpuMemoryCategory : uint8_t {
+		BUFFER,        // Default heap buffers
+		TEXTURE,       // Sampled textures, no render target or depth stencil
+		RENDER_TARGET, // Render targets and depth stencils, cleared or discarded before first use
+		UPLOAD,        // Upload heap buffers, staging and constant data
+		COUNT
+	};
+
+	struct GpuMemoryCategoryStats {
+		size_t               heapCount      = 0;
+		OffsetAllocatorStats heaps;              // Bytes of every heap of the category
+		size_t               placedCount    = 0;
+		size_t               smallCount     = 0; // Placed at the 4 KB small resource alignment
+		size_t               committedCount = 0; // Too large for a heap, they got their own
+		uint64_t             committedBytes = 0;
+
+		uint64_t getResidentBytes() const {
+			return heaps.capacity + committedBytes;
+		}
+	};
+
+	struct GpuMemoryStats {
+		std::array<GpuMemoryCategoryStats, static_cast<size_t>(GpuMemoryCategory::COUNT)> categories;
+		size_t                                                                          pendingReleases = 0; // Freed blocks waiting for the GPU
+
+		// What the OS lets the process use, zero when the adapter could not be queried
+		DXGI_QUERY_VIDEO_MEMORY_INFO local    = {};
+		DXGI_QUERY_VIDEO_MEMORY_INFO nonLocal = {};
+
+		const GpuMemoryCategoryStats& operator[](const GpuMemoryCategory category) const {
+			return categories[static_cast<size_t>(category)];
+		}
+
+		bool isOverBudget() const {
+			return local.CurrentUsage > local.Budget || nonLocal.CurrentUsage > nonLocal.Budget;
+		}
+	};
+
+	class GpuMemoryAllocator;
+
+	// Rides on a resource as private data, D3D12 releases it when the resource is destroyed and the
+	// block goes back to its heap. Holds the heap so it outlives every resource placed in it.
+	class GpuMemoryBlock final : public IUnknown {
+	private:
+		std::atomic<ULONG> references_ = 1;
+
+		std::weak_ptr<GpuMemoryAllocator>  owner_;
+		Microsoft::WRL::ComPtr<ID3D12Heap> heap_;
+
+		GpuMemoryCategory category_;
+		uint32_t          heapIndex_;
+		TlsfAllocation    allocation_; // Invalid for committed resources
+		uint64_t          bytes_;
+		bool              isSmall_;
+
+		friend class GpuMemoryAllocator;
+
+		void release();
+
+	public:
+		// {6F3E2A1C-5B47-4D89-9C1E-2B8D7A4F5E63}
+		static constexpr GUID guid = { 0x6f3e2a1c, 0x5b47, 0x4d89, { 0x9c, 0x1e, 0x2b, 0x8d, 0x7a, 0x4f, 0x5e, 0x63 } };
+
+		GpuMemoryBlock(std::weak_ptr<GpuMemoryAllocator> owner,
+					   ID3D12Heap*                       heap,
+					   const GpuMemoryCategory           category,
+					   const uint32_t                    heapIndex,
+					   const TlsfAllocation&             allocation,
+					   const uint64_t                    bytes,
+					   const bool                        isSmall) :
+			owner_(std::move(owner)),
+			heap_(heap),
+			category_(category),
+			heapIndex_(heapIndex),
+			allocation_(allocation),
+			bytes_(bytes),
+			isSmall_(isSmall)
+		{}
+		GpuMemoryBlock(const GpuMemoryBlock&) = delete;
+		GpuMemoryBlock(GpuMemoryBlock&&)      = delete;
+
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID id, void** object) override {
+			if (!object) return E_POINTER;
+			if (id == __uuidof(IUnknown) || id == guid) {
+				*object = this;
+				AddRef();
+				return S_OK;
+			}
+			*object = nullptr;
+			return E_NOINTERFACE;
+		}
+		ULONG STDMETHODCALLTYPE AddRef() override {
+			return ++references_;
+		}
+		ULONG STDMETHODCALLTYPE Release() override {
+			const ULONG references = --references_;
+			if (references == 0) {
+				release();
+				delete this;
+			}
+			return references;
+		}
+
+		GpuMemoryBlock& operator=(const GpuMemoryBlock&) = delete;
+		GpuMemoryBlock& operator=(GpuMemoryBlock&&)      = delete;
+	};
+
+	// Creates resources as placed resources in a few large heaps per category instead of one committed
+	// resource (and one implicit heap) each. Blocks are sub-allocated with a TLSF allocator at a 4 KB
+	// granularity, so textures small enough for D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT only pay 4 KB
+	// alignment instead of 64 KB. Resources larger than half a heap stay committed. A block is freed when
+	// its resource is destroyed, then reused once the frames that may still read it are done.
+	class GpuMemoryAllocator : public std::enable_shared_from_this<GpuMemoryAllocator> {
+	private:
+		template <typename Ty>
+		using ComPtr = Microsoft::WRL::ComPtr<Ty>;
+
+		static constexpr size_t   categoryCount = static_cast<size_t>(GpuMemoryCategory::COUNT);
+		static constexpr uint64_t granularity   = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+
+		struct Heap {
+			ComPtr<ID3D12Heap> heap;
+			TlsfAllocator      allocator;
+		};
+
+		struct Category {
+			std::vector<std::unique_ptr<Heap>> heaps;          // Null where an empty heap was released
+			size_t                             placedCount    = 0;
+			size_t                             smallCount     = 0;
+			size_t                             committedCount = 0;
+			uint64_t                           committedBytes = 0;
+		};
+
+		struct Retired {
+			GpuMemoryCategory category;
+			uint32_t          heap;
+			TlsfAllocation    allocation;
+			uint64_t          frame;
+		};
+
+		ID3D12Device*         device_;
+		ComPtr<IDXGIAdapter3> adapter_;
+
+		uint64_t heapBytes_;
+		uint64_t frameLatency_;
+		uint64_t frame_ = 0;
+
+		std::mutex                          mutex_;
+		std::array<Category, categoryCount> categories_;
+		std::vector<Retired>                retired_;
+
+		friend class GpuMemoryBlock;
+
+		static D3D12_HEAP_TYPE getHeapType(const GpuMemoryCategory category) {
+			return category == GpuMemoryCategory::UPLOAD ? D3D12_HEAP_TYPE_UPLOAD : D3D12_HEAP_TYPE_DEFAULT;
+		}
+		static D3D12_HEAP_FLAGS getHeapFlags(const GpuMemoryCategory category) {
+			switch (category) {
+				case GpuMemoryCategory::TEXTURE:       return D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+				case GpuMemoryCategory::RENDER_TARGET: return D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+				default:                               return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+			}
+		}
+
+		// Small resource alignment is only granted to textures that are not render targets, depth stencils
+		// or multisampled, and only when the whole resource fits in 64 KB; the device says which.
+		D3D12_RESOURCE_ALLOCATION_INFO getAllocationInfo(D3D12_RESOURCE_DESC& desc) const {
+			const bool isSmallCandidate = desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER &&
+										  desc.SampleDesc.Count == 1 &&
+										  !(desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL));
+			if (isSmallCandidate) {
+				desc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+				D3D12_RESOURCE_ALLOCATION_INFO info = device_->GetResourceAllocationInfo(0, 1, &desc);
+				if (info.Alignment == D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) return info;
+			}
+
+			desc.Alignment = 0;
+			D3D12_RESOURCE_ALLOCATION_INFO info = device_->GetResourceAllocationInfo(0, 1, &desc);
+			if (info.SizeInBytes == UINT64_MAX) {
+				throw std::runtime_error("Invalid resource description");
+			}
+			return info;
+		}
+
+		Heap& addHeap(const GpuMemoryCategory category, uint32_t& index) {
+			Category& pool = categories_[static_cast<size_t>(category)];
+
+			auto heap = std::make_unique<Heap>();
+			heap->allocator.reset(heapBytes_, granularity);
+
+			const uint64_t  alignment = category == GpuMemoryCategory::RENDER_TARGET ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+			CD3DX12_HEAP_DESC heapDesc(heapBytes_, getHeapType(category), alignment, getHeapFlags(category));
+			SPIDER_DX12_ERROR_CHECK(device_->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap->heap)));
+
+			SPIDER_DBG_CODE(heap->heap->SetName(L"GpuMemoryHeap"));
+
+			// Reuse the slot of a released heap
+			auto slot = std::find(pool.heaps.begin(), pool.heaps.end(), nullptr);
+			if (slot == pool.heaps.end()) slot = pool.heaps.insert(slot, nullptr);
+
+			*slot = std::move(heap);
+			index = static_cast<uint32_t>(slot - pool.heaps.begin());
+			return **slot;
+		}
+
+		void retire(const GpuMemoryBlock& block) {
+			std::lock_guard lock(mutex_);
+
+			Category& pool = categories_[static_cast<size_t>(block.category_)];
+			if (!block.allocation_.isValid()) {
+				--pool.committedCount;
+				pool.committedBytes -= block.bytes_;
+				return;
+			}
+
+			--pool.placedCount;
+			if (block.isSmall_) --pool.smallCount;
+			retired_.push_back({ block.category_, block.heapIndex_, block.allocation_, frame_ });
+		}
+
+	public:
+		// Frame latency is the number of frames in flight, blocks are reused only after it has passed.
+		// The adapter is only used for budget queries and may be null.
+		GpuMemoryAllocator(ID3D12Device*  device,
+						   IDXGIAdapter*  adapter,
+						   const uint64_t frameLatency,
+						   const uint64_t heapBytes = 64ull << 20) :
+			device_(device),
+			heapBytes_(heapBytes),
+			frameLatency_(frameLatency)
+		{
+			if (adapter) adapter->QueryInterface(IID_PPV_ARGS(&adapter_));
+		}
+		GpuMemoryAllocator(const GpuMemoryAllocator&) = delete;
+		GpuMemoryAllocator(GpuMemoryAllocator&&)      = delete;
+
+		// Thread safe. Textures placed in reused memory are fully overwritten by their upload or copy,
+		// render targets and depth stencils have to be cleared or discarded before their first use.
+		ComPtr<ID3D12Resource> createResource(const GpuMemoryCategory     category,
+											  D3D12_RESOURCE_DESC         desc,
+											  const D3D12_RESOURCE_STATES state,
+											  const D3D12_CLEAR_VALUE*    clearValue = nullptr)
+		{
+			const D3D12_RESOURCE_ALLOCATION_INFO info = getAllocationInfo(desc);
+
+			ComPtr<ID3D12Resource> resource;
+			GpuMemoryBlock*        block;
+			{
+				std::lock_guard lock(mutex_);
+				Category& pool = categories_[static_cast<size_t>(category)];
+
+				if (info.SizeInBytes > heapBytes_ / 2) {
+					CD3DX12_HEAP_PROPERTIES heapProps(getHeapType(category));
+					SPIDER_DX12_ERROR_CHECK(
+						device_->CreateCommittedResource(
+							&heapProps,
+							D3D12_HEAP_FLAG_NONE,
+							&desc,
+							state,
+							clearValue,
+							IID_PPV_ARGS(&resource)
+						)
+					);
+
+					++pool.committedCount;
+					pool.committedBytes += info.SizeInBytes;
+					block = new GpuMemoryBlock(weak_from_this(), nullptr, category, 0, {}, info.SizeInBytes, false);
+				}
+				else {
+					// First heap with room, new heaps only when none has
+					TlsfAllocation allocation;
+					uint32_t       index = 0;
+					for (; index < pool.heaps.size() && !allocation.isValid(); ++index) {
+						if (pool.heaps[index]) allocation = pool.heaps[index]->allocator.allocate(info.SizeInBytes, info.Alignment);
+					}
+					if (allocation.isValid()) --index;
+					else                      allocation = addHeap(category, index).allocator.allocate(info.SizeInBytes, info.Alignment);
+
+					ID3D12Heap*   heap   = pool.heaps[index]->heap.Get();
+					const HRESULT placed = device_->CreatePlacedResource(
+						heap,
+						allocation.offset,
+						&desc,
+						state,
+						clearValue,
+						IID_PPV_ARGS(&resource)
+					);
+
+					// Nothing owns the range yet, so it goes back before the error leaves
+					if (FAILED(placed)) {
+						pool.heaps[index]->allocator.free(allocation);
+						SPIDER_DX12_ERROR_CHECK(placed);
+						return nullptr;
+					}
+
+					const bool isSmall = info.Alignment == D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+					++pool.placedCount;
+					if (isSmall) ++pool.smallCount;
+					block = new GpuMemoryBlock(weak_from_this(), heap, category, index, allocation, allocation.size, isSmall);
+				}
+			}
+
+			// The resource holds the only reference from here on
+			resource->SetPrivateDataInterface(GpuMemoryBlock::guid, block);
+			block->Release();
+
+			return resource;
+		}
+		ComPtr<ID3D12Resource> createBuffer(const GpuMemoryCategory     category,
+											const uint64_t              size,
+											const D3D12_RESOURCE_STATES state,
+											const D3D12_RESOURCE_FLAGS  flags = D3D12_RESOURCE_FLAG_NONE)
+		{
+			return createResource(category, CD3DX12_RESOURCE_DESC::Buffer(size, flags), state);
+		}
+
+		// Call once per frame after waiting for its fence, returns the blocks no frame in flight can still read.
+		// Heaps left empty are released, except the first of each category.
+		void beginFrame() {
+			std::lock_guard lock(mutex_);
+			++frame_;
+
+			auto done = std::partition(retired_.begin(), retired_.end(), [this](const Retired& retired) {
+				return frame_ - retired.frame <= frameLatency_;
+			});
+			for (auto it = done; it != retired_.end(); ++it) {
+				auto& heap = categories_[static_cast<size_t>(it->category)].heaps[it->heap];
+				heap->allocator.free(it->allocation);
+				if (it->heap > 0 && heap->allocator.getUsed() == 0) heap.reset();
+			}
+			retired_.erase(done, retired_.end());
+		}
+
+		GpuMemoryStats getStats() {
+			GpuMemoryStats stats;
+			if (adapter_) {
+				adapter_->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL,     &stats.local);
+				adapter_->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_NON_LOCAL, &stats.nonLocal);
+			}
+
+			std::lock_guard lock(mutex_);
+			stats.pendingReleases = retired_.size();
+
+			for (size_t c = 0; c < categoryCount; ++c) {
+				const Category&         pool  = categories_[c];
+				GpuMemoryCategoryStats& total = stats.categories[c];
+				total.placedCount    = pool.placedCount;
+				total.smallCount     = pool.smallCount;
+				total.committedCount = pool.committedCount;
+				total.committedBytes = pool.committedBytes;
+
+				for (const auto& heap : pool.heaps) {
+					if (!heap) continue;
+
+					total.heaps += heap->allocator.getStats();
+					++total.heapCount;
+				}
+			}
+			return stats;
+		}
+
+		GpuMemoryAllocator& operator=(const GpuMemoryAllocator&) = delete;
+		GpuMemoryAllocator& operator=(GpuMemoryAllocator&&)      = delete;
+	};
+
+	inline void GpuMemoryBlock::release() {
+		// The allocator may already be gone when resources outlive the renderer, the heap goes with the last of them
+		if (std::shared_ptr<GpuMemoryAllocator> owner = owner_.lock()) owner->retire(*this);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,249 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <windows.h>
+#include <d3d12.h>
+#include <wrl/client.h>
+
+#include "d3dx12.h"
+#include "definitions.hpp"
+#include "frame_profiler.hpp"
+
+namespace spider_engine::d3dx12 {
+	struct GpuScopeTiming {
+		const char* name;
+		uint32_t    depth;
+		double      milliseconds;
+	};
+
+	// Timestamp queries around GPU work, one slice of the query heap and readback buffer per frame in
+	// flight. A frame's timestamps are read when its slot comes around again, after the renderer waited
+	// for its fence, so nothing ever stalls on the GPU. Timings of captured frames go to the FrameProfiler
+	// on its clock, through the queue's clock calibration.
+	class GpuProfiler {
+	private:
+		template <typename Ty>
+		using ComPtr = Microsoft::WRL::ComPtr<Ty>;
+
+		struct Scope {
+			const char* name;
+			uint32_t    depth;
+			uint32_t    begin; // Query index within the slot
+			uint32_t    end;
+		};
+
+		struct Slot {
+			std::vector<Scope>    scopes;
+			std::vector<uint32_t> open;      // Scopes begun and not ended yet
+			uint64_t              frame      = 0; // FrameProfiler frame the scopes belong to
+			uint32_t              queryCount = 0;
+			bool                  isResolved = false;
+		};
+
+		ID3D12Device*       device_;
+		ID3D12CommandQueue* queue_;
+		std::string         trackName_;
+
+		ComPtr<ID3D12QueryHeap> queryHeap_;
+		ComPtr<ID3D12Resource>  readback_;
+
+		uint32_t          maxQueries_; // Per slot
+		std::vector<Slot> slots_;
+		uint32_t          current_ = 0;
+
+		uint64_t gpuFrequency_;
+		uint64_t cpuFrequency_;
+
+		std::vector<GpuScopeTiming> lastTimings_;
+		size_t                      droppedScopes_ = 0;
+
+		// Queue ticks to steady clock nanoseconds. The calibration's CPU side is QueryPerformanceCounter,
+		// the same counter MSVC's steady_clock reads.
+		struct Calibration {
+			uint64_t gpu;
+			uint64_t cpuNanoseconds;
+		};
+		Calibration calibrate() const {
+			UINT64 gpuTimestamp, cpuTimestamp;
+			queue_->GetClockCalibration(&gpuTimestamp, &cpuTimestamp);
+			return { gpuTimestamp, static_cast<uint64_t>(static_cast<double>(cpuTimestamp) * 1e9 / static_cast<double>(cpuFrequency_)) };
+		}
+
+		// Timestamps of the slot's last frame, its GPU work is done
+		void collect(Slot& slot) {
+			if (!slot.isResolved) return;
+
+			const Calibration calibration = calibrate();
+			const double      toNanoseconds = 1e9 / static_cast<double>(gpuFrequency_);
+
+			const size_t offset = static_cast<size_t>(current_) * maxQueries_ * sizeof(uint64_t);
+			D3D12_RANGE  range  = { offset, offset + slot.queryCount * sizeof(uint64_t) };
+			uint64_t*    mapped = nullptr;
+			if (FAILED(readback_->Map(0, &range, reinterpret_cast<void**>(&mapped)))) return;
+
+			const uint64_t* timestamps = reinterpret_cast<const uint64_t*>(reinterpret_cast<const uint8_t*>(mapped) + offset);
+
+			FrameProfiler& profiler = FrameProfiler::get();
+			lastTimings_.clear();
+			for (const Scope& scope : slot.scopes) {
+				if (scope.end == ~0u) continue;
+
+				const uint64_t begin = timestamps[scope.begin];
+				const uint64_t end   = std::max(timestamps[scope.end], begin);
+				lastTimings_.push_back({ scope.name, scope.depth, static_cast<double>(end - begin) * toNanoseconds / 1e6 });
+
+				const double beginNanoseconds = static_cast<double>(calibration.cpuNanoseconds) + (static_cast<double>(begin) - static_cast<double>(calibration.gpu)) * toNanoseconds;
+				const double endNanoseconds   = beginNanoseconds + static_cast<double>(end - begin) * toNanoseconds;
+				profiler.addGpuEvent(trackName_, scope.name, static_cast<uint64_t>(beginNanoseconds), static_cast<uint64_t>(endNanoseconds), slot.frame, scope.depth);
+			}
+
+			D3D12_RANGE written = { 0, 0 };
+			readback_->Unmap(0, &written);
+		}
+
+	public:
+		// One slot per frame in flight, each with room for maxScopes scopes
+		GpuProfiler(ID3D12Device*       device,
+					ID3D12CommandQueue* queue,
+					const uint32_t      frameLatency,
+					const uint32_t      maxScopes = 256,
+					const std::string&  trackName = "Direct queue") :
+			device_(device),
+			queue_(queue),
+			trackName_(trackName),
+			maxQueries_(maxScopes * 2),
+			slots_(frameLatency)
+		{
+			D3D12_QUERY_HEAP_DESC heapDesc = {};
+			heapDesc.Type                  = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+			heapDesc.Count                 = maxQueries_ * frameLatency;
+			SPIDER_DX12_ERROR_CHECK(device_->CreateQueryHeap(&heapDesc, IID_PPV_ARGS(&queryHeap_)));
+
+			CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_READBACK);
+			CD3DX12_RESOURCE_DESC   bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(uint64_t(heapDesc.Count) * sizeof(uint64_t));
+			SPIDER_DX12_ERROR_CHECK(
+				device_->CreateCommittedResource(
+					&heapProperties,
+					D3D12_HEAP_FLAG_NONE,
+					&bufferDesc,
+					D3D12_RESOURCE_STATE_COPY_DEST,
+					nullptr,
+					IID_PPV_ARGS(&readback_)
+				)
+			);
+
+			UINT64 gpuFrequency;
+			SPIDER_DX12_ERROR_CHECK(queue_->GetTimestampFrequency(&gpuFrequency));
+			gpuFrequency_ = gpuFrequency;
+
+			LARGE_INTEGER cpuFrequency;
+			QueryPerformanceFrequency(&cpuFrequency);
+			cpuFrequency_ = static_cast<uint64_t>(cpuFrequency.QuadPart);
+
+			SPIDER_DBG_CODE(
+				queryHeap_->SetName(L"GpuProfilerQueries");
+				readback_->SetName(L"GpuProfilerReadback");
+			)
+		}
+		GpuProfiler(const GpuProfiler&) = delete;
+		GpuProfiler(GpuProfiler&&)      = delete;
+
+		// Call after waiting for the slot's fence, before anything of the frame is recorded
+		void beginFrame(const uint32_t slot) {
+			current_ = slot;
+
+			Slot& current = slots_[current_];
+			collect(current);
+
+			current.scopes.clear();
+			current.open.clear();
+			current.queryCount = 0;
+			current.frame      = FrameProfiler::get().getFrame();
+			current.isResolved = false;
+		}
+
+		// Scopes nest, a frame with more than maxScopes drops the rest
+		void begin(ID3D12GraphicsCommandList* commandList, const char* name) {
+			Slot& slot = slots_[current_];
+			if (slot.queryCount + 2 > maxQueries_) {
+				slot.open.push_back(~0u);
+				++droppedScopes_;
+				return;
+			}
+
+			const uint32_t query = slot.queryCount;
+			slot.queryCount += 2; // The end query is reserved now, so every begun scope can end
+			commandList->EndQuery(queryHeap_.Get(), D3D12_QUERY_TYPE_TIMESTAMP, current_ * maxQueries_ + query);
+
+			slot.open.push_back(static_cast<uint32_t>(slot.scopes.size()));
+			slot.scopes.push_back({ name, static_cast<uint32_t>(slot.open.size() - 1), query, ~0u });
+		}
+		void end(ID3D12GraphicsCommandList* commandList) {
+			Slot& slot = slots_[current_];
+			if (slot.open.empty()) return;
+
+			const uint32_t index = slot.open.back();
+			slot.open.pop_back();
+			if (index == ~0u) return;
+
+			Scope& scope = slot.scopes[index];
+			scope.end    = scope.begin + 1;
+			commandList->EndQuery(queryHeap_.Get(), D3D12_QUERY_TYPE_TIMESTAMP, current_ * maxQueries_ + scope.end);
+		}
+
+		// Copies the frame's timestamps to its readback slice, record it last
+		void resolve(ID3D12GraphicsCommandList* commandList) {
+			Slot& slot = slots_[current_];
+			if (slot.queryCount == 0) return;
+
+			const UINT first = current_ * maxQueries_;
+			commandList->ResolveQueryData(queryHeap_.Get(), D3D12_QUERY_TYPE_TIMESTAMP, first, slot.queryCount, readback_.Get(), uint64_t(first) * sizeof(uint64_t));
+			slot.isResolved = true;
+		}
+
+		// Scopes of the last frame read back, frameLatency frames old
+		const std::vector<GpuScopeTiming>& getLastTimings() const {
+			return lastTimings_;
+		}
+		// Sum of the outermost scopes of that frame
+		double getLastFrameMilliseconds() const {
+			double milliseconds = 0.0;
+			for (const GpuScopeTiming& timing : lastTimings_) {
+				if (timing.depth == 0) milliseconds += timing.milliseconds;
+			}
+			return milliseconds;
+		}
+		size_t getDroppedScopes() const {
+			return droppedScopes_;
+		}
+
+		GpuProfiler& operator=(const GpuProfiler&) = delete;
+		GpuProfiler& operator=(GpuProfiler&&)      = delete;
+	};
+
+	// Times a GPU scope on a command list
+	class GpuProfileScope {
+	private:
+		GpuProfiler*               profiler_;
+		ID3D12GraphicsCommandList* commandList_;
+
+	public:
+		GpuProfileScope(GpuProfiler* profiler, ID3D12GraphicsCommandList* commandList, const char* name) :
+			profiler_(profiler),
+			commandList_(commandList)
+		{
+			if (profiler_) profiler_->begin(commandList_, name);
+		}
+		GpuProfileScope(const GpuProfileScope&) = delete;
+		GpuProfileScope(GpuProfileScope&&)      = delete;
+
+		~GpuProfileScope() {
+			if (profiler_) profiler_->end(commandList_);
+		}
+
+		GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+		GpuProfileScope& operator=(GpuProfileScope&&)      = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,380 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <initializer_list>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace spider_engine {
+	enum class InputEventType : uint8_t {
+		KEY_DOWN,          // code is the virtual key, repeats while held are ignored
+		KEY_UP,
+		MOUSE_BUTTON_DOWN, // code is a MouseButton
+		MOUSE_BUTTON_UP,
+		MOUSE_POSITION,    // Client coordinates in x and y
+		MOUSE_MOVE,        // Relative motion in x and y, unaffected by the cursor reaching the screen edge
+		MOUSE_WHEEL,       // Notches times 120 in y, horizontal in x
+		FOCUS_LOST         // Everything held is released
+	};
+
+	enum class MouseButton : uint8_t {
+		LEFT,
+		RIGHT,
+		MIDDLE,
+		X1,
+		X2,
+		COUNT
+	};
+
+	struct InputEvent {
+		InputEventType type;
+		uint8_t        code = 0;
+		int32_t        x    = 0;
+		int32_t        y    = 0;
+	};
+
+	// Input of one frame: what is held at its end and the edges that happened during it. A key pressed and
+	// released within the frame keeps both edges, so short taps are never lost.
+	struct InputState {
+		std::bitset<256> keys;
+		std::bitset<256> pressedKeys;
+		std::bitset<256> releasedKeys;
+
+		uint8_t buttons         = 0; // One bit per MouseButton
+		uint8_t pressedButtons  = 0;
+		uint8_t releasedButtons = 0;
+
+		int32_t mouseX      = 0;
+		int32_t mouseY      = 0;
+		int32_t mouseDeltaX = 0;
+		int32_t mouseDeltaY = 0;
+		int32_t wheel       = 0;
+		int32_t wheelX      = 0;
+
+		bool isKeyDown(const uint8_t key) const {
+			return keys[key];
+		}
+		bool wasKeyPressed(const uint8_t key) const {
+			return pressedKeys[key];
+		}
+		bool wasKeyReleased(const uint8_t key) const {
+			return releasedKeys[key];
+		}
+
+		bool isButtonDown(const MouseButton button) const {
+			return (buttons >> static_cast<uint8_t>(button)) & 1;
+		}
+		bool wasButtonPressed(const MouseButton button) const {
+			return (pressedButtons >> static_cast<uint8_t>(button)) & 1;
+		}
+		bool wasButtonReleased(const MouseButton button) const {
+			return (releasedButtons >> static_cast<uint8_t>(button)) & 1;
+		}
+	};
+
+	struct InputStats {
+		uint64_t events  = 0; // Applied since creation
+		uint64_t dropped = 0; // The ring was full
+		size_t   capacity = 0;
+	};
+
+	// Input events go into a bounded lock-free ring from whatever produces them: the window procedure,
+	// raw input, or a script. The frame consumes them once in update() into an InputState, so queries are
+	// plain bit tests and nothing polls the OS. Any thread may push; one thread calls update().
+	class InputSystem {
+	private:
+		struct Slot {
+			std::atomic<uint64_t> sequence;
+			InputEvent            event;
+		};
+
+		std::unique_ptr<Slot[]> slots_;
+		size_t                  mask_;
+
+		alignas(64) std::atomic<uint64_t> enqueuePosition_ = 0;
+		alignas(64) uint64_t              dequeuePosition_ = 0;
+		std::atomic<uint64_t>             dropped_         = 0;
+		uint64_t                          events_          = 0;
+
+		InputState state_;
+
+		void apply(const InputEvent& event) {
+			switch (event.type) {
+				case InputEventType::KEY_DOWN:
+					if (!state_.keys[event.code]) {
+						state_.keys.set(event.code);
+						state_.pressedKeys.set(event.code);
+					}
+					break;
+				case InputEventType::KEY_UP:
+					if (state_.keys[event.code]) {
+						state_.keys.reset(event.code);
+						state_.releasedKeys.set(event.code);
+					}
+					break;
+				case InputEventType::MOUSE_BUTTON_DOWN: {
+					const uint8_t bit = static_cast<uint8_t>(1u << event.code);
+					if (!(state_.buttons & bit)) state_.pressedButtons |= bit;
+					state_.buttons |= bit;
+					break;
+				}
+				case InputEventType::MOUSE_BUTTON_UP: {
+					const uint8_t bit = static_cast<uint8_t>(1u << event.code);
+					if (state_.buttons & bit) state_.releasedButtons |= bit;
+					state_.buttons &= ~bit;
+					break;
+				}
+				case InputEventType::MOUSE_POSITION:
+					state_.mouseX = event.x;
+					state_.mouseY = event.y;
+					break;
+				case InputEventType::MOUSE_MOVE:
+					state_.mouseDeltaX += event.x;
+					state_.mouseDeltaY += event.y;
+					break;
+				case InputEventType::MOUSE_WHEEL:
+					state_.wheelX += event.x;
+					state_.wheel  += event.y;
+					break;
+				case InputEventType::FOCUS_LOST:
+					state_.releasedKeys    |= state_.keys;
+					state_.releasedButtons |= state_.buttons;
+					state_.keys.reset();
+					state_.buttons = 0;
+					break;
+			}
+		}
+
+	public:
+		// Capacity is rounded up to a power of two
+		explicit InputSystem(const size_t capacity = 1024) {
+			size_t size = 2;
+			while (size < capacity) size *= 2;
+
+			slots_ = std::make_unique<Slot[]>(size);
+			mask_  = size - 1;
+			for (size_t i = 0; i < size; ++i) slots_[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		InputSystem(const InputSystem&) = delete;
+		InputSystem(InputSystem&&)      = delete;
+
+		// False when the ring is full, the event is dropped
+		bool push(const InputEvent& event) {
+			uint64_t position = enqueuePosition_.load(std::memory_order_relaxed);
+			Slot*    slot;
+			while (true) {
+				slot = &slots_[position & mask_];
+
+				const uint64_t sequence   = slot->sequence.load(std::memory_order_acquire);
+				const int64_t  difference = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+				if (difference == 0) {
+					if (enqueuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+				}
+				else if (difference < 0) {
+					dropped_.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+				else {
+					position = enqueuePosition_.load(std::memory_order_relaxed);
+				}
+			}
+
+			slot->event = event;
+			slot->sequence.store(position + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Once per frame, before anything reads the state: edges and deltas restart, then every queued
+		// event is applied in order
+		void update() {
+			state_.pressedKeys.reset();
+			state_.releasedKeys.reset();
+			state_.pressedButtons  = 0;
+			state_.releasedButtons = 0;
+			state_.mouseDeltaX     = 0;
+			state_.mouseDeltaY     = 0;
+			state_.wheel           = 0;
+			state_.wheelX          = 0;
+
+			while (true) {
+				Slot& slot = slots_[dequeuePosition_ & mask_];
+				if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition_ + 1) break;
+
+				apply(slot.event);
+				slot.sequence.store(dequeuePosition_ + mask_ + 1, std::memory_order_release);
+				++dequeuePosition_;
+				++events_;
+			}
+		}
+
+		const InputState& getState() const {
+			return state_;
+		}
+
+		bool isKeyDown(const uint8_t key) const {
+			return state_.isKeyDown(key);
+		}
+		bool wasKeyPressed(const uint8_t key) const {
+			return state_.wasKeyPressed(key);
+		}
+		bool wasKeyReleased(const uint8_t key) const {
+			return state_.wasKeyReleased(key);
+		}
+
+		InputStats getStats() const {
+			InputStats stats;
+			stats.events   = events_;
+			stats.dropped  = dropped_.load(std::memory_order_relaxed);
+			stats.capacity = mask_ + 1;
+			return stats;
+		}
+
+#ifdef _WIN32
+		// Relative mouse motion through WM_INPUT. Keys stay on WM_KEYDOWN, so system keys and text input
+		// keep working.
+		static bool registerRawInput(HWND hwnd) {
+			RAWINPUTDEVICE device = {};
+			device.usUsagePage    = 0x01; // Generic desktop
+			device.usUsage        = 0x02; // Mouse
+			device.dwFlags        = 0;
+			device.hwndTarget     = hwnd;
+			return RegisterRawInputDevices(&device, 1, sizeof(device)) == TRUE;
+		}
+
+		// Call from the window procedure, which still passes every message on to DefWindowProc
+		void handleMessage(const UINT message, const WPARAM wParam, const LPARAM lParam) {
+			auto getX = [lParam]() { return static_cast<int32_t>(static_cast<int16_t>(LOWORD(lParam))); };
+			auto getY = [lParam]() { return static_cast<int32_t>(static_cast<int16_t>(HIWORD(lParam))); };
+
+			switch (message) {
+				case WM_KEYDOWN:
+				case WM_SYSKEYDOWN:
+					push({ InputEventType::KEY_DOWN, static_cast<uint8_t>(wParam) });
+					break;
+				case WM_KEYUP:
+				case WM_SYSKEYUP:
+					push({ InputEventType::KEY_UP, static_cast<uint8_t>(wParam) });
+					break;
+
+				case WM_LBUTTONDOWN: push({ InputEventType::MOUSE_BUTTON_DOWN, static_cast<uint8_t>(MouseButton::LEFT) });   break;
+				case WM_LBUTTONUP:   push({ InputEventType::MOUSE_BUTTON_UP,   static_cast<uint8_t>(MouseButton::LEFT) });   break;
+				case WM_RBUTTONDOWN: push({ InputEventType::MOUSE_BUTTON_DOWN, static_cast<uint8_t>(MouseButton::RIGHT) });  break;
+				case WM_RBUTTONUP:   push({ InputEventType::MOUSE_BUTTON_UP,   static_cast<uint8_t>(MouseButton::RIGHT) });  break;
+				case WM_MBUTTONDOWN: push({ InputEventType::MOUSE_BUTTON_DOWN, static_cast<uint8_t>(MouseButton::MIDDLE) }); break;
+				case WM_MBUTTONUP:   push({ InputEventType::MOUSE_BUTTON_UP,   static_cast<uint8_t>(MouseButton::MIDDLE) }); break;
+				case WM_XBUTTONDOWN:
+				case WM_XBUTTONUP: {
+					const MouseButton button = GET_XBUTTON_WPARAM(wParam) == XBUTTON1 ? MouseButton::X1 : MouseButton::X2;
+					push({ message == WM_XBUTTONDOWN ? InputEventType::MOUSE_BUTTON_DOWN : InputEventType::MOUSE_BUTTON_UP, static_cast<uint8_t>(button) });
+					break;
+				}
+
+				case WM_MOUSEMOVE:
+					push({ InputEventType::MOUSE_POSITION, 0, getX(), getY() });
+					break;
+				case WM_MOUSEWHEEL:
+					push({ InputEventType::MOUSE_WHEEL, 0, 0, GET_WHEEL_DELTA_WPARAM(wParam) });
+					break;
+				case WM_MOUSEHWHEEL:
+					push({ InputEventType::MOUSE_WHEEL, 0, GET_WHEEL_DELTA_WPARAM(wParam), 0 });
+					break;
+
+				case WM_INPUT: {
+					RAWINPUT input;
+					UINT     size = sizeof(input);
+					if (GetRawInputData(reinterpret_cast<HRAWINPUT>(lParam), RID_INPUT, &input, &size, sizeof(RAWINPUTHEADER)) == static_cast<UINT>(-1)) break;
+
+					// Absolute devices (tablets, remote desktop) report positions, which WM_MOUSEMOVE covers
+					if (input.header.dwType == RIM_TYPEMOUSE && !(input.data.mouse.usFlags & MOUSE_MOVE_ABSOLUTE)) {
+						if (input.data.mouse.lLastX != 0 || input.data.mouse.lLastY != 0) {
+							push({ InputEventType::MOUSE_MOVE, 0, input.data.mouse.lLastX, input.data.mouse.lLastY });
+						}
+					}
+					break;
+				}
+
+				case WM_KILLFOCUS:
+					push({ InputEventType::FOCUS_LOST });
+					break;
+			}
+		}
+#endif
+
+		InputSystem& operator=(const InputSystem&) = delete;
+		InputSystem& operator=(InputSystem&&)      = delete;
+	};
+
+	// Scripted input for headless runs: events are grouped into frames and pushed one frame per call, the
+	// way the window would have delivered them before the frame's update()
+	class InputScript {
+	private:
+		std::vector<std::vector<InputEvent>> frames_ = { {} };
+		size_t                               next_   = 0;
+
+	public:
+		// Later events go into a new frame
+		InputScript& frame() {
+			frames_.emplace_back();
+			return *this;
+		}
+		InputScript& frames(const size_t count) {
+			for (size_t i = 0; i < count; ++i) frame();
+			return *this;
+		}
+
+		InputScript& event(const InputEvent& event) {
+			frames_.back().push_back(event);
+			return *this;
+		}
+		InputScript& press(const uint8_t key) {
+			return event({ InputEventType::KEY_DOWN, key });
+		}
+		InputScript& release(const uint8_t key) {
+			return event({ InputEventType::KEY_UP, key });
+		}
+		InputScript& tap(const uint8_t key) {
+			return press(key).release(key);
+		}
+		InputScript& press(const MouseButton button) {
+			return event({ InputEventType::MOUSE_BUTTON_DOWN, static_cast<uint8_t>(button) });
+		}
+		InputScript& release(const MouseButton button) {
+			return event({ InputEventType::MOUSE_BUTTON_UP, static_cast<uint8_t>(button) });
+		}
+		InputScript& moveTo(const int32_t x, const int32_t y) {
+			return event({ InputEventType::MOUSE_POSITION, 0, x, y });
+		}
+		InputScript& move(const int32_t deltaX, const int32_t deltaY) {
+			return event({ InputEventType::MOUSE_MOVE, 0, deltaX, deltaY });
+		}
+		InputScript& scroll(const int32_t delta) {
+			return event({ InputEventType::MOUSE_WHEEL, 0, 0, delta });
+		}
+		InputScript& loseFocus() {
+			return event({ InputEventType::FOCUS_LOST });
+		}
+
+		// Pushes the next frame's events, false once the script has run out
+		bool pump(InputSystem& input) {
+			if (next_ >= frames_.size()) return false;
+
+			for (const InputEvent& event : frames_[next_]) input.push(event);
+			++next_;
+			return true;
+		}
+		void rewind() {
+			next_ = 0;
+		}
+
+		size_t getFrameCount() const {
+			return frames_.size();
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <DirectXMath.h>
+
+#include "types.hpp"
+#include "camera.hpp"
+#include "dx12_types.hpp"
+#include "scene_hierarchy.hpp"
+#include "mesh_simplifier.hpp"
+#include "flecs.h"
+
+namespace spider_engine::rendering {
+	// Level of detail drawn for a renderizable, written by LodSelector
+	struct LodState {
+		uint32_t level = 0;
+	};
+
+	struct LodStats {
+		size_t entityCount        = 0;
+		size_t fullTriangles      = 0; // What would be submitted without LODs
+		size_t submittedTriangles = 0;
+		size_t switches           = 0;
+	};
+
+	class LodSelector {
+	private:
+		flecs::world* world_;
+
+		float pixelError_;
+		float hysteresis_;
+
+		std::vector<std::pair<flecs::entity, uint32_t>> changes_;
+
+		LodStats stats_;
+
+	public:
+		LodSelector(flecs::world* world,
+					const float   pixelError = 1.0f,
+					const float   hysteresis = 0.25f) :
+			world_(world),
+			pixelError_(pixelError),
+			hysteresis_(hysteresis)
+		{}
+		LodSelector(const LodSelector&) = delete;
+		LodSelector(LodSelector&&)      = delete;
+
+		void update(const Camera& camera) {
+			stats_ = {};
+			changes_.clear();
+
+			DirectX::XMFLOAT3 eye;
+			DirectX::XMStoreFloat3(&eye, camera.transform.position);
+
+			// Pixels covered by one world unit at distance one
+			const float pixelsPerUnitAtOne = static_cast<float>(camera.getHeight()) / (2.0f * std::tan(camera.getFov() * 0.5f));
+
+			world_->each([&](flecs::entity entity, const d3dx12::Renderizable& renderizable) {
+				if (!renderizable.mesh) return;
+
+				const d3dx12::Mesh& mesh = *renderizable.mesh;
+				if (mesh.lods.empty()) return;
+
+				const WorldTransform* worldTransform = entity.get<WorldTransform>();
+				DirectX::XMMATRIX     world          = worldTransform ? worldTransform->matrix : renderizable.transform.toMatrix();
+
+				// Object space errors are scaled the same way as the bounding sphere
+				const BoundingVolume bounds = mesh.bounds.transformed(world);
+				const float          scale  = mesh.bounds.radius > 0.0f ? bounds.radius / mesh.bounds.radius : 1.0f;
+
+				const float dx       = bounds.center.x - eye.x;
+				const float dy       = bounds.center.y - eye.y;
+				const float dz       = bounds.center.z - eye.z;
+				const float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz) - bounds.radius, camera.getNearZ());
+
+				const LodState* state   = entity.get<LodState>();
+				const uint32_t  current = state ? state->level : 0;
+				const uint32_t  level   = selectLodLevel(mesh.lods, pixelsPerUnitAtOne * scale / distance, current, pixelError_, hysteresis_);
+
+				if (!state || level != current) changes_.push_back({ entity, level });
+				if (state && level != current) ++stats_.switches;
+
+				++stats_.entityCount;
+				stats_.fullTriangles      += mesh.lods.front().indexCount / 3;
+				stats_.submittedTriangles += mesh.lods[level].indexCount / 3;
+			});
+
+			// Written after the iteration so the tables are not changed under it
+			for (auto& [entity, level] : changes_) {
+				entity.set<LodState>({ level });
+			}
+		}
+
+		void setPixelError(const float pixelError) {
+			pixelError_ = pixelError;
+		}
+		void setHysteresis(const float hysteresis) {
+			hysteresis_ = hysteresis;
+		}
+
+		const LodStats& getStats() const {
+			return stats_;
+		}
+
+		LodSelector& operator=(const LodSelector&) = delete;
+		LodSelector& operator=(LodSelector&&)      = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,538 @@
+#pragma once
+#include <mutex>
+#include <tuple>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <format>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <string_view>
+#include <type_traits>
+#include <condition_variable>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Levels below SPIDER_LOG_LEVEL expand to nothing: 0 keeps debug messages, 1 starts at info, up to 4 for
+// fatal only. Debug builds keep everything by default, release builds start at info.
+#ifndef SPIDER_LOG_LEVEL
+#ifdef _DEBUG
+#define SPIDER_LOG_LEVEL 0
+#else
+#define SPIDER_LOG_LEVEL 1
+#endif
+#endif
+
+// The format string is checked at compile time, the arguments are copied raw and formatted on the
+// logger thread. Strings are copied too, so temporaries are fine.
+#define SPIDER_LOG(level, format, ...)                                                                           \
+	do {                                                                                                         \
+		static constexpr ::spider_engine::LogSite spiderLogSite_{ level, format, __FILE__, __LINE__ };          \
+		::spider_engine::Logger::get().log(spiderLogSite_, format __VA_OPT__(,) __VA_ARGS__);                  \
+	} while (false)
+
+#if SPIDER_LOG_LEVEL <= 0
+#define SPIDER_LOG_DEBUG(format, ...) SPIDER_LOG(::spider_engine::LogLevel::Debug, format __VA_OPT__(,) __VA_ARGS__)
+#else
+#define SPIDER_LOG_DEBUG(format, ...) ((void)0)
+#endif
+#if SPIDER_LOG_LEVEL <= 1
+#define SPIDER_LOG_INFO(format, ...) SPIDER_LOG(::spider_engine::LogLevel::Info, format __VA_OPT__(,) __VA_ARGS__)
+#else
+#define SPIDER_LOG_INFO(format, ...) ((void)0)
+#endif
+#if SPIDER_LOG_LEVEL <= 2
+#define SPIDER_LOG_WARNING(format, ...) SPIDER_LOG(::spider_engine::LogLevel::Warning, format __VA_OPT__(,) __VA_ARGS__)
+#else
+#define SPIDER_LOG_WARNING(format, ...) ((void)0)
+#endif
+#if SPIDER_LOG_LEVEL <= 3
+#define SPIDER_LOG_ERROR(format, ...) SPIDER_LOG(::spider_engine::LogLevel::Error, format __VA_OPT__(,) __VA_ARGS__)
+#else
+#define SPIDER_LOG_ERROR(format, ...) ((void)0)
+#endif
+#define SPIDER_LOG_FATAL(format, ...) SPIDER_LOG(::spider_engine::LogLevel::Fatal, format __VA_OPT__(,) __VA_ARGS__)
+
+namespace spider_engine {
+	enum class LogLevel : uint8_t {
+		Debug,
+		Info,
+		Warning,
+		Error,
+		Fatal
+	};
+
+	inline std::string_view getLogLevelName(const LogLevel level) {
+		switch (level) {
+			case LogLevel::Debug:   return "DEBUG";
+			case LogLevel::Info:    return "INFO ";
+			case LogLevel::Warning: return "WARN ";
+			case LogLevel::Error:   return "ERROR";
+			case LogLevel::Fatal:   return "FATAL";
+		}
+		return "?????";
+	}
+
+	// One per call site with static storage, a record only carries its address
+	struct LogSite {
+		LogLevel         level;
+		std::string_view format;
+		const char*      file;
+		uint32_t         line;
+	};
+
+	// Handed to the sinks on the logger thread, the text is only valid during the call
+	struct LogMessage {
+		const LogSite*   site;
+		LogLevel         level;
+		uint64_t         time;   // Nanoseconds since the logger started
+		uint32_t         thread; // Small id in the order threads first logged
+		std::string_view text;
+	};
+
+	class LogSink {
+	public:
+		virtual ~LogSink() = default;
+
+		virtual void write(const LogMessage& message) = 0;
+		virtual void flush() {}
+	};
+
+	// "[    12.345678] [WARN ] [T2] text"
+	inline void formatLogLine(const LogMessage& message, std::string& line) {
+		line.clear();
+		std::format_to(
+			std::back_inserter(line),
+			"[{:13.6f}] [{}] [T{}] {}\n",
+			static_cast<double>(message.time) / 1e9,
+			getLogLevelName(message.level),
+			message.thread,
+			message.text
+		);
+	}
+
+	// Standard output, colored by level. Writes go through stdio and are flushed when the queue runs dry.
+	class ConsoleLogSink : public LogSink {
+	private:
+		std::string line_;
+#ifdef _WIN32
+		HANDLE   handle_    = GetStdHandle(STD_OUTPUT_HANDLE);
+		LogLevel lastLevel_ = LogLevel::Info;
+		bool     hasColor_  = false;
+
+		static WORD getColor(const LogLevel level) {
+			switch (level) {
+				case LogLevel::Debug:   return FOREGROUND_BLUE | FOREGROUND_GREEN;
+				case LogLevel::Warning: return FOREGROUND_RED | FOREGROUND_GREEN;
+				case LogLevel::Error:   return FOREGROUND_RED;
+				case LogLevel::Fatal:   return FOREGROUND_RED | FOREGROUND_INTENSITY;
+				default:                return FOREGROUND_RED | FOREGROUND_GREEN | FOREGROUND_BLUE;
+			}
+		}
+#else
+		static std::string_view getColor(const LogLevel level) {
+			switch (level) {
+				case LogLevel::Debug:   return "\x1b[36m";
+				case LogLevel::Warning: return "\x1b[33m";
+				case LogLevel::Error:   return "\x1b[31m";
+				case LogLevel::Fatal:   return "\x1b[1;31m";
+				default:                return "\x1b[0m";
+			}
+		}
+#endif
+
+	public:
+		void write(const LogMessage& message) override {
+			formatLogLine(message, line_);
+#ifdef _WIN32
+			// The attribute applies to what is already buffered too, so the color only changes with the level
+			if (!hasColor_ || message.level != lastLevel_) {
+				std::fflush(stdout);
+				SetConsoleTextAttribute(handle_, getColor(message.level));
+				lastLevel_ = message.level;
+				hasColor_  = true;
+			}
+			std::fwrite(line_.data(), 1, line_.size(), stdout);
+#else
+			const std::string_view color = getColor(message.level);
+			std::fwrite(color.data(), 1, color.size(), stdout);
+			std::fwrite(line_.data(), 1, line_.size(), stdout);
+			std::fwrite("\x1b[0m", 1, 4, stdout);
+#endif
+		}
+		void flush() override {
+			std::fflush(stdout);
+		}
+	};
+
+	class FileLogSink : public LogSink {
+	private:
+		std::ofstream file_;
+		std::string   line_;
+
+	public:
+		FileLogSink(const std::filesystem::path& path, const bool append = false) :
+			file_(path, append ? std::ios::app : std::ios::trunc)
+		{
+			if (!file_) throw std::runtime_error("Failed to open log file: " + path.string());
+		}
+
+		void write(const LogMessage& message) override {
+			formatLogLine(message, line_);
+			file_.write(line_.data(), static_cast<std::streamsize>(line_.size()));
+		}
+		void flush() override {
+			file_.flush();
+		}
+	};
+
+	struct LoggerStats {
+		uint64_t written  = 0; // Handed to the sinks
+		uint64_t dropped  = 0; // The ring was full, only below error level
+		size_t   capacity = 0; // Records in the ring
+	};
+
+	// Multiple producer, single consumer logging. A call claims a slot of a bounded ring with one atomic
+	// increment, copies its call site and raw arguments into it and returns; the logger thread formats the
+	// records in order and hands them to the sinks. Nothing is formatted or written on the calling thread.
+	// A full ring drops messages below error level instead of blocking, errors wait for room, and fatal
+	// messages wait until they are written.
+	class Logger {
+	public:
+		static constexpr size_t MAX_ARGUMENTS = 8;
+		static constexpr size_t TEXT_BYTES    = 384; // Strings of all arguments, truncated past it
+
+	private:
+		struct Record {
+			const LogSite* site;
+			std::string  (*format)(const Record&); // Decodes with the argument types of the call
+			uint64_t       time;
+			uint32_t       thread;
+			uint16_t       textBytes;
+			uint64_t       arguments[MAX_ARGUMENTS];
+			char           text[TEXT_BYTES];
+		};
+
+		struct alignas(64) Slot {
+			std::atomic<uint64_t> sequence;
+			Record                record;
+		};
+
+		enum class ArgumentKind {
+			VALUE,    // Copied bitwise
+			POINTER,  // Address only
+			TEXT,     // Characters copied into the record
+			FORMATTED // Anything else, formatted on the caller into text
+		};
+
+		template <typename Ty>
+		static constexpr ArgumentKind getArgumentKind() {
+			using Type = std::remove_cvref_t<Ty>;
+			if constexpr (std::is_arithmetic_v<Type> || std::is_enum_v<Type>)        return ArgumentKind::VALUE;
+			else if constexpr (std::is_null_pointer_v<Type>)                         return ArgumentKind::POINTER;
+			else if constexpr (std::is_convertible_v<const Type&, std::string_view>) return ArgumentKind::TEXT;
+			else if constexpr (std::is_pointer_v<Type>)                              return ArgumentKind::POINTER;
+			else                                                                     return ArgumentKind::FORMATTED;
+		}
+
+		template <typename Ty, ArgumentKind Kind = getArgumentKind<Ty>()>
+		struct Argument {
+			using Type = std::string_view;
+		};
+		template <typename Ty>
+		struct Argument<Ty, ArgumentKind::VALUE> {
+			using Type = typename std::conditional_t<std::is_enum_v<std::remove_cvref_t<Ty>>, std::underlying_type<std::remove_cvref_t<Ty>>, std::type_identity<std::remove_cvref_t<Ty>>>::type;
+		};
+		template <typename Ty>
+		struct Argument<Ty, ArgumentKind::POINTER> {
+			using Type = const void*;
+		};
+
+	public:
+		// What the logger thread formats an argument of type Ty as
+		template <typename Ty>
+		using ArgumentType = typename Argument<Ty>::Type;
+
+	private:
+		std::unique_ptr<Slot[]> slots_;
+		size_t                  mask_;
+
+		alignas(64) std::atomic<uint64_t> enqueuePosition_ = 0;
+		alignas(64) std::atomic<uint64_t> dequeuePosition_ = 0; // Written by the logger thread only
+		std::atomic<uint64_t>             dropped_         = 0;
+		std::atomic<uint8_t>              level_           = 0;
+
+		std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+
+		std::mutex                            sinksMutex_; // Held by the logger thread while writing
+		std::vector<std::unique_ptr<LogSink>> sinks_;
+
+		std::mutex              wakeMutex_;
+		std::condition_variable wake_;
+		std::atomic<bool>       isWaiting_  = false;
+		std::atomic<bool>       isStopping_ = false;
+		std::thread             thread_;
+
+		static uint32_t getThreadId() {
+			static std::atomic<uint32_t> next = 0;
+			thread_local const uint32_t  id   = ++next;
+			return id;
+		}
+
+		static void encodeText(Record& record, uint64_t& slot, const std::string_view text) {
+			const size_t offset = record.textBytes;
+			size_t       length = std::min(text.size(), TEXT_BYTES - offset);
+			std::memcpy(record.text + offset, text.data(), length);
+
+			// Truncation is marked where there is room for it
+			if (length < text.size() && length >= 3) std::memcpy(record.text + offset + length - 3, "...", 3);
+
+			record.textBytes = static_cast<uint16_t>(offset + length);
+			slot             = (static_cast<uint64_t>(offset) << 32) | length;
+		}
+		template <typename Ty>
+		static void encode(Record& record, uint64_t& slot, const Ty& value) {
+			constexpr ArgumentKind kind = getArgumentKind<Ty>();
+
+			if constexpr (kind == ArgumentKind::VALUE) {
+				const ArgumentType<Ty> stored = static_cast<ArgumentType<Ty>>(value);
+				std::memcpy(&slot, &stored, sizeof(stored));
+			}
+			else if constexpr (kind == ArgumentKind::POINTER) {
+				const void* pointer = value;
+				std::memcpy(&slot, &pointer, sizeof(pointer));
+			}
+			else if constexpr (kind == ArgumentKind::TEXT) {
+				encodeText(record, slot, std::string_view(value));
+			}
+			else {
+				encodeText(record, slot, std::format("{}", value));
+			}
+		}
+		template <typename Ty>
+		static ArgumentType<Ty> decode(const Record& record, const uint64_t slot) {
+			constexpr ArgumentKind kind = getArgumentKind<Ty>();
+
+			if constexpr (kind == ArgumentKind::VALUE || kind == ArgumentKind::POINTER) {
+				ArgumentType<Ty> value;
+				std::memcpy(&value, &slot, sizeof(value));
+				return value;
+			}
+			else {
+				return std::string_view(record.text + (slot >> 32), slot & 0xFFFFFFFFu);
+			}
+		}
+
+		template <typename... Args, size_t... Indices>
+		static std::string formatRecord(const Record& record, std::index_sequence<Indices...>) {
+			std::tuple<ArgumentType<Args>...> arguments{ decode<Args>(record, record.arguments[Indices])... };
+			return std::apply([&record](auto&... values) {
+				return std::vformat(record.site->format, std::make_format_args(values...));
+			}, arguments);
+		}
+		template <typename... Args>
+		static std::string formatRecord(const Record& record) {
+			return formatRecord<Args...>(record, std::index_sequence_for<Args...>{});
+		}
+
+		// Claims a slot, false when the ring is full
+		template <typename Fill>
+		bool tryPush(Fill&& fill) {
+			uint64_t position = enqueuePosition_.load(std::memory_order_relaxed);
+			Slot*    slot;
+			while (true) {
+				slot = &slots_[position & mask_];
+
+				const uint64_t sequence   = slot->sequence.load(std::memory_order_acquire);
+				const int64_t  difference = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+				if (difference == 0) {
+					if (enqueuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+				}
+				else if (difference < 0) {
+					return false;
+				}
+				else {
+					position = enqueuePosition_.load(std::memory_order_relaxed);
+				}
+			}
+
+			fill(slot->record);
+			slot->sequence.store(position + 1, std::memory_order_release);
+
+			if (isWaiting_.load(std::memory_order_relaxed)) wake_.notify_one();
+			return true;
+		}
+
+		// Formats and writes every published record, in order
+		size_t drain(std::string& text) {
+			size_t   count    = 0;
+			uint64_t position = dequeuePosition_.load(std::memory_order_relaxed);
+
+			std::lock_guard lock(sinksMutex_);
+			while (true) {
+				Slot& slot = slots_[position & mask_];
+				if (slot.sequence.load(std::memory_order_acquire) != position + 1) break;
+
+				const Record& record = slot.record;
+				try {
+					text = record.format(record);
+				}
+				catch (const std::exception& exception) {
+					text = std::string("Log format failed: ") + exception.what();
+				}
+
+				const LogMessage message = { record.site, record.site->level, record.time, record.thread, text };
+				for (const auto& sink : sinks_) sink->write(message);
+
+				slot.sequence.store(position + mask_ + 1, std::memory_order_release);
+				dequeuePosition_.store(++position, std::memory_order_release);
+				++count;
+			}
+
+			if (count > 0) {
+				for (const auto& sink : sinks_) sink->flush();
+			}
+			return count;
+		}
+
+		void run() {
+			std::string text;
+			while (true) {
+				if (drain(text) > 0) continue;
+				if (isStopping_.load(std::memory_order_acquire)) break;
+
+				// Producers only notify while the flag is up; the timeout covers one that looked just before
+				std::unique_lock lock(wakeMutex_);
+				isWaiting_.store(true, std::memory_order_seq_cst);
+				wake_.wait_for(lock, std::chrono::milliseconds(10), [this]() {
+					const uint64_t position = dequeuePosition_.load(std::memory_order_relaxed);
+					return isStopping_.load(std::memory_order_relaxed) || slots_[position & mask_].sequence.load(std::memory_order_acquire) == position + 1;
+				});
+				isWaiting_.store(false, std::memory_order_relaxed);
+			}
+			drain(text);
+		}
+
+	public:
+		// Capacity is rounded up to a power of two, a record takes half a kilobyte
+		explicit Logger(const size_t capacity = 4096, const bool hasConsole = true) {
+			size_t size = 2;
+			while (size < capacity) size *= 2;
+
+			slots_ = std::make_unique<Slot[]>(size);
+			mask_  = size - 1;
+			for (size_t i = 0; i < size; ++i) slots_[i].sequence.store(i, std::memory_order_relaxed);
+
+			if (hasConsole) sinks_.push_back(std::make_unique<ConsoleLogSink>());
+
+			thread_ = std::thread([this]() { run(); });
+		}
+		Logger(const Logger&) = delete;
+		Logger(Logger&&)      = delete;
+
+		~Logger() {
+			{
+				std::lock_guard lock(wakeMutex_);
+				isStopping_.store(true, std::memory_order_release);
+			}
+			wake_.notify_one();
+			if (thread_.joinable()) thread_.join();
+		}
+
+		static Logger& get() {
+			static Logger logger;
+			return logger;
+		}
+
+		// Use the SPIDER_LOG macros, they keep the site static and filter levels at compile time
+		template <typename... Args>
+		void log(const LogSite& site, const std::format_string<ArgumentType<Args>...>, Args&&... args) {
+			static_assert(sizeof...(Args) <= MAX_ARGUMENTS, "Too many log arguments");
+
+			if (static_cast<uint8_t>(site.level) < level_.load(std::memory_order_relaxed)) return;
+
+			const uint64_t time   = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count());
+			const uint32_t thread = getThreadId();
+
+			auto fill = [&](Record& record) {
+				record.site      = &site;
+				record.format    = &formatRecord<std::remove_cvref_t<Args>...>;
+				record.time      = time;
+				record.thread    = thread;
+				record.textBytes = 0;
+
+				[[maybe_unused]] size_t index = 0;
+				(encode(record, record.arguments[index++], args), ...);
+			};
+
+			while (!tryPush(fill)) {
+				if (site.level < LogLevel::Error) {
+					dropped_.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}
+				std::this_thread::yield();
+			}
+
+			if (site.level == LogLevel::Fatal) flush();
+		}
+
+		// Runtime text without a format string, for callers that build their own messages
+		void write(const LogLevel level, const std::string_view text) {
+			static constexpr LogSite sites[] = {
+				{ LogLevel::Debug,   "{}", __FILE__, __LINE__ },
+				{ LogLevel::Info,    "{}", __FILE__, __LINE__ },
+				{ LogLevel::Warning, "{}", __FILE__, __LINE__ },
+				{ LogLevel::Error,   "{}", __FILE__, __LINE__ },
+				{ LogLevel::Fatal,   "{}", __FILE__, __LINE__ }
+			};
+			log(sites[static_cast<size_t>(level)], "{}", text);
+		}
+
+		// Blocks until everything logged before the call was written
+		void flush() {
+			const uint64_t target = enqueuePosition_.load(std::memory_order_acquire);
+			while (dequeuePosition_.load(std::memory_order_acquire) < target) {
+				if (!thread_.joinable() || isStopping_.load(std::memory_order_relaxed)) return;
+
+				wake_.notify_one();
+				std::this_thread::yield();
+			}
+		}
+
+		// Messages below the level are dropped at the call, on top of SPIDER_LOG_LEVEL
+		void setLevel(const LogLevel level) {
+			level_.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+		}
+
+		void addSink(std::unique_ptr<LogSink> sink) {
+			std::lock_guard lock(sinksMutex_);
+			sinks_.push_back(std::move(sink));
+		}
+		void clearSinks() {
+			std::lock_guard lock(sinksMutex_);
+			sinks_.clear();
+		}
+
+		LoggerStats getStats() const {
+			LoggerStats stats;
+			stats.written  = dequeuePosition_.load(std::memory_order_relaxed);
+			stats.dropped  = dropped_.load(std::memory_order_relaxed);
+			stats.capacity = mask_ + 1;
+			return stats;
+		}
+
+		Logger& operator=(const Logger&) = delete;
+		Logger& operator=(Logger&&)      = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <stdexcept>
+#include <filesystem>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace spider_engine {
+	// Read-only view of a whole file, pages are loaded on first touch
+	class MappedFile {
+	private:
+#if defined(_WIN32)
+		HANDLE file_    = INVALID_HANDLE_VALUE;
+		HANDLE mapping_ = nullptr;
+#else
+		int file_ = -1;
+#endif
+		const uint8_t* data_ = nullptr;
+		size_t         size_ = 0;
+
+		void release() {
+#if defined(_WIN32)
+			if (data_)                         UnmapViewOfFile(data_);
+			if (mapping_)                      CloseHandle(mapping_);
+			if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+			file_    = INVALID_HANDLE_VALUE;
+			mapping_ = nullptr;
+#else
+			if (data_)      munmap(const_cast<uint8_t*>(data_), size_);
+			if (file_ >= 0) close(file_);
+			file_ = -1;
+#endif
+			data_ = nullptr;
+			size_ = 0;
+		}
+
+	public:
+		MappedFile() = default;
+		MappedFile(const std::filesystem::path& path) {
+#if defined(_WIN32)
+			file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file_ == INVALID_HANDLE_VALUE) {
+				throw std::runtime_error("Failed to open " + path.string());
+			}
+
+			LARGE_INTEGER size;
+			GetFileSizeEx(file_, &size);
+			size_ = static_cast<size_t>(size.QuadPart);
+			if (size_ == 0) return;
+
+			mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping_) data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+#else
+			file_ = open(path.c_str(), O_RDONLY);
+			if (file_ < 0) {
+				throw std::runtime_error("Failed to open " + path.string());
+			}
+
+			struct stat status;
+			fstat(file_, &status);
+			size_ = static_cast<size_t>(status.st_size);
+			if (size_ == 0) return;
+
+			void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file_, 0);
+			if (data != MAP_FAILED) data_ = static_cast<const uint8_t*>(data);
+#endif
+			if (!data_) {
+				release();
+				throw std::runtime_error("Failed to map " + path.string());
+			}
+		}
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&& other) noexcept {
+			*this = std::move(other);
+		}
+
+		~MappedFile() {
+			release();
+		}
+
+		const uint8_t* data() const {
+			return data_;
+		}
+		size_t size() const {
+			return size_;
+		}
+
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile& operator=(MappedFile&& other) noexcept {
+			if (this != &other) {
+				release();
+				std::swap(file_, other.file_);
+#if defined(_WIN32)
+				std::swap(mapping_, other.mapping_);
+#endif
+				std::swap(data_, other.data_);
+				std::swap(size_, other.size_);
+			}
+			return *this;
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,269 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <chrono>
+#include <stdexcept>
+#include <filesystem>
+
+#include "assimp/Importer.hpp"
+#include "assimp/scene.h"
+#include "assimp/postprocess.h"
+
+#include "types.hpp"
+#include "mesh_simplifier.hpp"
+#include "mesh_optimizer.hpp"
+#include "meshlet_builder.hpp"
+#include "submesh.hpp"
+#include "spmesh_format.hpp"
+
+namespace spider_engine::rendering {
+	struct MeshImportSettings {
+		uint32_t lodCount      = 4;
+		bool     optimize      = true;
+		bool     buildMeshlets = true;
+	};
+
+	// Everything the renderer (or the cooker) needs from a source model, without touching the GPU
+	struct ImportedMesh {
+		std::vector<Vertex>   vertices;
+		std::vector<uint32_t> indices;
+		std::vector<MeshLod>  lods;
+
+		BoundingVolume        bounds;
+		MeshOptimizationStats optimizationStats;
+		MeshletData           meshlets;
+		SubmeshTable          submeshes;
+
+		std::vector<std::filesystem::path> materialTextures; // Diffuse texture per material, empty when it has none
+		std::filesystem::path              diffuseTexture;   // First one used by a submesh, empty when the model has none
+
+		double importMilliseconds = 0.0;
+	};
+
+	inline ImportedMesh importMesh(Assimp::Importer&            importer,
+								   const std::filesystem::path& path,
+								   const MeshImportSettings&    settings = {})
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		const std::string utf8Path = path.string();
+
+		const aiScene* scene = importer.ReadFile(
+			utf8Path,
+			aiProcess_Triangulate |
+			aiProcess_JoinIdenticalVertices |
+			aiProcess_CalcTangentSpace |
+			aiProcess_GenSmoothNormals |
+			aiProcess_FlipUVs |
+			aiProcess_MakeLeftHanded |
+			aiProcess_FlipWindingOrder
+		);
+
+		if (!scene || !scene->mRootNode || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE)) {
+			throw std::runtime_error(std::string("Assimp error: ") + importer.GetErrorString());
+		}
+
+		ImportedMesh imported;
+		std::vector<Vertex>&   vertices = imported.vertices;
+		std::vector<uint32_t>& indices  = imported.indices;
+
+		// Each aiMesh becomes a submesh, processed on its own so its indices stay local to its vertices
+		struct Part {
+			std::vector<Vertex>   vertices;
+			std::vector<uint32_t> indices;
+			std::vector<MeshLod>  lods;
+			uint32_t              materialIndex;
+		};
+		std::vector<Part> parts;
+		parts.reserve(scene->mNumMeshes);
+
+		uint32_t cacheMissesBefore = 0;
+		uint32_t cacheMissesAfter  = 0;
+		size_t   cacheTriangles    = 0;
+		size_t   cacheVertices     = 0;
+
+		// Loop through every mesh
+		for (uint32_t m = 0; m < scene->mNumMeshes; ++m) {
+			aiMesh* mesh = scene->mMeshes[m];
+			if (mesh->mNumFaces == 0) continue;
+
+			Part& part         = parts.emplace_back();
+			part.materialIndex = mesh->mMaterialIndex;
+			part.vertices.reserve(mesh->mNumVertices);
+
+			for (uint32_t i = 0; i < mesh->mNumVertices; ++i) {
+				Vertex v {};
+				v.position = { mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z };
+
+				if (mesh->HasNormals())
+					v.normal = { mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z };
+				else
+					v.normal = { 0.f, 1.f, 0.f };
+
+				if (mesh->mTextureCoords[0])
+					v.uv = { mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y };
+				else
+					v.uv = { 0.f, 0.f };
+
+				if (mesh->HasTangentsAndBitangents())
+					v.tangent = { mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z };
+				else
+					v.tangent = { 0.f, 0.f, 0.f };
+
+				part.vertices.push_back(v);
+			}
+
+			for (uint32_t i = 0; i < mesh->mNumFaces; ++i) {
+				const aiFace& face = mesh->mFaces[i];
+				for (uint32_t j = 0; j < face.mNumIndices; ++j)
+					part.indices.push_back(face.mIndices[j]);
+			}
+
+			// Simplified levels are appended after the full resolution indices
+			part.lods = generateLodChain(
+				part.vertices.data(),
+				part.vertices.size(),
+				sizeof(Vertex),
+				part.indices,
+				settings.lodCount
+			);
+
+			// Reorder triangles for the post-transform cache and overdraw, then vertices for fetch
+			if (settings.optimize) {
+				const MeshOptimizationStats stats = optimizeMesh(part.vertices, part.indices, part.lods);
+
+				cacheMissesBefore += stats.before.misses;
+				cacheMissesAfter  += stats.after.misses;
+				cacheTriangles    += part.lods.front().indexCount / 3;
+				cacheVertices     += part.vertices.size();
+
+				imported.optimizationStats.clusterCount += stats.clusterCount;
+			}
+		}
+
+		if (cacheTriangles) {
+			MeshOptimizationStats& stats = imported.optimizationStats;
+			stats.before.misses = cacheMissesBefore;
+			stats.after.misses  = cacheMissesAfter;
+			stats.before.acmr   = static_cast<float>(cacheMissesBefore) / cacheTriangles;
+			stats.after.acmr    = static_cast<float>(cacheMissesAfter) / cacheTriangles;
+			stats.before.atvr   = static_cast<float>(cacheMissesBefore) / cacheVertices;
+			stats.after.atvr    = static_cast<float>(cacheMissesAfter) / cacheVertices;
+		}
+
+		// Level count of the whole mesh, parts that ran out of levels repeat their coarsest one
+		uint32_t levelCount = 0;
+		for (const Part& part : parts) levelCount = std::max(levelCount, static_cast<uint32_t>(part.lods.size()));
+
+		SubmeshTable& table = imported.submeshes;
+		table.submeshes.resize(parts.size());
+
+		for (size_t p = 0; p < parts.size(); ++p) {
+			const Part& part    = parts[p];
+			Submesh&    submesh = table.submeshes[p];
+
+			submesh.vertexOffset  = static_cast<uint32_t>(vertices.size());
+			submesh.vertexCount   = static_cast<uint32_t>(part.vertices.size());
+			submesh.materialIndex = part.materialIndex;
+			submesh.bounds        = computeBoundingVolume(part.vertices.data(), part.vertices.data() + part.vertices.size());
+
+			vertices.insert(vertices.end(), part.vertices.begin(), part.vertices.end());
+
+			// Meshlets follow the optimized order of level 0 and index the shared vertex buffer
+			if (settings.buildMeshlets) {
+				MeshletData meshlets = buildMeshlets(
+					part.indices.data(),
+					part.lods.front().indexCount,
+					part.vertices.data(),
+					part.vertices.size(),
+					sizeof(Vertex)
+				);
+
+				MeshletData& all      = imported.meshlets;
+				submesh.meshletOffset = static_cast<uint32_t>(all.meshlets.size());
+				submesh.meshletCount  = static_cast<uint32_t>(meshlets.meshlets.size());
+
+				for (Meshlet meshlet : meshlets.meshlets) {
+					meshlet.vertexOffset   += static_cast<uint32_t>(all.vertices.size());
+					meshlet.triangleOffset += static_cast<uint32_t>(all.triangles.size());
+					all.meshlets.push_back(meshlet);
+				}
+				for (uint32_t vertex : meshlets.vertices) all.vertices.push_back(vertex + submesh.vertexOffset);
+
+				all.bounds.insert(all.bounds.end(), meshlets.bounds.begin(), meshlets.bounds.end());
+				all.triangles.insert(all.triangles.end(), meshlets.triangles.begin(), meshlets.triangles.end());
+			}
+		}
+
+		// Level major index buffer, so every level of the whole mesh is still one contiguous range
+		table.lods.resize(size_t(levelCount) * parts.size());
+
+		for (uint32_t level = 0; level < levelCount; ++level) {
+			MeshLod meshLod = { static_cast<uint32_t>(indices.size()), 0, 0.0f };
+
+			for (size_t p = 0; p < parts.size(); ++p) {
+				const Part&    part = parts[p];
+				const MeshLod& lod  = part.lods[std::min<size_t>(level, part.lods.size() - 1)];
+
+				table.lods[size_t(level) * parts.size() + p] = { static_cast<uint32_t>(indices.size()), lod.indexCount, lod.error };
+				indices.insert(indices.end(), part.indices.begin() + lod.indexOffset, part.indices.begin() + lod.indexOffset + lod.indexCount);
+
+				meshLod.indexCount += lod.indexCount;
+				meshLod.error       = std::max(meshLod.error, lod.error);
+			}
+
+			// Same rule as generateLodChain, a level has to pay for its indices
+			if (level > 0 && meshLod.indexCount * 10ull > imported.lods.back().indexCount * 9ull) {
+				indices.resize(meshLod.indexOffset);
+				table.lods.resize(size_t(level) * parts.size());
+				break;
+			}
+			imported.lods.push_back(meshLod);
+		}
+
+		// Diffuse texture of every material, relative paths are resolved against the model folder
+		imported.materialTextures.resize(scene->mNumMaterials);
+		for (uint32_t m = 0; m < scene->mNumMaterials; ++m) {
+			aiString texPath;
+			if (scene->mMaterials[m]->GetTexture(aiTextureType_DIFFUSE, 0, &texPath) == AI_SUCCESS) {
+				imported.materialTextures[m] = path.parent_path() / texPath.C_Str();
+			}
+		}
+
+		// First diffuse texture in submesh order, for renderizables that bind a single texture
+		for (const Submesh& submesh : table.submeshes) {
+			if (submesh.materialIndex < imported.materialTextures.size() && !imported.materialTextures[submesh.materialIndex].empty()) {
+				imported.diffuseTexture = imported.materialTextures[submesh.materialIndex];
+				break;
+			}
+		}
+
+		imported.bounds = computeBoundingVolume(vertices.data(), vertices.data() + vertices.size());
+
+		auto finish = std::chrono::steady_clock::now();
+		imported.importMilliseconds = std::chrono::duration<double, std::milli>(finish - start).count();
+
+		return imported;
+	}
+
+	// Bakes an import, texture paths are stored relative to the output so baked folders can move
+	inline void writeSpmesh(const std::filesystem::path& path,
+							const ImportedMesh&          imported,
+							const VertexFormat           format = VertexFormat::FULL)
+	{
+		const std::filesystem::path folder = std::filesystem::absolute(path).parent_path();
+
+		std::vector<std::string> textures;
+		textures.reserve(imported.materialTextures.size());
+		for (const std::filesystem::path& texture : imported.materialTextures) {
+			std::string& relative = textures.emplace_back();
+			if (texture.empty()) continue;
+
+			const std::u8string utf8 = std::filesystem::absolute(texture).lexically_relative(folder).generic_u8string();
+			relative.assign(utf8.begin(), utf8.end());
+		}
+
+		writeSpmesh(path, imported.vertices, imported.indices, imported.lods, imported.meshlets, imported.submeshes, textures, format);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,445 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <cstdint>
+#include <numeric>
+#include <algorithm>
+#include <DirectXMath.h>
+
+#include "mesh_simplifier.hpp"
+
+namespace spider_engine::rendering {
+	// Post-transform cache efficiency of an index sequence (simulated FIFO cache)
+	struct VertexCacheStats {
+		uint32_t misses = 0;
+		float    acmr   = 0.0f; // Average cache misses per triangle (0.5 is the ideal for large grids)
+		float    atvr   = 0.0f; // Average transformed vertices per referenced vertex (1.0 is ideal)
+	};
+
+	// Pixels shaded per pixel covered, rasterized from the six axis directions
+	struct OverdrawStats {
+		uint64_t covered  = 0;
+		uint64_t shaded   = 0;
+		float    overdraw = 0.0f; // 1.0 is ideal
+	};
+
+	struct MeshOptimizationStats {
+		VertexCacheStats before;
+		VertexCacheStats after;
+
+		size_t clusterCount = 0;
+	};
+
+	inline VertexCacheStats analyzeVertexCache(const uint32_t* indices,
+											   const size_t    indexCount,
+											   const size_t    vertexCount,
+											   const uint32_t  cacheSize = 16)
+	{
+		VertexCacheStats stats;
+		if (indexCount < 3) return stats;
+
+		// A vertex is resident while fewer than cacheSize misses happened after it was loaded
+		std::vector<uint32_t> loadedAt(vertexCount, 0);
+		std::vector<uint8_t>  referenced(vertexCount, 0);
+		uint32_t              timestamp = cacheSize + 1;
+		size_t                unique    = 0;
+
+		for (size_t i = 0; i < indexCount; ++i) {
+			const uint32_t v = indices[i];
+			if (timestamp - loadedAt[v] > cacheSize) {
+				loadedAt[v] = timestamp++;
+				++stats.misses;
+			}
+			if (!referenced[v]) {
+				referenced[v] = 1;
+				++unique;
+			}
+		}
+
+		stats.acmr = static_cast<float>(stats.misses) / static_cast<float>(indexCount / 3);
+		stats.atvr = static_cast<float>(stats.misses) / static_cast<float>(unique);
+		return stats;
+	}
+
+	// Orthographic views of the bounding box along +-x, +-y and +-z with a depth test and no face culling,
+	// every triangle that passes the test on a pixel counts as shaded
+	inline OverdrawStats analyzeOverdraw(const uint32_t* indices,
+										 const size_t    indexCount,
+										 const void*     positions,
+										 const size_t    vertexCount,
+										 const size_t    stride,
+										 const uint32_t  resolution = 256)
+	{
+		OverdrawStats stats;
+		if (indexCount < 3 || vertexCount == 0) return stats;
+
+		const uint8_t* bytes    = reinterpret_cast<const uint8_t*>(positions);
+		auto           position = [bytes, stride](uint32_t v) -> const DirectX::XMFLOAT3& {
+			return *reinterpret_cast<const DirectX::XMFLOAT3*>(bytes + v * stride);
+		};
+
+		float lower[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float upper[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (size_t v = 0; v < vertexCount; ++v) {
+			const float* p = &position(static_cast<uint32_t>(v)).x;
+			for (int axis = 0; axis < 3; ++axis) {
+				lower[axis] = std::min(lower[axis], p[axis]);
+				upper[axis] = std::max(upper[axis], p[axis]);
+			}
+		}
+		const float extent = std::max({ upper[0] - lower[0], upper[1] - lower[1], upper[2] - lower[2], 1e-6f });
+		const float scale  = static_cast<float>(resolution) / extent;
+
+		std::vector<float> depth(size_t(resolution) * resolution);
+
+		for (int view = 0; view < 6; ++view) {
+			const int   axis = view / 2;
+			const float sign = (view & 1) ? -1.0f : 1.0f;
+			const int   u    = (axis + 1) % 3;
+			const int   w    = (axis + 2) % 3;
+
+			std::fill(depth.begin(), depth.end(), FLT_MAX);
+
+			for (size_t i = 0; i + 2 < indexCount; i += 3) {
+				float x[3], y[3], z[3];
+				for (int k = 0; k < 3; ++k) {
+					const float* p = &position(indices[i + k]).x;
+					x[k] = (p[u] - lower[u]) * scale;
+					y[k] = (p[w] - lower[w]) * scale;
+					z[k] = (p[axis] - lower[axis]) * sign;
+				}
+
+				const float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+				if (std::fabs(area) < 1e-12f) continue;
+				const float inverseArea = 1.0f / area;
+
+				const int minX = std::max(0, static_cast<int>(std::floor(std::min({ x[0], x[1], x[2] }))));
+				const int maxX = std::min(static_cast<int>(resolution) - 1, static_cast<int>(std::ceil(std::max({ x[0], x[1], x[2] }))));
+				const int minY = std::max(0, static_cast<int>(std::floor(std::min({ y[0], y[1], y[2] }))));
+				const int maxY = std::min(static_cast<int>(resolution) - 1, static_cast<int>(std::ceil(std::max({ y[0], y[1], y[2] }))));
+
+				for (int py = minY; py <= maxY; ++py) {
+					for (int px = minX; px <= maxX; ++px) {
+						const float cx = static_cast<float>(px) + 0.5f;
+						const float cy = static_cast<float>(py) + 0.5f;
+
+						// Barycentrics, the sign of the area makes them positive inside for either winding
+						const float b0 = ((x[1] - cx) * (y[2] - cy) - (y[1] - cy) * (x[2] - cx)) * inverseArea;
+						const float b1 = ((x[2] - cx) * (y[0] - cy) - (y[2] - cy) * (x[0] - cx)) * inverseArea;
+						const float b2 = 1.0f - b0 - b1;
+						if (b0 < 0.0f || b1 < 0.0f || b2 < 0.0f) continue;
+
+						const float pixelDepth = b0 * z[0] + b1 * z[1] + b2 * z[2];
+						float&      stored     = depth[size_t(py) * resolution + px];
+						if (pixelDepth < stored) {
+							stored = pixelDepth;
+							++stats.shaded;
+						}
+					}
+				}
+			}
+
+			for (const float d : depth) stats.covered += d != FLT_MAX;
+		}
+
+		stats.overdraw = stats.covered ? static_cast<float>(stats.shaded) / static_cast<float>(stats.covered) : 0.0f;
+		return stats;
+	}
+
+	// Tipsify (Sander et al. 2007), fans around the vertex most likely to still be cached.
+	// Hard cluster boundaries (dead ends) are written to clusters when given.
+	inline void optimizeVertexCache(uint32_t*              indices,
+									const size_t           indexCount,
+									const size_t           vertexCount,
+									const uint32_t         cacheSize = 16,
+									std::vector<uint32_t>* clusters  = nullptr)
+	{
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0) return;
+
+		// Vertex to triangle adjacency (compressed rows)
+		std::vector<uint32_t> offsets(vertexCount + 1, 0);
+		for (size_t i = 0; i < indexCount; ++i) ++offsets[indices[i] + 1];
+		for (size_t v = 0; v < vertexCount; ++v) offsets[v + 1] += offsets[v];
+
+		std::vector<uint32_t> adjacency(indexCount);
+		std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indexCount; ++i) {
+			adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		std::vector<uint32_t> liveTriangles(vertexCount);
+		for (size_t v = 0; v < vertexCount; ++v) liveTriangles[v] = offsets[v + 1] - offsets[v];
+
+		std::vector<uint32_t> loadedAt(vertexCount, 0);
+		std::vector<uint8_t>  emitted(triangleCount, 0);
+		std::vector<uint32_t> deadEnds;
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> output;
+		output.reserve(indexCount);
+
+		if (clusters) {
+			clusters->clear();
+			clusters->push_back(0);
+		}
+
+		uint32_t timestamp    = cacheSize + 1;
+		uint32_t scanCursor   = 0;
+		int64_t  fanningVertex = indices[0];
+
+		while (fanningVertex >= 0) {
+			const uint32_t f = static_cast<uint32_t>(fanningVertex);
+			candidates.clear();
+
+			for (uint32_t k = offsets[f]; k < offsets[f + 1]; ++k) {
+				const uint32_t t = adjacency[k];
+				if (emitted[t]) continue;
+
+				for (int c = 0; c < 3; ++c) {
+					const uint32_t v = indices[t * 3 + c];
+					output.push_back(v);
+					deadEnds.push_back(v);
+					candidates.push_back(v);
+					--liveTriangles[v];
+
+					if (timestamp - loadedAt[v] > cacheSize) loadedAt[v] = timestamp++;
+				}
+				emitted[t] = 1;
+			}
+
+			// Prefer the oldest candidate that will still be cached after fanning around it
+			fanningVertex = -1;
+			int64_t bestPriority = -1;
+			for (uint32_t v : candidates) {
+				if (liveTriangles[v] == 0) continue;
+
+				int64_t priority = 0;
+				if (timestamp - loadedAt[v] + 2 * liveTriangles[v] <= cacheSize) priority = timestamp - loadedAt[v];
+				if (priority > bestPriority) {
+					bestPriority  = priority;
+					fanningVertex = v;
+				}
+			}
+			if (fanningVertex >= 0) continue;
+
+			// Dead end, restart from a recently used vertex or the next unprocessed one
+			while (!deadEnds.empty()) {
+				const uint32_t v = deadEnds.back();
+				deadEnds.pop_back();
+				if (liveTriangles[v] > 0) {
+					fanningVertex = v;
+					break;
+				}
+			}
+			while (fanningVertex < 0 && scanCursor < vertexCount) {
+				if (liveTriangles[scanCursor] > 0) fanningVertex = scanCursor;
+				++scanCursor;
+			}
+
+			if (clusters && fanningVertex >= 0) clusters->push_back(static_cast<uint32_t>(output.size() / 3));
+		}
+
+		std::copy(output.begin(), output.end(), indices);
+	}
+
+	// Splits the hard clusters where the running cache efficiency is already close to the cluster's,
+	// then draws outward facing clusters first (Sander et al. 2007)
+	inline void optimizeOverdraw(uint32_t*                    indices,
+								 const size_t                 indexCount,
+								 const void*                  positions,
+								 const size_t                 vertexCount,
+								 const size_t                 stride,
+								 const std::vector<uint32_t>& hardClusters,
+								 const float                  threshold = 1.05f,
+								 const uint32_t               cacheSize = 16,
+								 size_t*                      clusterCount = nullptr)
+	{
+		const size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0) return;
+
+		const uint8_t* bytes    = reinterpret_cast<const uint8_t*>(positions);
+		auto           position = [bytes, stride](uint32_t v) -> const DirectX::XMFLOAT3& {
+			return *reinterpret_cast<const DirectX::XMFLOAT3*>(bytes + v * stride);
+		};
+
+		// Soft boundaries
+		std::vector<uint32_t> clusters;
+		std::vector<uint32_t> loadedAt(vertexCount, 0);
+		uint32_t              timestamp = cacheSize + 1;
+
+		auto countMisses = [&](const size_t t) {
+			uint32_t misses = 0;
+			for (int c = 0; c < 3; ++c) {
+				const uint32_t v = indices[t * 3 + c];
+				if (timestamp - loadedAt[v] > cacheSize) {
+					loadedAt[v] = timestamp++;
+					++misses;
+				}
+			}
+			return misses;
+		};
+
+		for (size_t h = 0; h < hardClusters.size(); ++h) {
+			const size_t begin = hardClusters[h];
+			const size_t end   = h + 1 < hardClusters.size() ? hardClusters[h + 1] : triangleCount;
+			if (begin >= end) continue;
+
+			// Flushing the cache is a matter of moving the clock forward
+			timestamp += cacheSize + 1;
+			uint32_t clusterMisses = 0;
+			for (size_t t = begin; t < end; ++t) clusterMisses += countMisses(t);
+			const float limit = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+			timestamp += cacheSize + 1;
+			clusters.push_back(static_cast<uint32_t>(begin));
+
+			size_t   start  = begin;
+			uint32_t misses = 0;
+			for (size_t t = begin; t < end; ++t) {
+				misses += countMisses(t);
+
+				if (t + 1 < end && static_cast<float>(misses) <= limit * static_cast<float>(t + 1 - start)) {
+					clusters.push_back(static_cast<uint32_t>(t + 1));
+					start   = t + 1;
+					misses  = 0;
+					timestamp += cacheSize + 1;
+				}
+			}
+		}
+
+		// Mesh centroid
+		DirectX::XMFLOAT3 meshCentroid = { 0.0f, 0.0f, 0.0f };
+		float             meshArea     = 0.0f;
+
+		struct ClusterSort {
+			uint32_t          index;
+			float             key;
+			DirectX::XMFLOAT3 centroid;
+			DirectX::XMFLOAT3 normal;
+			float             area;
+		};
+		std::vector<ClusterSort> sorts(clusters.size());
+
+		for (size_t c = 0; c < clusters.size(); ++c) {
+			const size_t begin = clusters[c];
+			const size_t end   = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+			ClusterSort& sort = sorts[c];
+			sort = { static_cast<uint32_t>(c), 0.0f, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f }, 0.0f };
+
+			for (size_t t = begin; t < end; ++t) {
+				const DirectX::XMFLOAT3& a = position(indices[t * 3]);
+				const DirectX::XMFLOAT3& b = position(indices[t * 3 + 1]);
+				const DirectX::XMFLOAT3& d = position(indices[t * 3 + 2]);
+
+				const float ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+				const float vx = d.x - a.x, vy = d.y - a.y, vz = d.z - a.z;
+				const float nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+				const float area = std::sqrt(nx * nx + ny * ny + nz * nz);
+
+				// Normal is area weighted already
+				sort.normal.x += nx;
+				sort.normal.y += ny;
+				sort.normal.z += nz;
+
+				sort.centroid.x += (a.x + b.x + d.x) * (area / 3.0f);
+				sort.centroid.y += (a.y + b.y + d.y) * (area / 3.0f);
+				sort.centroid.z += (a.z + b.z + d.z) * (area / 3.0f);
+				sort.area       += area;
+			}
+
+			meshCentroid.x += sort.centroid.x;
+			meshCentroid.y += sort.centroid.y;
+			meshCentroid.z += sort.centroid.z;
+			meshArea       += sort.area;
+		}
+
+		const float inverseMeshArea = meshArea > 0.0f ? 1.0f / meshArea : 0.0f;
+		meshCentroid = { meshCentroid.x * inverseMeshArea, meshCentroid.y * inverseMeshArea, meshCentroid.z * inverseMeshArea };
+
+		for (ClusterSort& sort : sorts) {
+			const float inverseArea = sort.area > 0.0f ? 1.0f / sort.area : 0.0f;
+			const float dx          = sort.centroid.x * inverseArea - meshCentroid.x;
+			const float dy          = sort.centroid.y * inverseArea - meshCentroid.y;
+			const float dz          = sort.centroid.z * inverseArea - meshCentroid.z;
+
+			const float length = std::sqrt(sort.normal.x * sort.normal.x + sort.normal.y * sort.normal.y + sort.normal.z * sort.normal.z);
+			sort.key = length > 0.0f ? (dx * sort.normal.x + dy * sort.normal.y + dz * sort.normal.z) / length : 0.0f;
+		}
+
+		// Clusters facing away from the center occlude the rest, so they go first
+		std::stable_sort(sorts.begin(), sorts.end(), [](const ClusterSort& a, const ClusterSort& b) {
+			return a.key > b.key;
+		});
+
+		std::vector<uint32_t> output;
+		output.reserve(indexCount);
+		for (const ClusterSort& sort : sorts) {
+			const size_t begin = clusters[sort.index];
+			const size_t end   = sort.index + 1 < clusters.size() ? clusters[sort.index + 1] : triangleCount;
+			output.insert(output.end(), indices + begin * 3, indices + end * 3);
+		}
+		std::copy(output.begin(), output.end(), indices);
+
+		if (clusterCount) *clusterCount = clusters.size();
+	}
+
+	// Renumbers vertices in first use order, unreferenced vertices are dropped.
+	// Returns the new vertex count.
+	template <typename VertexTy>
+	size_t optimizeVertexFetch(std::vector<VertexTy>& vertices, std::vector<uint32_t>& indices) {
+		constexpr uint32_t unused = ~0u;
+
+		std::vector<uint32_t> remap(vertices.size(), unused);
+		std::vector<VertexTy> remapped;
+		remapped.reserve(vertices.size());
+
+		for (uint32_t& index : indices) {
+			if (remap[index] == unused) {
+				remap[index] = static_cast<uint32_t>(remapped.size());
+				remapped.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		vertices = std::move(remapped);
+		return vertices.size();
+	}
+
+	// Import time pipeline: cache order and overdraw order per level, then one fetch order for the shared buffer
+	template <typename VertexTy>
+	MeshOptimizationStats optimizeMesh(std::vector<VertexTy>&      vertices,
+									   std::vector<uint32_t>&      indices,
+									   const std::vector<MeshLod>& lods,
+									   const float                 overdrawThreshold = 1.05f,
+									   const uint32_t              cacheSize         = 16)
+	{
+		MeshOptimizationStats stats;
+		if (vertices.empty() || indices.empty()) return stats;
+
+		const uint32_t fullCount = lods.empty() ? static_cast<uint32_t>(indices.size()) : lods.front().indexCount;
+		stats.before = analyzeVertexCache(indices.data(), fullCount, vertices.size(), cacheSize);
+
+		std::vector<MeshLod> ranges = lods;
+		if (ranges.empty()) ranges.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+		std::vector<uint32_t> clusters;
+		for (size_t level = 0; level < ranges.size(); ++level) {
+			uint32_t*    begin = indices.data() + ranges[level].indexOffset;
+			const size_t count = ranges[level].indexCount;
+
+			optimizeVertexCache(begin, count, vertices.size(), cacheSize, &clusters);
+
+			size_t clusterCount = 0;
+			optimizeOverdraw(begin, count, &vertices[0].position, vertices.size(), sizeof(VertexTy), clusters, overdrawThreshold, cacheSize, &clusterCount);
+			if (level == 0) stats.clusterCount = clusterCount;
+		}
+
+		// Level 0 comes first in the index buffer, so its vertices end up in fetch order
+		optimizeVertexFetch(vertices, indices);
+
+		stats.after = analyzeVertexCache(indices.data(), fullCount, vertices.size(), cacheSize);
+		return stats;
+	}
+}
\ No newline at end of file
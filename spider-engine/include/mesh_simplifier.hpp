@@ -0,0 +1,451 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <cstdint>
+#include <numeric>
+#include <algorithm>
+#include <DirectXMath.h>
+
+namespace spider_engine::rendering {
+	// Range of the shared index buffer used by one level of detail
+	struct MeshLod {
+		uint32_t indexOffset = 0;
+		uint32_t indexCount  = 0;
+		float    error       = 0.0f; // Object space distance from the full resolution surface
+	};
+
+	// Quadric error simplifier (Garland-Heckbert) restricted to half-edge collapses,
+	// so every level keeps indexing the original vertex buffer
+	class MeshSimplifier {
+	private:
+		enum class VertexKind : uint8_t {
+			MANIFOLD,
+			BORDER,
+			LOCKED
+		};
+
+		// Symmetric 4x4 matrix plus the accumulated weight
+		struct Quadric {
+			double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+			double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+			double a22 = 0.0, a23 = 0.0;
+			double a33 = 0.0;
+			double weight = 0.0;
+
+			static Quadric fromPlane(const double a, const double b, const double c, const double d, const double weight) {
+				Quadric q;
+				q.a00 = a * a * weight; q.a01 = a * b * weight; q.a02 = a * c * weight; q.a03 = a * d * weight;
+				q.a11 = b * b * weight; q.a12 = b * c * weight; q.a13 = b * d * weight;
+				q.a22 = c * c * weight; q.a23 = c * d * weight;
+				q.a33 = d * d * weight;
+				q.weight = weight;
+				return q;
+			}
+
+			void add(const Quadric& other) {
+				a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+				a11 += other.a11; a12 += other.a12; a13 += other.a13;
+				a22 += other.a22; a23 += other.a23;
+				a33 += other.a33;
+				weight += other.weight;
+			}
+
+			// Mean squared distance to the accumulated planes
+			double evaluate(const DirectX::XMFLOAT3& p) const {
+				const double x = p.x, y = p.y, z = p.z;
+				const double error =
+					a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x +
+					a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y +
+					a22 * z * z + 2.0 * a23 * z +
+					a33;
+
+				return weight > 0.0 ? std::fabs(error) / weight : 0.0;
+			}
+		};
+
+		struct Collapse {
+			uint32_t source;
+			uint32_t target;
+			double   cost;
+		};
+
+		static constexpr double borderWeight_ = 10.0;
+
+		std::vector<DirectX::XMFLOAT3> positions_;
+
+		// First vertex sharing the same position, attribute seams collapse as one
+		std::vector<uint32_t>   canonical_;
+		std::vector<VertexKind> kinds_;
+		std::vector<Quadric>    quadrics_;
+		std::vector<uint64_t>   borderEdges_;
+
+		std::vector<uint32_t> indices_;
+
+		double maxCost_;
+
+		static uint64_t edgeKey(uint32_t a, uint32_t b) {
+			if (a > b) std::swap(a, b);
+			return (static_cast<uint64_t>(a) << 32) | b;
+		}
+
+		static DirectX::XMFLOAT3 triangleNormal(const DirectX::XMFLOAT3& a,
+												const DirectX::XMFLOAT3& b,
+												const DirectX::XMFLOAT3& c)
+		{
+			const float ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+			const float vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+			return { uy * vz - uz * vy, uz * vx - ux * vz, ux * vy - uy * vx };
+		}
+
+		void buildCanonical() {
+			const uint32_t vertexCount = static_cast<uint32_t>(positions_.size());
+
+			std::vector<uint32_t> order(vertexCount);
+			std::iota(order.begin(), order.end(), 0u);
+			auto less = [this](uint32_t a, uint32_t b) {
+				const DirectX::XMFLOAT3& pa = positions_[a];
+				const DirectX::XMFLOAT3& pb = positions_[b];
+				if (pa.x != pb.x) return pa.x < pb.x;
+				if (pa.y != pb.y) return pa.y < pb.y;
+				if (pa.z != pb.z) return pa.z < pb.z;
+				return a < b;
+			};
+			std::sort(order.begin(), order.end(), less);
+
+			canonical_.resize(vertexCount);
+			kinds_.assign(vertexCount, VertexKind::MANIFOLD);
+
+			for (uint32_t i = 0; i < vertexCount;) {
+				uint32_t end = i + 1;
+				while (end < vertexCount &&
+					   positions_[order[end]].x == positions_[order[i]].x &&
+					   positions_[order[end]].y == positions_[order[i]].y &&
+					   positions_[order[end]].z == positions_[order[i]].z)
+				{
+					++end;
+				}
+
+				for (uint32_t k = i; k < end; ++k) {
+					canonical_[order[k]] = order[i];
+					// Moving one side of a UV/normal seam would tear it
+					if (end - i > 1) kinds_[order[k]] = VertexKind::LOCKED;
+				}
+				i = end;
+			}
+		}
+
+		void buildQuadrics() {
+			quadrics_.assign(positions_.size(), Quadric{});
+
+			// Canonical edges, each one tagged with the triangle it came from
+			std::vector<std::pair<uint64_t, uint32_t>> edges;
+			edges.reserve(indices_.size());
+
+			for (size_t t = 0; t < indices_.size(); t += 3) {
+				const uint32_t a = canonical_[indices_[t]];
+				const uint32_t b = canonical_[indices_[t + 1]];
+				const uint32_t c = canonical_[indices_[t + 2]];
+
+				const DirectX::XMFLOAT3 n = triangleNormal(positions_[a], positions_[b], positions_[c]);
+				const double length = std::sqrt(double(n.x) * n.x + double(n.y) * n.y + double(n.z) * n.z);
+				if (length > 0.0) {
+					const double nx = n.x / length, ny = n.y / length, nz = n.z / length;
+					const double d  = -(nx * positions_[a].x + ny * positions_[a].y + nz * positions_[a].z);
+
+					// Weighted by area so large faces dominate
+					const Quadric q = Quadric::fromPlane(nx, ny, nz, d, length * 0.5);
+					quadrics_[a].add(q);
+					quadrics_[b].add(q);
+					quadrics_[c].add(q);
+				}
+
+				edges.push_back({ edgeKey(a, b), static_cast<uint32_t>(t) });
+				edges.push_back({ edgeKey(b, c), static_cast<uint32_t>(t) });
+				edges.push_back({ edgeKey(c, a), static_cast<uint32_t>(t) });
+			}
+
+			std::sort(edges.begin(), edges.end());
+
+			borderEdges_.clear();
+			for (size_t i = 0; i < edges.size();) {
+				size_t end = i + 1;
+				while (end < edges.size() && edges[end].first == edges[i].first) ++end;
+
+				const uint32_t a = static_cast<uint32_t>(edges[i].first >> 32);
+				const uint32_t b = static_cast<uint32_t>(edges[i].first & 0xffffffffu);
+
+				if (end - i == 1) {
+					borderEdges_.push_back(edges[i].first);
+
+					// Plane through the edge, perpendicular to its face, keeps the outline in place
+					const uint32_t t = edges[i].second;
+					const DirectX::XMFLOAT3 n = triangleNormal(
+						positions_[canonical_[indices_[t]]],
+						positions_[canonical_[indices_[t + 1]]],
+						positions_[canonical_[indices_[t + 2]]]
+					);
+					const DirectX::XMFLOAT3& pa = positions_[a];
+					const DirectX::XMFLOAT3& pb = positions_[b];
+					const double ex = pb.x - pa.x, ey = pb.y - pa.y, ez = pb.z - pa.z;
+
+					double px = ey * n.z - ez * n.y;
+					double py = ez * n.x - ex * n.z;
+					double pz = ex * n.y - ey * n.x;
+					const double length = std::sqrt(px * px + py * py + pz * pz);
+					if (length > 0.0) {
+						px /= length; py /= length; pz /= length;
+						const double d = -(px * pa.x + py * pa.y + pz * pa.z);
+						const double edgeLength = std::sqrt(ex * ex + ey * ey + ez * ez);
+
+						const Quadric q = Quadric::fromPlane(px, py, pz, d, edgeLength * edgeLength * borderWeight_);
+						quadrics_[a].add(q);
+						quadrics_[b].add(q);
+					}
+
+					if (kinds_[a] == VertexKind::MANIFOLD) kinds_[a] = VertexKind::BORDER;
+					if (kinds_[b] == VertexKind::MANIFOLD) kinds_[b] = VertexKind::BORDER;
+				}
+				else if (end - i > 2) {
+					// Non-manifold edges are left untouched
+					kinds_[a] = VertexKind::LOCKED;
+					kinds_[b] = VertexKind::LOCKED;
+				}
+				i = end;
+			}
+
+			// Wedges share the canonical quadric and classification
+			for (size_t v = 0; v < positions_.size(); ++v) {
+				if (kinds_[canonical_[v]] == VertexKind::LOCKED) kinds_[v] = VertexKind::LOCKED;
+			}
+		}
+
+		bool isBorderEdge(uint32_t a, uint32_t b) const {
+			return std::binary_search(borderEdges_.begin(), borderEdges_.end(), edgeKey(canonical_[a], canonical_[b]));
+		}
+
+		bool canCollapse(uint32_t source, uint32_t target) const {
+			switch (kinds_[source]) {
+				case VertexKind::MANIFOLD: return true;
+				case VertexKind::BORDER:   return kinds_[target] != VertexKind::MANIFOLD && isBorderEdge(source, target);
+				default:                   return false;
+			}
+		}
+
+		// Moving source onto target must not flip any surviving triangle
+		bool flipsTriangle(uint32_t source,
+						   uint32_t target,
+						   const std::vector<uint32_t>& triangleOffsets,
+						   const std::vector<uint32_t>& triangles) const
+		{
+			const uint32_t canonicalTarget = canonical_[target];
+
+			for (uint32_t k = triangleOffsets[source]; k < triangleOffsets[source + 1]; ++k) {
+				const uint32_t t = triangles[k];
+
+				uint32_t corners[3] = { indices_[t], indices_[t + 1], indices_[t + 2] };
+				if (canonical_[corners[0]] == canonicalTarget ||
+					canonical_[corners[1]] == canonicalTarget ||
+					canonical_[corners[2]] == canonicalTarget)
+				{
+					continue; // Collapses with the edge
+				}
+
+				const DirectX::XMFLOAT3 before = triangleNormal(positions_[corners[0]], positions_[corners[1]], positions_[corners[2]]);
+				for (uint32_t& corner : corners) {
+					if (corner == source) corner = target;
+				}
+				const DirectX::XMFLOAT3 after = triangleNormal(positions_[corners[0]], positions_[corners[1]], positions_[corners[2]]);
+
+				if (before.x * after.x + before.y * after.y + before.z * after.z <= 0.0f) return true;
+			}
+			return false;
+		}
+
+		// One batch of independent collapses, returns how many triangles were removed
+		size_t collapsePass(const size_t targetTriangleCount, const double maxCost) {
+			const uint32_t vertexCount   = static_cast<uint32_t>(positions_.size());
+			const size_t   triangleCount = indices_.size() / 3;
+
+			// Vertex to triangle adjacency (compressed rows)
+			std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+			for (uint32_t index : indices_) ++triangleOffsets[index + 1];
+			for (uint32_t v = 0; v < vertexCount; ++v) triangleOffsets[v + 1] += triangleOffsets[v];
+
+			std::vector<uint32_t> triangles(indices_.size());
+			std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < indices_.size(); ++i) {
+				triangles[cursor[indices_[i]]++] = static_cast<uint32_t>(i / 3 * 3);
+			}
+
+			// Candidates in both directions of every edge
+			std::vector<Collapse> collapses;
+			collapses.reserve(indices_.size());
+			for (size_t t = 0; t < indices_.size(); t += 3) {
+				for (int e = 0; e < 3; ++e) {
+					const uint32_t a = indices_[t + e];
+					const uint32_t b = indices_[t + (e + 1) % 3];
+
+					for (int direction = 0; direction < 2; ++direction) {
+						const uint32_t source = direction ? b : a;
+						const uint32_t target = direction ? a : b;
+						if (!canCollapse(source, target)) continue;
+
+						Quadric q = quadrics_[canonical_[source]];
+						q.add(quadrics_[canonical_[target]]);
+						collapses.push_back({ source, target, q.evaluate(positions_[target]) });
+					}
+				}
+			}
+
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+				return a.cost < b.cost;
+			});
+
+			std::vector<uint8_t>  locked(vertexCount, 0);
+			std::vector<uint32_t> remap(vertexCount);
+			std::iota(remap.begin(), remap.end(), 0u);
+
+			size_t removed = 0;
+			for (const Collapse& collapse : collapses) {
+				if (triangleCount - removed <= targetTriangleCount) break;
+				if (collapse.cost > maxCost) break;
+
+				const uint32_t source = collapse.source;
+				const uint32_t target = collapse.target;
+				if (locked[canonical_[source]] || locked[canonical_[target]]) continue;
+				if (flipsTriangle(source, target, triangleOffsets, triangles)) continue;
+
+				// Freeze the one-ring so the flip checks of later collapses stay valid
+				const uint32_t canonicalTarget = canonical_[target];
+				for (uint32_t k = triangleOffsets[source]; k < triangleOffsets[source + 1]; ++k) {
+					const uint32_t t = triangles[k];
+					bool isDegenerate = false;
+					for (int c = 0; c < 3; ++c) {
+						locked[canonical_[indices_[t + c]]] = 1;
+						isDegenerate |= canonical_[indices_[t + c]] == canonicalTarget;
+					}
+					if (isDegenerate) ++removed;
+				}
+
+				remap[source] = target;
+				quadrics_[canonicalTarget].add(quadrics_[canonical_[source]]);
+				maxCost_ = std::max(maxCost_, collapse.cost);
+			}
+
+			// Apply the collapses and drop triangles that became degenerate
+			size_t write = 0;
+			for (size_t t = 0; t < indices_.size(); t += 3) {
+				const uint32_t a = remap[indices_[t]];
+				const uint32_t b = remap[indices_[t + 1]];
+				const uint32_t c = remap[indices_[t + 2]];
+				if (canonical_[a] == canonical_[b] || canonical_[b] == canonical_[c] || canonical_[c] == canonical_[a]) continue;
+
+				indices_[write++] = a;
+				indices_[write++] = b;
+				indices_[write++] = c;
+			}
+			indices_.resize(write);
+
+			return triangleCount - write / 3;
+		}
+
+	public:
+		// Positions are read with a byte stride so vertex arrays can be passed directly
+		MeshSimplifier(const void*                  positions,
+					   const size_t                 vertexCount,
+					   const size_t                 stride,
+					   const std::vector<uint32_t>& indices) :
+			indices_(indices),
+			maxCost_(0.0)
+		{
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(positions);
+
+			positions_.resize(vertexCount);
+			for (size_t v = 0; v < vertexCount; ++v) {
+				positions_[v] = *reinterpret_cast<const DirectX::XMFLOAT3*>(bytes + v * stride);
+			}
+
+			buildCanonical();
+			buildQuadrics();
+		}
+		MeshSimplifier(const MeshSimplifier&)     = default;
+		MeshSimplifier(MeshSimplifier&&) noexcept = default;
+
+		// Keeps simplifying the current result, so successive calls build a LOD chain
+		const std::vector<uint32_t>& simplify(const size_t targetIndexCount, const float maxError) {
+			const size_t targetTriangleCount = std::max<size_t>(targetIndexCount / 3, 1);
+			const double maxCost             = double(maxError) * double(maxError);
+
+			while (indices_.size() / 3 > targetTriangleCount) {
+				if (collapsePass(targetTriangleCount, maxCost) == 0) break;
+			}
+			return indices_;
+		}
+
+		const std::vector<uint32_t>& getIndices() const {
+			return indices_;
+		}
+		float getError() const {
+			return static_cast<float>(std::sqrt(maxCost_));
+		}
+
+		MeshSimplifier& operator=(const MeshSimplifier&)     = default;
+		MeshSimplifier& operator=(MeshSimplifier&&) noexcept = default;
+	};
+
+	// Level to draw when one object space unit covers pixelsPerUnit pixels. Errors grow with the level,
+	// so the coarsest acceptable level is the last one under the limit.
+	inline uint32_t selectLodLevel(const std::vector<MeshLod>& lods,
+								   const float                 pixelsPerUnit,
+								   const uint32_t              current,
+								   const float                 pixelError,
+								   const float                 hysteresis)
+	{
+		if (lods.empty()) return 0;
+
+		auto coarsest = [&lods, pixelsPerUnit](const float limit) {
+			uint32_t level = 0;
+			while (level + 1 < lods.size() && lods[level + 1].error * pixelsPerUnit <= limit) ++level;
+			return level;
+		};
+
+		const uint32_t level = std::min<uint32_t>(current, static_cast<uint32_t>(lods.size() - 1));
+
+		// Only coarsen once the next level is comfortably under the limit
+		const uint32_t coarser = coarsest(pixelError * (1.0f - hysteresis));
+		if (coarser > level) return coarser;
+
+		// Only refine once the current level is clearly over it
+		if (lods[level].error * pixelsPerUnit > pixelError * (1.0f + hysteresis)) return coarsest(pixelError);
+
+		return level;
+	}
+
+	// Appends every coarser level to indices, level 0 is the original range
+	inline std::vector<MeshLod> generateLodChain(const void*            positions,
+												 const size_t           vertexCount,
+												 const size_t           stride,
+												 std::vector<uint32_t>& indices,
+												 const uint32_t         maxLodCount = 4,
+												 const float            maxError    = FLT_MAX)
+	{
+		std::vector<MeshLod> lods;
+		lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+		if (maxLodCount <= 1 || indices.size() < 3) return lods;
+
+		MeshSimplifier simplifier(positions, vertexCount, stride, indices);
+
+		for (uint32_t level = 1; level < maxLodCount; ++level) {
+			const size_t previousCount = lods.back().indexCount;
+			const std::vector<uint32_t>& simplified = simplifier.simplify(previousCount / 2, maxError);
+
+			// Stop once a level no longer pays for its indices
+			if (simplified.size() * 10 > previousCount * 9) break;
+
+			lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplified.size()), simplifier.getError() });
+			indices.insert(indices.end(), simplified.begin(), simplified.end());
+		}
+		return lods;
+	}
+}
\ No newline at end of file
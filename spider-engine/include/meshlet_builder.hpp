@@ -0,0 +1,256 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <DirectXMath.h>
+
+#include "types.hpp"
+#include "frustum_culling.hpp"
+
+namespace spider_engine::rendering {
+	struct Meshlet {
+		uint32_t vertexOffset;   // Into MeshletData::vertices
+		uint32_t triangleOffset; // Into MeshletData::triangles, three local indices per triangle
+		uint32_t vertexCount;
+		uint32_t triangleCount;
+	};
+
+	// Object space culling data of one meshlet
+	struct MeshletBounds {
+		DirectX::XMFLOAT3 center;
+		float             radius;
+
+		// Normal cone, backfacing when dot(center - eye, axis) >= cutoff * |center - eye| + radius.
+		// Only valid for pipelines that cull backfaces.
+		DirectX::XMFLOAT3 coneAxis;
+		float             coneCutoff; // 1 when the normals spread too much to ever cull
+	};
+
+	struct MeshletData {
+		std::vector<Meshlet>       meshlets;
+		std::vector<MeshletBounds> bounds;
+		std::vector<uint32_t>      vertices;  // Mesh vertex index of every local vertex
+		std::vector<uint8_t>       triangles; // Local vertex indices
+
+		static constexpr uint32_t maxVertices  = 64;
+		static constexpr uint32_t maxTriangles = 124;
+	};
+
+	struct MeshletCullingStats {
+		size_t tested           = 0;
+		size_t frustumCulled    = 0;
+		size_t visible          = 0;
+		size_t visibleTriangles = 0;
+		double cullMilliseconds = 0.0;
+	};
+
+	// Greedy scan in index order, expects indices already ordered for the vertex cache
+	inline MeshletData buildMeshlets(const uint32_t* indices,
+									 const size_t    indexCount,
+									 const void*     positions,
+									 const size_t    vertexCount,
+									 const size_t    stride)
+	{
+		constexpr uint8_t unused = 0xff;
+
+		MeshletData data;
+		data.meshlets.reserve(indexCount / 3 / MeshletData::maxTriangles + 1);
+		data.vertices.reserve(indexCount / 3);
+		data.triangles.reserve(indexCount);
+
+		// Local index of each mesh vertex in the meshlet being built
+		std::vector<uint8_t> local(vertexCount, unused);
+
+		Meshlet current = { 0, 0, 0, 0 };
+
+		auto flush = [&]() {
+			if (current.triangleCount == 0) return;
+
+			for (uint32_t v = 0; v < current.vertexCount; ++v) {
+				local[data.vertices[current.vertexOffset + v]] = unused;
+			}
+			data.meshlets.push_back(current);
+
+			current = { static_cast<uint32_t>(data.vertices.size()), static_cast<uint32_t>(data.triangles.size()), 0, 0 };
+		};
+
+		for (size_t i = 0; i + 2 < indexCount; i += 3) {
+			const uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+
+			const uint32_t newVertices = (local[a] == unused) + (local[b] == unused) + (local[c] == unused);
+			if (current.vertexCount + newVertices > MeshletData::maxVertices ||
+				current.triangleCount + 1 > MeshletData::maxTriangles)
+			{
+				flush();
+			}
+
+			for (uint32_t v : { a, b, c }) {
+				if (local[v] == unused) {
+					local[v] = static_cast<uint8_t>(current.vertexCount++);
+					data.vertices.push_back(v);
+				}
+				data.triangles.push_back(local[v]);
+			}
+			++current.triangleCount;
+		}
+		flush();
+
+		// Bounds and normal cones
+		const uint8_t* bytes    = reinterpret_cast<const uint8_t*>(positions);
+		auto           position = [bytes, stride](uint32_t v) {
+			return DirectX::XMLoadFloat3(reinterpret_cast<const DirectX::XMFLOAT3*>(bytes + v * stride));
+		};
+
+		std::vector<DirectX::XMFLOAT3> normals;
+		normals.reserve(MeshletData::maxTriangles);
+
+		data.bounds.resize(data.meshlets.size());
+		for (size_t m = 0; m < data.meshlets.size(); ++m) {
+			const Meshlet& meshlet = data.meshlets[m];
+			MeshletBounds& bounds  = data.bounds[m];
+
+			// Sphere around the box center
+			DirectX::XMVECTOR min = position(data.vertices[meshlet.vertexOffset]);
+			DirectX::XMVECTOR max = min;
+			for (uint32_t v = 1; v < meshlet.vertexCount; ++v) {
+				const DirectX::XMVECTOR p = position(data.vertices[meshlet.vertexOffset + v]);
+				min = DirectX::XMVectorMin(min, p);
+				max = DirectX::XMVectorMax(max, p);
+			}
+			const DirectX::XMVECTOR center = DirectX::XMVectorScale(DirectX::XMVectorAdd(min, max), 0.5f);
+
+			float radiusSq = 0.0f;
+			for (uint32_t v = 0; v < meshlet.vertexCount; ++v) {
+				const DirectX::XMVECTOR offset = DirectX::XMVectorSubtract(position(data.vertices[meshlet.vertexOffset + v]), center);
+				radiusSq = std::max(radiusSq, DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(offset)));
+			}
+			DirectX::XMStoreFloat3(&bounds.center, center);
+			bounds.radius = std::sqrt(radiusSq);
+
+			// Cone axis is the mean normal, cutoff is the sine of the widest normal deviation
+			normals.clear();
+
+			DirectX::XMVECTOR axis = DirectX::XMVectorZero();
+			for (uint32_t t = 0; t < meshlet.triangleCount; ++t) {
+				const uint8_t* corners = &data.triangles[meshlet.triangleOffset + t * 3];
+				const DirectX::XMVECTOR p0 = position(data.vertices[meshlet.vertexOffset + corners[0]]);
+				const DirectX::XMVECTOR p1 = position(data.vertices[meshlet.vertexOffset + corners[1]]);
+				const DirectX::XMVECTOR p2 = position(data.vertices[meshlet.vertexOffset + corners[2]]);
+
+				const DirectX::XMVECTOR normal = DirectX::XMVector3Cross(
+					DirectX::XMVectorSubtract(p1, p0),
+					DirectX::XMVectorSubtract(p2, p0)
+				);
+				if (DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(normal)) == 0.0f) continue;
+
+				const DirectX::XMVECTOR unit = DirectX::XMVector3Normalize(normal);
+				DirectX::XMStoreFloat3(&normals.emplace_back(), unit);
+				axis = DirectX::XMVectorAdd(axis, unit);
+			}
+
+			bounds.coneAxis   = { 0.0f, 0.0f, 0.0f };
+			bounds.coneCutoff = 1.0f;
+
+			const float axisLengthSq = DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(axis));
+			if (normals.empty() || axisLengthSq == 0.0f) continue;
+
+			axis = DirectX::XMVector3Normalize(axis);
+
+			float minDot = 1.0f;
+			for (const DirectX::XMFLOAT3& normal : normals) {
+				minDot = std::min(minDot, DirectX::XMVectorGetX(DirectX::XMVector3Dot(DirectX::XMLoadFloat3(&normal), axis)));
+			}
+
+			DirectX::XMStoreFloat3(&bounds.coneAxis, axis);
+
+			// A cone wider than a hemisphere can never be entirely backfacing
+			if (minDot > 0.0f) bounds.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+
+		return data;
+	}
+
+	// CPU cluster culling for regular indexed draws when mesh shaders are not available, the renderer does not use it yet
+	class MeshletCuller {
+	private:
+		std::vector<uint32_t> visible_;
+
+		MeshletCullingStats stats_;
+
+	public:
+		MeshletCuller() = default;
+		MeshletCuller(const MeshletCuller&)     = default;
+		MeshletCuller(MeshletCuller&&) noexcept = default;
+
+		// The frustum is in world space, meshlets are tested in object space. No cone test: the scene
+		// pipeline draws both faces, so a meshlet facing away can still be seen.
+		const std::vector<uint32_t>& cull(const MeshletData& data,
+										  const Frustum&     frustum,
+										  DirectX::FXMMATRIX world)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			visible_.clear();
+			stats_ = {};
+
+			// Row vector planes go to object space through the transposed world matrix
+			const DirectX::XMMATRIX worldTransposed = DirectX::XMMatrixTranspose(world);
+
+			Frustum objectFrustum;
+			for (int p = 0; p < 6; ++p) {
+				const DirectX::XMVECTOR plane = DirectX::XMVector4Transform(DirectX::XMLoadFloat4(&frustum.planes[p]), worldTransposed);
+				DirectX::XMStoreFloat4(&objectFrustum.planes[p], DirectX::XMPlaneNormalize(plane));
+			}
+
+			for (uint32_t m = 0; m < data.meshlets.size(); ++m) {
+				const MeshletBounds& bounds = data.bounds[m];
+				++stats_.tested;
+
+				bool isOutside = false;
+				for (const auto& plane : objectFrustum.planes) {
+					const float distance = plane.x * bounds.center.x + plane.y * bounds.center.y + plane.z * bounds.center.z + plane.w;
+					if (distance < -bounds.radius) {
+						isOutside = true;
+						break;
+					}
+				}
+				if (isOutside) {
+					++stats_.frustumCulled;
+					continue;
+				}
+
+				visible_.push_back(m);
+				stats_.visibleTriangles += data.meshlets[m].triangleCount;
+			}
+
+			auto finish = std::chrono::steady_clock::now();
+
+			stats_.visible          = visible_.size();
+			stats_.cullMilliseconds = std::chrono::duration<double, std::milli>(finish - start).count();
+
+			return visible_;
+		}
+
+		// Expands the visible meshlets back to mesh indices for a regular indexed draw
+		void appendIndices(const MeshletData& data, std::vector<uint32_t>& indices) const {
+			for (uint32_t m : visible_) {
+				const Meshlet& meshlet = data.meshlets[m];
+				for (uint32_t i = 0; i < meshlet.triangleCount * 3; ++i) {
+					indices.push_back(data.vertices[meshlet.vertexOffset + data.triangles[meshlet.triangleOffset + i]]);
+				}
+			}
+		}
+
+		const std::vector<uint32_t>& getVisible() const {
+			return visible_;
+		}
+		const MeshletCullingStats& getStats() const {
+			return stats_;
+		}
+
+		MeshletCuller& operator=(const MeshletCuller&)     = default;
+		MeshletCuller& operator=(MeshletCuller&&) noexcept = default;
+	};
+}
\ No newline at end of file
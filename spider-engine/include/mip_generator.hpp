@@ -0,0 +1,340 @@
+#pragma once
+#include <cmath>
+#include <array>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <algorithm>
+#include <execution>
+#include <immintrin.h>
+
+namespace spider_engine::rendering {
+	enum class MipFilter : uint8_t {
+		BOX,   // 2x2 average, the cheapest
+		KAISER // Kaiser windowed sinc over 8x8 texels, sharper and less aliasing
+	};
+
+	struct MipSettings {
+		MipFilter filter     = MipFilter::BOX;
+		bool      isSrgb     = true; // Color channels are filtered in linear space, alpha always is
+		bool      isParallel = true;
+		uint32_t  maxLevels  = 0;    // 0 builds the full chain down to 1x1
+	};
+
+	struct MipLevel {
+		uint32_t width;
+		uint32_t height;
+		size_t   offset; // Into MipChain::pixels, rows are tightly packed
+	};
+
+	// RGBA8 chain, level 0 first
+	struct MipChain {
+		std::vector<MipLevel> levels;
+		std::vector<uint8_t>  pixels;
+
+		const uint8_t* getPixels(const uint32_t level) const {
+			return pixels.data() + levels[level].offset;
+		}
+		size_t getRowPitch(const uint32_t level) const {
+			return size_t(levels[level].width) * 4;
+		}
+	};
+
+	struct MipGenerationStats {
+		size_t levelCount      = 0;
+		size_t sourcePixels    = 0;
+		size_t generatedPixels = 0; // Every level below the source
+		double milliseconds    = 0.0;
+
+		double getMegapixelsPerSecond() const {
+			return milliseconds > 0.0 ? sourcePixels / (milliseconds * 1000.0) : 0.0;
+		}
+	};
+
+	inline uint32_t getMipLevelCount(const uint32_t width, const uint32_t height) {
+		uint32_t levels = 1;
+		for (uint32_t size = std::max(width, height); size > 1; size >>= 1) ++levels;
+		return levels;
+	}
+
+	// Box and Kaiser downsampling of RGBA8 images. Each level is filtered from the previous one in linear
+	// float, rows are split across threads and the filters work on whole texels in SIMD registers.
+	class MipGenerator {
+	private:
+		static constexpr size_t linearTableSize_ = 16384;
+		static constexpr int    kaiserTaps_      = 8;
+
+		// Linear float texels of one level
+		struct FloatImage {
+			uint32_t           width  = 0;
+			uint32_t           height = 0;
+			std::vector<float> texels;
+
+			float* row(const uint32_t y) {
+				return texels.data() + size_t(y) * width * 4;
+			}
+			const float* row(const uint32_t y) const {
+				return texels.data() + size_t(y) * width * 4;
+			}
+		};
+
+		static const std::array<float, 256>& getSrgbToLinear() {
+			static const std::array<float, 256> table = []() {
+				std::array<float, 256> values;
+				for (int i = 0; i < 256; ++i) {
+					const float c = i / 255.0f;
+					values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+				}
+				return values;
+			}();
+			return table;
+		}
+		static const std::array<uint8_t, linearTableSize_>& getLinearToSrgb() {
+			static const std::array<uint8_t, linearTableSize_> table = []() {
+				std::array<uint8_t, linearTableSize_> values;
+				for (size_t i = 0; i < linearTableSize_; ++i) {
+					const float l = static_cast<float>(i) / (linearTableSize_ - 1);
+					const float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+					values[i] = static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+				}
+				return values;
+			}();
+			return table;
+		}
+
+		// Kaiser window (alpha 4) over a sinc with a two texel support, normalized. A 2x downsample always
+		// lands halfway between the same source texels, so one set of weights serves every output texel.
+		static const std::array<float, kaiserTaps_>& getKaiserWeights() {
+			static const std::array<float, kaiserTaps_> weights = []() {
+				auto besselI0 = [](const float x) {
+					float sum = 1.0f, term = 1.0f;
+					for (int k = 1; k < 16; ++k) {
+						term *= (x / (2.0f * k)) * (x / (2.0f * k));
+						sum  += term;
+					}
+					return sum;
+				};
+
+				constexpr float alpha   = 4.0f;
+				constexpr float support = 2.0f; // In output texels
+				constexpr float pi      = 3.14159265358979f;
+
+				std::array<float, kaiserTaps_> values;
+				for (int t = 0; t < kaiserTaps_; ++t) {
+					// Source texel centers relative to the output center, in output texels
+					const float d      = (t - kaiserTaps_ / 2 + 0.5f) * 0.5f;
+					const float sinc   = d == 0.0f ? 1.0f : std::sin(pi * d) / (pi * d);
+					const float ratio  = d / support;
+					const float window = besselI0(alpha * std::sqrt(std::max(0.0f, 1.0f - ratio * ratio))) / besselI0(alpha);
+					values[t] = sinc * window;
+				}
+				const float sum = std::accumulate(values.begin(), values.end(), 0.0f);
+				for (float& value : values) value /= sum;
+				return values;
+			}();
+			return weights;
+		}
+
+		template <typename Fn>
+		static void forEachRow(const uint32_t rows, const bool isParallel, Fn&& fn) {
+			if (!isParallel || rows < 64) {
+				for (uint32_t y = 0; y < rows; ++y) fn(y);
+				return;
+			}
+
+			// Bands of rows, enough of them to balance but not so small that scheduling dominates
+			constexpr uint32_t bandRows  = 16;
+			const uint32_t     bandCount = (rows + bandRows - 1) / bandRows;
+
+			std::vector<uint32_t> bands(bandCount);
+			std::iota(bands.begin(), bands.end(), 0u);
+			std::for_each(std::execution::par, bands.begin(), bands.end(), [&](const uint32_t band) {
+				const uint32_t end = std::min(rows, (band + 1) * bandRows);
+				for (uint32_t y = band * bandRows; y < end; ++y) fn(y);
+			});
+		}
+
+		static void decode(const uint8_t* source,
+						   const uint32_t width,
+						   const uint32_t height,
+						   const size_t   rowPitch,
+						   const bool     isSrgb,
+						   const bool     isParallel,
+						   FloatImage&    out)
+		{
+			const std::array<float, 256>& toLinear = getSrgbToLinear();
+
+			out.width  = width;
+			out.height = height;
+			out.texels.resize(size_t(width) * height * 4);
+
+			forEachRow(height, isParallel, [&](const uint32_t y) {
+				const uint8_t* in  = source + y * rowPitch;
+				float*         row = out.row(y);
+				for (uint32_t x = 0; x < width * 4; x += 4) {
+					row[x + 0] = isSrgb ? toLinear[in[x + 0]] : in[x + 0] / 255.0f;
+					row[x + 1] = isSrgb ? toLinear[in[x + 1]] : in[x + 1] / 255.0f;
+					row[x + 2] = isSrgb ? toLinear[in[x + 2]] : in[x + 2] / 255.0f;
+					row[x + 3] = in[x + 3] / 255.0f;
+				}
+			});
+		}
+
+		static void encode(const FloatImage& image, const bool isSrgb, const bool isParallel, uint8_t* out) {
+			const std::array<uint8_t, linearTableSize_>& toSrgb = getLinearToSrgb();
+
+			forEachRow(image.height, isParallel, [&](const uint32_t y) {
+				const float* row = image.row(y);
+				uint8_t*     dst = out + size_t(y) * image.width * 4;
+
+				const __m128 zero  = _mm_setzero_ps();
+				const __m128 one   = _mm_set1_ps(1.0f);
+				const __m128 scale = isSrgb ? _mm_setr_ps(linearTableSize_ - 1.0f, linearTableSize_ - 1.0f, linearTableSize_ - 1.0f, 255.0f)
+											: _mm_set1_ps(255.0f);
+
+				for (uint32_t x = 0; x < image.width; ++x) {
+					// Sharp filters overshoot, clamp before quantizing
+					const __m128 texel = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(row + x * 4), zero), one);
+					alignas(16) int32_t q[4];
+					_mm_store_si128(reinterpret_cast<__m128i*>(q), _mm_cvtps_epi32(_mm_mul_ps(texel, scale)));
+
+					dst[x * 4 + 0] = isSrgb ? toSrgb[q[0]] : static_cast<uint8_t>(q[0]);
+					dst[x * 4 + 1] = isSrgb ? toSrgb[q[1]] : static_cast<uint8_t>(q[1]);
+					dst[x * 4 + 2] = isSrgb ? toSrgb[q[2]] : static_cast<uint8_t>(q[2]);
+					dst[x * 4 + 3] = static_cast<uint8_t>(q[3]);
+				}
+			});
+		}
+
+		// Odd sizes clamp the last source row and column
+		static void downsampleBox(const FloatImage& source, FloatImage& out, const bool isParallel) {
+			forEachRow(out.height, isParallel, [&](const uint32_t y) {
+				const float* row0 = source.row(std::min(2 * y, source.height - 1));
+				const float* row1 = source.row(std::min(2 * y + 1, source.height - 1));
+				float*       dst  = out.row(y);
+
+				uint32_t x = 0;
+#if defined(__AVX__)
+				// Two output texels per iteration while both source pairs are inside the row
+				const __m256 quarter = _mm256_set1_ps(0.25f);
+				for (; 4 * x + 3 < source.width && x + 1 < out.width; x += 2) {
+					const __m256 a = _mm256_add_ps(_mm256_loadu_ps(row0 + 8 * x), _mm256_loadu_ps(row1 + 8 * x));
+					const __m256 b = _mm256_add_ps(_mm256_loadu_ps(row0 + 8 * x + 8), _mm256_loadu_ps(row1 + 8 * x + 8));
+
+					// a = [p0 p1], b = [p2 p3] -> [p0 + p1, p2 + p3]
+					const __m256 sum = _mm256_add_ps(_mm256_permute2f128_ps(a, b, 0x20), _mm256_permute2f128_ps(a, b, 0x31));
+					_mm256_storeu_ps(dst + 4 * x, _mm256_mul_ps(sum, quarter));
+				}
+#endif
+				const __m128 quarter4 = _mm_set1_ps(0.25f);
+				for (; x < out.width; ++x) {
+					const uint32_t x0 = std::min(2 * x, source.width - 1) * 4;
+					const uint32_t x1 = std::min(2 * x + 1, source.width - 1) * 4;
+
+					__m128 sum = _mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1));
+					sum        = _mm_add_ps(sum, _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1)));
+					_mm_storeu_ps(dst + 4 * x, _mm_mul_ps(sum, quarter4));
+				}
+			});
+		}
+
+		// Separable, horizontal into scratch then vertical, edges clamp
+		static void downsampleKaiser(const FloatImage& source, FloatImage& scratch, FloatImage& out, const bool isParallel) {
+			const std::array<float, kaiserTaps_>& weights = getKaiserWeights();
+
+			scratch.width  = out.width;
+			scratch.height = source.height;
+			scratch.texels.resize(size_t(scratch.width) * scratch.height * 4);
+
+			auto tap = [](const uint32_t center, const int t, const uint32_t size) {
+				const int index = static_cast<int>(2 * center) + t - kaiserTaps_ / 2 + 1;
+				return static_cast<uint32_t>(std::clamp(index, 0, static_cast<int>(size) - 1));
+			};
+
+			forEachRow(scratch.height, isParallel, [&](const uint32_t y) {
+				const float* row = source.row(y);
+				float*       dst = scratch.row(y);
+				for (uint32_t x = 0; x < scratch.width; ++x) {
+					__m128 sum = _mm_setzero_ps();
+					for (int t = 0; t < kaiserTaps_; ++t) {
+						sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + tap(x, t, source.width) * 4), _mm_set1_ps(weights[t])));
+					}
+					_mm_storeu_ps(dst + 4 * x, sum);
+				}
+			});
+
+			forEachRow(out.height, isParallel, [&](const uint32_t y) {
+				const float* rows[kaiserTaps_];
+				for (int t = 0; t < kaiserTaps_; ++t) rows[t] = scratch.row(tap(y, t, scratch.height));
+
+				float* dst = out.row(y);
+				for (uint32_t x = 0; x < out.width * 4; x += 4) {
+					__m128 sum = _mm_setzero_ps();
+					for (int t = 0; t < kaiserTaps_; ++t) {
+						sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[t] + x), _mm_set1_ps(weights[t])));
+					}
+					_mm_storeu_ps(dst + x, sum);
+				}
+			});
+		}
+
+	public:
+		// Level 0 is copied from the source, which may have padded rows
+		static MipChain generate(const uint8_t*      source,
+								 const uint32_t      width,
+								 const uint32_t      height,
+								 const size_t        rowPitch,
+								 const MipSettings&  settings = {},
+								 MipGenerationStats* stats    = nullptr)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			uint32_t levelCount = getMipLevelCount(width, height);
+			if (settings.maxLevels) levelCount = std::min(levelCount, settings.maxLevels);
+
+			MipChain chain;
+			size_t   total = 0;
+			for (uint32_t level = 0, w = width, h = height; level < levelCount; ++level) {
+				chain.levels.push_back({ w, h, total });
+				total += size_t(w) * h * 4;
+				w      = std::max(1u, w / 2);
+				h      = std::max(1u, h / 2);
+			}
+			chain.pixels.resize(total);
+
+			for (uint32_t y = 0; y < height; ++y) {
+				std::memcpy(chain.pixels.data() + size_t(y) * width * 4, source + y * rowPitch, size_t(width) * 4);
+			}
+
+			if (levelCount > 1) {
+				FloatImage current, next, scratch;
+				decode(source, width, height, rowPitch, settings.isSrgb, settings.isParallel, current);
+
+				for (uint32_t level = 1; level < levelCount; ++level) {
+					next.width  = chain.levels[level].width;
+					next.height = chain.levels[level].height;
+					next.texels.resize(size_t(next.width) * next.height * 4);
+
+					if (settings.filter == MipFilter::KAISER) downsampleKaiser(current, scratch, next, settings.isParallel);
+					else                                      downsampleBox(current, next, settings.isParallel);
+
+					encode(next, settings.isSrgb, settings.isParallel, chain.pixels.data() + chain.levels[level].offset);
+					std::swap(current, next);
+				}
+			}
+
+			if (stats) {
+				auto finish = std::chrono::steady_clock::now();
+
+				stats->levelCount      = levelCount;
+				stats->sourcePixels    = size_t(width) * height;
+				stats->generatedPixels = total / 4 - stats->sourcePixels;
+				stats->milliseconds    = std::chrono::duration<double, std::milli>(finish - start).count();
+			}
+
+			return chain;
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,371 @@
+#pragma once
+#include <vector>
+#include <cfloat>
+#include <chrono>
+#include <algorithm>
+#include <immintrin.h>
+#include <DirectXMath.h>
+
+#include "types.hpp"
+
+namespace spider_engine::rendering {
+	// Simplified geometry rasterized into the occlusion buffer
+	struct OccluderMesh {
+		std::vector<DirectX::XMFLOAT3> positions;
+		std::vector<uint32_t>          indices;
+	};
+
+	struct OcclusionStats {
+		size_t occluderCount       = 0;
+		size_t occluderTriangles   = 0;
+		size_t rasterizedTriangles = 0;
+		size_t tested              = 0;
+		size_t culled              = 0;
+
+		double rasterMilliseconds = 0.0;
+		double testMilliseconds   = 0.0;
+
+		double getCulledPercentage() const {
+			return tested ? 100.0 * static_cast<double>(culled) / static_cast<double>(tested) : 0.0;
+		}
+	};
+
+	class OcclusionCuller {
+	private:
+		static constexpr uint32_t tileWidth_  = 8;
+		static constexpr uint32_t tileHeight_ = 4;
+		static constexpr float    nearW_      = 1e-4f;
+
+		uint32_t width_;
+		uint32_t height_;
+		uint32_t tilesX_;
+		uint32_t tilesY_;
+
+		// Post-projection depth (0 near, 1 far), nearest occluder wins
+		std::vector<float> depth_;
+		// Farthest depth per tile, lets most occludee tests stop at tile level
+		std::vector<float> tileMaxDepth_;
+
+		DirectX::XMMATRIX viewProjection_;
+
+		bool isHierarchyDirty_;
+
+		OcclusionStats stats_;
+
+		void updateTileMaxDepth() {
+			for (uint32_t ty = 0; ty < tilesY_; ++ty) {
+				for (uint32_t tx = 0; tx < tilesX_; ++tx) {
+					float maxDepth = 0.0f;
+					for (uint32_t y = ty * tileHeight_; y < (ty + 1) * tileHeight_; ++y) {
+						const float* row = &depth_[y * width_ + tx * tileWidth_];
+						for (uint32_t x = 0; x < tileWidth_; ++x) {
+							maxDepth = std::max(maxDepth, row[x]);
+						}
+					}
+					tileMaxDepth_[ty * tilesX_ + tx] = maxDepth;
+				}
+			}
+			isHierarchyDirty_ = false;
+		}
+
+		void rasterizeTriangle(const DirectX::XMFLOAT3& v0,
+							   const DirectX::XMFLOAT3& v1,
+							   const DirectX::XMFLOAT3& v2)
+		{
+			// Orient edges so that the inside is positive regardless of winding
+			float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+			if (std::fabs(area) < 1e-8f) return;
+
+			const DirectX::XMFLOAT3& a = v0;
+			const DirectX::XMFLOAT3& b = area > 0.0f ? v1 : v2;
+			const DirectX::XMFLOAT3& c = area > 0.0f ? v2 : v1;
+			area = std::fabs(area);
+
+			// Screen bounds
+			const int minX = std::max(0, static_cast<int>(std::floor(std::min({ a.x, b.x, c.x }))));
+			const int maxX = std::min(static_cast<int>(width_) - 1, static_cast<int>(std::ceil(std::max({ a.x, b.x, c.x }))));
+			const int minY = std::max(0, static_cast<int>(std::floor(std::min({ a.y, b.y, c.y }))));
+			const int maxY = std::min(static_cast<int>(height_) - 1, static_cast<int>(std::ceil(std::max({ a.y, b.y, c.y }))));
+			if (minX > maxX || minY > maxY) return;
+
+			// Edge functions E(p) = A * x + B * y + C
+			const float a0 = b.y - c.y, b0 = c.x - b.x, c0 = b.x * c.y - b.y * c.x;
+			const float a1 = c.y - a.y, b1 = a.x - c.x, c1 = c.x * a.y - c.y * a.x;
+			const float a2 = a.y - b.y, b2 = b.x - a.x, c2 = a.x * b.y - a.y * b.x;
+
+			// Depth plane z(x, y) = dzdx * x + dzdy * y + z0
+			const float inverseArea = 1.0f / area;
+			const float dzdx        = (a0 * a.z + a1 * b.z + a2 * c.z) * inverseArea;
+			const float dzdy        = (b0 * a.z + b1 * b.z + b2 * c.z) * inverseArea;
+			const float dz0         = (c0 * a.z + c1 * b.z + c2 * c.z) * inverseArea;
+
+			const int startX = minX & ~static_cast<int>(tileWidth_ - 1);
+
+#if defined(__AVX2__)
+			const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+			const __m256 zero        = _mm256_setzero_ps();
+			const __m256i laneIndex  = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+			for (int y = minY; y <= maxY; ++y) {
+				const float py = static_cast<float>(y) + 0.5f;
+				float*      row = &depth_[y * width_];
+
+				for (int x = startX; x <= maxX; x += tileWidth_) {
+					const __m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), laneOffsets);
+
+					const __m256 e0 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a0), px), _mm256_set1_ps(b0 * py + c0));
+					const __m256 e1 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a1), px), _mm256_set1_ps(b1 * py + c1));
+					const __m256 e2 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a2), px), _mm256_set1_ps(b2 * py + c2));
+
+					// Strictly inside keeps the occluder conservative on its edges
+					__m256 inside = _mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GT_OQ), _mm256_cmp_ps(e1, zero, _CMP_GT_OQ));
+					inside        = _mm256_and_ps(inside, _mm256_cmp_ps(e2, zero, _CMP_GT_OQ));
+
+					// Stay inside the bounding box columns
+					const __m256i column = _mm256_add_epi32(_mm256_set1_epi32(x), laneIndex);
+					const __m256i inBox  = _mm256_and_si256(
+						_mm256_cmpgt_epi32(column, _mm256_set1_epi32(minX - 1)),
+						_mm256_cmpgt_epi32(_mm256_set1_epi32(maxX + 1), column)
+					);
+					inside = _mm256_and_ps(inside, _mm256_castsi256_ps(inBox));
+
+					if (_mm256_movemask_ps(inside) == 0) continue;
+
+					const __m256 z        = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(dzdx), px), _mm256_set1_ps(dzdy * py + dz0));
+					const __m256 oldDepth = _mm256_loadu_ps(row + x);
+					const __m256 newDepth = _mm256_blendv_ps(oldDepth, _mm256_min_ps(oldDepth, z), inside);
+					_mm256_storeu_ps(row + x, newDepth);
+				}
+			}
+#else
+			for (int y = minY; y <= maxY; ++y) {
+				const float py = static_cast<float>(y) + 0.5f;
+				float*      row = &depth_[y * width_];
+
+				for (int x = minX; x <= maxX; ++x) {
+					const float px = static_cast<float>(x) + 0.5f;
+					if (a0 * px + b0 * py + c0 <= 0.0f) continue;
+					if (a1 * px + b1 * py + c1 <= 0.0f) continue;
+					if (a2 * px + b2 * py + c2 <= 0.0f) continue;
+
+					row[x] = std::min(row[x], dzdx * px + dzdy * py + dz0);
+				}
+			}
+#endif
+			++stats_.rasterizedTriangles;
+		}
+
+		// Any pixel of the rectangle farther than depth means the box may show through
+		bool isRectVisible(const int minX, const int maxX, const int minY, const int maxY, const float depth) const {
+#if defined(__AVX2__)
+			const __m256  boxDepth  = _mm256_set1_ps(depth);
+			const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+			const int     startX    = minX & ~static_cast<int>(tileWidth_ - 1);
+
+			for (int y = minY; y <= maxY; ++y) {
+				const float* row = &depth_[y * width_];
+				for (int x = startX; x <= maxX; x += tileWidth_) {
+					const __m256i column = _mm256_add_epi32(_mm256_set1_epi32(x), laneIndex);
+					const __m256i inRect = _mm256_and_si256(
+						_mm256_cmpgt_epi32(column, _mm256_set1_epi32(minX - 1)),
+						_mm256_cmpgt_epi32(_mm256_set1_epi32(maxX + 1), column)
+					);
+					const __m256 farther = _mm256_cmp_ps(_mm256_loadu_ps(row + x), boxDepth, _CMP_GE_OQ);
+					if (_mm256_movemask_ps(_mm256_and_ps(farther, _mm256_castsi256_ps(inRect))) != 0) return true;
+				}
+			}
+#else
+			for (int y = minY; y <= maxY; ++y) {
+				const float* row = &depth_[y * width_];
+				for (int x = minX; x <= maxX; ++x) {
+					if (row[x] >= depth) return true;
+				}
+			}
+#endif
+			return false;
+		}
+
+	public:
+		OcclusionCuller(const uint32_t width  = 320,
+						const uint32_t height = 192) :
+			width_((width + tileWidth_ - 1) / tileWidth_ * tileWidth_),
+			height_((height + tileHeight_ - 1) / tileHeight_ * tileHeight_),
+			viewProjection_(DirectX::XMMatrixIdentity()),
+			isHierarchyDirty_(true)
+		{
+			tilesX_ = width_ / tileWidth_;
+			tilesY_ = height_ / tileHeight_;
+
+			depth_.resize(static_cast<size_t>(width_) * height_, 1.0f);
+			tileMaxDepth_.resize(static_cast<size_t>(tilesX_) * tilesY_, 1.0f);
+		}
+		OcclusionCuller(const OcclusionCuller&)     = default;
+		OcclusionCuller(OcclusionCuller&&) noexcept = default;
+
+		void beginFrame(DirectX::FXMMATRIX viewProjection) {
+			viewProjection_ = viewProjection;
+
+			std::fill(depth_.begin(), depth_.end(), 1.0f);
+			std::fill(tileMaxDepth_.begin(), tileMaxDepth_.end(), 1.0f);
+			isHierarchyDirty_ = false;
+
+			stats_ = {};
+		}
+
+		// Positions are read with a byte stride so vertex arrays can be passed directly
+		void renderOccluder(const void*        positions,
+							const size_t       stride,
+							const uint32_t*    indices,
+							const size_t       indexCount,
+							DirectX::FXMMATRIX world)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			const DirectX::XMMATRIX worldViewProjection = world * viewProjection_;
+			const uint8_t*          bytes               = reinterpret_cast<const uint8_t*>(positions);
+
+			for (size_t i = 0; i + 2 < indexCount; i += 3) {
+				DirectX::XMFLOAT3 screen[3];
+				bool              isClipped = false;
+
+				for (int k = 0; k < 3; ++k) {
+					const DirectX::XMFLOAT3* position = reinterpret_cast<const DirectX::XMFLOAT3*>(bytes + indices[i + k] * stride);
+
+					DirectX::XMFLOAT4 clip;
+					DirectX::XMStoreFloat4(
+						&clip,
+						DirectX::XMVector4Transform(
+							DirectX::XMVectorSet(position->x, position->y, position->z, 1.0f),
+							worldViewProjection
+						)
+					);
+
+					// The GPU clips what lies before the near plane (z < 0 in D3D), so triangles reaching
+					// it are dropped. That only makes culling less aggressive.
+					if (clip.w < nearW_ || clip.z < 0.0f) {
+						isClipped = true;
+						break;
+					}
+
+					const float inverseW = 1.0f / clip.w;
+					screen[k].x = (clip.x * inverseW * 0.5f + 0.5f) * static_cast<float>(width_);
+					screen[k].y = (0.5f - clip.y * inverseW * 0.5f) * static_cast<float>(height_);
+					screen[k].z = clip.z * inverseW;
+				}
+				if (isClipped) continue;
+
+				rasterizeTriangle(screen[0], screen[1], screen[2]);
+			}
+
+			isHierarchyDirty_ = true;
+
+			auto finish = std::chrono::steady_clock::now();
+
+			++stats_.occluderCount;
+			stats_.occluderTriangles  += indexCount / 3;
+			stats_.rasterMilliseconds += std::chrono::duration<double, std::milli>(finish - start).count();
+		}
+		void renderOccluder(const OccluderMesh& occluder, DirectX::FXMMATRIX world) {
+			renderOccluder(
+				occluder.positions.data(),
+				sizeof(DirectX::XMFLOAT3),
+				occluder.indices.data(),
+				occluder.indices.size(),
+				world
+			);
+		}
+
+		// Bounds are in world space
+		bool isVisible(const BoundingVolume& bounds) {
+			if (isHierarchyDirty_) updateTileMaxDepth();
+
+			auto start = std::chrono::steady_clock::now();
+			++stats_.tested;
+
+			bool visible = [&]() {
+				float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+				float minDepth = FLT_MAX;
+
+				for (int corner = 0; corner < 8; ++corner) {
+					const DirectX::XMVECTOR position = DirectX::XMVectorSet(
+						bounds.center.x + ((corner & 1) ? bounds.extents.x : -bounds.extents.x),
+						bounds.center.y + ((corner & 2) ? bounds.extents.y : -bounds.extents.y),
+						bounds.center.z + ((corner & 4) ? bounds.extents.z : -bounds.extents.z),
+						1.0f
+					);
+
+					DirectX::XMFLOAT4 clip;
+					DirectX::XMStoreFloat4(&clip, DirectX::XMVector4Transform(position, viewProjection_));
+
+					// Boxes touching the near plane are always drawn
+					if (clip.w < nearW_) return true;
+
+					const float inverseW = 1.0f / clip.w;
+					const float x        = (clip.x * inverseW * 0.5f + 0.5f) * static_cast<float>(width_);
+					const float y        = (0.5f - clip.y * inverseW * 0.5f) * static_cast<float>(height_);
+
+					minX     = std::min(minX, x);
+					maxX     = std::max(maxX, x);
+					minY     = std::min(minY, y);
+					maxY     = std::max(maxY, y);
+					minDepth = std::min(minDepth, clip.z * inverseW);
+				}
+
+				const int x0 = std::max(0, static_cast<int>(std::floor(minX)));
+				const int x1 = std::min(static_cast<int>(width_) - 1, static_cast<int>(std::ceil(maxX)));
+				const int y0 = std::max(0, static_cast<int>(std::floor(minY)));
+				const int y1 = std::min(static_cast<int>(height_) - 1, static_cast<int>(std::ceil(maxY)));
+
+				// Off screen, leave it to frustum culling
+				if (x0 > x1 || y0 > y1) return true;
+
+				// Coarse test per tile, fine test only where the tile is not fully in front of the box
+				for (int ty = y0 / static_cast<int>(tileHeight_); ty <= y1 / static_cast<int>(tileHeight_); ++ty) {
+					for (int tx = x0 / static_cast<int>(tileWidth_); tx <= x1 / static_cast<int>(tileWidth_); ++tx) {
+						if (tileMaxDepth_[ty * tilesX_ + tx] < minDepth) continue;
+
+						const int rx0 = std::max(x0, tx * static_cast<int>(tileWidth_));
+						const int rx1 = std::min(x1, (tx + 1) * static_cast<int>(tileWidth_) - 1);
+						const int ry0 = std::max(y0, ty * static_cast<int>(tileHeight_));
+						const int ry1 = std::min(y1, (ty + 1) * static_cast<int>(tileHeight_) - 1);
+						if (isRectVisible(rx0, rx1, ry0, ry1, minDepth)) return true;
+					}
+				}
+				return false;
+			}();
+
+			if (!visible) ++stats_.culled;
+
+			auto finish = std::chrono::steady_clock::now();
+			stats_.testMilliseconds += std::chrono::duration<double, std::milli>(finish - start).count();
+
+			return visible;
+		}
+
+		// Keeps the indices of the boxes that may be visible
+		void filterVisible(const std::vector<BoundingVolume>& bounds, std::vector<uint32_t>& indices) {
+			indices.erase(
+				std::remove_if(indices.begin(), indices.end(), [this, &bounds](uint32_t index) {
+					return !isVisible(bounds[index]);
+				}),
+				indices.end()
+			);
+		}
+
+		uint32_t getWidth() const {
+			return width_;
+		}
+		uint32_t getHeight() const {
+			return height_;
+		}
+		const std::vector<float>& getDepthBuffer() const {
+			return depth_;
+		}
+		const OcclusionStats& getStats() const {
+			return stats_;
+		}
+
+		OcclusionCuller& operator=(const OcclusionCuller&)     = default;
+		OcclusionCuller& operator=(OcclusionCuller&&) noexcept = default;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,165 @@
+#pragma once
+#include <map>
+#include <cstdint>
+#include <algorithm>
+
+namespace spider_engine {
+	struct OffsetAllocation {
+		static constexpr uint64_t invalidOffset = ~0ull;
+
+		uint64_t offset = invalidOffset;
+		uint64_t size   = 0;
+
+		bool isValid() const {
+			return offset != invalidOffset;
+		}
+	};
+
+	struct OffsetAllocatorStats {
+		uint64_t capacity         = 0;
+		uint64_t used             = 0;
+		uint64_t largestFreeBlock = 0;
+		size_t   allocationCount  = 0;
+		size_t   freeBlockCount   = 0;
+
+		double getOccupancy() const {
+			return capacity ? static_cast<double>(used) / capacity : 0.0;
+		}
+		// 0 while the free space is one block, towards 1 as it splits into pieces too small to use
+		double getFragmentation() const {
+			const uint64_t free = capacity - used;
+			return free ? 1.0 - static_cast<double>(largestFreeBlock) / free : 0.0;
+		}
+
+		OffsetAllocatorStats& operator+=(const OffsetAllocatorStats& other) {
+			capacity         += other.capacity;
+			used             += other.used;
+			largestFreeBlock  = std::max(largestFreeBlock, other.largestFreeBlock);
+			allocationCount  += other.allocationCount;
+			freeBlockCount   += other.freeBlockCount;
+			return *this;
+		}
+	};
+
+	// Sub-allocates ranges of an abstract [0, capacity) space, units are up to the caller.
+	// Best fit out of a size ordered free list, freed ranges are merged with their free neighbours.
+	// Nothing here touches a device, GPU buffers keep their own memory and only ask for offsets.
+	class OffsetAllocator {
+	private:
+		std::map<uint64_t, uint64_t>      freeByOffset_; // offset -> size
+		std::multimap<uint64_t, uint64_t> freeBySize_;   // size -> offset
+
+		uint64_t capacity_;
+		uint64_t used_;
+		size_t   allocationCount_;
+
+		void insertFree(const uint64_t offset, const uint64_t size) {
+			freeByOffset_.emplace(offset, size);
+			freeBySize_.emplace(size, offset);
+		}
+		void eraseFree(const std::map<uint64_t, uint64_t>::iterator it) {
+			auto [begin, end] = freeBySize_.equal_range(it->second);
+			for (auto sized = begin; sized != end; ++sized) {
+				if (sized->second == it->first) {
+					freeBySize_.erase(sized);
+					break;
+				}
+			}
+			freeByOffset_.erase(it);
+		}
+
+	public:
+		OffsetAllocator(const uint64_t capacity = 0) :
+			capacity_(0),
+			used_(0),
+			allocationCount_(0)
+		{
+			reset(capacity);
+		}
+		OffsetAllocator(const OffsetAllocator&)     = default;
+		OffsetAllocator(OffsetAllocator&&) noexcept = default;
+
+		// Invalid when no free block is large enough
+		OffsetAllocation allocate(const uint64_t size) {
+			if (size == 0) return {};
+
+			auto sized = freeBySize_.lower_bound(size);
+			if (sized == freeBySize_.end()) return {};
+
+			const uint64_t blockSize   = sized->first;
+			const uint64_t blockOffset = sized->second;
+			freeBySize_.erase(sized);
+			freeByOffset_.erase(blockOffset);
+
+			// The tail stays free
+			if (blockSize > size) insertFree(blockOffset + size, blockSize - size);
+
+			used_ += size;
+			++allocationCount_;
+
+			return { blockOffset, size };
+		}
+
+		void free(const OffsetAllocation& allocation) {
+			if (!allocation.isValid() || allocation.size == 0) return;
+
+			uint64_t offset = allocation.offset;
+			uint64_t size   = allocation.size;
+
+			used_ -= size;
+			--allocationCount_;
+
+			// Merge with the following block
+			auto next = freeByOffset_.lower_bound(offset);
+			if (next != freeByOffset_.end() && next->first == offset + size) {
+				size += next->second;
+				eraseFree(next);
+			}
+
+			// And the preceding one
+			auto following = freeByOffset_.lower_bound(offset);
+			if (following != freeByOffset_.begin()) {
+				auto previous = std::prev(following);
+				if (previous->first + previous->second == offset) {
+					offset  = previous->first;
+					size   += previous->second;
+					eraseFree(previous);
+				}
+			}
+
+			insertFree(offset, size);
+		}
+
+		// Drops every allocation
+		void reset(const uint64_t capacity) {
+			freeByOffset_.clear();
+			freeBySize_.clear();
+
+			capacity_        = capacity;
+			used_            = 0;
+			allocationCount_ = 0;
+
+			if (capacity) insertFree(0, capacity);
+		}
+
+		uint64_t getCapacity() const {
+			return capacity_;
+		}
+		uint64_t getUsed() const {
+			return used_;
+		}
+
+		OffsetAllocatorStats getStats() const {
+			OffsetAllocatorStats stats;
+			stats.capacity         = capacity_;
+			stats.used             = used_;
+			stats.largestFreeBlock = freeBySize_.empty() ? 0 : freeBySize_.rbegin()->first;
+			stats.allocationCount  = allocationCount_;
+			stats.freeBlockCount   = freeByOffset_.size();
+			return stats;
+		}
+
+		OffsetAllocator& operator=(const OffsetAllocator&)     = default;
+		OffsetAllocator& operator=(OffsetAllocator&&) noexcept = default;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,432 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+
+namespace spider_engine::rendering {
+	// Same values as D3D12_RESOURCE_STATES, so the backend casts them as they are
+	enum class ResourceAccess : uint32_t {
+		COMMON                     = 0,
+		PRESENT                    = 0,
+		VERTEX_AND_CONSTANT_BUFFER = 0x1,
+		INDEX_BUFFER               = 0x2,
+		RENDER_TARGET              = 0x4,
+		UNORDERED_ACCESS           = 0x8,
+		DEPTH_WRITE                = 0x10,
+		DEPTH_READ                 = 0x20,
+		NON_PIXEL_SHADER_RESOURCE  = 0x40,
+		PIXEL_SHADER_RESOURCE      = 0x80,
+		SHADER_RESOURCE            = 0xC0,
+		COPY_DEST                  = 0x400,
+		COPY_SOURCE                = 0x800
+	};
+
+	inline ResourceAccess operator|(const ResourceAccess a, const ResourceAccess b) {
+		return static_cast<ResourceAccess>(static_cast<uint32_t>(a) | static_cast<uint32_t>(b));
+	}
+	inline ResourceAccess operator&(const ResourceAccess a, const ResourceAccess b) {
+		return static_cast<ResourceAccess>(static_cast<uint32_t>(a) & static_cast<uint32_t>(b));
+	}
+
+	// Read states can be combined into one, write states stand alone. Common is neither.
+	inline bool isReadOnlyAccess(const ResourceAccess access) {
+		constexpr uint32_t writes = static_cast<uint32_t>(ResourceAccess::RENDER_TARGET)    |
+									static_cast<uint32_t>(ResourceAccess::UNORDERED_ACCESS) |
+									static_cast<uint32_t>(ResourceAccess::DEPTH_WRITE)      |
+									static_cast<uint32_t>(ResourceAccess::COPY_DEST);
+		return access != ResourceAccess::COMMON && (static_cast<uint32_t>(access) & writes) == 0;
+	}
+
+	using RenderResourceId = uint32_t;
+	using RenderPassId     = uint32_t;
+
+	static constexpr RenderResourceId invalidRenderResource = ~0u;
+
+	struct RenderResourceDesc {
+		std::string name;
+		bool        isImported = false;
+
+		// Transient resources, as the device reports them. Only resources of the same heap group alias.
+		uint64_t sizeInBytes = 0;
+		uint64_t alignment   = 0;
+		uint32_t heapGroup   = 0;
+
+		// Imported resources, the state they are in when the frame starts and the one they are left in
+		ResourceAccess initialAccess = ResourceAccess::COMMON;
+		ResourceAccess finalAccess   = ResourceAccess::COMMON;
+	};
+
+	struct RenderPassUse {
+		RenderResourceId resource;
+		ResourceAccess   access;
+		bool             isWrite;
+	};
+
+	struct RenderPassDesc {
+		std::string                name;
+		std::vector<RenderPassUse> uses;
+		bool                       hasSideEffects = false; // Never culled, even when nothing reads what it writes
+	};
+
+	enum class RenderBarrierType : uint8_t {
+		TRANSITION,
+		ALIASING, // resource takes over memory last used by before (invalid when it may be any of several)
+		UAV       // Unordered access writes of the previous pass finish before the next one reads or writes
+	};
+
+	struct RenderBarrier {
+		RenderBarrierType type;
+		RenderResourceId  resource;
+		RenderResourceId  before = invalidRenderResource;
+		ResourceAccess    from   = ResourceAccess::COMMON;
+		ResourceAccess    to     = ResourceAccess::COMMON;
+	};
+
+	// Positions are indices into RenderGraphPlan::passes
+	struct RenderResourceLifetime {
+		static constexpr uint32_t unused = ~0u;
+
+		uint32_t firstPass  = unused;
+		uint32_t lastPass   = 0;
+		uint64_t heapOffset = 0;
+
+		// Transient resources sharing memory with another one, their first use has to clear, discard or fully overwrite them
+		bool isAliased = false;
+
+		// Transient resources are created in the state their last use leaves them in, so every frame starts where the last one ended
+		ResourceAccess createAccess = ResourceAccess::COMMON;
+
+		bool isUsed() const {
+			return firstPass != unused;
+		}
+	};
+
+	struct RenderGraphStats {
+		size_t passCount            = 0;
+		size_t culledPassCount      = 0;
+		size_t transientCount       = 0;
+		size_t barrierCount         = 0;
+		size_t barrierBatchCount    = 0; // ResourceBarrier calls
+		size_t aliasingBarrierCount = 0;
+
+		uint64_t transientBytes = 0; // Every transient resource in its own memory
+		uint64_t heapBytes      = 0; // What aliasing brought it down to
+
+		double getAliasingSavings() const {
+			return transientBytes ? 1.0 - static_cast<double>(heapBytes) / transientBytes : 0.0;
+		}
+	};
+
+	struct RenderGraphPlan {
+		std::vector<RenderPassId>               passes;        // Live passes in execution order
+		std::vector<std::vector<RenderBarrier>> barriers;      // Batch before each pass, parallel to passes
+		std::vector<RenderBarrier>              finalBarriers; // Imported resources back to their final access
+		std::vector<RenderResourceLifetime>     resources;     // Parallel to the graph's resources
+		std::vector<uint64_t>                   heapBytes;     // Per heap group
+		RenderGraphStats                        stats;
+	};
+
+	// Frame graph: passes declare what they read and write, compile() turns that into a plan. Passes run in
+	// declaration order, those whose writes nobody reads are culled, transient resources get a lifetime and
+	// an offset in their group's heap (resources that are never alive at the same time share memory), and
+	// every state change happens in one barrier batch right before the pass that needs it. Pure CPU, the
+	// backend creates the resources and records the passes.
+	class RenderGraph {
+	private:
+		std::vector<RenderResourceDesc> resources_;
+		std::vector<RenderPassDesc>     passes_;
+
+		// Access the pass needs the resource in, every use of it in the pass has to agree
+		static bool findAccess(const RenderPassDesc& pass, const RenderResourceId resource, ResourceAccess& access) {
+			bool isUsed  = false;
+			bool isWrite = false;
+			for (const RenderPassUse& use : pass.uses) {
+				if (use.resource != resource) continue;
+
+				if (!isUsed) access = use.access;
+				else if (use.isWrite || isWrite) {
+					if (use.access != access) throw std::runtime_error("Render pass " + pass.name + " uses a resource in conflicting states");
+				}
+				else access = access | use.access;
+
+				isUsed   = true;
+				isWrite |= use.isWrite;
+			}
+			return isUsed;
+		}
+
+		// State after a pass needing access, reads combine so a readable resource does not go back and forth
+		static ResourceAccess nextAccess(const ResourceAccess current, const ResourceAccess access) {
+			if (current != access && isReadOnlyAccess(current) && isReadOnlyAccess(access)) return current | access;
+			return access;
+		}
+
+		// A pass is live when it has side effects or writes something read later (imported resources are always read)
+		std::vector<bool> cull() const {
+			std::vector<bool> isNeeded(resources_.size());
+			for (size_t r = 0; r < resources_.size(); ++r) isNeeded[r] = resources_[r].isImported;
+
+			std::vector<bool> isLive(passes_.size());
+			for (size_t p = passes_.size(); p-- > 0;) {
+				const RenderPassDesc& pass = passes_[p];
+
+				isLive[p] = pass.hasSideEffects;
+				for (const RenderPassUse& use : pass.uses) {
+					if (use.isWrite && isNeeded[use.resource]) isLive[p] = true;
+				}
+				if (!isLive[p]) continue;
+
+				for (const RenderPassUse& use : pass.uses) {
+					if (!use.isWrite) isNeeded[use.resource] = true;
+				}
+			}
+			return isLive;
+		}
+
+		static bool overlaps(const RenderResourceLifetime& a, const RenderResourceLifetime& b) {
+			return a.firstPass <= b.lastPass && b.firstPass <= a.lastPass;
+		}
+		static uint64_t alignUp(const uint64_t value, const uint64_t alignment) {
+			return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+		}
+
+		// Largest first, each at the lowest offset clear of the resources alive at the same time
+		void placeTransients(RenderGraphPlan& plan) const {
+			std::vector<RenderResourceId> transients;
+			for (RenderResourceId r = 0; r < resources_.size(); ++r) {
+				if (!resources_[r].isImported && plan.resources[r].isUsed()) transients.push_back(r);
+			}
+			std::sort(transients.begin(), transients.end(), [this, &plan](const RenderResourceId a, const RenderResourceId b) {
+				if (resources_[a].sizeInBytes != resources_[b].sizeInBytes) return resources_[a].sizeInBytes > resources_[b].sizeInBytes;
+				return plan.resources[a].firstPass < plan.resources[b].firstPass;
+			});
+
+			struct Range {
+				uint64_t begin;
+				uint64_t end;
+			};
+
+			std::vector<RenderResourceId> placed;
+			std::vector<Range>            ranges;
+			for (const RenderResourceId r : transients) {
+				const RenderResourceDesc& desc     = resources_[r];
+				RenderResourceLifetime&   lifetime = plan.resources[r];
+
+				ranges.clear();
+				for (const RenderResourceId other : placed) {
+					if (resources_[other].heapGroup != desc.heapGroup || !overlaps(lifetime, plan.resources[other])) continue;
+
+					const uint64_t offset = plan.resources[other].heapOffset;
+					ranges.push_back({ offset, offset + resources_[other].sizeInBytes });
+				}
+				std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.begin < b.begin; });
+
+				uint64_t offset = 0;
+				for (const Range& range : ranges) {
+					if (alignUp(offset, desc.alignment) + desc.sizeInBytes <= range.begin) break;
+					offset = std::max(offset, range.end);
+				}
+				lifetime.heapOffset = alignUp(offset, desc.alignment);
+
+				if (plan.heapBytes.size() <= desc.heapGroup) plan.heapBytes.resize(desc.heapGroup + 1);
+				plan.heapBytes[desc.heapGroup] = std::max(plan.heapBytes[desc.heapGroup], lifetime.heapOffset + desc.sizeInBytes);
+
+				plan.stats.transientBytes += desc.sizeInBytes;
+				placed.push_back(r);
+			}
+
+			for (const uint64_t bytes : plan.heapBytes) plan.stats.heapBytes += bytes;
+			plan.stats.transientCount = transients.size();
+		}
+
+		// Resources in memory another one used, in this frame or (for the first users) the last one
+		std::vector<RenderResourceId> findAliases(const RenderGraphPlan& plan, const RenderResourceId resource) const {
+			const RenderResourceDesc&     desc     = resources_[resource];
+			const RenderResourceLifetime& lifetime = plan.resources[resource];
+
+			std::vector<RenderResourceId> aliases;
+			for (RenderResourceId other = 0; other < resources_.size(); ++other) {
+				const RenderResourceDesc&     otherDesc     = resources_[other];
+				const RenderResourceLifetime& otherLifetime = plan.resources[other];
+				if (other == resource || otherDesc.isImported || !otherLifetime.isUsed() || otherDesc.heapGroup != desc.heapGroup) continue;
+
+				if (lifetime.heapOffset < otherLifetime.heapOffset + otherDesc.sizeInBytes && otherLifetime.heapOffset < lifetime.heapOffset + desc.sizeInBytes) {
+					aliases.push_back(other);
+				}
+			}
+			return aliases;
+		}
+
+	public:
+		RenderGraph()                       = default;
+		RenderGraph(const RenderGraph&)     = default;
+		RenderGraph(RenderGraph&&) noexcept = default;
+
+		RenderResourceId createTransient(const std::string& name,
+										 const uint64_t     sizeInBytes,
+										 const uint64_t     alignment = 65536,
+										 const uint32_t     heapGroup = 0)
+		{
+			RenderResourceDesc desc;
+			desc.name        = name;
+			desc.sizeInBytes = sizeInBytes;
+			desc.alignment   = alignment;
+			desc.heapGroup   = heapGroup;
+			resources_.push_back(std::move(desc));
+			return static_cast<RenderResourceId>(resources_.size() - 1);
+		}
+		RenderResourceId importResource(const std::string&   name,
+										const ResourceAccess initialAccess,
+										const ResourceAccess finalAccess)
+		{
+			RenderResourceDesc desc;
+			desc.name          = name;
+			desc.isImported    = true;
+			desc.initialAccess = initialAccess;
+			desc.finalAccess   = finalAccess;
+			resources_.push_back(std::move(desc));
+			return static_cast<RenderResourceId>(resources_.size() - 1);
+		}
+
+		RenderPassId addPass(const std::string& name, const bool hasSideEffects = false) {
+			passes_.push_back({ name, {}, hasSideEffects });
+			return static_cast<RenderPassId>(passes_.size() - 1);
+		}
+
+		// A pass that keeps what is already in a resource it writes (blending, no clear) reads it too
+		void read(const RenderPassId pass, const RenderResourceId resource, const ResourceAccess access) {
+			passes_[pass].uses.push_back({ resource, access, false });
+		}
+		void write(const RenderPassId pass, const RenderResourceId resource, const ResourceAccess access) {
+			passes_[pass].uses.push_back({ resource, access, true });
+		}
+
+		RenderGraphPlan compile() const {
+			RenderGraphPlan plan;
+			plan.resources.resize(resources_.size());
+
+			const std::vector<bool> isLive = cull();
+			for (RenderPassId p = 0; p < passes_.size(); ++p) {
+				if (isLive[p]) plan.passes.push_back(p);
+			}
+			plan.stats.passCount       = plan.passes.size();
+			plan.stats.culledPassCount = passes_.size() - plan.passes.size();
+
+			// Lifetimes, and the state each resource is left in
+			for (uint32_t i = 0; i < plan.passes.size(); ++i) {
+				const RenderPassDesc& pass = passes_[plan.passes[i]];
+				for (const RenderPassUse& use : pass.uses) {
+					RenderResourceLifetime& lifetime = plan.resources[use.resource];
+					if (!lifetime.isUsed()) {
+						if (!use.isWrite && !resources_[use.resource].isImported) {
+							throw std::runtime_error("Render pass " + pass.name + " reads " + resources_[use.resource].name + " before anything writes it");
+						}
+						lifetime.firstPass = i;
+					}
+					lifetime.lastPass = i;
+				}
+			}
+			for (uint32_t i = 0; i < plan.passes.size(); ++i) {
+				const RenderPassDesc& pass = passes_[plan.passes[i]];
+				for (const RenderPassUse& use : pass.uses) {
+					RenderResourceLifetime& lifetime = plan.resources[use.resource];
+
+					// Transients are written first, so where they end up does not depend on where they started
+					ResourceAccess access = ResourceAccess::COMMON;
+					findAccess(pass, use.resource, access);
+					lifetime.createAccess = lifetime.firstPass == i ? access : nextAccess(lifetime.createAccess, access);
+				}
+			}
+
+			placeTransients(plan);
+
+			std::vector<RenderResourceId> aliasedBefore(resources_.size(), invalidRenderResource);
+			for (RenderResourceId r = 0; r < resources_.size(); ++r) {
+				if (resources_[r].isImported || !plan.resources[r].isUsed()) continue;
+
+				const std::vector<RenderResourceId> aliases = findAliases(plan, r);
+				plan.resources[r].isAliased = !aliases.empty();
+				if (aliases.size() == 1) aliasedBefore[r] = aliases.front();
+			}
+
+			// Barriers, each resource changes state only right before the pass that needs the new one
+			std::vector<ResourceAccess> current(resources_.size());
+			std::vector<bool>           isTouched(resources_.size());
+			for (RenderResourceId r = 0; r < resources_.size(); ++r) {
+				current[r] = resources_[r].isImported ? resources_[r].initialAccess : plan.resources[r].createAccess;
+			}
+
+			plan.barriers.resize(plan.passes.size());
+			for (uint32_t i = 0; i < plan.passes.size(); ++i) {
+				const RenderPassDesc&       pass  = passes_[plan.passes[i]];
+				std::vector<RenderBarrier>& batch = plan.barriers[i];
+
+				for (size_t u = 0; u < pass.uses.size(); ++u) {
+					const RenderResourceId r = pass.uses[u].resource;
+
+					// Once per resource per pass
+					bool isRepeated = false;
+					for (size_t earlier = 0; earlier < u; ++earlier) isRepeated |= pass.uses[earlier].resource == r;
+					if (isRepeated) continue;
+
+					ResourceAccess access = ResourceAccess::COMMON;
+					findAccess(pass, r, access);
+
+					if (plan.resources[r].isAliased && plan.resources[r].firstPass == i) {
+						batch.push_back({ RenderBarrierType::ALIASING, r, aliasedBefore[r] });
+					}
+
+					if (current[r] == access) {
+						if (access == ResourceAccess::UNORDERED_ACCESS && isTouched[r]) batch.push_back({ RenderBarrierType::UAV, r });
+					}
+					else if (!isReadOnlyAccess(current[r]) || !isReadOnlyAccess(access) || (current[r] & access) != access) {
+						const ResourceAccess next = nextAccess(current[r], access);
+						batch.push_back({ RenderBarrierType::TRANSITION, r, invalidRenderResource, current[r], next });
+						current[r] = next;
+					}
+					isTouched[r] = true;
+				}
+			}
+
+			for (RenderResourceId r = 0; r < resources_.size(); ++r) {
+				if (resources_[r].isImported && current[r] != resources_[r].finalAccess) {
+					plan.finalBarriers.push_back({ RenderBarrierType::TRANSITION, r, invalidRenderResource, current[r], resources_[r].finalAccess });
+				}
+			}
+
+			for (const std::vector<RenderBarrier>& batch : plan.barriers) {
+				if (batch.empty()) continue;
+
+				++plan.stats.barrierBatchCount;
+				plan.stats.barrierCount += batch.size();
+				for (const RenderBarrier& barrier : batch) {
+					if (barrier.type == RenderBarrierType::ALIASING) ++plan.stats.aliasingBarrierCount;
+				}
+			}
+			if (!plan.finalBarriers.empty()) {
+				++plan.stats.barrierBatchCount;
+				plan.stats.barrierCount += plan.finalBarriers.size();
+			}
+
+			return plan;
+		}
+
+		// Every frame declares its graph again
+		void reset() {
+			resources_.clear();
+			passes_.clear();
+		}
+
+		const std::vector<RenderResourceDesc>& getResources() const {
+			return resources_;
+		}
+		const std::vector<RenderPassDesc>& getPasses() const {
+			return passes_;
+		}
+
+		RenderGraph& operator=(const RenderGraph&)     = default;
+		RenderGraph& operator=(RenderGraph&&) noexcept = default;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,302 @@
+#pragma once
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <d3d12.h>
+#include <wrl/client.h>
+
+#include "d3dx12.h"
+#include "definitions.hpp"
+#include "flat_hash_map.hpp"
+#include "render_graph.hpp"
+#include "gpu_memory_allocator.hpp"
+#include "resource_state_registry.hpp"
+#include "frame_profiler.hpp"
+#include "gpu_profiler.hpp"
+
+namespace spider_engine::d3dx12 {
+	class RenderGraphExecutor;
+
+	using RenderPassFunction = std::function<void(ID3D12GraphicsCommandList*, RenderGraphExecutor&)>;
+
+	// Records a RenderGraph on a D3D12 command list. Transient resources are placed resources in one heap
+	// per heap group (buffers, textures, render targets and depth stencils, like GpuMemoryCategory) at the
+	// offsets the plan aliased them to. They are kept between frames by name and only created again when
+	// their description or place changes; replaced heaps and resources live on until the frames in flight
+	// are done. Aliased render targets and depth stencils are discarded before their first use. Barriers
+	// go through the command list's ResourceStateTracker, so imported resources are transitioned from the
+	// state the tracker knows them in and repeated transitions are dropped.
+	class RenderGraphExecutor {
+	private:
+		template <typename Ty>
+		using ComPtr = Microsoft::WRL::ComPtr<Ty>;
+
+		struct Transient {
+			D3D12_RESOURCE_DESC       desc;
+			D3D12_CLEAR_VALUE         clearValue;
+			bool                      hasClearValue;
+			uint64_t                  heapOffset;
+			rendering::ResourceAccess createAccess;
+			ID3D12Heap*               heap;
+			ComPtr<ID3D12Resource>    resource;
+		};
+
+		struct TransientHeap {
+			ComPtr<ID3D12Heap> heap;
+			uint64_t           sizeInBytes = 0;
+		};
+
+		struct Retired {
+			ComPtr<ID3D12Pageable> object;
+			uint64_t               frame;
+		};
+
+		ID3D12Device*                          device_;
+		std::shared_ptr<ResourceStateRegistry> resourceStates_;
+		GpuProfiler*                           profiler_ = nullptr;
+
+		uint64_t frameLatency_;
+		uint64_t frame_ = 0;
+
+		rendering::RenderGraph          graph_;
+		std::vector<RenderPassFunction> passFunctions_;  // Parallel to the graph's passes
+		std::vector<ID3D12Resource*>    resources_;      // Parallel to the graph's resources
+		std::vector<Transient>          transientDescs_; // Parallel to the graph's resources, filled for transients
+
+		ska::flat_hash_map<std::string, Transient>                               transients_; // Kept between frames
+		std::array<TransientHeap, static_cast<size_t>(GpuMemoryCategory::COUNT)> heaps_;
+		std::vector<Retired>                                                     retired_;
+
+		rendering::RenderGraphStats stats_;
+
+		static GpuMemoryCategory getCategory(const D3D12_RESOURCE_DESC& desc) {
+			if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER) return GpuMemoryCategory::BUFFER;
+			if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) return GpuMemoryCategory::RENDER_TARGET;
+			return GpuMemoryCategory::TEXTURE;
+		}
+		static D3D12_HEAP_FLAGS getHeapFlags(const GpuMemoryCategory category) {
+			switch (category) {
+				case GpuMemoryCategory::TEXTURE:       return D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+				case GpuMemoryCategory::RENDER_TARGET: return D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+				default:                               return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+			}
+		}
+
+		void retire(ComPtr<ID3D12Pageable> object) {
+			if (object) retired_.push_back({ std::move(object), frame_ });
+		}
+
+		// Heaps only grow, a larger one replaces every resource placed in the old one
+		void prepareHeaps(const rendering::RenderGraphPlan& plan) {
+			for (size_t group = 0; group < plan.heapBytes.size(); ++group) {
+				TransientHeap& heap = heaps_[group];
+				if (plan.heapBytes[group] <= heap.sizeInBytes) continue;
+
+				const uint64_t alignment = group == static_cast<size_t>(GpuMemoryCategory::RENDER_TARGET) ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+				retire(std::move(heap.heap));
+				heap.sizeInBytes = (plan.heapBytes[group] + alignment - 1) / alignment * alignment;
+
+				CD3DX12_HEAP_DESC heapDesc(heap.sizeInBytes, D3D12_HEAP_TYPE_DEFAULT, alignment, getHeapFlags(static_cast<GpuMemoryCategory>(group)));
+				SPIDER_DX12_ERROR_CHECK(device_->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap.heap)));
+
+				SPIDER_DBG_CODE(heap.heap->SetName(L"RenderGraphTransientHeap"));
+			}
+		}
+
+		ID3D12Resource* prepareTransient(const rendering::RenderGraphPlan& plan, const rendering::RenderResourceId resource) {
+			const rendering::RenderResourceDesc&     desc     = graph_.getResources()[resource];
+			const rendering::RenderResourceLifetime& lifetime = plan.resources[resource];
+
+			Transient wanted    = transientDescs_[resource];
+			wanted.heapOffset   = lifetime.heapOffset;
+			wanted.createAccess = lifetime.createAccess;
+			wanted.heap         = heaps_[desc.heapGroup].heap.Get();
+
+			Transient& cached = transients_[desc.name];
+			const bool isSame = cached.resource &&
+								cached.heap == wanted.heap &&
+								cached.heapOffset == wanted.heapOffset &&
+								cached.createAccess == wanted.createAccess &&
+								std::memcmp(&cached.desc, &wanted.desc, sizeof(D3D12_RESOURCE_DESC)) == 0;
+			if (isSame) return cached.resource.Get();
+
+			retire(std::move(cached.resource));
+			cached = wanted;
+
+			SPIDER_DX12_ERROR_CHECK(
+				device_->CreatePlacedResource(
+					cached.heap,
+					cached.heapOffset,
+					&cached.desc,
+					static_cast<D3D12_RESOURCE_STATES>(cached.createAccess),
+					cached.hasClearValue ? &cached.clearValue : nullptr,
+					IID_PPV_ARGS(&cached.resource)
+				)
+			);
+
+			resourceStates_->track(cached.resource.Get(), static_cast<D3D12_RESOURCE_STATES>(cached.createAccess));
+
+			SPIDER_DBG_CODE(cached.resource->SetName(std::wstring(desc.name.begin(), desc.name.end()).c_str()));
+
+			return cached.resource.Get();
+		}
+
+		void recordBarriers(ResourceStateTracker& states, const std::vector<rendering::RenderBarrier>& batch) {
+			for (const rendering::RenderBarrier& barrier : batch) {
+				switch (barrier.type) {
+					case rendering::RenderBarrierType::TRANSITION:
+						states.transition(resources_[barrier.resource], static_cast<D3D12_RESOURCE_STATES>(barrier.to));
+						break;
+					case rendering::RenderBarrierType::ALIASING:
+						states.aliasing(barrier.before != rendering::invalidRenderResource ? resources_[barrier.before] : nullptr, resources_[barrier.resource]);
+						break;
+					case rendering::RenderBarrierType::UAV:
+						states.uav(resources_[barrier.resource]);
+						break;
+				}
+			}
+		}
+
+	public:
+		// Frame latency is the number of frames in flight, replaced resources are released after it has passed
+		RenderGraphExecutor(ID3D12Device* device, std::shared_ptr<ResourceStateRegistry> resourceStates, const uint64_t frameLatency) :
+			device_(device),
+			resourceStates_(std::move(resourceStates)),
+			frameLatency_(frameLatency)
+		{}
+		RenderGraphExecutor(const RenderGraphExecutor&) = delete;
+		RenderGraphExecutor(RenderGraphExecutor&&)      = delete;
+
+		// Call once per frame after waiting for its fence, the graph is declared again every frame
+		void beginFrame() {
+			++frame_;
+
+			std::erase_if(retired_, [this](const Retired& retired) {
+				return frame_ - retired.frame > frameLatency_;
+			});
+
+			graph_.reset();
+			passFunctions_.clear();
+			resources_.clear();
+			transientDescs_.clear();
+		}
+
+		// Sized and aligned by the device, the clear value is only for render targets and depth stencils
+		rendering::RenderResourceId createTransient(const std::string&         name,
+													const D3D12_RESOURCE_DESC& desc,
+													const D3D12_CLEAR_VALUE*   clearValue = nullptr)
+		{
+			const D3D12_RESOURCE_ALLOCATION_INFO info = device_->GetResourceAllocationInfo(0, 1, &desc);
+
+			const rendering::RenderResourceId id = graph_.createTransient(name, info.SizeInBytes, info.Alignment, static_cast<uint32_t>(getCategory(desc)));
+			resources_.push_back(nullptr);
+
+			Transient& transient    = transientDescs_.emplace_back();
+			transient.desc          = desc;
+			transient.hasClearValue = clearValue != nullptr;
+			if (clearValue) transient.clearValue = *clearValue;
+
+			return id;
+		}
+		rendering::RenderResourceId importResource(const std::string&          name,
+												   ID3D12Resource*             resource,
+												   const D3D12_RESOURCE_STATES initialState,
+												   const D3D12_RESOURCE_STATES finalState)
+		{
+			const rendering::RenderResourceId id = graph_.importResource(
+				name,
+				static_cast<rendering::ResourceAccess>(initialState),
+				static_cast<rendering::ResourceAccess>(finalState)
+			);
+			resources_.push_back(resource);
+			transientDescs_.emplace_back();
+			return id;
+		}
+
+		// Declare what the pass reads and writes on the graph with the returned id
+		rendering::RenderPassId addPass(const std::string& name, RenderPassFunction function, const bool hasSideEffects = false) {
+			passFunctions_.push_back(std::move(function));
+			return graph_.addPass(name, hasSideEffects);
+		}
+		void read(const rendering::RenderPassId pass, const rendering::RenderResourceId resource, const D3D12_RESOURCE_STATES state) {
+			graph_.read(pass, resource, static_cast<rendering::ResourceAccess>(state));
+		}
+		void write(const rendering::RenderPassId pass, const rendering::RenderResourceId resource, const D3D12_RESOURCE_STATES state) {
+			graph_.write(pass, resource, static_cast<rendering::ResourceAccess>(state));
+		}
+
+		// Valid while the passes record, transients only exist once the graph is compiled
+		ID3D12Resource* getResource(const rendering::RenderResourceId resource) const {
+			return resources_[resource];
+		}
+
+		// Compiles the graph and records every live pass with its barrier batch in front of it. The final
+		// transitions stay pending in the tracker, they are flushed when the list is submitted.
+		void execute(ID3D12GraphicsCommandList* commandList) {
+			ResourceStateTracker& states = resourceStates_->getTracker(commandList);
+
+			const rendering::RenderGraphPlan plan = graph_.compile();
+			stats_ = plan.stats;
+
+			prepareHeaps(plan);
+
+			const auto& resources = graph_.getResources();
+			for (rendering::RenderResourceId r = 0; r < resources.size(); ++r) {
+				if (!resources[r].isImported && plan.resources[r].isUsed()) {
+					// Every frame leaves transients in the state they are created in
+					resources_[r] = prepareTransient(plan, r);
+					states.assume(resources_[r], static_cast<D3D12_RESOURCE_STATES>(plan.resources[r].createAccess));
+				}
+				// The plan starts from the declared state, a different global one is fixed up at submission
+				else if (resources[r].isImported && plan.resources[r].isUsed()) {
+					states.transition(resources_[r], static_cast<D3D12_RESOURCE_STATES>(resources[r].initialAccess));
+				}
+			}
+
+			for (uint32_t i = 0; i < plan.passes.size(); ++i) {
+				const rendering::RenderPassDesc& pass = graph_.getPasses()[plan.passes[i]];
+				SPIDER_PROFILE_SCOPE_DYNAMIC(pass.name);
+				GpuProfileScope gpuScope(profiler_, commandList, profiler_ ? FrameProfiler::get().intern(pass.name) : nullptr);
+
+				recordBarriers(states, plan.barriers[i]);
+				states.flush(commandList);
+
+				// Aliased memory holds whatever was there, render targets and depth stencils start discarded
+				for (const rendering::RenderPassUse& use : pass.uses) {
+					const rendering::RenderResourceLifetime& lifetime = plan.resources[use.resource];
+					const bool isTarget = use.access == rendering::ResourceAccess::RENDER_TARGET || use.access == rendering::ResourceAccess::DEPTH_WRITE;
+					if (use.isWrite && isTarget && lifetime.isAliased && lifetime.firstPass == i) {
+						commandList->DiscardResource(resources_[use.resource], nullptr);
+					}
+				}
+
+				if (RenderPassFunction& function = passFunctions_[plan.passes[i]]) function(commandList, *this);
+			}
+
+			recordBarriers(states, plan.finalBarriers);
+		}
+
+		// Times every pass on the GPU, null stops it
+		void setProfiler(GpuProfiler* profiler) {
+			profiler_ = profiler;
+		}
+
+		rendering::RenderGraph& getGraph() {
+			return graph_;
+		}
+
+		// Culling, barriers and aliasing of the last executed frame
+		const rendering::RenderGraphStats& getStats() const {
+			return stats_;
+		}
+
+		RenderGraphExecutor& operator=(const RenderGraphExecutor&) = delete;
+		RenderGraphExecutor& operator=(RenderGraphExecutor&&)      = delete;
+	};
+}
\ No newline at end of file
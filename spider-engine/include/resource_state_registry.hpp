@@ -0,0 +1,261 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <d3d12.h>
+#include <wrl/client.h>
+
+#include "d3dx12.h"
+#include "definitions.hpp"
+#include "flat_hash_map.hpp"
+#include "resource_state_tracker.hpp"
+
+namespace spider_engine::d3dx12 {
+	class ResourceStateRegistry;
+
+	// Private data of a tracked resource, its global state is dropped when the resource is destroyed
+	class ResourceStateHook final : public IUnknown {
+	private:
+		std::atomic<ULONG> references_ = 1;
+
+		std::weak_ptr<ResourceStateRegistry> owner_;
+		ID3D12Resource*                      resource_;
+
+	public:
+		// {3B8C5D2E-7A41-4F06-B9E2-6D1C8F4A2B97}
+		static constexpr GUID guid = { 0x3b8c5d2e, 0x7a41, 0x4f06, { 0xb9, 0xe2, 0x6d, 0x1c, 0x8f, 0x4a, 0x2b, 0x97 } };
+
+		ResourceStateHook(std::weak_ptr<ResourceStateRegistry> owner, ID3D12Resource* resource) :
+			owner_(std::move(owner)),
+			resource_(resource)
+		{}
+		ResourceStateHook(const ResourceStateHook&) = delete;
+		ResourceStateHook(ResourceStateHook&&)      = delete;
+
+		HRESULT STDMETHODCALLTYPE QueryInterface(REFIID id, void** object) override {
+			if (!object) return E_POINTER;
+			if (id == __uuidof(IUnknown) || id == guid) {
+				*object = this;
+				AddRef();
+				return S_OK;
+			}
+			*object = nullptr;
+			return E_NOINTERFACE;
+		}
+		ULONG STDMETHODCALLTYPE AddRef() override {
+			return ++references_;
+		}
+		ULONG STDMETHODCALLTYPE Release() override;
+
+		ResourceStateHook& operator=(const ResourceStateHook&) = delete;
+		ResourceStateHook& operator=(ResourceStateHook&&)      = delete;
+	};
+
+	// Global resource states: what every submitted command list left each tracked resource in, in
+	// submission order. submit() closes a list, resolves the first state it wanted for each resource
+	// against the global one and records the fixups in a small list executed right before it, then
+	// takes over the states the list ends with. Resources nobody tracked are trusted as they are.
+	class ResourceStateRegistry : public std::enable_shared_from_this<ResourceStateRegistry> {
+	private:
+		template <typename Ty>
+		using ComPtr = Microsoft::WRL::ComPtr<Ty>;
+
+		struct Record {
+			UINT              subresourceCount;
+			SubresourceStates states;
+		};
+
+		struct Prologue {
+			ComPtr<ID3D12CommandAllocator>    allocator;
+			ComPtr<ID3D12GraphicsCommandList> commandList;
+			uint64_t                          fenceValue = 0;
+		};
+
+		ID3D12Device* device_;
+
+		std::mutex                                                                            mutex_;
+		ska::flat_hash_map<ID3D12Resource*, Record>                                           records_;
+		ska::flat_hash_map<ID3D12GraphicsCommandList*, std::unique_ptr<ResourceStateTracker>> trackers_;
+		std::vector<D3D12_RESOURCE_BARRIER>                                                   fixups_;
+
+		std::vector<Prologue> prologues_;
+		ComPtr<ID3D12Fence>   fence_;
+		uint64_t              fenceValue_ = 0;
+
+		ResourceStateStats frameStats_;
+		ResourceStateStats lastFrameStats_;
+
+		friend class ResourceStateHook;
+
+		void forget(ID3D12Resource* resource) {
+			std::lock_guard lock(mutex_);
+			records_.erase(resource);
+		}
+
+		Prologue& acquirePrologue() {
+			const uint64_t completed = fence_->GetCompletedValue();
+			for (Prologue& prologue : prologues_) {
+				if (prologue.fenceValue <= completed) return prologue;
+			}
+
+			Prologue& prologue = prologues_.emplace_back();
+			SPIDER_DX12_ERROR_CHECK(device_->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&prologue.allocator)));
+			SPIDER_DX12_ERROR_CHECK(device_->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, prologue.allocator.Get(), nullptr, IID_PPV_ARGS(&prologue.commandList)));
+			prologue.commandList->Close();
+
+			SPIDER_DBG_CODE(prologue.commandList->SetName(L"ResourceStatePrologue"));
+
+			return prologue;
+		}
+
+		// Fixups for the first states the list wanted, then the global state becomes the one it ends with
+		void resolve(ResourceStateTracker& tracker) {
+			fixups_.clear();
+			for (auto& [resource, entry] : tracker.entries_) {
+				auto it = records_.find(resource);
+				if (it == records_.end()) continue;
+
+				Record& record = it->second;
+				if (entry.required.isUniform() && record.states.isUniform()) {
+					const D3D12_RESOURCE_STATES required = entry.required.get(0);
+					const D3D12_RESOURCE_STATES global   = record.states.get(0);
+					if (required != SubresourceStates::unknown) {
+						if (required == global) ++frameStats_.elided;
+						else                    fixups_.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, global, required));
+					}
+				}
+				else {
+					for (UINT s = 0; s < record.subresourceCount; ++s) {
+						const D3D12_RESOURCE_STATES required = entry.required.get(s);
+						const D3D12_RESOURCE_STATES global   = record.states.get(s);
+						if (required == SubresourceStates::unknown) continue;
+
+						if (required == global) ++frameStats_.elided;
+						else                    fixups_.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, global, required, s));
+					}
+				}
+
+				if (entry.current.isUniform()) {
+					const D3D12_RESOURCE_STATES current = entry.current.get(0);
+					if (current != SubresourceStates::unknown) record.states.set(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, current, record.subresourceCount);
+				}
+				else {
+					for (UINT s = 0; s < record.subresourceCount; ++s) {
+						const D3D12_RESOURCE_STATES current = entry.current.get(s);
+						if (current != SubresourceStates::unknown) record.states.set(s, current, record.subresourceCount);
+					}
+				}
+			}
+		}
+
+	public:
+		ResourceStateRegistry(ID3D12Device* device) :
+			device_(device)
+		{
+			SPIDER_DX12_ERROR_CHECK(device_->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence_)));
+		}
+		ResourceStateRegistry(const ResourceStateRegistry&) = delete;
+		ResourceStateRegistry(ResourceStateRegistry&&)      = delete;
+
+		// State the resource is in once every list submitted so far has run, call it when the resource is created
+		void track(ID3D12Resource* resource, const D3D12_RESOURCE_STATES state) {
+			const UINT subresourceCount = getSubresourceCount(resource->GetDesc());
+			{
+				std::lock_guard lock(mutex_);
+				auto it = records_.find(resource);
+				if (it != records_.end()) {
+					it->second.states.set(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, state, subresourceCount);
+					return;
+				}
+				records_[resource] = { subresourceCount, SubresourceStates(state) };
+			}
+
+			ResourceStateHook* hook = new ResourceStateHook(weak_from_this(), resource);
+			resource->SetPrivateDataInterface(ResourceStateHook::guid, hook);
+			hook->Release();
+		}
+
+		// One tracker per command list, kept for as long as the registry lives
+		ResourceStateTracker& getTracker(ID3D12GraphicsCommandList* commandList) {
+			std::lock_guard lock(mutex_);
+			std::unique_ptr<ResourceStateTracker>& tracker = trackers_[commandList];
+			if (!tracker) tracker = std::make_unique<ResourceStateTracker>();
+			return *tracker;
+		}
+
+		// Flushes and closes the list, then executes it behind its fixups
+		void submit(ID3D12CommandQueue* queue, ID3D12GraphicsCommandList* commandList) {
+			ResourceStateTracker& tracker = getTracker(commandList);
+			tracker.flush(commandList);
+			SPIDER_DX12_ERROR_CHECK(commandList->Close());
+
+			ID3D12CommandList* commandLists[2];
+			UINT               commandListCount = 0;
+			Prologue*          prologue         = nullptr;
+			{
+				std::lock_guard lock(mutex_);
+				resolve(tracker);
+
+				if (!fixups_.empty()) {
+					prologue = &acquirePrologue();
+					SPIDER_DX12_ERROR_CHECK(prologue->allocator->Reset());
+					SPIDER_DX12_ERROR_CHECK(prologue->commandList->Reset(prologue->allocator.Get(), nullptr));
+					prologue->commandList->ResourceBarrier(static_cast<UINT>(fixups_.size()), fixups_.data());
+					SPIDER_DX12_ERROR_CHECK(prologue->commandList->Close());
+
+					commandLists[commandListCount++] = prologue->commandList.Get();
+				}
+
+				const ResourceStateStats& stats = tracker.getStats();
+				frameStats_.transitions += stats.transitions;
+				frameStats_.issued      += stats.issued + fixups_.size();
+				frameStats_.elided      += stats.elided;
+				frameStats_.resolved    += fixups_.size();
+				frameStats_.batches     += stats.batches + (fixups_.empty() ? 0 : 1);
+				++frameStats_.submissions;
+			}
+			commandLists[commandListCount++] = commandList;
+			queue->ExecuteCommandLists(commandListCount, commandLists);
+
+			if (prologue) {
+				SPIDER_DX12_ERROR_CHECK(queue->Signal(fence_.Get(), ++fenceValue_));
+				prologue->fenceValue = fenceValue_;
+			}
+			tracker.reset();
+		}
+
+		// For a list closed without being submitted, nothing it recorded happened
+		void discard(ID3D12GraphicsCommandList* commandList) {
+			getTracker(commandList).reset();
+		}
+
+		// Counters restart every frame, getStats() reports the last full one
+		void beginFrame() {
+			std::lock_guard lock(mutex_);
+			lastFrameStats_ = frameStats_;
+			frameStats_     = {};
+		}
+
+		ResourceStateStats getStats() {
+			std::lock_guard lock(mutex_);
+			ResourceStateStats stats = lastFrameStats_;
+			stats.tracked = records_.size();
+			return stats;
+		}
+
+		ResourceStateRegistry& operator=(const ResourceStateRegistry&) = delete;
+		ResourceStateRegistry& operator=(ResourceStateRegistry&&)      = delete;
+	};
+
+	inline ULONG STDMETHODCALLTYPE ResourceStateHook::Release() {
+		const ULONG references = --references_;
+		if (references == 0) {
+			// The registry may already be gone when resources outlive the renderer
+			if (std::shared_ptr<ResourceStateRegistry> owner = owner_.lock()) owner->forget(resource_);
+			delete this;
+		}
+		return references;
+	}
+}
\ No newline at end of file
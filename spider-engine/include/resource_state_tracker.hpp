@@ -0,0 +1,193 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <d3d12.h>
+
+#include "d3dx12.h"
+#include "flat_hash_map.hpp"
+
+namespace spider_engine::d3dx12 {
+	struct ResourceStateStats {
+		size_t transitions = 0; // Requested through transition()
+		size_t issued      = 0; // Barriers recorded, fixups included
+		size_t elided      = 0; // Transitions to a state the resource was already in
+		size_t resolved    = 0; // Fixup barriers against the global state, recorded at submission
+		size_t batches     = 0; // ResourceBarrier calls
+		size_t submissions = 0;
+		size_t tracked     = 0; // Resources with a known global state
+	};
+
+	// State of every subresource of a resource, one value while they all agree
+	class SubresourceStates {
+	private:
+		D3D12_RESOURCE_STATES              state_;
+		std::vector<D3D12_RESOURCE_STATES> states_; // Empty while uniform
+
+	public:
+		static constexpr D3D12_RESOURCE_STATES unknown = static_cast<D3D12_RESOURCE_STATES>(~0u);
+
+		SubresourceStates(const D3D12_RESOURCE_STATES state = unknown) :
+			state_(state)
+		{}
+
+		bool isUniform() const {
+			return states_.empty();
+		}
+		D3D12_RESOURCE_STATES get(const UINT subresource) const {
+			return states_.empty() ? state_ : states_[subresource];
+		}
+
+		void set(const UINT subresource, const D3D12_RESOURCE_STATES state, const UINT subresourceCount) {
+			if (subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) {
+				state_ = state;
+				states_.clear();
+				return;
+			}
+			if (states_.empty()) {
+				if (state == state_) return;
+				states_.assign(subresourceCount, state_);
+			}
+			states_[subresource] = state;
+
+			if (std::all_of(states_.begin(), states_.end(), [state](const D3D12_RESOURCE_STATES other) { return other == state; })) {
+				state_ = state;
+				states_.clear();
+			}
+		}
+	};
+
+	// Mip levels of every array slice, depth stencil planes move together
+	inline UINT getSubresourceCount(const D3D12_RESOURCE_DESC& desc) {
+		if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)    return 1;
+		if (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D) return desc.MipLevels;
+		return UINT(desc.MipLevels) * desc.DepthOrArraySize;
+	}
+
+	// Resource states as one command list sees them while it is recorded. Transitions are compared
+	// against the state the list left the resource in and dropped when nothing changes; the others wait
+	// in a batch that flush() records with a single ResourceBarrier call, right before the next draw or
+	// copy that needs them. The first state a list wants for each subresource is not recorded at all:
+	// the list cannot know what earlier lists leave behind, so it is resolved against the global state
+	// when the list is submitted.
+	class ResourceStateTracker {
+	private:
+		struct Entry {
+			UINT              subresourceCount;
+			SubresourceStates current;  // Unknown until the list first uses the subresource
+			SubresourceStates required; // First state the list wants for each subresource
+		};
+
+		ska::flat_hash_map<ID3D12Resource*, Entry> entries_;
+		std::vector<D3D12_RESOURCE_BARRIER>        pending_;
+		ResourceStateStats                         stats_;
+
+		friend class ResourceStateRegistry;
+
+		Entry& find(ID3D12Resource* resource) {
+			auto it = entries_.find(resource);
+			if (it != entries_.end()) return it->second;
+
+			Entry& entry = entries_[resource];
+			entry.subresourceCount = getSubresourceCount(resource->GetDesc());
+			return entry;
+		}
+
+		// Read states combine, a resource in several of them can be read as any one
+		static bool isSatisfied(const D3D12_RESOURCE_STATES current, const D3D12_RESOURCE_STATES state) {
+			constexpr UINT writes = D3D12_RESOURCE_STATE_RENDER_TARGET | D3D12_RESOURCE_STATE_UNORDERED_ACCESS |
+									D3D12_RESOURCE_STATE_DEPTH_WRITE   | D3D12_RESOURCE_STATE_COPY_DEST        |
+									D3D12_RESOURCE_STATE_STREAM_OUT    | D3D12_RESOURCE_STATE_RESOLVE_DEST;
+			if (current == state) return true;
+			return state != D3D12_RESOURCE_STATE_COMMON && (current & writes) == 0 && (current & state) == state;
+		}
+
+		// False when nothing has to be recorded
+		bool transitionSubresource(ID3D12Resource* resource, Entry& entry, const UINT subresource, const D3D12_RESOURCE_STATES state) {
+			const D3D12_RESOURCE_STATES current = entry.current.get(subresource);
+			if (current == SubresourceStates::unknown) {
+				entry.required.set(subresource, state, entry.subresourceCount);
+				entry.current.set(subresource, state, entry.subresourceCount);
+				return true;
+			}
+			if (isSatisfied(current, state)) return false;
+
+			pending_.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource, current, state, subresource));
+			entry.current.set(subresource, state, entry.subresourceCount);
+			return true;
+		}
+
+	public:
+		ResourceStateTracker()                            = default;
+		ResourceStateTracker(const ResourceStateTracker&) = delete;
+		ResourceStateTracker(ResourceStateTracker&&)      = default;
+
+		void transition(ID3D12Resource*             resource,
+						const D3D12_RESOURCE_STATES state,
+						const UINT                  subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+		{
+			++stats_.transitions;
+
+			Entry& entry     = find(resource);
+			bool   isChanged = false;
+			if (subresource != D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES || entry.current.isUniform()) {
+				isChanged = transitionSubresource(resource, entry, subresource, state);
+			}
+			else {
+				// Subresources went separate ways, each one not there yet gets its own barrier
+				for (UINT s = 0; s < entry.subresourceCount; ++s) {
+					isChanged |= transitionSubresource(resource, entry, s, state);
+				}
+			}
+			if (!isChanged) ++stats_.elided;
+		}
+
+		// The list knows the state, e.g. a resource it created: nothing is resolved for it at submission
+		void assume(ID3D12Resource* resource, const D3D12_RESOURCE_STATES state) {
+			Entry& entry = find(resource);
+			entry.current.set(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, state, entry.subresourceCount);
+		}
+
+		void uav(ID3D12Resource* resource) {
+			pending_.push_back(CD3DX12_RESOURCE_BARRIER::UAV(resource));
+		}
+		void aliasing(ID3D12Resource* before, ID3D12Resource* after) {
+			pending_.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(before, after));
+		}
+
+		// Records the pending batch, call right before the draw or copy that needs it
+		void flush(ID3D12GraphicsCommandList* commandList) {
+			if (pending_.empty()) return;
+
+			commandList->ResourceBarrier(static_cast<UINT>(pending_.size()), pending_.data());
+			stats_.issued += pending_.size();
+			++stats_.batches;
+			pending_.clear();
+		}
+
+		// State the list leaves the subresource in, unknown when it never touched it
+		D3D12_RESOURCE_STATES getState(ID3D12Resource* resource, const UINT subresource = 0) const {
+			auto it = entries_.find(resource);
+			return it != entries_.end() ? it->second.current.get(subresource) : SubresourceStates::unknown;
+		}
+
+		// Barriers the next flush() records
+		const std::vector<D3D12_RESOURCE_BARRIER>& getPending() const {
+			return pending_;
+		}
+
+		// Forgets everything, for a list that is reset without being submitted
+		void reset() {
+			entries_.clear();
+			pending_.clear();
+			stats_ = {};
+		}
+
+		const ResourceStateStats& getStats() const {
+			return stats_;
+		}
+
+		ResourceStateTracker& operator=(const ResourceStateTracker&) = delete;
+		ResourceStateTracker& operator=(ResourceStateTracker&&)      = default;
+	};
+}
\ No newline at end of file
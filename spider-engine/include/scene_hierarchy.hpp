@@ -0,0 +1,220 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <execution>
+#include <DirectXMath.h>
+
+#include "types.hpp"
+#include "flecs.h"
+#include "flat_hash_map.hpp"
+
+namespace spider_engine::rendering {
+	struct LocalTransform {
+		Transform transform;
+	};
+
+	struct alignas(16) WorldTransform {
+		DirectX::XMMATRIX matrix = DirectX::XMMatrixIdentity();
+	};
+
+	struct HierarchyStats {
+		size_t nodeCount          = 0;
+		size_t levelCount         = 0;
+		size_t matricesRecomputed = 0;
+		size_t rebuildCount       = 0;
+	};
+
+	class SceneHierarchy {
+	private:
+		static constexpr uint32_t noParent_ = UINT32_MAX;
+
+		struct alignas(16) Node {
+			DirectX::XMMATRIX world;
+			Transform         local;
+
+			flecs::entity entity;
+			uint32_t      parent;
+
+			bool dirty;
+			bool updated;
+		};
+
+		struct NodeLocation {
+			uint32_t level;
+			uint32_t index;
+		};
+
+		flecs::world* world_;
+
+		// Nodes stored breadth-first, one array per depth level
+		std::vector<std::vector<Node>>                    levels_;
+		ska::flat_hash_map<flecs::entity_t, NodeLocation> locations_;
+
+		flecs::observer localTransformObserver_;
+		flecs::observer structureObserver_;
+		flecs::observer removalObserver_;
+
+		bool isStructureDirty_;
+
+		HierarchyStats stats_;
+
+		void pushNode(flecs::entity entity, const uint32_t level, const uint32_t parent) {
+			if (levels_.size() <= level) levels_.emplace_back();
+
+			const LocalTransform* local = entity.get<LocalTransform>();
+
+			Node node    = {};
+			node.world   = DirectX::XMMatrixIdentity();
+			node.local   = local->transform;
+			node.entity  = entity;
+			node.parent  = parent;
+			node.dirty   = true;
+			node.updated = false;
+
+			locations_[entity.id()] = { level, static_cast<uint32_t>(levels_[level].size()) };
+			levels_[level].push_back(node);
+		}
+
+		void rebuild() {
+			levels_.clear();
+			locations_.clear();
+
+			// Roots are entities whose parent (if any) is not part of the hierarchy
+			world_->each([this](flecs::entity entity, const LocalTransform&) {
+				flecs::entity parent = entity.parent();
+				if (parent && parent.has<LocalTransform>()) return;
+
+				pushNode(entity, 0, noParent_);
+			});
+
+			// Walk children level by level so that every level only depends on the previous one
+			for (uint32_t level = 0; level < levels_.size(); ++level) {
+				for (uint32_t i = 0; i < levels_[level].size(); ++i) {
+					flecs::entity entity = levels_[level][i].entity;
+
+					entity.children([this, level, i](flecs::entity child) {
+						if (!child.has<LocalTransform>()) return;
+						pushNode(child, level + 1, i);
+					});
+				}
+			}
+
+			// Make sure every node can receive its world matrix
+			for (auto& level : levels_) {
+				for (auto& node : level) {
+					if (!node.entity.has<WorldTransform>()) node.entity.set<WorldTransform>({});
+				}
+			}
+
+			isStructureDirty_ = false;
+			++stats_.rebuildCount;
+		}
+
+	public:
+		SceneHierarchy(flecs::world* world) :
+			world_(world),
+			isStructureDirty_(true)
+		{
+			// Local changes only flag their node, propagation happens on update
+			localTransformObserver_ = world_->observer<const LocalTransform>()
+				.event(flecs::OnSet)
+				.each([this](flecs::entity entity, const LocalTransform& local) {
+					if (isStructureDirty_) return;
+
+					auto it = locations_.find(entity.id());
+					if (it == locations_.end()) {
+						isStructureDirty_ = true;
+						return;
+					}
+
+					Node& node = levels_[it->second.level][it->second.index];
+					node.local = local.transform;
+					node.dirty = true;
+				});
+
+			// Reparenting or adding/removing nodes invalidates the breadth-first order
+			structureObserver_ = world_->observer()
+				.with(flecs::ChildOf, flecs::Wildcard)
+				.event(flecs::OnAdd)
+				.event(flecs::OnRemove)
+				.each([this](flecs::entity) {
+					isStructureDirty_ = true;
+				});
+			removalObserver_ = world_->observer<const LocalTransform>()
+				.event(flecs::OnRemove)
+				.each([this](flecs::entity, const LocalTransform&) {
+					isStructureDirty_ = true;
+				});
+		}
+		SceneHierarchy(const SceneHierarchy&) = delete;
+		SceneHierarchy(SceneHierarchy&&)      = delete;
+
+		// The observers capture this, and the world outlives the hierarchy: its teardown removes every
+		// LocalTransform and ChildOf pair, which would run them on a destroyed object
+		~SceneHierarchy() {
+			if (localTransformObserver_) localTransformObserver_.destruct();
+			if (structureObserver_)      structureObserver_.destruct();
+			if (removalObserver_)        removalObserver_.destruct();
+		}
+
+		void update() {
+			if (isStructureDirty_) rebuild();
+
+			// Each level only reads from the previous one, so nodes inside a level are independent
+			for (size_t level = 0; level < levels_.size(); ++level) {
+				std::vector<Node>&       nodes   = levels_[level];
+				const std::vector<Node>* parents = level > 0 ? &levels_[level - 1] : nullptr;
+
+				std::for_each(
+					std::execution::par,
+					nodes.begin(),
+					nodes.end(),
+					[parents](Node& node) {
+						const Node* parent = parents ? &(*parents)[node.parent] : nullptr;
+						if (!node.dirty && !(parent && parent->updated)) return;
+
+						node.world = node.local.toMatrix();
+						if (parent) node.world = node.world * parent->world;
+
+						node.updated = true;
+					}
+				);
+			}
+
+			// Write back changed matrices, counting them, and reset flags for the next frame
+			size_t recomputed = 0;
+			for (auto& level : levels_) {
+				for (auto& node : level) {
+					if (node.updated) {
+						node.entity.set<WorldTransform>({ node.world });
+						++recomputed;
+					}
+					node.dirty   = false;
+					node.updated = false;
+				}
+			}
+
+			stats_.nodeCount          = locations_.size();
+			stats_.levelCount         = levels_.size();
+			stats_.matricesRecomputed = recomputed;
+		}
+
+		void markStructureDirty() {
+			isStructureDirty_ = true;
+		}
+
+		const DirectX::XMMATRIX* getWorldMatrix(flecs::entity entity) const {
+			auto it = locations_.find(entity.id());
+			if (it == locations_.end()) return nullptr;
+
+			return &levels_[it->second.level][it->second.index].world;
+		}
+
+		const HierarchyStats& getStats() const {
+			return stats_;
+		}
+
+		SceneHierarchy& operator=(const SceneHierarchy&) = delete;
+		SceneHierarchy& operator=(SceneHierarchy&&)      = delete;
+	};
+}
\ No newline at end of file
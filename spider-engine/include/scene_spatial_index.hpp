@@ -0,0 +1,142 @@
+#pragma once
+#include <vector>
+#include <optional>
+#include <DirectXMath.h>
+
+#include "types.hpp"
+#include "dx12_types.hpp"
+#include "scene_hierarchy.hpp"
+#include "dynamic_aabb_tree.hpp"
+#include "flecs.h"
+#include "flat_hash_map.hpp"
+
+namespace spider_engine::rendering {
+	struct RayHit {
+		flecs::entity entity;
+		float         distance;
+	};
+
+	class SceneSpatialIndex {
+	private:
+		flecs::world* world_;
+
+		DynamicAabbTree tree_;
+
+		ska::flat_hash_map<flecs::entity_t, int32_t> proxies_;
+
+		flecs::observer worldTransformObserver_;
+		flecs::observer renderizableObserver_;
+		flecs::observer removalObserver_;
+
+		void synchronize(flecs::entity entity) {
+			const d3dx12::Renderizable* renderizable = entity.get<d3dx12::Renderizable>();
+			if (!renderizable || !renderizable->mesh) return;
+
+			// Prefer the hierarchy result, fall back to the standalone transform
+			const WorldTransform* worldTransform = entity.get<WorldTransform>();
+			DirectX::XMMATRIX     world          = worldTransform ? worldTransform->matrix : renderizable->transform.toMatrix();
+
+			const Aabb box = Aabb::fromBoundingVolume(renderizable->mesh->bounds.transformed(world));
+
+			auto it = proxies_.find(entity.id());
+			if (it == proxies_.end()) {
+				proxies_.emplace(entity.id(), tree_.createProxy(box, entity.id()));
+			}
+			else {
+				tree_.moveProxy(it->second, box);
+			}
+		}
+
+	public:
+		SceneSpatialIndex(flecs::world* world, const float margin = 0.1f) :
+			world_(world),
+			tree_(margin)
+		{
+			// Keep the tree in sync with transform and mesh changes
+			worldTransformObserver_ = world_->observer<const WorldTransform>()
+				.event(flecs::OnSet)
+				.each([this](flecs::entity entity, const WorldTransform&) {
+					synchronize(entity);
+				});
+			renderizableObserver_ = world_->observer<const d3dx12::Renderizable>()
+				.event(flecs::OnSet)
+				.each([this](flecs::entity entity, const d3dx12::Renderizable&) {
+					synchronize(entity);
+				});
+			removalObserver_ = world_->observer<const d3dx12::Renderizable>()
+				.event(flecs::OnRemove)
+				.each([this](flecs::entity entity, const d3dx12::Renderizable&) {
+					auto it = proxies_.find(entity.id());
+					if (it == proxies_.end()) return;
+
+					tree_.destroyProxy(it->second);
+					proxies_.erase(it);
+				});
+		}
+		SceneSpatialIndex(const SceneSpatialIndex&) = delete;
+		SceneSpatialIndex(SceneSpatialIndex&&)      = delete;
+
+		// The world outlives the index and removes every Renderizable on teardown, the observers capture this
+		~SceneSpatialIndex() {
+			if (worldTransformObserver_) worldTransformObserver_.destruct();
+			if (renderizableObserver_)   renderizableObserver_.destruct();
+			if (removalObserver_)        removalObserver_.destruct();
+		}
+
+		// Needed after editing Renderizable::transform in place without calling modified()
+		void refresh(flecs::entity entity) {
+			synchronize(entity);
+		}
+
+		void queryFrustum(const Frustum& frustum, std::vector<flecs::entity>& out) const {
+			tree_.query(frustum, [this, &out](int32_t proxy) {
+				out.push_back(world_->entity(tree_.getUserData(proxy)));
+				return true;
+			});
+		}
+		void queryBox(const Aabb& box, std::vector<flecs::entity>& out) const {
+			tree_.query(box, [this, &out](int32_t proxy) {
+				out.push_back(world_->entity(tree_.getUserData(proxy)));
+				return true;
+			});
+		}
+
+		// Closest hit against the (fat) bounds of each entity
+		std::optional<RayHit> rayCast(DirectX::FXMVECTOR origin,
+									  DirectX::FXMVECTOR direction,
+									  const float        maxDistance) const
+		{
+			RayCastInput input;
+			DirectX::XMStoreFloat3(&input.origin, origin);
+			DirectX::XMStoreFloat3(&input.direction, DirectX::XMVector3Normalize(direction));
+			input.maxDistance = maxDistance;
+
+			const DirectX::XMFLOAT3 inverseDirection = {
+				1.0f / input.direction.x,
+				1.0f / input.direction.y,
+				1.0f / input.direction.z
+			};
+
+			std::optional<RayHit> hit;
+			tree_.rayCast(input, [this, &hit, &inverseDirection](int32_t proxy, const RayCastInput& current) {
+				const float distance = tree_.getFatAabb(proxy).rayDistance(current.origin, inverseDirection, current.maxDistance);
+				if (distance < 0.0f) return -1.0f;
+
+				hit = RayHit{ world_->entity(tree_.getUserData(proxy)), distance };
+				return std::max(distance, std::numeric_limits<float>::min());
+			});
+
+			return hit;
+		}
+
+		const DynamicAabbTree& getTree() const {
+			return tree_;
+		}
+		const DynamicAabbTreeStats& getStats() {
+			return tree_.getStats();
+		}
+
+		SceneSpatialIndex& operator=(const SceneSpatialIndex&) = delete;
+		SceneSpatialIndex& operator=(SceneSpatialIndex&&)      = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,356 @@
+#pragma once
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <filesystem>
+#include <type_traits>
+
+#include "types.hpp"
+#include "mapped_file.hpp"
+#include "mesh_simplifier.hpp"
+#include "meshlet_builder.hpp"
+#include "submesh.hpp"
+#include "vertex_compression.hpp"
+
+namespace spider_engine::rendering {
+	// Baked mesh file (.spmesh): a fixed header followed by sections that are used in place.
+	// Vertex and index blobs are already in their GPU layout and aligned for direct upload.
+	inline constexpr uint32_t spmeshMagic     = 0x484d5053; // "SPMH"
+	inline constexpr uint32_t spmeshVersion   = 2;
+	inline constexpr uint64_t spmeshAlignment = 256;
+
+	enum class MeshSource {
+		IMPORTED, // Source model through Assimp, processed at load time
+		BAKED     // Memory mapped .spmesh
+	};
+
+	// How a mesh reached the GPU, to compare the baked path against a full import
+	struct MeshLoadStats {
+		MeshSource source           = MeshSource::IMPORTED;
+		double     loadMilliseconds = 0.0;
+		size_t     fileBytes        = 0;
+	};
+
+	struct SpmeshSection {
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	struct SpmeshHeader {
+		uint32_t magic;
+		uint32_t version;
+
+		uint32_t vertexFormat; // VertexFormat
+		uint32_t vertexStride;
+		uint32_t vertexCount;
+		uint32_t indexSize;    // 2 or 4 bytes
+		uint32_t indexCount;
+		uint32_t lodCount;
+		uint32_t meshletCount;
+		uint32_t submeshCount;
+		uint32_t materialCount;
+
+		float boundsCenter[3];
+		float boundsExtents[3];
+		float boundsRadius;
+		float quantizationOffset[3];
+		float quantizationScale[3];
+
+		SpmeshSection vertices;
+		SpmeshSection indices;
+		SpmeshSection lods;             // MeshLod[lodCount]
+		SpmeshSection meshlets;         // Meshlet[meshletCount]
+		SpmeshSection meshletBounds;    // MeshletBounds[meshletCount]
+		SpmeshSection meshletVertices;  // uint32_t[]
+		SpmeshSection meshletTriangles; // uint8_t[]
+		SpmeshSection submeshes;        // Submesh[submeshCount]
+		SpmeshSection submeshLods;      // MeshLod[lodCount * submeshCount], level major
+		SpmeshSection materialTextures; // materialCount UTF-8 paths relative to the .spmesh folder, NUL separated
+	};
+	static_assert(std::is_trivially_copyable_v<SpmeshHeader>);
+	static_assert(sizeof(SpmeshHeader) == 256, "the on-disk header layout changed, bump spmeshVersion");
+
+	class SpmeshFile {
+	private:
+		MappedFile          file_;
+		const SpmeshHeader* header_;
+
+		std::filesystem::path folder_;
+
+		template <typename Ty>
+		std::span<const Ty> getSection(const SpmeshSection& section) const {
+			return { reinterpret_cast<const Ty*>(file_.data() + section.offset), section.size / sizeof(Ty) };
+		}
+
+		void validate(const std::filesystem::path& path) const {
+			auto fail = [&path](const char* reason) {
+				throw std::runtime_error("Invalid spmesh " + path.string() + ": " + reason);
+			};
+
+			if (file_.size() < sizeof(SpmeshHeader)) fail("truncated header");
+			if (header_->magic != spmeshMagic)      fail("bad magic");
+			if (header_->version != spmeshVersion)  fail("unsupported version");
+
+			const SpmeshSection* sections[] = {
+				&header_->vertices,
+				&header_->indices,
+				&header_->lods,
+				&header_->meshlets,
+				&header_->meshletBounds,
+				&header_->meshletVertices,
+				&header_->meshletTriangles,
+				&header_->submeshes,
+				&header_->submeshLods,
+				&header_->materialTextures
+			};
+			for (const SpmeshSection* section : sections) {
+				if (section->offset > file_.size() || section->size > file_.size() - section->offset) fail("section out of bounds");
+
+				// Sections are read in place through typed pointers
+				if (section->offset % spmeshAlignment != 0) fail("misaligned section");
+			}
+
+			if (header_->vertexFormat > static_cast<uint32_t>(VertexFormat::PACKED)) fail("unknown vertex format");
+			if (header_->vertexStride != (getVertexFormat() == VertexFormat::PACKED ? sizeof(PackedVertex) : sizeof(Vertex))) {
+				fail("vertex stride does not match the vertex format");
+			}
+			if (header_->indexSize != sizeof(uint16_t) && header_->indexSize != sizeof(uint32_t)) fail("index size is neither 2 nor 4 bytes");
+
+			if (header_->vertices.size != uint64_t(header_->vertexCount) * header_->vertexStride)            fail("vertex size mismatch");
+			if (header_->indices.size != uint64_t(header_->indexCount) * header_->indexSize)                 fail("index size mismatch");
+			if (header_->lods.size != uint64_t(header_->lodCount) * sizeof(MeshLod))                         fail("lod table size mismatch");
+			if (header_->meshlets.size != uint64_t(header_->meshletCount) * sizeof(Meshlet))                 fail("meshlet table size mismatch");
+			if (header_->meshletBounds.size != uint64_t(header_->meshletCount) * sizeof(MeshletBounds))      fail("meshlet bounds size mismatch");
+			if (header_->meshletVertices.size % sizeof(uint32_t) != 0)                                       fail("meshlet vertex size mismatch");
+			if (header_->submeshes.size != uint64_t(header_->submeshCount) * sizeof(Submesh))                fail("submesh table size mismatch");
+			if (header_->submeshLods.size != uint64_t(header_->submeshCount) * header_->lodCount * sizeof(MeshLod)) {
+				fail("submesh lod table size mismatch");
+			}
+
+			// Ranges the renderer draws or walks without checking again
+			auto isInside = [](const uint64_t offset, const uint64_t count, const uint64_t total) {
+				return offset <= total && count <= total - offset;
+			};
+			for (const MeshLod& lod : getLods()) {
+				if (!isInside(lod.indexOffset, lod.indexCount, header_->indexCount)) fail("lod index range out of bounds");
+			}
+			for (const MeshLod& lod : getSubmeshLods()) {
+				if (!isInside(lod.indexOffset, lod.indexCount, header_->indexCount)) fail("submesh lod index range out of bounds");
+			}
+			for (const Submesh& submesh : getSubmeshes()) {
+				if (!isInside(submesh.vertexOffset, submesh.vertexCount, header_->vertexCount))    fail("submesh vertex range out of bounds");
+				if (!isInside(submesh.meshletOffset, submesh.meshletCount, header_->meshletCount)) fail("submesh meshlet range out of bounds");
+			}
+			for (const Meshlet& meshlet : getMeshlets()) {
+				if (!isInside(meshlet.vertexOffset, meshlet.vertexCount, getMeshletVertices().size()) ||
+					!isInside(meshlet.triangleOffset, uint64_t(meshlet.triangleCount) * 3, getMeshletTriangles().size()))
+				{
+					fail("meshlet range out of bounds");
+				}
+			}
+		}
+
+	public:
+		// Maps the file, nothing is parsed or copied
+		SpmeshFile(const std::filesystem::path& path) :
+			file_(path),
+			header_(reinterpret_cast<const SpmeshHeader*>(file_.data())),
+			folder_(path.parent_path())
+		{
+			validate(path);
+		}
+		SpmeshFile(const SpmeshFile&)     = delete;
+		SpmeshFile(SpmeshFile&&) noexcept = default;
+
+		const SpmeshHeader& getHeader() const {
+			return *header_;
+		}
+		size_t getSize() const {
+			return file_.size();
+		}
+
+		VertexFormat getVertexFormat() const {
+			return static_cast<VertexFormat>(header_->vertexFormat);
+		}
+		const void* getVertexData() const {
+			return file_.data() + header_->vertices.offset;
+		}
+		const void* getIndexData() const {
+			return file_.data() + header_->indices.offset;
+		}
+
+		std::span<const MeshLod> getLods() const {
+			return getSection<MeshLod>(header_->lods);
+		}
+		std::span<const Meshlet> getMeshlets() const {
+			return getSection<Meshlet>(header_->meshlets);
+		}
+		std::span<const MeshletBounds> getMeshletBounds() const {
+			return getSection<MeshletBounds>(header_->meshletBounds);
+		}
+		std::span<const uint32_t> getMeshletVertices() const {
+			return getSection<uint32_t>(header_->meshletVertices);
+		}
+		std::span<const uint8_t> getMeshletTriangles() const {
+			return getSection<uint8_t>(header_->meshletTriangles);
+		}
+		std::span<const Submesh> getSubmeshes() const {
+			return getSection<Submesh>(header_->submeshes);
+		}
+		std::span<const MeshLod> getSubmeshLods() const {
+			return getSection<MeshLod>(header_->submeshLods);
+		}
+
+		BoundingVolume getBounds() const {
+			BoundingVolume bounds;
+			bounds.center  = { header_->boundsCenter[0], header_->boundsCenter[1], header_->boundsCenter[2] };
+			bounds.extents = { header_->boundsExtents[0], header_->boundsExtents[1], header_->boundsExtents[2] };
+			bounds.radius  = header_->boundsRadius;
+			return bounds;
+		}
+		VertexQuantization getQuantization() const {
+			VertexQuantization quantization;
+			quantization.offset = { header_->quantizationOffset[0], header_->quantizationOffset[1], header_->quantizationOffset[2] };
+			quantization.scale  = { header_->quantizationScale[0], header_->quantizationScale[1], header_->quantizationScale[2] };
+			return quantization;
+		}
+
+		// One entry per material, empty for materials without a texture
+		std::vector<std::filesystem::path> getMaterialTextures() const {
+			std::vector<std::filesystem::path> textures;
+			textures.reserve(header_->materialCount);
+
+			std::span<const char> paths = getSection<char>(header_->materialTextures);
+			auto                  begin = paths.begin();
+			while (textures.size() < header_->materialCount && begin != paths.end()) {
+				auto end = std::find(begin, paths.end(), '\0');
+
+				if (begin == end) textures.emplace_back();
+				else              textures.push_back(folder_ / std::filesystem::u8path(std::string(begin, end)));
+
+				begin = end != paths.end() ? end + 1 : end;
+			}
+			textures.resize(header_->materialCount);
+
+			return textures;
+		}
+
+		// First texture used by a submesh, empty when the mesh has none
+		std::filesystem::path getDiffuseTexture() const {
+			const std::vector<std::filesystem::path> textures = getMaterialTextures();
+			for (const Submesh& submesh : getSubmeshes()) {
+				if (submesh.materialIndex < textures.size() && !textures[submesh.materialIndex].empty()) return textures[submesh.materialIndex];
+			}
+			return {};
+		}
+
+		SpmeshFile& operator=(const SpmeshFile&)     = delete;
+		SpmeshFile& operator=(SpmeshFile&&) noexcept = default;
+	};
+
+	// Bakes a mesh the same way createMesh would upload it (packed formats and 16-bit indices included)
+	inline void writeSpmesh(const std::filesystem::path&    path,
+							const std::vector<Vertex>&      vertices,
+							const std::vector<uint32_t>&    indices,
+							const std::vector<MeshLod>&     lods,
+							const MeshletData&              meshlets,
+							const SubmeshTable&             submeshes,
+							const std::vector<std::string>& materialTextures,
+							const VertexFormat              format = VertexFormat::FULL)
+	{
+		SpmeshHeader header  = {};
+		header.magic         = spmeshMagic;
+		header.version       = spmeshVersion;
+		header.vertexFormat  = static_cast<uint32_t>(format);
+		header.vertexCount   = static_cast<uint32_t>(vertices.size());
+		header.indexCount    = static_cast<uint32_t>(indices.size());
+		header.lodCount      = static_cast<uint32_t>(lods.size());
+		header.meshletCount  = static_cast<uint32_t>(meshlets.meshlets.size());
+		header.submeshCount  = static_cast<uint32_t>(submeshes.submeshes.size());
+		header.materialCount = static_cast<uint32_t>(materialTextures.size());
+
+		const BoundingVolume bounds = computeBoundingVolume(vertices.data(), vertices.data() + vertices.size());
+		std::memcpy(header.boundsCenter, &bounds.center, sizeof(header.boundsCenter));
+		std::memcpy(header.boundsExtents, &bounds.extents, sizeof(header.boundsExtents));
+		header.boundsRadius = bounds.radius;
+
+		// Vertex and index blobs in their final layout
+		VertexQuantization        quantization;
+		std::vector<PackedVertex> packedVertices;
+		std::vector<uint16_t>     packedIndices;
+		const void*               vertexData = vertices.data();
+		const void*               indexData  = indices.data();
+
+		header.vertexStride = sizeof(Vertex);
+		header.indexSize    = sizeof(uint32_t);
+
+		if (format == VertexFormat::PACKED) {
+			packedVertices      = packVertices(vertices, quantization);
+			vertexData          = packedVertices.data();
+			header.vertexStride = sizeof(PackedVertex);
+
+			// Submesh indices are local to their vertex range
+			if (canUse16BitIndices(submeshes.empty() ? vertices.size() : submeshes.getMaxVertexCount())) {
+				packedIndices    = packIndices(indices);
+				indexData        = packedIndices.data();
+				header.indexSize = sizeof(uint16_t);
+			}
+		}
+		std::memcpy(header.quantizationOffset, &quantization.offset, sizeof(header.quantizationOffset));
+		std::memcpy(header.quantizationScale, &quantization.scale, sizeof(header.quantizationScale));
+
+		std::string materialPaths;
+		for (const std::string& texture : materialTextures) {
+			materialPaths += texture;
+			materialPaths += '\0';
+		}
+
+		// Lay sections out back to back, each one aligned
+		uint64_t cursor  = sizeof(SpmeshHeader);
+		auto     reserve = [&cursor](SpmeshSection& section, const uint64_t size) {
+			cursor         = (cursor + spmeshAlignment - 1) / spmeshAlignment * spmeshAlignment;
+			section.offset = cursor;
+			section.size   = size;
+			cursor        += size;
+		};
+
+		reserve(header.vertices, uint64_t(header.vertexCount) * header.vertexStride);
+		reserve(header.indices, uint64_t(header.indexCount) * header.indexSize);
+		reserve(header.lods, lods.size() * sizeof(MeshLod));
+		reserve(header.meshlets, meshlets.meshlets.size() * sizeof(Meshlet));
+		reserve(header.meshletBounds, meshlets.bounds.size() * sizeof(MeshletBounds));
+		reserve(header.meshletVertices, meshlets.vertices.size() * sizeof(uint32_t));
+		reserve(header.meshletTriangles, meshlets.triangles.size());
+		reserve(header.submeshes, submeshes.submeshes.size() * sizeof(Submesh));
+		reserve(header.submeshLods, submeshes.lods.size() * sizeof(MeshLod));
+		reserve(header.materialTextures, materialPaths.size());
+
+		std::vector<uint8_t> blob(cursor, 0);
+		auto write = [&blob](const SpmeshSection& section, const void* data) {
+			if (section.size) std::memcpy(blob.data() + section.offset, data, section.size);
+		};
+
+		std::memcpy(blob.data(), &header, sizeof(SpmeshHeader));
+		write(header.vertices, vertexData);
+		write(header.indices, indexData);
+		write(header.lods, lods.data());
+		write(header.meshlets, meshlets.meshlets.data());
+		write(header.meshletBounds, meshlets.bounds.data());
+		write(header.meshletVertices, meshlets.vertices.data());
+		write(header.meshletTriangles, meshlets.triangles.data());
+		write(header.submeshes, submeshes.submeshes.data());
+		write(header.submeshLods, submeshes.lods.data());
+		write(header.materialTextures, materialPaths.data());
+
+		std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+		if (!stream) {
+			throw std::runtime_error("Failed to create " + path.string());
+		}
+		stream.write(reinterpret_cast<const char*>(blob.data()), static_cast<std::streamsize>(blob.size()));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <DirectXMath.h>
+
+#include "types.hpp"
+#include "frustum_culling.hpp"
+#include "mesh_simplifier.hpp"
+
+namespace spider_engine::rendering {
+	// One part of a model that keeps its own material inside the shared vertex and index buffers.
+	// Its indices are local to its vertex range, draws use vertexOffset as the base vertex.
+	struct Submesh {
+		uint32_t vertexOffset;
+		uint32_t vertexCount;
+		uint32_t meshletOffset; // Into MeshletData::meshlets
+		uint32_t meshletCount;
+		uint32_t materialIndex;
+
+		BoundingVolume bounds; // Object space
+	};
+
+	// Index ranges are level major, submesh s at level l is lods[l * submeshes.size() + s].
+	// Every submesh has an entry on every level, parts that stop simplifying early repeat their coarsest one.
+	struct SubmeshTable {
+		std::vector<Submesh> submeshes;
+		std::vector<MeshLod> lods;
+
+		const MeshLod& getLod(const uint32_t level, const uint32_t submesh) const {
+			return lods[size_t(level) * submeshes.size() + submesh];
+		}
+		uint32_t getLevelCount() const {
+			return submeshes.empty() ? 0 : static_cast<uint32_t>(lods.size() / submeshes.size());
+		}
+
+		// Largest local index range, decides whether 16-bit indices fit
+		size_t getMaxVertexCount() const {
+			size_t count = 0;
+			for (const Submesh& submesh : submeshes) count = std::max<size_t>(count, submesh.vertexCount);
+			return count;
+		}
+
+		size_t size() const {
+			return submeshes.size();
+		}
+		bool empty() const {
+			return submeshes.empty();
+		}
+	};
+
+	struct SubmeshDraw {
+		uint32_t indexOffset;
+		uint32_t indexCount;
+		int32_t  baseVertex;
+		uint32_t materialIndex;
+		uint32_t submesh;
+	};
+
+	// Accumulated over every cull() until reset, so a frame reports all of its meshes together
+	struct SubmeshCullingStats {
+		size_t meshCount        = 0;
+		size_t tested           = 0;
+		size_t culled           = 0;
+		size_t testedTriangles  = 0; // What drawing whole meshes would have submitted
+		size_t culledTriangles  = 0;
+		size_t materialBatches  = 0; // Runs of visible submeshes sharing a material
+		double cullMilliseconds = 0.0;
+
+		double getCulledTriangleRatio() const {
+			return testedTriangles ? static_cast<double>(culledTriangles) / testedTriangles : 0.0;
+		}
+	};
+
+	class SubmeshCuller {
+	private:
+		std::vector<SubmeshDraw> draws_;
+
+		SubmeshCullingStats stats_;
+
+	public:
+		SubmeshCuller() = default;
+		SubmeshCuller(const SubmeshCuller&)     = default;
+		SubmeshCuller(SubmeshCuller&&) noexcept = default;
+
+		// The frustum is in world space, visible draws come back sorted by material
+		const std::vector<SubmeshDraw>& cull(const SubmeshTable& table,
+											 const uint32_t      level,
+											 const Frustum&      frustum,
+											 DirectX::FXMMATRIX  world)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			draws_.clear();
+			if (table.empty()) return draws_;
+
+			const uint32_t clamped = std::min(level, table.getLevelCount() - 1);
+
+			for (uint32_t s = 0; s < table.size(); ++s) {
+				const Submesh& submesh = table.submeshes[s];
+				const MeshLod& lod     = table.getLod(clamped, s);
+
+				++stats_.tested;
+				stats_.testedTriangles += lod.indexCount / 3;
+
+				if (!frustum.intersects(submesh.bounds.transformed(world))) {
+					++stats_.culled;
+					stats_.culledTriangles += lod.indexCount / 3;
+					continue;
+				}
+
+				draws_.push_back({ lod.indexOffset, lod.indexCount, static_cast<int32_t>(submesh.vertexOffset), submesh.materialIndex, s });
+			}
+
+			// Stable so parts of one material keep their optimized order
+			std::stable_sort(draws_.begin(), draws_.end(), [](const SubmeshDraw& a, const SubmeshDraw& b) {
+				return a.materialIndex < b.materialIndex;
+			});
+			for (size_t d = 0; d < draws_.size(); ++d) {
+				if (d == 0 || draws_[d].materialIndex != draws_[d - 1].materialIndex) ++stats_.materialBatches;
+			}
+
+			auto finish = std::chrono::steady_clock::now();
+
+			++stats_.meshCount;
+			stats_.cullMilliseconds += std::chrono::duration<double, std::milli>(finish - start).count();
+
+			return draws_;
+		}
+
+		void resetStats() {
+			stats_ = {};
+		}
+
+		const std::vector<SubmeshDraw>& getDraws() const {
+			return draws_;
+		}
+		const SubmeshCullingStats& getStats() const {
+			return stats_;
+		}
+
+		SubmeshCuller& operator=(const SubmeshCuller&)     = default;
+		SubmeshCuller& operator=(SubmeshCuller&&) noexcept = default;
+	};
+}
\ No newline at end of file
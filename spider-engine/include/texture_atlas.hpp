@@ -0,0 +1,403 @@
+#pragma once
+#include <map>
+#include <tuple>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <DirectXMath.h>
+
+namespace spider_engine::rendering {
+	struct AtlasRect {
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	// Bottom-left skyline bin packer, the top edge of what is placed is kept as a list of horizontal segments
+	class SkylinePacker {
+	private:
+		struct Segment {
+			uint32_t x;
+			uint32_t y;
+			uint32_t width;
+		};
+
+		uint32_t             width_;
+		uint32_t             height_;
+		std::vector<Segment> skyline_;
+		size_t               usedArea_ = 0;
+
+		// Lowest y a rect of this width can sit at when its left edge is on segment index, false if it does not fit
+		bool fits(const size_t index, const uint32_t width, const uint32_t height, uint32_t& y) const {
+			const uint32_t x = skyline_[index].x;
+			if (x + width > width_) return false;
+
+			y = 0;
+			for (size_t i = index, left = width; left > 0; ++i) {
+				y = std::max(y, skyline_[i].y);
+				if (y + height > height_) return false;
+
+				left -= std::min<size_t>(left, skyline_[i].width);
+			}
+			return true;
+		}
+
+	public:
+		SkylinePacker(const uint32_t width = 0, const uint32_t height = 0) :
+			width_(width),
+			height_(height)
+		{
+			reset(width, height);
+		}
+		SkylinePacker(const SkylinePacker&)     = default;
+		SkylinePacker(SkylinePacker&&) noexcept = default;
+
+		void reset(const uint32_t width, const uint32_t height) {
+			width_    = width;
+			height_   = height;
+			usedArea_ = 0;
+			skyline_.assign(1, { 0, 0, width });
+		}
+
+		// Picks the position with the lowest top edge, ties go to the narrowest segment so gaps fill first
+		bool insert(const uint32_t width, const uint32_t height, AtlasRect& rect) {
+			size_t   best       = skyline_.size();
+			uint32_t bestY      = UINT32_MAX;
+			uint32_t bestWidth  = UINT32_MAX;
+			for (size_t i = 0; i < skyline_.size(); ++i) {
+				uint32_t y;
+				if (!fits(i, width, height, y)) continue;
+
+				if (y + height < bestY || (y + height == bestY && skyline_[i].width < bestWidth)) {
+					best      = i;
+					bestY     = y + height;
+					bestWidth = skyline_[i].width;
+				}
+			}
+			if (best == skyline_.size()) return false;
+
+			rect = { skyline_[best].x, bestY - height, width, height };
+
+			// The new segment covers the ones under the rect, the last of them may stick out on the right
+			skyline_.insert(skyline_.begin() + best, { rect.x, bestY, width });
+			for (size_t i = best + 1; i < skyline_.size();) {
+				const uint32_t end = rect.x + width;
+				if (skyline_[i].x >= end) break;
+
+				const uint32_t segmentEnd = skyline_[i].x + skyline_[i].width;
+				if (segmentEnd <= end) {
+					skyline_.erase(skyline_.begin() + i);
+					continue;
+				}
+				skyline_[i].width = segmentEnd - end;
+				skyline_[i].x     = end;
+				break;
+			}
+
+			// Neighbors at the same height become one segment
+			for (size_t i = 0; i + 1 < skyline_.size();) {
+				if (skyline_[i].y == skyline_[i + 1].y) {
+					skyline_[i].width += skyline_[i + 1].width;
+					skyline_.erase(skyline_.begin() + i + 1);
+				}
+				else {
+					++i;
+				}
+			}
+
+			usedArea_ += size_t(width) * height;
+			return true;
+		}
+
+		// Highest top edge so far, pages are trimmed down to it
+		uint32_t getUsedHeight() const {
+			uint32_t height = 0;
+			for (const Segment& segment : skyline_) height = std::max(height, segment.y);
+			return height;
+		}
+		size_t getUsedArea() const {
+			return usedArea_;
+		}
+
+		SkylinePacker& operator=(const SkylinePacker&)     = default;
+		SkylinePacker& operator=(SkylinePacker&&) noexcept = default;
+	};
+
+	struct TexturePackInput {
+		uint32_t width;
+		uint32_t height;
+		uint32_t mipLevels;
+		uint32_t format;            // DXGI_FORMAT, only textures of the same format share a page
+		uint32_t blockSize = 1;     // 4 for block compressed formats
+		bool     isTiling  = false; // Sampled with wrap outside [0, 1], can not go in an atlas
+	};
+
+	struct TexturePackSettings {
+		uint32_t atlasSize      = 2048;
+		uint32_t maxPackedSize  = 256; // Textures with a larger side keep their own resource or go to an array
+		uint32_t padding        = 1;   // Gutter texels around every texture, on each atlas mip level
+		uint32_t atlasMipLevels = 4;   // Each level doubles the gutter at the top, coarser levels would bleed anyway
+		uint32_t minArraySlices = 2;   // Same size, format and mips
+		uint32_t maxArraySlices = 256;
+		bool     useArrays      = true;
+	};
+
+	enum class TexturePageType : uint8_t {
+		STANDALONE, // Kept as it is
+		ARRAY,      // One slice per texture, every mip
+		ATLAS       // Packed side by side, atlasMipLevels mips
+	};
+
+	struct TexturePage {
+		TexturePageType type;
+
+		uint32_t width;
+		uint32_t height;
+		uint32_t mipLevels;
+		uint32_t arraySize = 1;
+		uint32_t format;
+		uint32_t blockSize = 1;
+		uint32_t gutter    = 0; // Atlas padding at level 0, halves on every level
+
+		std::vector<uint32_t> textures; // Inputs in slice or packing order
+	};
+
+	// Where a texture ended up. Materials sample the page at uv * uvScale + uvOffset and, for arrays, the slice
+	struct TexturePlacement {
+		uint32_t          page;
+		uint32_t          slice = 0;
+		AtlasRect         rect;     // Texels of level 0, without the gutter
+		DirectX::XMFLOAT2 uvScale  = { 1.0f, 1.0f };
+		DirectX::XMFLOAT2 uvOffset = { 0.0f, 0.0f };
+
+		// Scale in xy and offset in zw, as a material constant
+		DirectX::XMFLOAT4 getUvTransform() const {
+			return { uvScale.x, uvScale.y, uvOffset.x, uvOffset.y };
+		}
+	};
+
+	struct TexturePackingStats {
+		size_t textureCount    = 0;
+		size_t standaloneCount = 0;
+		size_t arrayCount      = 0;
+		size_t arraySlices     = 0;
+		size_t atlasCount      = 0;
+		size_t atlasTextures   = 0;
+		size_t atlasUsedTexels = 0; // Texture texels of level 0, gutters excluded
+		size_t atlasTexels     = 0; // Page texels of level 0
+		size_t bindingsBefore  = 0; // Texture changes over a draw order, see measureBindings()
+		size_t bindingsAfter   = 0;
+		double milliseconds    = 0.0;
+
+		size_t getResourceCount() const {
+			return standaloneCount + arrayCount + atlasCount;
+		}
+		// One view per resource instead of one per texture
+		size_t getDescriptorsSaved() const {
+			return textureCount - getResourceCount();
+		}
+		size_t getBindingsSaved() const {
+			return bindingsBefore > bindingsAfter ? bindingsBefore - bindingsAfter : 0;
+		}
+		double getAtlasEfficiency() const {
+			return atlasTexels ? static_cast<double>(atlasUsedTexels) / atlasTexels : 0.0;
+		}
+	};
+
+	struct TexturePackPlan {
+		std::vector<TexturePage>      pages;
+		std::vector<TexturePlacement> placements; // One per input, in input order
+
+		// Counts the texture changes of drawing textures in this order, unpacked and packed
+		void measureBindings(const std::vector<uint32_t>& drawOrder, TexturePackingStats& stats) const {
+			stats.bindingsBefore = 0;
+			stats.bindingsAfter  = 0;
+			for (size_t d = 0; d < drawOrder.size(); ++d) {
+				if (d == 0 || drawOrder[d] != drawOrder[d - 1])                                   ++stats.bindingsBefore;
+				if (d == 0 || placements[drawOrder[d]].page != placements[drawOrder[d - 1]].page) ++stats.bindingsAfter;
+			}
+		}
+	};
+
+	// Groups textures into fewer resources: same size, format and mip count go to texture arrays,
+	// what is left and small enough is packed into atlases per format, the rest stays as it is.
+	// Atlas rects are aligned so that every kept mip level of a texture starts on a whole texel (or block)
+	// and keeps its own gutter, filled with the texture's edge so filtering never reaches a neighbor.
+	class TexturePacker {
+	private:
+		static uint32_t alignUp(const uint32_t value, const uint32_t alignment) {
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		static void addStandalone(TexturePackPlan& plan, const TexturePackInput& input, const uint32_t id) {
+			TexturePage& page = plan.pages.emplace_back();
+			page.type         = TexturePageType::STANDALONE;
+			page.width        = input.width;
+			page.height       = input.height;
+			page.mipLevels    = input.mipLevels;
+			page.format       = input.format;
+			page.blockSize    = input.blockSize;
+			page.textures     = { id };
+
+			plan.placements[id].page = static_cast<uint32_t>(plan.pages.size() - 1);
+			plan.placements[id].rect = { 0, 0, input.width, input.height };
+		}
+
+	public:
+		static TexturePackPlan plan(const std::vector<TexturePackInput>& inputs,
+									const TexturePackSettings&           settings = {},
+									TexturePackingStats*                 stats    = nullptr)
+		{
+			auto start = std::chrono::steady_clock::now();
+
+			TexturePackPlan plan;
+			plan.placements.resize(inputs.size());
+
+			TexturePackingStats packing;
+			packing.textureCount = inputs.size();
+
+			std::vector<bool> isPlaced(inputs.size(), false);
+
+			// Arrays keep the full chain and need no gutter, so they get the first pick
+			if (settings.useArrays) {
+				std::map<std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>, std::vector<uint32_t>> groups;
+				for (uint32_t id = 0; id < inputs.size(); ++id) {
+					const TexturePackInput& input = inputs[id];
+					groups[{ input.format, input.width, input.height, input.mipLevels }].push_back(id);
+				}
+
+				for (auto& [key, ids] : groups) {
+					for (size_t first = 0; first < ids.size(); first += settings.maxArraySlices) {
+						const size_t count = std::min<size_t>(ids.size() - first, settings.maxArraySlices);
+						if (count < std::max(settings.minArraySlices, 2u)) break;
+
+						const TexturePackInput& input = inputs[ids[first]];
+
+						TexturePage& page = plan.pages.emplace_back();
+						page.type         = TexturePageType::ARRAY;
+						page.width        = input.width;
+						page.height       = input.height;
+						page.mipLevels    = input.mipLevels;
+						page.arraySize    = static_cast<uint32_t>(count);
+						page.format       = input.format;
+						page.blockSize    = input.blockSize;
+
+						for (uint32_t slice = 0; slice < count; ++slice) {
+							const uint32_t id = ids[first + slice];
+							page.textures.push_back(id);
+
+							TexturePlacement& placement = plan.placements[id];
+							placement.page  = static_cast<uint32_t>(plan.pages.size() - 1);
+							placement.slice = slice;
+							placement.rect  = { 0, 0, input.width, input.height };
+							isPlaced[id]    = true;
+						}
+
+						++packing.arrayCount;
+						packing.arraySlices += count;
+					}
+				}
+			}
+
+			// Atlas candidates per format, tallest first so shelves of the skyline line up
+			std::map<uint32_t, std::vector<uint32_t>> candidates;
+			for (uint32_t id = 0; id < inputs.size(); ++id) {
+				if (isPlaced[id]) continue;
+
+				const TexturePackInput& input     = inputs[id];
+				const uint32_t          alignment = input.blockSize << (settings.atlasMipLevels - 1);
+
+				const bool isSmall   = std::max(input.width, input.height) <= settings.maxPackedSize;
+				const bool hasMips   = input.mipLevels >= settings.atlasMipLevels;
+				const bool isAligned = input.blockSize == 1 || (input.width % alignment == 0 && input.height % alignment == 0);
+				if (isSmall && hasMips && isAligned && !input.isTiling && settings.atlasMipLevels > 0) candidates[input.format].push_back(id);
+			}
+
+			for (auto& [format, ids] : candidates) {
+				std::stable_sort(ids.begin(), ids.end(), [&inputs](const uint32_t a, const uint32_t b) {
+					return std::max(inputs[a].height, inputs[a].width) > std::max(inputs[b].height, inputs[b].width);
+				});
+
+				const uint32_t blockSize = inputs[ids.front()].blockSize;
+				const uint32_t alignment = blockSize << (settings.atlasMipLevels - 1);
+				const uint32_t gutter    = alignUp(settings.padding << (settings.atlasMipLevels - 1), alignment);
+
+				std::vector<std::vector<uint32_t>> pageTextures;
+				std::vector<SkylinePacker>         packers;
+				for (const uint32_t id : ids) {
+					const uint32_t width  = alignUp(inputs[id].width + 2 * gutter, alignment);
+					const uint32_t height = alignUp(inputs[id].height + 2 * gutter, alignment);
+
+					// Earlier pages may still have room for the smaller ones
+					AtlasRect rect;
+					size_t    p = 0;
+					while (p < packers.size() && !packers[p].insert(width, height, rect)) ++p;
+					if (p == packers.size()) {
+						packers.emplace_back(settings.atlasSize, settings.atlasSize);
+						pageTextures.emplace_back();
+						if (!packers.back().insert(width, height, rect)) {
+							packers.pop_back();
+							pageTextures.pop_back();
+							addStandalone(plan, inputs[id], id);
+							continue;
+						}
+					}
+
+					pageTextures[p].push_back(id);
+					plan.placements[id].rect = { rect.x + gutter, rect.y + gutter, inputs[id].width, inputs[id].height };
+				}
+
+				for (size_t p = 0; p < packers.size(); ++p) {
+					// A page of one texture saves nothing
+					if (pageTextures[p].size() < 2) {
+						for (const uint32_t id : pageTextures[p]) addStandalone(plan, inputs[id], id);
+						continue;
+					}
+
+					TexturePage& page = plan.pages.emplace_back();
+					page.type         = TexturePageType::ATLAS;
+					page.width        = settings.atlasSize;
+					page.height       = alignUp(packers[p].getUsedHeight(), alignment);
+					page.mipLevels    = settings.atlasMipLevels;
+					page.format       = format;
+					page.blockSize    = blockSize;
+					page.gutter       = gutter;
+					page.textures     = pageTextures[p];
+
+					for (const uint32_t id : page.textures) {
+						TexturePlacement& placement = plan.placements[id];
+						placement.page     = static_cast<uint32_t>(plan.pages.size() - 1);
+						placement.uvScale  = { static_cast<float>(placement.rect.width) / page.width, static_cast<float>(placement.rect.height) / page.height };
+						placement.uvOffset = { static_cast<float>(placement.rect.x) / page.width, static_cast<float>(placement.rect.y) / page.height };
+
+						packing.atlasUsedTexels += size_t(placement.rect.width) * placement.rect.height;
+					}
+
+					++packing.atlasCount;
+					packing.atlasTextures += page.textures.size();
+					packing.atlasTexels   += size_t(page.width) * page.height;
+				}
+
+				for (const uint32_t id : ids) isPlaced[id] = true;
+			}
+
+			for (uint32_t id = 0; id < inputs.size(); ++id) {
+				if (!isPlaced[id]) addStandalone(plan, inputs[id], id);
+			}
+			for (const TexturePage& page : plan.pages) {
+				if (page.type == TexturePageType::STANDALONE) ++packing.standaloneCount;
+			}
+
+			if (stats) {
+				auto finish = std::chrono::steady_clock::now();
+
+				packing.milliseconds = std::chrono::duration<double, std::milli>(finish - start).count();
+				*stats = packing;
+			}
+
+			return plan;
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,125 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+#include "DirectXTex/DirectXTex.h"
+#include "texture_atlas.hpp"
+
+namespace spider_engine::rendering {
+	struct PackedTextures {
+		TexturePackPlan                    plan;
+		std::vector<DirectX::ScratchImage> pages; // Parallel to plan.pages, empty for standalone pages
+		TexturePackingStats                stats;
+	};
+
+	inline TexturePackInput describeTexture(const DirectX::ScratchImage& image, const bool isTiling = false) {
+		const DirectX::TexMetadata& metadata = image.GetMetadata();
+
+		TexturePackInput input;
+		input.width     = static_cast<uint32_t>(metadata.width);
+		input.height    = static_cast<uint32_t>(metadata.height);
+		input.mipLevels = static_cast<uint32_t>(metadata.mipLevels);
+		input.format    = static_cast<uint32_t>(metadata.format);
+		input.blockSize = DirectX::IsCompressed(metadata.format) ? 4 : 1;
+		input.isTiling  = isTiling;
+		return input;
+	}
+
+	// Copies the textures of an array or atlas page of the plan into the page's image.
+	// Atlas gutters repeat the edge texels of each level (edge blocks for compressed formats).
+	inline void buildTexturePage(const TexturePage&                               page,
+								 const TexturePackPlan&                           plan,
+								 const std::vector<const DirectX::ScratchImage*>& textures,
+								 DirectX::ScratchImage&                           result)
+	{
+		const DXGI_FORMAT format = static_cast<DXGI_FORMAT>(page.format);
+
+		HRESULT hr = result.Initialize2D(format, page.width, page.height, page.arraySize, page.mipLevels);
+		if (FAILED(hr)) {
+			throw std::runtime_error("Failed to allocate texture page");
+		}
+
+		if (page.type == TexturePageType::ARRAY) {
+			for (uint32_t slice = 0; slice < page.arraySize; ++slice) {
+				for (uint32_t level = 0; level < page.mipLevels; ++level) {
+					const DirectX::Image* source      = textures[page.textures[slice]]->GetImage(level, 0, 0);
+					const DirectX::Image* destination = result.GetImage(level, slice, 0);
+					const size_t          rows        = destination->slicePitch / destination->rowPitch;
+					for (size_t row = 0; row < rows; ++row) {
+						std::memcpy(destination->pixels + row * destination->rowPitch, source->pixels + row * source->rowPitch, std::min(source->rowPitch, destination->rowPitch));
+					}
+				}
+			}
+			return;
+		}
+
+		std::memset(result.GetPixels(), 0, result.GetPixelsSize());
+
+		// Copies work on elements, a texel or a whole block
+		const uint32_t blockSize   = page.blockSize;
+		const size_t   elementSize = DirectX::BitsPerPixel(format) * blockSize * blockSize / 8;
+
+		for (const uint32_t id : page.textures) {
+			const AtlasRect& rect = plan.placements[id].rect;
+
+			for (uint32_t level = 0; level < page.mipLevels; ++level) {
+				const DirectX::Image* source      = textures[id]->GetImage(level, 0, 0);
+				const DirectX::Image* destination = result.GetImage(level, 0, 0);
+
+				const size_t columns     = (source->width + blockSize - 1) / blockSize;
+				const size_t rows        = (source->height + blockSize - 1) / blockSize;
+				const size_t pageColumns = (destination->width + blockSize - 1) / blockSize;
+				const size_t pageRows    = (destination->height + blockSize - 1) / blockSize;
+				const size_t x           = (rect.x >> level) / blockSize;
+				const size_t y           = (rect.y >> level) / blockSize;
+				const size_t gutter      = (page.gutter >> level) / blockSize;
+
+				auto element = [&](const size_t column, const size_t row) {
+					return destination->pixels + row * destination->rowPitch + column * elementSize;
+				};
+
+				for (size_t row = 0; row < rows; ++row) {
+					std::memcpy(element(x, y + row), source->pixels + row * source->rowPitch, columns * elementSize);
+
+					for (size_t g = 1; g <= gutter; ++g) {
+						std::memcpy(element(x - g, y + row), element(x, y + row), elementSize);
+						if (x + columns - 1 + g < pageColumns) std::memcpy(element(x + columns - 1 + g, y + row), element(x + columns - 1, y + row), elementSize);
+					}
+				}
+
+				// Rows above and below take the first and last row, gutter corners included
+				const size_t spanColumns = std::min(x + columns + gutter, pageColumns) - (x - gutter);
+				for (size_t g = 1; g <= gutter; ++g) {
+					std::memcpy(element(x - gutter, y - g), element(x - gutter, y), spanColumns * elementSize);
+					if (y + rows - 1 + g < pageRows) std::memcpy(element(x - gutter, y + rows - 1 + g), element(x - gutter, y + rows - 1), spanColumns * elementSize);
+				}
+			}
+		}
+	}
+
+	// Plans and builds the pages, isTiling marks the textures sampled with wrap (empty when none are)
+	inline PackedTextures packTextures(const std::vector<const DirectX::ScratchImage*>& textures,
+									   const TexturePackSettings&                       settings = {},
+									   const std::vector<bool>&                         isTiling = {})
+	{
+		std::vector<TexturePackInput> inputs;
+		inputs.reserve(textures.size());
+		for (size_t t = 0; t < textures.size(); ++t) {
+			inputs.push_back(describeTexture(*textures[t], t < isTiling.size() && isTiling[t]));
+		}
+
+		PackedTextures packed;
+		packed.plan = TexturePacker::plan(inputs, settings, &packed.stats);
+		packed.pages.resize(packed.plan.pages.size());
+
+		for (size_t p = 0; p < packed.plan.pages.size(); ++p) {
+			const TexturePage& page = packed.plan.pages[p];
+			if (page.type != TexturePageType::STANDALONE) buildTexturePage(page, packed.plan, textures, packed.pages[p]);
+		}
+
+		return packed;
+	}
+}
\ No newline at end of file
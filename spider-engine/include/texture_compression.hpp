@@ -0,0 +1,265 @@
+#pragma once
+#include <cctype>
+#include <chrono>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+
+#include "DirectXTex/DirectXTex.h"
+#include "mip_generator.hpp"
+
+namespace spider_engine::rendering {
+	enum class TextureCompression : uint8_t {
+		NONE, // RGBA8, still cooked into a DDS with its mips
+		AUTO, // Picked from the file name and the content
+		BC1,  // Opaque color, 4 bits per texel
+		BC3,  // Color with alpha, 8 bits per texel
+		BC4,  // One channel (masks, roughness, height), 4 bits per texel
+		BC5,  // Two channels, tangent space normal maps with Z rebuilt in the shader, 8 bits per texel
+		BC7   // High quality color with or without alpha, 8 bits per texel
+	};
+
+	struct TextureCookSettings {
+		TextureCompression compression = TextureCompression::AUTO;
+		MipFilter          mipFilter   = MipFilter::KAISER; // Cook time can afford the sharper filter
+		bool               highQuality = false;             // AUTO picks BC7 over BC1 / BC3 for color
+	};
+
+	struct TextureCompressionStats {
+		size_t textureCount       = 0;
+		size_t pixels             = 0; // Every mip level
+		size_t uncompressedBytes  = 0; // The same mips as RGBA8
+		size_t compressedBytes    = 0;
+		double encodeMilliseconds = 0.0;
+
+		size_t getSavedBytes() const {
+			return uncompressedBytes > compressedBytes ? uncompressedBytes - compressedBytes : 0;
+		}
+		double getMegapixelsPerSecond() const {
+			return encodeMilliseconds > 0.0 ? pixels / (encodeMilliseconds * 1000.0) : 0.0;
+		}
+
+		TextureCompressionStats& operator+=(const TextureCompressionStats& other) {
+			textureCount       += other.textureCount;
+			pixels             += other.pixels;
+			uncompressedBytes  += other.uncompressedBytes;
+			compressedBytes    += other.compressedBytes;
+			encodeMilliseconds += other.encodeMilliseconds;
+			return *this;
+		}
+	};
+
+	// Textures created on the GPU, compared with what they would take as RGBA8
+	struct TextureMemoryStats {
+		size_t textureCount      = 0;
+		size_t bytes             = 0;
+		size_t uncompressedBytes = 0;
+
+		size_t getSavedBytes() const {
+			return uncompressedBytes > bytes ? uncompressedBytes - bytes : 0;
+		}
+	};
+
+	inline DXGI_FORMAT getCompressedFormat(const TextureCompression compression) {
+		switch (compression) {
+			case TextureCompression::BC1: return DXGI_FORMAT_BC1_UNORM;
+			case TextureCompression::BC3: return DXGI_FORMAT_BC3_UNORM;
+			case TextureCompression::BC4: return DXGI_FORMAT_BC4_UNORM;
+			case TextureCompression::BC5: return DXGI_FORMAT_BC5_UNORM;
+			case TextureCompression::BC7: return DXGI_FORMAT_BC7_UNORM;
+			default:                      return DXGI_FORMAT_R8G8B8A8_UNORM;
+		}
+	}
+
+	// Bytes of the chain described by the metadata if it were stored as RGBA8
+	inline size_t getUncompressedSize(const DirectX::TexMetadata& metadata) {
+		size_t bytes = 0;
+		for (size_t level = 0, w = metadata.width, h = metadata.height; level < metadata.mipLevels; ++level) {
+			bytes += w * h * 4;
+			w      = std::max<size_t>(1, w / 2);
+			h      = std::max<size_t>(1, h / 2);
+		}
+		return bytes * metadata.arraySize;
+	}
+
+	// Mip chain of an RGBA8 image built by MipGenerator, as a DirectXTex image the upload and compressors take
+	inline DirectX::ScratchImage generateMipImage(const DirectX::Image& image,
+												  const MipSettings&    settings = {},
+												  MipGenerationStats*   stats    = nullptr)
+	{
+		const MipChain chain = MipGenerator::generate(
+			image.pixels,
+			static_cast<uint32_t>(image.width),
+			static_cast<uint32_t>(image.height),
+			image.rowPitch,
+			settings,
+			stats
+		);
+
+		DirectX::ScratchImage mipped;
+		HRESULT hr = mipped.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, image.width, image.height, 1, chain.levels.size());
+		if (FAILED(hr)) {
+			throw std::runtime_error("Failed to allocate mip chain");
+		}
+
+		for (uint32_t level = 0; level < chain.levels.size(); ++level) {
+			const DirectX::Image* mip = mipped.GetImage(level, 0, 0);
+			for (uint32_t y = 0; y < chain.levels[level].height; ++y) {
+				std::memcpy(mip->pixels + y * mip->rowPitch, chain.getPixels(level) + y * chain.getRowPitch(level), chain.getRowPitch(level));
+			}
+		}
+
+		return mipped;
+	}
+
+	// Name hints follow the usual suffixes, the content decides between grayscale, opaque and alpha
+	inline TextureCompression chooseCompression(const std::filesystem::path& path, const DirectX::Image& image, const bool highQuality) {
+		std::string stem = path.stem().string();
+		std::transform(stem.begin(), stem.end(), stem.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+		auto endsWith = [&stem](const std::string& suffix) {
+			return stem.size() >= suffix.size() && stem.compare(stem.size() - suffix.size(), suffix.size(), suffix) == 0;
+		};
+		if (endsWith("_n") || endsWith("_nrm") || endsWith("_normal")) return TextureCompression::BC5;
+
+		bool hasAlpha    = false;
+		bool isGrayscale = true;
+		for (size_t y = 0; y < image.height && (!hasAlpha || isGrayscale); ++y) {
+			const uint8_t* row = image.pixels + y * image.rowPitch;
+			for (size_t x = 0; x < image.width * 4; x += 4) {
+				hasAlpha    |= row[x + 3] != 255;
+				isGrayscale &= row[x] == row[x + 1] && row[x] == row[x + 2];
+			}
+		}
+
+		if (isGrayscale && !hasAlpha) return TextureCompression::BC4;
+		if (highQuality)              return TextureCompression::BC7;
+		return hasAlpha ? TextureCompression::BC3 : TextureCompression::BC1;
+	}
+
+	inline bool canLoadTextureSource(const std::filesystem::path& path) {
+		std::string extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+		if (extension == ".dds" || extension == ".tga") return true;
+#ifdef _WIN32
+		return extension == ".png" || extension == ".jpg" || extension == ".jpeg";
+#else
+		return false; // WIC is Windows only
+#endif
+	}
+
+	inline DirectX::ScratchImage loadTextureSource(const std::filesystem::path& path) {
+		std::string extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+		DirectX::ScratchImage image;
+		HRESULT               hr;
+		if      (extension == ".dds") hr = DirectX::LoadFromDDSFile(path.wstring().c_str(), DirectX::DDS_FLAGS_NONE, nullptr, image);
+		else if (extension == ".tga") hr = DirectX::LoadFromTGAFile(path.wstring().c_str(), nullptr, image);
+#ifdef _WIN32
+		else                          hr = DirectX::LoadFromWICFile(path.wstring().c_str(), DirectX::WIC_FLAGS_NONE, nullptr, image);
+#else
+		else                          hr = E_NOTIMPL;
+#endif
+		if (FAILED(hr)) {
+			throw std::runtime_error("Failed to load texture: " + path.string());
+		}
+		return image;
+	}
+
+	// Decodes, builds the mip chain and block compresses it, ready to be saved as a DDS.
+	// Sources that are already block compressed are kept untouched.
+	inline DirectX::ScratchImage compressTexture(const std::filesystem::path& path,
+												 const TextureCookSettings&   settings = {},
+												 TextureCompressionStats*     stats    = nullptr)
+	{
+		DirectX::ScratchImage source = loadTextureSource(path);
+		if (DirectX::IsCompressed(source.GetMetadata().format)) {
+			if (stats) {
+				++stats->textureCount;
+				stats->uncompressedBytes += getUncompressedSize(source.GetMetadata());
+				stats->compressedBytes   += source.GetPixelsSize();
+			}
+			return source;
+		}
+
+		const DirectX::Image* img = source.GetImage(0, 0, 0);
+
+		DirectX::ScratchImage rgba;
+		if (img->format != DXGI_FORMAT_R8G8B8A8_UNORM) {
+			HRESULT hr = DirectX::Convert(*img, DXGI_FORMAT_R8G8B8A8_UNORM, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, rgba);
+			if (FAILED(hr)) {
+				throw std::runtime_error("Failed to convert texture to RGBA8: " + path.string());
+			}
+			img = rgba.GetImage(0, 0, 0);
+		}
+
+		TextureCompression compression = settings.compression;
+		if (compression == TextureCompression::AUTO) compression = chooseCompression(path, *img, settings.highQuality);
+
+		// D3D12 wants the top level of a block compressed texture in whole blocks
+		if (img->width % 4 != 0 || img->height % 4 != 0) compression = TextureCompression::NONE;
+
+		auto start = std::chrono::steady_clock::now();
+
+		// Data channels are not gamma encoded
+		MipSettings mips;
+		mips.filter = settings.mipFilter;
+		mips.isSrgb = compression != TextureCompression::BC4 && compression != TextureCompression::BC5;
+
+		DirectX::ScratchImage mipped      = generateMipImage(*img, mips);
+		const size_t          mippedBytes = mipped.GetPixelsSize();
+
+		DirectX::ScratchImage result;
+		if (compression == TextureCompression::NONE) {
+			result = std::move(mipped);
+		}
+		else {
+			// Blocks are spread over every core, BC7 is by far the slowest so it takes the quick mode unless asked
+			DirectX::TEX_COMPRESS_FLAGS flags = DirectX::TEX_COMPRESS_PARALLEL;
+			if (compression == TextureCompression::BC7 && !settings.highQuality) flags |= DirectX::TEX_COMPRESS_BC7_QUICK;
+
+			HRESULT hr = DirectX::Compress(
+				mipped.GetImages(),
+				mipped.GetImageCount(),
+				mipped.GetMetadata(),
+				getCompressedFormat(compression),
+				flags,
+				DirectX::TEX_THRESHOLD_DEFAULT,
+				result
+			);
+			if (FAILED(hr)) {
+				throw std::runtime_error("Failed to compress texture: " + path.string());
+			}
+		}
+
+		if (stats) {
+			auto finish = std::chrono::steady_clock::now();
+
+			++stats->textureCount;
+			stats->pixels             += mippedBytes / 4;
+			stats->uncompressedBytes  += mippedBytes;
+			stats->compressedBytes    += result.GetPixelsSize();
+			stats->encodeMilliseconds += std::chrono::duration<double, std::milli>(finish - start).count();
+		}
+
+		return result;
+	}
+
+	inline void cookTexture(const std::filesystem::path& source,
+							const std::filesystem::path& output,
+							const TextureCookSettings&   settings = {},
+							TextureCompressionStats*     stats    = nullptr)
+	{
+		const DirectX::ScratchImage image = compressTexture(source, settings, stats);
+
+		HRESULT hr = DirectX::SaveToDDSFile(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DirectX::DDS_FLAGS_NONE, output.wstring().c_str());
+		if (FAILED(hr)) {
+			throw std::runtime_error("Failed to write texture: " + output.string());
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,331 @@
+#pragma once
+#include <queue>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+namespace spider_engine::rendering {
+	using StreamingTextureId = uint32_t;
+
+	struct StreamingTextureDesc {
+		uint32_t            width;
+		uint32_t            height;
+		std::vector<size_t> mipBytes; // One entry per level, level 0 first
+
+		uint32_t tailSize = 64; // Levels this size and smaller are always resident
+	};
+
+	// Residency changes decided by update(), in mip levels of the texture.
+	// Loads are done by the caller, which reports back with completeLoad() once the new mips are usable.
+	struct TextureResidencyChange {
+		StreamingTextureId id;
+		uint32_t           fromMip;
+		uint32_t           toMip; // Smaller than fromMip for loads
+	};
+
+	struct TextureStreamingStats {
+		size_t textureCount  = 0;
+		size_t budgetBytes   = 0;
+		size_t residentBytes = 0;
+		size_t pendingBytes  = 0; // Loads issued and not completed yet
+		size_t desiredBytes  = 0; // What every texture at its desired mip would take
+		size_t requested     = 0; // Textures seen by a camera this frame
+		size_t loads         = 0;
+		size_t evictions     = 0;
+		size_t budgetLimited = 0; // Textures held coarser than desired by the budget
+		double milliseconds  = 0.0;
+
+		double getBudgetUsage() const {
+			return budgetBytes ? static_cast<double>(residentBytes + pendingBytes) / budgetBytes : 0.0;
+		}
+	};
+
+	// Decides which mips of every streamed texture should be in video memory. Each frame the users of a
+	// texture request the mip their screen size needs, then update() hands out the byte budget to the most
+	// visible, most under-resolved textures first and evicts what is no longer worth keeping.
+	// Nothing here touches the GPU, so the policy can be driven by simulated cameras.
+	class TextureResidency {
+	private:
+		struct Entry {
+			StreamingTextureDesc desc;
+
+			uint32_t tailMip;          // Finest level of the always resident tail
+			uint32_t residentMip;      // Finest level in memory
+			uint32_t pendingMip;       // Finest level in memory once the issued load completes
+			uint32_t requestedMip;     // Finest level asked for this frame
+			float    priority = 0.0f;  // Largest screen size this frame, in pixels
+			uint64_t lastRequested = 0;
+			bool     isAlive = true;
+		};
+
+		std::vector<Entry>              entries_;
+		std::vector<StreamingTextureId> freeIds_;
+
+		std::vector<TextureResidencyChange> loads_;
+		std::vector<TextureResidencyChange> evictions_;
+
+		size_t   budgetBytes_;
+		uint32_t maxLoadsPerFrame_;
+		uint64_t frame_ = 0;
+
+		TextureStreamingStats stats_;
+
+		static constexpr uint64_t requestGrace = 10; // Frames
+
+		// Bytes of every level from mip down to the coarsest
+		static size_t getBytesFrom(const Entry& entry, const uint32_t mip) {
+			size_t bytes = 0;
+			for (uint32_t level = mip; level < entry.desc.mipBytes.size(); ++level) bytes += entry.desc.mipBytes[level];
+			return bytes;
+		}
+
+	public:
+		TextureResidency(const size_t budgetBytes = 256ull << 20, const uint32_t maxLoadsPerFrame = 8) :
+			budgetBytes_(budgetBytes),
+			maxLoadsPerFrame_(maxLoadsPerFrame)
+		{}
+		TextureResidency(const TextureResidency&)     = default;
+		TextureResidency(TextureResidency&&) noexcept = default;
+
+		// Level whose texel density matches the screen, assuming the texture is stretched once across the object.
+		// A positive bias picks coarser levels.
+		static uint32_t computeDesiredMip(const uint32_t width,
+										  const uint32_t height,
+										  const uint32_t mipLevels,
+										  const float    screenPixels,
+										  const float    bias = 0.0f)
+		{
+			if (mipLevels == 0) return 0;
+			if (screenPixels <= 0.0f) return mipLevels - 1;
+
+			const float level = std::floor(std::log2(std::max(width, height) / screenPixels) + bias);
+			return static_cast<uint32_t>(std::clamp(level, 0.0f, static_cast<float>(mipLevels - 1)));
+		}
+
+		// Projected diameter of a bounding sphere, pixelsPerUnitAtOne is viewport height / (2 tan(fovY / 2))
+		static float computeScreenPixels(const float radius, const float distance, const float pixelsPerUnitAtOne) {
+			return 2.0f * radius * pixelsPerUnitAtOne / std::max(distance, 1e-4f);
+		}
+
+		// Only the tail is resident at first, the caller uploads it right away
+		StreamingTextureId add(StreamingTextureDesc desc) {
+			Entry entry;
+			entry.desc = std::move(desc);
+
+			const uint32_t levels = static_cast<uint32_t>(entry.desc.mipBytes.size());
+			uint32_t       tail   = 0;
+			while (tail + 1 < levels && std::max(entry.desc.width >> tail, entry.desc.height >> tail) > entry.desc.tailSize) ++tail;
+
+			entry.tailMip      = tail;
+			entry.residentMip  = tail;
+			entry.pendingMip   = tail;
+			entry.requestedMip = tail;
+
+			if (!freeIds_.empty()) {
+				const StreamingTextureId id = freeIds_.back();
+				freeIds_.pop_back();
+				entries_[id] = std::move(entry);
+				return id;
+			}
+			entries_.push_back(std::move(entry));
+			return static_cast<StreamingTextureId>(entries_.size() - 1);
+		}
+		void remove(const StreamingTextureId id) {
+			entries_[id].isAlive = false;
+			entries_[id].desc    = {};
+			freeIds_.push_back(id);
+		}
+
+		// Call for every visible user of the texture, the finest mip and largest screen size win
+		void request(const StreamingTextureId id, const uint32_t mip, const float screenPixels) {
+			Entry& entry = entries_[id];
+			if (entry.lastRequested != frame_ + 1) {
+				entry.requestedMip = entry.tailMip;
+				entry.priority     = 0.0f;
+			}
+			entry.requestedMip  = std::min(entry.requestedMip, mip);
+			entry.priority      = std::max(entry.priority, screenPixels);
+			entry.lastRequested = frame_ + 1;
+		}
+
+		// The caller finished uploading the levels of a load change. Returns the finest level to keep,
+		// coarser than the load when an eviction cancelled it in the meantime.
+		uint32_t completeLoad(const StreamingTextureId id, const uint32_t mip) {
+			Entry& entry = entries_[id];
+			if (!entry.isAlive) return mip;
+
+			entry.residentMip = std::min(entry.residentMip, std::max(mip, entry.pendingMip));
+			return entry.residentMip;
+		}
+
+		// The load could not be issued, it is asked for again on a later update
+		void cancelLoad(const StreamingTextureId id) {
+			entries_[id].pendingMip = entries_[id].residentMip;
+		}
+
+		void update() {
+			auto start = std::chrono::steady_clock::now();
+
+			++frame_;
+			loads_.clear();
+			evictions_.clear();
+			stats_ = {};
+			stats_.budgetBytes = budgetBytes_;
+
+			// The tails always stay, the rest of the budget is handed out one level at a time
+			size_t                budget = budgetBytes_;
+			std::vector<uint32_t> targets(entries_.size());
+			for (StreamingTextureId id = 0; id < entries_.size(); ++id) {
+				const Entry& entry = entries_[id];
+				if (!entry.isAlive) continue;
+
+				const size_t tail = getBytesFrom(entry, entry.tailMip);
+				budget      = budget > tail ? budget - tail : 0;
+				targets[id] = entry.tailMip;
+
+				++stats_.textureCount;
+				if (entry.lastRequested == frame_) {
+					++stats_.requested;
+					stats_.desiredBytes += getBytesFrom(entry, std::min(entry.requestedMip, entry.tailMip));
+				}
+				else {
+					stats_.desiredBytes += tail;
+				}
+			}
+
+			// Levels in memory stay while their texture is in use, loads only take what is left, so a moving camera
+			// does not swap levels back and forth. One level finer than asked for is kept too, and levels outlive
+			// the last request by a few frames for props on the edge of the frustum.
+			std::vector<StreamingTextureId> inUse;
+			for (StreamingTextureId id = 0; id < entries_.size(); ++id) {
+				const Entry& entry = entries_[id];
+				if (entry.isAlive && entry.lastRequested != 0 && frame_ - entry.lastRequested < requestGrace && entry.pendingMip < targets[id]) {
+					inUse.push_back(id);
+				}
+			}
+			std::sort(inUse.begin(), inUse.end(), [this](const StreamingTextureId a, const StreamingTextureId b) {
+				return entries_[a].lastRequested > entries_[b].lastRequested;
+			});
+			for (const StreamingTextureId id : inUse) {
+				const Entry&   entry = entries_[id];
+				const uint32_t keep  = std::max(entry.pendingMip, entry.requestedMip > 0 ? entry.requestedMip - 1 : 0);
+				while (targets[id] > keep && entry.desc.mipBytes[targets[id] - 1] <= budget) {
+					budget -= entry.desc.mipBytes[targets[id] - 1];
+					--targets[id];
+				}
+			}
+
+			// Largest on screen and furthest from the desired level first, each level costs four times the last
+			using Step = std::pair<float, StreamingTextureId>;
+			std::priority_queue<Step> steps;
+			auto pushStep = [&](const StreamingTextureId id) {
+				const Entry& entry = entries_[id];
+				if (entry.lastRequested != frame_ || targets[id] <= entry.requestedMip) return;
+				steps.push({ entry.priority * static_cast<float>(1u << std::min(targets[id] - entry.requestedMip, 16u)), id });
+			};
+			for (StreamingTextureId id = 0; id < entries_.size(); ++id) {
+				if (entries_[id].isAlive) pushStep(id);
+			}
+
+			while (!steps.empty()) {
+				const StreamingTextureId id = steps.top().second;
+				steps.pop();
+
+				const size_t cost = entries_[id].desc.mipBytes[targets[id] - 1];
+				if (cost > budget) {
+					++stats_.budgetLimited;
+					continue;
+				}
+				budget -= cost;
+				--targets[id];
+				pushStep(id);
+			}
+
+			// Leftover budget keeps finer levels already in memory, most recently used first, so nothing thrashes
+			std::vector<StreamingTextureId> resident;
+			for (StreamingTextureId id = 0; id < entries_.size(); ++id) {
+				if (entries_[id].isAlive && entries_[id].pendingMip < targets[id]) resident.push_back(id);
+			}
+			std::sort(resident.begin(), resident.end(), [this](const StreamingTextureId a, const StreamingTextureId b) {
+				return entries_[a].lastRequested > entries_[b].lastRequested;
+			});
+			for (const StreamingTextureId id : resident) {
+				const Entry& entry = entries_[id];
+				while (targets[id] > entry.pendingMip && entry.desc.mipBytes[targets[id] - 1] <= budget) {
+					budget -= entry.desc.mipBytes[targets[id] - 1];
+					--targets[id];
+				}
+			}
+
+			// Evictions free memory at once, loads are capped and the coarsest missing levels go first
+			std::vector<StreamingTextureId> wanted;
+			for (StreamingTextureId id = 0; id < entries_.size(); ++id) {
+				Entry& entry = entries_[id];
+				if (!entry.isAlive) continue;
+
+				if (targets[id] > entry.pendingMip) {
+					// Cancels a pending load, and drops resident levels past the target
+					if (targets[id] > entry.residentMip) {
+						evictions_.push_back({ id, entry.residentMip, targets[id] });
+						entry.residentMip = targets[id];
+					}
+					entry.pendingMip = targets[id];
+				}
+				else if (targets[id] < entry.pendingMip && entry.pendingMip == entry.residentMip) {
+					wanted.push_back(id);
+				}
+			}
+			std::sort(wanted.begin(), wanted.end(), [this](const StreamingTextureId a, const StreamingTextureId b) {
+				return entries_[a].priority > entries_[b].priority;
+			});
+			for (size_t w = 0; w < std::min<size_t>(wanted.size(), maxLoadsPerFrame_); ++w) {
+				Entry& entry = entries_[wanted[w]];
+
+				// One level per load, big jumps are spread over frames and the texture sharpens gradually
+				loads_.push_back({ wanted[w], entry.residentMip, entry.residentMip - 1 });
+				entry.pendingMip = entry.residentMip - 1;
+			}
+
+			for (const Entry& entry : entries_) {
+				if (!entry.isAlive) continue;
+				stats_.residentBytes += getBytesFrom(entry, entry.residentMip);
+				stats_.pendingBytes  += getBytesFrom(entry, entry.pendingMip) - getBytesFrom(entry, std::max(entry.pendingMip, entry.residentMip));
+			}
+			stats_.loads     = loads_.size();
+			stats_.evictions = evictions_.size();
+
+			auto finish = std::chrono::steady_clock::now();
+			stats_.milliseconds = std::chrono::duration<double, std::milli>(finish - start).count();
+		}
+
+		const std::vector<TextureResidencyChange>& getLoads() const {
+			return loads_;
+		}
+		const std::vector<TextureResidencyChange>& getEvictions() const {
+			return evictions_;
+		}
+
+		uint32_t getResidentMip(const StreamingTextureId id) const {
+			return entries_[id].residentMip;
+		}
+		uint32_t getTailMip(const StreamingTextureId id) const {
+			return entries_[id].tailMip;
+		}
+
+		void setBudget(const size_t budgetBytes) {
+			budgetBytes_ = budgetBytes;
+		}
+		size_t getBudget() const {
+			return budgetBytes_;
+		}
+
+		const TextureStreamingStats& getStats() const {
+			return stats_;
+		}
+
+		TextureResidency& operator=(const TextureResidency&)     = default;
+		TextureResidency& operator=(TextureResidency&&) noexcept = default;
+	};
+}
\ No newline at end of file
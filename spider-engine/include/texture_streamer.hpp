@@ -0,0 +1,396 @@
+#pragma once
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <DirectXMath.h>
+
+#include "dx12_renderer.hpp"
+#include "frame_profiler.hpp"
+#include "texture_residency.hpp"
+#include "frustum_culling.hpp"
+#include "scene_hierarchy.hpp"
+#include "camera.hpp"
+#include "flecs.h"
+
+namespace spider_engine::d3dx12 {
+	// Marks a Renderizable whose texture is streamed, its texture member always holds the resident levels
+	struct StreamedTexture {
+		rendering::StreamingTextureId id;
+	};
+
+	// Keeps every streamed texture's full mip chain in system memory and only the levels TextureResidency
+	// picked on the GPU. A residency change builds a new texture: levels already resident are copied on
+	// the GPU, new ones are uploaded, and the Renderizables using it switch over once the copy is done.
+	// Pipelines hold views of the texture they were bound with, so bound textures have to be bound again.
+	class TextureStreamer {
+	private:
+		template <typename Ty>
+		using ComPtr = Microsoft::WRL::ComPtr<Ty>;
+
+		SPIDER_DX12_ERROR_CHECK_PREPARE;
+
+		struct Source {
+			DirectX::ScratchImage image;        // Every level
+			Texture2D             texture;      // Resident levels only
+			uint32_t              firstMip = 0; // Level of image held in the texture's first level
+			bool                  isBusy   = false;
+		};
+
+		// A rebuilt texture waiting for its copy before it replaces the old one
+		struct Transition {
+			rendering::StreamingTextureId id;
+			Texture2D                     texture;
+			uint32_t                      firstMip;
+			bool                          isLoad;
+			uint64_t                      fenceValue;
+		};
+
+		struct Retired {
+			Texture2D texture;
+			uint64_t  frame;
+		};
+
+		struct CopyBatch {
+			ComPtr<ID3D12CommandAllocator>    allocator;
+			ComPtr<ID3D12GraphicsCommandList> commandList;
+			uint64_t                          fenceValue = 0;
+		};
+
+		flecs::world* world_;
+		DX12Renderer* renderer_;
+
+		rendering::TextureResidency residency_;
+		float                       mipBias_;
+
+		std::vector<Source>     sources_; // Indexed by streaming id
+		std::vector<Transition> inFlight_;
+		std::vector<Retired>    retired_;
+		std::vector<CopyBatch>  batches_;
+		ComPtr<ID3D12Fence>     fence_;
+		uint64_t                fenceValue_ = 0;
+		uint64_t                frame_      = 0;
+		uint64_t                frameLatency_;
+
+		CopyBatch& acquireBatch() {
+			const uint64_t completed = fence_->GetCompletedValue();
+			for (CopyBatch& batch : batches_) {
+				if (batch.fenceValue <= completed) return batch;
+			}
+
+			CopyBatch& batch = batches_.emplace_back();
+			SPIDER_DX12_ERROR_CHECK(
+				renderer_->device_->CreateCommandAllocator(
+					D3D12_COMMAND_LIST_TYPE_DIRECT,
+					IID_PPV_ARGS(&batch.allocator)
+				)
+			);
+			SPIDER_DX12_ERROR_CHECK(
+				renderer_->device_->CreateCommandList(
+					0,
+					D3D12_COMMAND_LIST_TYPE_DIRECT,
+					batch.allocator.Get(),
+					nullptr,
+					IID_PPV_ARGS(&batch.commandList)
+				)
+			);
+			batch.commandList->Close();
+
+			return batch;
+		}
+
+		// Texture holding levels [firstMip, end) of the source. Levels the current texture has are copied
+		// from it, the finer ones come from system memory through an upload buffer.
+		Texture2D rebuild(const Source& source, const uint32_t firstMip, ID3D12GraphicsCommandList* commandList) {
+			const DirectX::TexMetadata& metadata = source.image.GetMetadata();
+			const DirectX::Image*       top      = source.image.GetImage(firstMip, 0, 0);
+
+			Texture2D texture;
+			texture.width       = static_cast<uint32_t>(top->width);
+			texture.height      = static_cast<uint32_t>(top->height);
+			texture.mipLevels   = static_cast<uint32_t>(metadata.mipLevels) - firstMip;
+			texture.format      = metadata.format;
+			texture.sizeInBytes = 0;
+			for (uint32_t level = firstMip; level < metadata.mipLevels; ++level) {
+				texture.sizeInBytes += source.image.GetImage(level, 0, 0)->slicePitch;
+			}
+
+			// Placed, so the memory of the level set it replaces is reused instead of going back to the OS
+			D3D12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(
+				texture.format,
+				texture.width,
+				texture.height,
+				1,
+				static_cast<UINT16>(texture.mipLevels)
+			);
+			texture.resource = renderer_->memoryAllocator_->createResource(GpuMemoryCategory::TEXTURE, textureDesc, D3D12_RESOURCE_STATE_COPY_DEST);
+			renderer_->resourceStates_->track(texture.resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+
+			ResourceStateTracker& states = renderer_->resourceStates_->getTracker(commandList);
+			states.assume(texture.resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST);
+
+			// New levels
+			const uint32_t uploadCount = !source.texture.resource  ? texture.mipLevels
+									   : firstMip < source.firstMip ? source.firstMip - firstMip
+																	: 0;
+			if (uploadCount > 0) {
+				const UINT64 uploadBufferSize = GetRequiredIntermediateSize(texture.resource.Get(), 0, uploadCount);
+				texture.uploadResource        = renderer_->memoryAllocator_->createBuffer(GpuMemoryCategory::UPLOAD, uploadBufferSize, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+				std::vector<D3D12_SUBRESOURCE_DATA> subresources(uploadCount);
+				for (uint32_t s = 0; s < uploadCount; ++s) {
+					const DirectX::Image* mip = source.image.GetImage(firstMip + s, 0, 0);
+					subresources[s].pData      = mip->pixels;
+					subresources[s].RowPitch   = mip->rowPitch;
+					subresources[s].SlicePitch = mip->slicePitch;
+				}
+				const UINT64 uploaded = UpdateSubresources(commandList, texture.resource.Get(), texture.uploadResource.Get(), 0, 0, uploadCount, subresources.data());
+				if (uploaded == 0) {
+					throw std::runtime_error("UpdateSubresources returned 0!");
+				}
+				renderer_->uploadedBytes_ += uploaded;
+			}
+
+			// Levels already on the GPU
+			if (uploadCount < texture.mipLevels) {
+				// Sampled by the frames in flight, whatever state they left it in is fixed up at submission
+				states.transition(source.texture.resource.Get(), D3D12_RESOURCE_STATE_COPY_SOURCE);
+				states.flush(commandList);
+
+				for (uint32_t level = firstMip + uploadCount; level < metadata.mipLevels; ++level) {
+					CD3DX12_TEXTURE_COPY_LOCATION destination(texture.resource.Get(), level - firstMip);
+					CD3DX12_TEXTURE_COPY_LOCATION origin(source.texture.resource.Get(), level - source.firstMip);
+					commandList->CopyTextureRegion(&destination, 0, 0, 0, &origin, nullptr);
+				}
+
+				// Frames already recorded keep sampling the old texture until the switch
+				states.transition(source.texture.resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+			}
+
+			// Batched with the other textures of the list, flushed before its next copy or at submission
+			states.transition(texture.resource.Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+			SPIDER_DBG_CODE(texture.resource->SetName(L"StreamedTexture2D"));
+
+			return texture;
+		}
+
+		uint64_t submit(CopyBatch& batch) {
+			renderer_->resourceStates_->submit(renderer_->commandQueue_.Get(), batch.commandList.Get());
+			renderer_->commandQueue_->Signal(fence_.Get(), ++fenceValue_);
+			batch.fenceValue = fenceValue_;
+
+			return fenceValue_;
+		}
+
+		void requestVisible(const rendering::Camera& camera) {
+			const rendering::Frustum frustum = rendering::Frustum::fromViewProjection(camera.getViewProjectionMatrix());
+
+			DirectX::XMFLOAT3 eye;
+			DirectX::XMStoreFloat3(&eye, camera.transform.position);
+
+			const float pixelsPerUnitAtOne = static_cast<float>(camera.getHeight()) / (2.0f * std::tan(camera.getFov() * 0.5f));
+
+			world_->each([&](flecs::entity entity, const Renderizable& renderizable, const StreamedTexture& streamed) {
+				if (!renderizable.mesh) return;
+
+				const rendering::WorldTransform* worldTransform = entity.get<rendering::WorldTransform>();
+				DirectX::XMMATRIX                world          = worldTransform ? worldTransform->matrix : renderizable.transform.toMatrix();
+
+				const rendering::BoundingVolume bounds = renderizable.mesh->bounds.transformed(world);
+				if (!frustum.intersects(bounds)) return;
+
+				const float dx       = bounds.center.x - eye.x;
+				const float dy       = bounds.center.y - eye.y;
+				const float dz       = bounds.center.z - eye.z;
+				const float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz) - bounds.radius, camera.getNearZ());
+
+				const DirectX::TexMetadata& metadata = sources_[streamed.id].image.GetMetadata();
+				const float                 pixels   = rendering::TextureResidency::computeScreenPixels(bounds.radius, distance, pixelsPerUnitAtOne);
+				const uint32_t              mip      = rendering::TextureResidency::computeDesiredMip(
+					static_cast<uint32_t>(metadata.width),
+					static_cast<uint32_t>(metadata.height),
+					static_cast<uint32_t>(metadata.mipLevels),
+					pixels,
+					mipBias_
+				);
+
+				residency_.request(streamed.id, mip, pixels);
+			});
+		}
+
+		// Switches every finished transition over and hands the new textures to their Renderizables
+		void completeTransitions() {
+			const uint64_t completed = fence_->GetCompletedValue();
+
+			std::vector<bool> changed(sources_.size(), false);
+			auto split = std::stable_partition(inFlight_.begin(), inFlight_.end(), [completed](const Transition& transition) {
+				return transition.fenceValue > completed;
+			});
+			for (auto it = split; it != inFlight_.end(); ++it) {
+				Source& source = sources_[it->id];
+				source.isBusy  = false;
+
+				// Removed while copying
+				if (source.image.GetImageCount() == 0) {
+					retired_.push_back({ std::move(it->texture), frame_ });
+					continue;
+				}
+
+				it->texture.uploadResource.Reset();
+				retired_.push_back({ std::move(source.texture), frame_ });
+
+				source.texture  = std::move(it->texture);
+				source.firstMip = it->firstMip;
+				changed[it->id] = true;
+
+				if (it->isLoad) residency_.completeLoad(it->id, it->firstMip);
+			}
+			inFlight_.erase(split, inFlight_.end());
+
+			if (std::find(changed.begin(), changed.end(), true) == changed.end()) return;
+
+			world_->each([&](Renderizable& renderizable, const StreamedTexture& streamed) {
+				if (streamed.id < changed.size() && changed[streamed.id]) renderizable.texture = std::make_shared<Texture2D>(sources_[streamed.id].texture);
+			});
+		}
+
+	public:
+		// Frame latency is the number of frames in flight, replaced textures are released after it has passed
+		TextureStreamer(flecs::world*  world,
+						DX12Renderer&  renderer,
+						const size_t   budgetBytes      = 256ull << 20,
+						const uint32_t maxLoadsPerFrame = 8,
+						const float    mipBias          = 0.0f) :
+			world_(world),
+			renderer_(&renderer),
+			residency_(budgetBytes, maxLoadsPerFrame),
+			mipBias_(mipBias),
+			frameLatency_(renderer.bufferCount_)
+		{
+			SPIDER_DX12_ERROR_CHECK(renderer_->device_->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence_)));
+		}
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer(TextureStreamer&&)      = delete;
+
+		~TextureStreamer() {
+			// Copies still reading the old textures or writing the new ones
+			if (fence_ && fence_->GetCompletedValue() < fenceValue_) {
+				fence_->SetEventOnCompletion(fenceValue_, nullptr);
+			}
+		}
+
+		// Takes the full chain (loadImage or a cooked DDS), only the small tail levels go to the GPU now
+		rendering::StreamingTextureId add(DirectX::ScratchImage image) {
+			const DirectX::TexMetadata& metadata = image.GetMetadata();
+
+			rendering::StreamingTextureDesc desc;
+			desc.width  = static_cast<uint32_t>(metadata.width);
+			desc.height = static_cast<uint32_t>(metadata.height);
+			for (uint32_t level = 0; level < metadata.mipLevels; ++level) {
+				desc.mipBytes.push_back(image.GetImage(level, 0, 0)->slicePitch);
+			}
+
+			const rendering::StreamingTextureId id = residency_.add(std::move(desc));
+			if (id >= sources_.size()) sources_.resize(id + 1);
+
+			Source& source = sources_[id];
+			source         = {};
+			source.image   = std::move(image);
+
+			CopyBatch& batch = acquireBatch();
+			SPIDER_DX12_ERROR_CHECK(batch.allocator->Reset());
+			SPIDER_DX12_ERROR_CHECK(batch.commandList->Reset(batch.allocator.Get(), nullptr));
+
+			source.firstMip = residency_.getTailMip(id);
+			source.texture  = rebuild(source, source.firstMip, batch.commandList.Get());
+
+			// Same queue as the frames, so draws recorded after this see the copy done
+			submit(batch);
+			retired_.push_back({ Texture2D{ nullptr, std::move(source.texture.uploadResource) }, frame_ });
+
+			return id;
+		}
+		void remove(const rendering::StreamingTextureId id) {
+			residency_.remove(id);
+
+			Source& source = sources_[id];
+			retired_.push_back({ std::move(source.texture), frame_ });
+			source.image.Release();
+		}
+
+		// Sets the component and the current texture, later swaps are written by update()
+		void attach(flecs::entity entity, const rendering::StreamingTextureId id) {
+			entity.set<StreamedTexture>({ id });
+			if (Renderizable* renderizable = entity.get_mut<Renderizable>()) renderizable->texture = std::make_shared<Texture2D>(sources_[id].texture);
+		}
+
+		// Call once per frame after waiting for its fence, from the thread that owns the renderer
+		void update(const rendering::Camera& camera) {
+			SPIDER_PROFILE_SCOPE("TextureStreamer::update");
+
+			++frame_;
+
+			completeTransitions();
+
+			retired_.erase(std::remove_if(retired_.begin(), retired_.end(), [this](const Retired& retired) {
+				return frame_ - retired.frame > frameLatency_;
+			}), retired_.end());
+
+			requestVisible(camera);
+			residency_.update();
+
+			std::vector<std::pair<rendering::StreamingTextureId, bool>> changes;
+			for (const rendering::TextureResidencyChange& load : residency_.getLoads()) {
+				if (sources_[load.id].isBusy) residency_.cancelLoad(load.id);
+				else                          changes.push_back({ load.id, true });
+			}
+
+			// Evictions, and loads that finished after an eviction made them too fine
+			for (rendering::StreamingTextureId id = 0; id < sources_.size(); ++id) {
+				const Source& source = sources_[id];
+				if (source.texture.resource && !source.isBusy && source.firstMip < residency_.getResidentMip(id)) changes.push_back({ id, false });
+			}
+			if (changes.empty()) return;
+
+			CopyBatch& batch = acquireBatch();
+			SPIDER_DX12_ERROR_CHECK(batch.allocator->Reset());
+			SPIDER_DX12_ERROR_CHECK(batch.commandList->Reset(batch.allocator.Get(), nullptr));
+
+			std::vector<Transition> recorded;
+			for (auto& [id, isLoad] : changes) {
+				Source&        source   = sources_[id];
+				const uint32_t firstMip = isLoad ? source.firstMip - 1 : residency_.getResidentMip(id);
+
+				recorded.push_back({ id, rebuild(source, firstMip, batch.commandList.Get()), firstMip, isLoad, 0 });
+				source.isBusy = true;
+			}
+
+			const uint64_t fenceValue = submit(batch);
+			for (Transition& transition : recorded) {
+				transition.fenceValue = fenceValue;
+				inFlight_.push_back(std::move(transition));
+			}
+		}
+
+		const Texture2D& getTexture(const rendering::StreamingTextureId id) const {
+			return sources_[id].texture;
+		}
+
+		void setBudget(const size_t budgetBytes) {
+			residency_.setBudget(budgetBytes);
+		}
+		void setMipBias(const float mipBias) {
+			mipBias_ = mipBias;
+		}
+
+		const rendering::TextureResidency& getResidency() const {
+			return residency_;
+		}
+		const rendering::TextureStreamingStats& getStats() const {
+			return residency_.getStats();
+		}
+
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(TextureStreamer&&)      = delete;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,287 @@
+#pragma once
+#include <bit>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "offset_allocator.hpp"
+
+namespace spider_engine {
+	struct TlsfAllocation {
+		static constexpr uint64_t invalidOffset = ~0ull;
+		static constexpr uint32_t invalidBlock  = ~0u;
+
+		uint64_t offset = invalidOffset;
+		uint64_t size   = 0;            // Rounded up to the granularity
+		uint32_t block  = invalidBlock; // Handed back to free()
+
+		bool isValid() const {
+			return offset != invalidOffset;
+		}
+	};
+
+	// Two-level segregated fit allocator over an abstract [0, capacity) space, like OffsetAllocator but with
+	// constant time allocate and free. Free blocks are binned by the position of their highest bit, then
+	// 32 linear steps within it, and two levels of bitmaps find the first non-empty bin that is large
+	// enough without walking any list. Sizes and offsets are kept in granules so every offset stays
+	// aligned to the granularity, larger power of two alignments are honored per allocation.
+	class TlsfAllocator {
+	private:
+		static constexpr uint32_t secondLevelBits  = 5;
+		static constexpr uint32_t secondLevelCount = 1u << secondLevelBits;
+		static constexpr uint32_t firstLevelCount  = 64 - secondLevelBits + 1;
+		static constexpr uint32_t none             = ~0u;
+
+		struct Block {
+			uint64_t offset; // In granules
+			uint64_t size;
+			uint32_t previousPhysical = none;
+			uint32_t nextPhysical     = none;
+			uint32_t previousFree     = none;
+			uint32_t nextFree         = none;
+			bool     isFree           = false;
+		};
+
+		std::vector<Block>    blocks_;
+		std::vector<uint32_t> unusedBlocks_;
+
+		uint64_t                                                            firstLevelMap_ = 0;
+		std::array<uint32_t, firstLevelCount>                               secondLevelMaps_{};
+		std::array<std::array<uint32_t, secondLevelCount>, firstLevelCount> heads_;
+
+		uint64_t capacity_;    // In granules
+		uint64_t granularity_; // Power of two
+		uint32_t granularityShift_;
+		uint64_t used_;
+		size_t   allocationCount_;
+		size_t   freeBlockCount_;
+
+		// Bin holding blocks of this size
+		static void mapInsert(const uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel) {
+			if (size < secondLevelCount) {
+				firstLevel  = 0;
+				secondLevel = static_cast<uint32_t>(size);
+				return;
+			}
+			const uint32_t highest = static_cast<uint32_t>(std::bit_width(size) - 1);
+			firstLevel  = highest - secondLevelBits + 1;
+			secondLevel = static_cast<uint32_t>(size >> (highest - secondLevelBits)) ^ secondLevelCount;
+		}
+		// First bin whose every block is at least this large, the request is rounded up to the next step
+		static void mapSearch(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel) {
+			if (size >= secondLevelCount) {
+				const uint32_t highest = static_cast<uint32_t>(std::bit_width(size) - 1);
+				size += (1ull << (highest - secondLevelBits)) - 1;
+			}
+			mapInsert(size, firstLevel, secondLevel);
+		}
+
+		uint32_t createBlock() {
+			if (!unusedBlocks_.empty()) {
+				const uint32_t index = unusedBlocks_.back();
+				unusedBlocks_.pop_back();
+				blocks_[index] = {};
+				return index;
+			}
+			blocks_.emplace_back();
+			return static_cast<uint32_t>(blocks_.size() - 1);
+		}
+		void destroyBlock(const uint32_t index) {
+			unusedBlocks_.push_back(index);
+		}
+
+		void insertFree(const uint32_t index) {
+			Block& block = blocks_[index];
+
+			uint32_t firstLevel, secondLevel;
+			mapInsert(block.size, firstLevel, secondLevel);
+
+			const uint32_t head = heads_[firstLevel][secondLevel];
+			block.isFree       = true;
+			block.previousFree = none;
+			block.nextFree     = head;
+			if (head != none) blocks_[head].previousFree = index;
+			heads_[firstLevel][secondLevel] = index;
+
+			firstLevelMap_               |= 1ull << firstLevel;
+			secondLevelMaps_[firstLevel] |= 1u << secondLevel;
+			++freeBlockCount_;
+		}
+		void removeFree(const uint32_t index) {
+			Block& block = blocks_[index];
+
+			uint32_t firstLevel, secondLevel;
+			mapInsert(block.size, firstLevel, secondLevel);
+
+			if (block.previousFree != none) blocks_[block.previousFree].nextFree = block.nextFree;
+			else                            heads_[firstLevel][secondLevel]     = block.nextFree;
+			if (block.nextFree != none) blocks_[block.nextFree].previousFree = block.previousFree;
+
+			if (heads_[firstLevel][secondLevel] == none) {
+				secondLevelMaps_[firstLevel] &= ~(1u << secondLevel);
+				if (secondLevelMaps_[firstLevel] == 0) firstLevelMap_ &= ~(1ull << firstLevel);
+			}
+
+			block.isFree = false;
+			--freeBlockCount_;
+		}
+
+		uint32_t findFree(const uint64_t size) const {
+			uint32_t firstLevel, secondLevel;
+			mapSearch(size, firstLevel, secondLevel);
+			if (firstLevel >= firstLevelCount) return none;
+
+			uint32_t secondLevelMap = secondLevelMaps_[firstLevel] & (~0u << secondLevel);
+			if (secondLevelMap == 0) {
+				const uint64_t firstLevelMap = firstLevel + 1 < 64 ? firstLevelMap_ & (~0ull << (firstLevel + 1)) : 0;
+				if (firstLevelMap == 0) return none;
+
+				firstLevel     = static_cast<uint32_t>(std::countr_zero(firstLevelMap));
+				secondLevelMap = secondLevelMaps_[firstLevel];
+			}
+			return heads_[firstLevel][std::countr_zero(secondLevelMap)];
+		}
+
+		// Cuts size granules off the front of the block, the rest becomes a new block right after it
+		uint32_t split(const uint32_t index, const uint64_t size) {
+			const uint32_t rest = createBlock();
+
+			Block& block     = blocks_[index];
+			Block& remainder = blocks_[rest];
+			remainder.offset           = block.offset + size;
+			remainder.size             = block.size - size;
+			remainder.previousPhysical = index;
+			remainder.nextPhysical     = block.nextPhysical;
+			if (block.nextPhysical != none) blocks_[block.nextPhysical].previousPhysical = rest;
+
+			block.size         = size;
+			block.nextPhysical = rest;
+			return rest;
+		}
+
+		// Absorbs the next physical block, which is gone afterwards
+		void merge(const uint32_t index, const uint32_t next) {
+			Block& block     = blocks_[index];
+			Block& following = blocks_[next];
+
+			block.size         += following.size;
+			block.nextPhysical  = following.nextPhysical;
+			if (following.nextPhysical != none) blocks_[following.nextPhysical].previousPhysical = index;
+
+			destroyBlock(next);
+		}
+
+	public:
+		TlsfAllocator(const uint64_t capacity = 0, const uint64_t granularity = 1) {
+			reset(capacity, granularity);
+		}
+		TlsfAllocator(const TlsfAllocator&)     = default;
+		TlsfAllocator(TlsfAllocator&&) noexcept = default;
+
+		// Invalid when no free block can hold it, alignment is a power of two
+		TlsfAllocation allocate(const uint64_t size, const uint64_t alignment = 1) {
+			if (size == 0) return {};
+
+			const uint64_t granules          = (size + granularity_ - 1) >> granularityShift_;
+			const uint64_t alignmentGranules = std::max<uint64_t>(1, alignment >> granularityShift_);
+
+			// Room for the worst case padding in front, so the block found always works
+			const uint32_t index = findFree(granules + alignmentGranules - 1);
+			if (index == none) return {};
+
+			removeFree(index);
+
+			uint32_t       allocated = index;
+			const uint64_t aligned   = (blocks_[index].offset + alignmentGranules - 1) & ~(alignmentGranules - 1);
+			if (const uint64_t padding = aligned - blocks_[index].offset; padding > 0) {
+				// Blocks before a free one are in use, so the padding stays a free block of its own
+				allocated = split(index, padding);
+				insertFree(index);
+			}
+			if (blocks_[allocated].size > granules) insertFree(split(allocated, granules));
+
+			used_ += granules;
+			++allocationCount_;
+
+			return { blocks_[allocated].offset << granularityShift_, granules << granularityShift_, allocated };
+		}
+
+		void free(const TlsfAllocation& allocation) {
+			if (!allocation.isValid()) return;
+
+			uint32_t index = allocation.block;
+			used_ -= blocks_[index].size;
+			--allocationCount_;
+
+			const uint32_t next = blocks_[index].nextPhysical;
+			if (next != none && blocks_[next].isFree) {
+				removeFree(next);
+				merge(index, next);
+			}
+
+			const uint32_t previous = blocks_[index].previousPhysical;
+			if (previous != none && blocks_[previous].isFree) {
+				removeFree(previous);
+				merge(previous, index);
+				index = previous;
+			}
+
+			insertFree(index);
+		}
+
+		// Drops every allocation
+		void reset(const uint64_t capacity, const uint64_t granularity = 1) {
+			blocks_.clear();
+			unusedBlocks_.clear();
+			firstLevelMap_ = 0;
+			secondLevelMaps_.fill(0);
+			for (auto& heads : heads_) heads.fill(none);
+
+			granularity_      = std::bit_ceil(std::max<uint64_t>(1, granularity));
+			granularityShift_ = static_cast<uint32_t>(std::countr_zero(granularity_));
+			capacity_         = capacity >> granularityShift_;
+			used_             = 0;
+			allocationCount_  = 0;
+			freeBlockCount_   = 0;
+
+			if (capacity_) {
+				const uint32_t index = createBlock();
+				blocks_[index].offset = 0;
+				blocks_[index].size   = capacity_;
+				insertFree(index);
+			}
+		}
+
+		uint64_t getCapacity() const {
+			return capacity_ << granularityShift_;
+		}
+		uint64_t getUsed() const {
+			return used_ << granularityShift_;
+		}
+		uint64_t getGranularity() const {
+			return granularity_;
+		}
+
+		// Same report as OffsetAllocator, the largest free block is searched in the highest non-empty bin only
+		OffsetAllocatorStats getStats() const {
+			OffsetAllocatorStats stats;
+			stats.capacity        = getCapacity();
+			stats.used            = getUsed();
+			stats.allocationCount = allocationCount_;
+			stats.freeBlockCount  = freeBlockCount_;
+
+			if (firstLevelMap_) {
+				const uint32_t firstLevel  = 63 - std::countl_zero(firstLevelMap_);
+				const uint32_t secondLevel = 31 - std::countl_zero(secondLevelMaps_[firstLevel]);
+				for (uint32_t index = heads_[firstLevel][secondLevel]; index != none; index = blocks_[index].nextFree) {
+					stats.largestFreeBlock = std::max(stats.largestFreeBlock, blocks_[index].size << granularityShift_);
+				}
+			}
+			return stats;
+		}
+
+		TlsfAllocator& operator=(const TlsfAllocator&)     = default;
+		TlsfAllocator& operator=(TlsfAllocator&&) noexcept = default;
+	};
+}
\ No newline at end of file
@@ -1,4 +1,6 @@
 #pragma once
+#include <cmath>
+#include <algorithm>
 #include <DirectXMath.h>
 
 namespace spider_engine::rendering {
@@ -19,8 +21,96 @@ namespace spider_engine::rendering {
 			position(position), 
 			rotation(rotation) 
 		{}
+
+		DirectX::XMMATRIX toMatrix() const {
+			DirectX::XMMATRIX scaleMatrix       = DirectX::XMMatrixScalingFromVector(scale);
+			DirectX::XMMATRIX rotationMatrix    = DirectX::XMMatrixRotationQuaternion(rotation);
+			DirectX::XMMATRIX translationMatrix = DirectX::XMMatrixTranslationFromVector(position);
+
+			return scaleMatrix * rotationMatrix * translationMatrix;
+		}
+	};
+
+	struct BoundingVolume {
+		DirectX::XMFLOAT3 center;
+		DirectX::XMFLOAT3 extents;
+		float             radius;
+
+		BoundingVolume() :
+			center(0.0f, 0.0f, 0.0f),
+			extents(0.0f, 0.0f, 0.0f),
+			radius(0.0f)
+		{}
+
+		// Transform into another space, keeping the box axis-aligned
+		BoundingVolume transformed(DirectX::FXMMATRIX matrix) const {
+			DirectX::XMFLOAT4X4 m;
+			DirectX::XMStoreFloat4x4(&m, matrix);
+
+			BoundingVolume result;
+			DirectX::XMStoreFloat3(
+				&result.center,
+				DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&center), matrix)
+			);
+
+			const float e[3] = { extents.x, extents.y, extents.z };
+			float       r[3] = {};
+			for (int column = 0; column < 3; ++column) {
+				for (int row = 0; row < 3; ++row) {
+					r[column] += std::fabs(m.m[row][column]) * e[row];
+				}
+			}
+			result.extents = { r[0], r[1], r[2] };
+
+			// Scale the sphere by the largest axis scale
+			float maxScaleSq = 0.0f;
+			for (int row = 0; row < 3; ++row) {
+				const float scaleSq = m.m[row][0] * m.m[row][0] + m.m[row][1] * m.m[row][1] + m.m[row][2] * m.m[row][2];
+				maxScaleSq = std::max(maxScaleSq, scaleSq);
+			}
+			result.radius = radius * std::sqrt(maxScaleSq);
+
+			return result;
+		}
 	};
 
+	struct Vertex {
+		DirectX::XMFLOAT3 position;
+		DirectX::XMFLOAT3 normal;
+		DirectX::XMFLOAT2 uv;
+		DirectX::XMFLOAT3 tangent;
+	};
+
+	inline BoundingVolume computeBoundingVolume(const Vertex* verticesBegin,
+												const Vertex* verticesEnd)
+	{
+		BoundingVolume bounds;
+		if (verticesBegin == verticesEnd) return bounds;
+
+		// Axis-aligned box
+		DirectX::XMVECTOR min = DirectX::XMLoadFloat3(&verticesBegin->position);
+		DirectX::XMVECTOR max = min;
+		for (const Vertex* it = verticesBegin; it != verticesEnd; ++it) {
+			DirectX::XMVECTOR position = DirectX::XMLoadFloat3(&it->position);
+			min = DirectX::XMVectorMin(min, position);
+			max = DirectX::XMVectorMax(max, position);
+		}
+
+		DirectX::XMVECTOR center = DirectX::XMVectorScale(DirectX::XMVectorAdd(min, max), 0.5f);
+		DirectX::XMStoreFloat3(&bounds.center, center);
+		DirectX::XMStoreFloat3(&bounds.extents, DirectX::XMVectorScale(DirectX::XMVectorSubtract(max, min), 0.5f));
+
+		// Sphere around the box center, tighter than the box diagonal
+		float radiusSq = 0.0f;
+		for (const Vertex* it = verticesBegin; it != verticesEnd; ++it) {
+			DirectX::XMVECTOR offset = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&it->position), center);
+			radiusSq = std::max(radiusSq, DirectX::XMVectorGetX(DirectX::XMVector3LengthSq(offset)));
+		}
+		bounds.radius = std::sqrt(radiusSq);
+
+		return bounds;
+	}
+
 	struct alignas(16) FrameData {
 		DirectX::XMMATRIX projection;
 		DirectX::XMMATRIX view;
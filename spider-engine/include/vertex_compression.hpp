@@ -0,0 +1,207 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+#include "types.hpp"
+
+namespace spider_engine::rendering {
+	enum class VertexFormat : uint8_t {
+		FULL,  // 44 bytes, every attribute as 32-bit floats
+		PACKED // 20 bytes, see PackedVertex
+	};
+
+	// Input assembler formats:
+	//   position R16G16B16A16_UNORM, relative to the mesh box (see VertexQuantization)
+	//   normal   R16G16_SNORM, octahedral
+	//   uv       R16G16_FLOAT
+	//   tangent  R16G16_SNORM, octahedral
+	struct PackedVertex {
+		uint16_t position[4];
+		int16_t  normal[2];
+		uint16_t uv[2];
+		int16_t  tangent[2];
+	};
+	static_assert(sizeof(PackedVertex) == 20);
+
+	// Layout of the quantization cbuffer in packedVertexDecodeHlsl
+	struct alignas(16) QuantizationData {
+		DirectX::XMFLOAT4 offset;
+		DirectX::XMFLOAT4 scale;
+	};
+
+	// Dequantization constant, position = offset + unorm * scale
+	struct VertexQuantization {
+		DirectX::XMFLOAT3 offset = { 0.0f, 0.0f, 0.0f };
+		DirectX::XMFLOAT3 scale  = { 1.0f, 1.0f, 1.0f };
+
+		// Decoded in the vertex shader, folding it into the model matrix would scale normals unevenly
+		QuantizationData toShaderData() const {
+			return { { offset.x, offset.y, offset.z, 0.0f }, { scale.x, scale.y, scale.z, 0.0f } };
+		}
+
+		// Largest distance between a decoded position and its source, per axis
+		// (half a step of rounding plus float error, kept under one step)
+		DirectX::XMFLOAT3 getErrorBound() const {
+			return { scale.x / 65535.0f, scale.y / 65535.0f, scale.z / 65535.0f };
+		}
+	};
+
+	struct MeshMemoryStats {
+		size_t vertexBytes = 0;
+		size_t indexBytes  = 0;
+
+		size_t getTotalBytes() const {
+			return vertexBytes + indexBytes;
+		}
+	};
+
+	// HLSL side of the packed layout: the position dequantization constant, bound per draw by the renderer,
+	// and the octahedral decoding
+	inline constexpr const wchar_t* packedVertexDecodeHlsl = LR"(
+cbuffer quantization : register(b1)
+{
+    float4 quantizationOffset;
+    float4 quantizationScale;
+};
+
+float3 decodePosition(float3 unorm) {
+    return quantizationOffset.xyz + unorm * quantizationScale.xyz;
+}
+
+float3 decodeOctahedral(float2 e) {
+    float3 n = float3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+    float  t = saturate(-n.z);
+    n.xy    += lerp(t.xx, -t.xx, step(0.0, n.xy));
+    return normalize(n);
+}
+)";
+
+	inline int16_t encodeSnorm16(const float value) {
+		return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
+	inline float decodeSnorm16(const int16_t value) {
+		return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+	}
+
+	inline uint16_t encodeUnorm16(const float value) {
+		return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+	}
+	inline float decodeUnorm16(const uint16_t value) {
+		return static_cast<float>(value) / 65535.0f;
+	}
+
+	// Unit vector to the [-1, 1] square (Meyer et al. 2010), zero vectors map to +Z
+	inline DirectX::XMFLOAT2 encodeOctahedral(const DirectX::XMFLOAT3& n) {
+		const float length = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+		if (length == 0.0f) return { 0.0f, 0.0f };
+
+		float x = n.x / length;
+		float y = n.y / length;
+		if (n.z < 0.0f) {
+			const float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			const float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = fx;
+			y = fy;
+		}
+		return { x, y };
+	}
+	inline DirectX::XMFLOAT3 decodeOctahedral(const DirectX::XMFLOAT2& e) {
+		float x = e.x;
+		float y = e.y;
+		const float z = 1.0f - std::fabs(x) - std::fabs(y);
+		const float t = std::max(-z, 0.0f);
+		x += x >= 0.0f ? -t : t;
+		y += y >= 0.0f ? -t : t;
+
+		const float length = std::sqrt(x * x + y * y + z * z);
+		return { x / length, y / length, z / length };
+	}
+
+	template <typename VertexTy>
+	VertexQuantization computeVertexQuantization(const std::vector<VertexTy>& vertices) {
+		VertexQuantization quantization;
+		if (vertices.empty()) return quantization;
+
+		DirectX::XMFLOAT3 min = vertices.front().position;
+		DirectX::XMFLOAT3 max = min;
+		for (const VertexTy& vertex : vertices) {
+			min = { std::min(min.x, vertex.position.x), std::min(min.y, vertex.position.y), std::min(min.z, vertex.position.z) };
+			max = { std::max(max.x, vertex.position.x), std::max(max.y, vertex.position.y), std::max(max.z, vertex.position.z) };
+		}
+
+		// Flat axes still need a non-zero scale to divide by
+		quantization.offset = min;
+		quantization.scale  = {
+			max.x > min.x ? max.x - min.x : 1.0f,
+			max.y > min.y ? max.y - min.y : 1.0f,
+			max.z > min.z ? max.z - min.z : 1.0f
+		};
+		return quantization;
+	}
+
+	template <typename VertexTy>
+	PackedVertex packVertex(const VertexTy& vertex, const VertexQuantization& quantization) {
+		PackedVertex packed;
+		packed.position[0] = encodeUnorm16((vertex.position.x - quantization.offset.x) / quantization.scale.x);
+		packed.position[1] = encodeUnorm16((vertex.position.y - quantization.offset.y) / quantization.scale.y);
+		packed.position[2] = encodeUnorm16((vertex.position.z - quantization.offset.z) / quantization.scale.z);
+		packed.position[3] = 0;
+
+		const DirectX::XMFLOAT2 normal  = encodeOctahedral(vertex.normal);
+		const DirectX::XMFLOAT2 tangent = encodeOctahedral(vertex.tangent);
+		packed.normal[0]  = encodeSnorm16(normal.x);
+		packed.normal[1]  = encodeSnorm16(normal.y);
+		packed.tangent[0] = encodeSnorm16(tangent.x);
+		packed.tangent[1] = encodeSnorm16(tangent.y);
+
+		packed.uv[0] = DirectX::PackedVector::XMConvertFloatToHalf(vertex.uv.x);
+		packed.uv[1] = DirectX::PackedVector::XMConvertFloatToHalf(vertex.uv.y);
+
+		return packed;
+	}
+
+	// CPU mirror of what the input assembler and vertex shader reconstruct
+	template <typename VertexTy>
+	VertexTy unpackVertex(const PackedVertex& packed, const VertexQuantization& quantization) {
+		VertexTy vertex {};
+		vertex.position = {
+			quantization.offset.x + decodeUnorm16(packed.position[0]) * quantization.scale.x,
+			quantization.offset.y + decodeUnorm16(packed.position[1]) * quantization.scale.y,
+			quantization.offset.z + decodeUnorm16(packed.position[2]) * quantization.scale.z
+		};
+		vertex.normal  = decodeOctahedral({ decodeSnorm16(packed.normal[0]), decodeSnorm16(packed.normal[1]) });
+		vertex.tangent = decodeOctahedral({ decodeSnorm16(packed.tangent[0]), decodeSnorm16(packed.tangent[1]) });
+		vertex.uv      = {
+			DirectX::PackedVector::XMConvertHalfToFloat(packed.uv[0]),
+			DirectX::PackedVector::XMConvertHalfToFloat(packed.uv[1])
+		};
+		return vertex;
+	}
+
+	template <typename VertexTy>
+	std::vector<PackedVertex> packVertices(const std::vector<VertexTy>& vertices, VertexQuantization& quantization) {
+		quantization = computeVertexQuantization(vertices);
+
+		std::vector<PackedVertex> packed(vertices.size());
+		std::transform(vertices.begin(), vertices.end(), packed.begin(), [&quantization](const VertexTy& vertex) {
+			return packVertex(vertex, quantization);
+		});
+		return packed;
+	}
+
+	// 16-bit indices are only possible while every vertex is addressable
+	inline bool canUse16BitIndices(const size_t vertexCount) {
+		return vertexCount <= 0xffff;
+	}
+	inline std::vector<uint16_t> packIndices(const std::vector<uint32_t>& indices) {
+		std::vector<uint16_t> packed(indices.size());
+		std::transform(indices.begin(), indices.end(), packed.begin(), [](uint32_t index) {
+			return static_cast<uint16_t>(index);
+		});
+		return packed;
+	}
+}
\ No newline at end of file
@@ -7,8 +7,13 @@
 #include <memory>
 
 #include "definitions.hpp"
+#include "input.hpp"
+
+inline LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
+	// Input is queued and still goes through DefWindowProc, which needs WM_INPUT and system keys too
+	auto* input = reinterpret_cast<spider_engine::InputSystem*>(GetWindowLongPtrW(hwnd, GWLP_USERDATA));
+	if (input) input->handleMessage(uMsg, wParam, lParam);
 
-LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
 	switch (uMsg) {
 	case WM_DESTROY:
 		PostQuitMessage(0);
@@ -154,6 +159,12 @@ namespace spider_engine::core_engine {
 			windowClassName_ = className;
 		}
 
+		// Messages of the window feed the input system from now on, nullptr stops them
+		void setInput(InputSystem* input) {
+			SetWindowLongPtrW(hwnd_, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(input));
+			if (input) InputSystem::registerRawInput(hwnd_);
+		}
+
 		uint_t getWidth() const {
 			return width_;
 		}
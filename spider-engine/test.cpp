@@ -112,11 +112,11 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
     camera.transform.position = DirectX::XMVectorSet(0.0f, 0.0f, -20.0f, 1.0f);
 
     auto updateLoop = [&]() {
-        if (isButtonDown(VK_F11)) {
+        if (coreEngine.getInput().wasKeyPressed(VK_F11)) {
             //renderer.setFullScreen(!renderer.isFullScreen());
         }
 
-        if (isButtonDown(VK_F11)) {
+        if (coreEngine.getInput().wasKeyPressed(VK_F11)) {
             camera.transform.position = DirectX::XMVectorSubtract(
                 camera.transform.position,
                 DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, 1.0f)
@@ -124,7 +124,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
 
             DirectX::XMFLOAT3 c;
             DirectX::XMStoreFloat3(&c, camera.transform.position);
-            std::cout << "Camera x: " << c.x << "y: " << c.y << "z" << c.z << std::endl;
+            SPIDER_LOG_INFO("Camera x: {} y: {} z: {}", c.x, c.y, c.z);
         }
 
         camera.updateViewMatrix();